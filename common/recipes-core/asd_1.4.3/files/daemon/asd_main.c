@@ -364,6 +364,43 @@ STATUS send_out_msg_on_socket(void* state, unsigned char* buffer, size_t length)
     return result;
 }
 
+STATUS send_out_msgv_on_socket(void* state, const struct iovec* iov,
+                               int iovcnt)
+{
+    extnet_conn_t authd_conn;
+    size_t length = 0;
+    int cnt = 0;
+    STATUS result = ST_ERR;
+
+    if (state && iov)
+    {
+        result = ST_OK;
+        if (session_get_authenticated_conn(((asd_state*)state)->session,
+                                           &authd_conn) != ST_OK)
+        {
+            result = ST_ERR;
+        }
+
+        if (result == ST_OK)
+        {
+            for (int i = 0; i < iovcnt; i++)
+                length += iov[i].iov_len;
+
+            cnt = extnet_sendv(((asd_state*)state)->extnet, &authd_conn, iov,
+                               iovcnt);
+            if (cnt != length)
+            {
+                ASD_log(ASD_LogLevel_Error, ASD_LogStream_Daemon,
+                        ASD_LogOption_No_Remote,
+                        "Failed to write to the socket: %d", cnt);
+                result = ST_ERR;
+            }
+        }
+    }
+
+    return result;
+}
+
 STATUS request_processing_loop(asd_state* state)
 {
     STATUS result = ST_OK;
@@ -757,6 +794,7 @@ STATUS on_client_connect(asd_state* state, extnet_conn_t* p_extcon)
                     ASD_LogOption_None, "Failed to create asd_msg.");
             result = ST_ERR;
         }
+        state->asd_msg->sendv_function = &send_out_msgv_on_socket;
         // Provide params to each handler
         state->asd_msg->jtag_handler->fru = state->args.fru;
         state->asd_msg->jtag_handler->msg_flow = state->args.msg_flow;
@@ -103,6 +103,8 @@ void showUsage(char** argv);
 STATUS init_asd_state(asd_state* state);
 STATUS send_out_msg_on_socket(void* state, unsigned char* buffer,
                               size_t length);
+STATUS send_out_msgv_on_socket(void* state, const struct iovec* iov,
+                               int iovcnt);
 void deinit_asd_state(asd_state* state);
 STATUS on_client_disconnect(asd_state* state);
 STATUS on_client_connect(asd_state* state, extnet_conn_t* p_extcon);
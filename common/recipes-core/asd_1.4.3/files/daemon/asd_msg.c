@@ -174,6 +174,7 @@ ASD_MSG* asd_msg_init(SendFunctionPtr send_function,
             else
             {
                 state->send_function = send_function;
+                state->sendv_function = NULL;
                 state->read_function = read_function;
                 state->asd_cfg = asd_cfg;
                 state->handlers_initialized = false;
@@ -790,6 +791,21 @@ STATUS process_jtag_message(ASD_MSG* state, struct asd_message* s_message)
             cmd = *data_ptr;
         }
 
+        // Scans and wait cycles are queued in the JTAG handler so runs of
+        // them reach the driver together; every other command has to see
+        // their effect on the target first.
+        if (cmd < WRITE_SCAN_MIN && cmd != WAIT_CYCLES_TCK_DISABLE &&
+            cmd != WAIT_CYCLES_TCK_ENABLE)
+        {
+            status = JTAG_flush(state->jtag_handler);
+            if (status != ST_OK)
+            {
+                ASD_log(ASD_LogLevel_Error, ASD_LogStream_SDK,
+                        ASD_LogOption_None, "JTAG_flush failed, %d", status);
+                break;
+            }
+        }
+
         if (cmd == WRITE_EVENT_CONFIG)
         {
             data_ptr = get_packet_data(&packet, 1);
@@ -991,7 +1007,8 @@ STATUS process_jtag_message(ASD_MSG* state, struct asd_message* s_message)
             unsigned int number_of_cycles = *data_ptr;
             if (number_of_cycles == 0)
                 number_of_cycles = 256;
-            status = JTAG_wait_cycles(state->jtag_handler, number_of_cycles);
+            status = JTAG_wait_cycles_queue(state->jtag_handler,
+                                            number_of_cycles);
             if (status != ST_OK)
             {
                 ASD_log(ASD_LogLevel_Error, ASD_LogStream_SDK,
@@ -1100,8 +1117,9 @@ STATUS process_jtag_message(ASD_MSG* state, struct asd_message* s_message)
                         "determine_shift_end_state failed, %d", status);
                 break;
             }
-            status = JTAG_shift(state->jtag_handler, num_of_bits, num_of_bytes,
-                                data_ptr, 0, NULL, end_state);
+            status = JTAG_shift_queue(state->jtag_handler, num_of_bits,
+                                      num_of_bytes, data_ptr, 0, NULL,
+                                      end_state);
             if (status != ST_OK)
             {
                 ASD_log(ASD_LogLevel_Error, ASD_LogStream_SDK,
@@ -1134,7 +1152,7 @@ STATUS process_jtag_message(ASD_MSG* state, struct asd_message* s_message)
                         "determine_shift_end_state failed, %d", status);
                 break;
             }
-            status = JTAG_shift(
+            status = JTAG_shift_queue(
                 state->jtag_handler, num_of_bits, 0, NULL, num_of_bytes,
                 &(state->out_msg.buffer[response_cnt]), end_state);
             if (status != ST_OK)
@@ -1178,10 +1196,10 @@ STATUS process_jtag_message(ASD_MSG* state, struct asd_message* s_message)
                         "determine_shift_end_state failed, %d", status);
                 break;
             }
-            status =
-                JTAG_shift(state->jtag_handler, num_of_bits, num_of_bytes,
-                           data_ptr, num_of_bytes,
-                           &(state->out_msg.buffer[response_cnt]), end_state);
+            status = JTAG_shift_queue(
+                state->jtag_handler, num_of_bits, num_of_bytes, data_ptr,
+                num_of_bytes, &(state->out_msg.buffer[response_cnt]),
+                end_state);
             if (status != ST_OK)
             {
                 ASD_log(ASD_LogLevel_Error, ASD_LogStream_SDK,
@@ -1200,6 +1218,15 @@ STATUS process_jtag_message(ASD_MSG* state, struct asd_message* s_message)
         }
     }
 
+    // Read scans complete, and fill the response, only once flushed. Scans
+    // queued before a failure are still issued, as they were before.
+    if (JTAG_flush(state->jtag_handler) != ST_OK && status == ST_OK)
+    {
+        ASD_log(ASD_LogLevel_Error, ASD_LogStream_SDK, ASD_LogOption_None,
+                "JTAG_flush failed");
+        status = ST_ERR;
+    }
+
     if (status == ST_OK)
     {
         if (memcpy_safe(&state->out_msg.header, sizeof(struct message_header),
@@ -1725,6 +1752,19 @@ STATUS send_response(ASD_MSG* state, struct asd_message* message)
                    "NetRsp");
 #endif
 
+    // Header and payload go out in one writev, skipping the copy into
+    // send_buffer, when the transport supports it.
+    if (state->sendv_function)
+    {
+        struct iovec iov[2];
+        iov[0].iov_base = &message->header;
+        iov[0].iov_len = sizeof(message->header);
+        iov[1].iov_base = message->buffer;
+        iov[1].iov_len = (size_t)size;
+        return state->sendv_function(state->callback_state, iov,
+                                     size ? 2 : 1);
+    }
+
     send_buffer_size = sizeof(struct message_header) + size;
 
     if (memcpy_safe(&send_buffer, MAX_PACKET_SIZE,
@@ -31,6 +31,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "config.h"
 
 #include <poll.h>
+#include <sys/uio.h>
 
 #include "asd_common.h"
 #include "i2c_handler.h"
@@ -52,6 +53,8 @@ static char asd_version[] = "ASD_BMC_v1.4.3";
 
 typedef STATUS (*SendFunctionPtr)(void* state, unsigned char* buffer,
                                   size_t length);
+typedef STATUS (*SendVFunctionPtr)(void* state, const struct iovec* iov,
+                                   int iovcnt);
 typedef STATUS (*ReadFunctionPtr)(void* state, void* connection, void* buffer,
                                   size_t* num_to_read, bool* data_pending);
 
@@ -73,6 +76,7 @@ typedef struct incoming_msg
 typedef struct ASD_MSG
 {
     SendFunctionPtr send_function;
+    SendVFunctionPtr sendv_function;
     ReadFunctionPtr read_function;
     config* asd_cfg;
     struct incoming_msg in_msg;
@@ -392,3 +392,43 @@ int extnet_send(ExtNet* state, extnet_conn_t* pconn, void* pv_buf,
     }
     return n_ret;
 }
+
+/** @brief Write a gathered buffer to external network connection
+ *
+ *  Handlers without a vectored send get one send per element.
+ *
+ *  @param [in] pconn Connetion pointer
+ *  @param [in] iov Buffers to send, in order.
+ *  @param [in] iovcnt Number of elements in iov
+ *  @return number of bytes sent.
+ */
+int extnet_sendv(ExtNet* state, extnet_conn_t* pconn, const struct iovec* iov,
+                 int iovcnt)
+{
+    int n_ret = -1;
+    int n_wr;
+
+    if (state && state->p_hdlrs && pconn && iov)
+    {
+        if (state->p_hdlrs->sendv)
+        {
+            n_ret = state->p_hdlrs->sendv(pconn, iov, iovcnt);
+        }
+        else if (state->p_hdlrs->send)
+        {
+            n_ret = 0;
+            for (int i = 0; i < iovcnt; i++)
+            {
+                n_wr = state->p_hdlrs->send(pconn, iov[i].iov_base,
+                                            iov[i].iov_len);
+                if (n_wr != (int)iov[i].iov_len)
+                {
+                    n_ret = (n_wr < 0) ? n_wr : n_ret + n_wr;
+                    break;
+                }
+                n_ret += n_wr;
+            }
+        }
+    }
+    return n_ret;
+}
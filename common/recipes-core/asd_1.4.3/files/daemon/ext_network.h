@@ -35,6 +35,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <sys/uio.h>
 
 #include "asd_common.h"
 
@@ -64,6 +65,7 @@ typedef struct
                 bool* b_data_pending);
     int (*send)(extnet_conn_t* pconn, void* pv_buf, size_t sz_len);
     void (*cleanup)(void);
+    int (*sendv)(extnet_conn_t* pconn, const struct iovec* iov, int iovcnt);
 } extnet_hdlrs_t;
 
 typedef struct ExtNet
@@ -85,5 +87,7 @@ int extnet_recv(ExtNet* state, extnet_conn_t* pconn, void* pv_buf,
                 size_t sz_len, bool* b_data_pending);
 int extnet_send(ExtNet* state, extnet_conn_t* pconn, void* pv_buf,
                 size_t sz_len);
+int extnet_sendv(ExtNet* state, extnet_conn_t* pconn, const struct iovec* iov,
+                 int iovcnt);
 
 #endif // __EXT_NETWORK_H_
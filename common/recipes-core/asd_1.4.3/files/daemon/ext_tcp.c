@@ -35,13 +35,14 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <netinet/tcp.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <sys/uio.h>
 
 #include "asd_common.h"
 #include "logging.h"
 
 extnet_hdlrs_t tcp_hdlrs = {
     exttcp_init, exttcp_on_accept, exttcp_on_close_client, exttcp_init_client,
-    exttcp_recv, exttcp_send,      exttcp_cleanup,
+    exttcp_recv, exttcp_send,      exttcp_cleanup,   exttcp_sendv,
 };
 
 /** @brief Initialize TCP
@@ -175,3 +176,35 @@ int exttcp_send(extnet_conn_t* pconn, void* pv_buf, size_t sz_len)
     }
     return n_wr;
 }
+
+/** @brief Write gathered data to external network connection
+ *
+ *  Sends header and payload with a single writev instead of copying
+ *  them into one buffer first.
+ *
+ *  @param [in] pconn Connetion pointer
+ *  @param [in] iov Buffers to send, in order.
+ *  @param [in] iovcnt Number of elements in iov
+ *  @return number of bytes sent.
+ */
+int exttcp_sendv(extnet_conn_t* pconn, const struct iovec* iov, int iovcnt)
+{
+    int n_wr = -1;
+
+    if (!pconn || !iov)
+    {
+        ASD_log(ASD_LogLevel_Error, ASD_LogStream_Network, ASD_LogOption_None,
+                "%s called with invalid pointer", __FUNCTION__);
+    }
+    else if (pconn->sockfd < 0)
+    {
+        ASD_log(ASD_LogLevel_Error, ASD_LogStream_Network, ASD_LogOption_None,
+                "%s called with invalid file descriptor %d", __FUNCTION__,
+                pconn->sockfd);
+    }
+    else
+    {
+        n_wr = (int)writev(pconn->sockfd, iov, iovcnt);
+    }
+    return n_wr;
+}
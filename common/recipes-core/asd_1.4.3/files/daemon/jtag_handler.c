@@ -35,6 +35,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <sys/ioctl.h>
 #include <unistd.h>
 
+#include "jtag_sim.h"
 #include "logging.h"
 #include "mem_helper.h"
 
@@ -53,6 +54,20 @@ STATUS perform_shift(JTAG_Handler* state, unsigned int number_of_bits,
                      enum jtag_states current_tap_state,
                      enum jtag_states end_tap_state);
 
+static int jtag_ioctl(JTAG_Handler* state, unsigned long request, void* arg)
+{
+    if (state->sim != NULL)
+        return JTAG_sim_ioctl(state->sim, request, arg);
+    return ioctl(state->JTAG_driver_handle, request, arg);
+}
+
+static void reset_batch(JTAG_Handler* state)
+{
+    state->batch.bits = 0;
+    state->batch.num_outputs = 0;
+    state->batch.wait_cycles = 0;
+}
+
 void initialize_jtag_chains(JTAG_Handler* state)
 {
     for (int i = 0; i < MAX_SCAN_CHAINS; i++)
@@ -80,6 +95,8 @@ JTAG_Handler* JTAGHandler()
     memset(state->padDataOne, ~0, sizeof(state->padDataOne));
     memset(state->padDataZero, 0, sizeof(state->padDataZero));
     state->JTAG_driver_handle = -1;
+    state->sim = NULL;
+    reset_batch(state);
 
     for (unsigned int i = 0; i < MAX_WAIT_CYCLES; i++)
     {
@@ -126,22 +143,26 @@ STATUS JTAG_initialize(JTAG_Handler* state, bool sw_mode)
     ASD_log(ASD_LogLevel_Info, stream, option, "JTAG mode set to '%s'.",
             state->sw_mode ? "software" : "hardware");
 
+    reset_batch(state);
+    if (state->sim == NULL)
+    {
 #ifdef JTAG_LEGACY_DRIVER
-    state->JTAG_driver_handle = open("/dev/jtag", O_RDWR);
+        state->JTAG_driver_handle = open("/dev/jtag", O_RDWR);
 #else
-    state->JTAG_driver_handle = open("/dev/jtag0", O_RDWR);
+        state->JTAG_driver_handle = open("/dev/jtag0", O_RDWR);
 #endif
-    if (state->JTAG_driver_handle == -1)
-    {
-        ASD_log(ASD_LogLevel_Error, stream, option,
-                "Can't open /dev/jtag, please install driver");
-        return ST_ERR;
+        if (state->JTAG_driver_handle == -1)
+        {
+            ASD_log(ASD_LogLevel_Error, stream, option,
+                    "Can't open /dev/jtag, please install driver");
+            return ST_ERR;
+        }
     }
 
 #ifndef JTAG_LEGACY_DRIVER
     jtag_mode.feature = JTAG_XFER_MODE;
     jtag_mode.mode = sw_mode ? JTAG_XFER_SW_MODE : JTAG_XFER_HW_MODE;
-    if (ioctl(state->JTAG_driver_handle, JTAG_SIOCMODE, &jtag_mode))
+    if (jtag_ioctl(state, JTAG_SIOCMODE, &jtag_mode))
     {
         ASD_log(ASD_LogLevel_Error, stream, option,
                 "Failed JTAG_SIOCMODE to set xfer mode");
@@ -169,6 +190,7 @@ STATUS JTAG_deinitialize(JTAG_Handler* state)
     if (state == NULL)
         return ST_ERR;
 
+    reset_batch(state);
     close(state->JTAG_driver_handle);
     state->JTAG_driver_handle = -1;
 
@@ -181,6 +203,10 @@ STATUS JTAG_set_padding(JTAG_Handler* state, const JTAGPaddingTypes padding,
     if (state == NULL)
         return ST_ERR;
 
+    // queued scans were issued under the old padding
+    if (JTAG_flush(state) != ST_OK)
+        return ST_ERR;
+
     if ((padding == JTAGPaddingTypes_DRPre ||
          padding == JTAGPaddingTypes_DRPost) &&
         value > DRMAXPADSIZE)
@@ -237,6 +263,8 @@ STATUS JTAG_set_tap_state(JTAG_Handler* state, enum jtag_states tap_state)
 {
     if (state == NULL)
         return ST_ERR;
+    if (JTAG_flush(state) != ST_OK)
+        return ST_ERR;
 #ifdef JTAG_LEGACY_DRIVER
     struct tap_state_param params;
     params.mode = state->sw_mode ? SW_MODE : HW_MODE;
@@ -251,9 +279,9 @@ STATUS JTAG_set_tap_state(JTAG_Handler* state, enum jtag_states tap_state)
 #endif
 
 #ifdef JTAG_LEGACY_DRIVER
-    if (ioctl(state->JTAG_driver_handle, AST_JTAG_SET_TAPSTATE, &params)
+    if (jtag_ioctl(state, AST_JTAG_SET_TAPSTATE, &params)
 #else
-    if (ioctl(state->JTAG_driver_handle, JTAG_SIOCSTATE, &tap_state_t)
+    if (jtag_ioctl(state, JTAG_SIOCSTATE, &tap_state_t)
 #endif
         < 0)
     {
@@ -382,8 +410,7 @@ STATUS perform_shift(JTAG_Handler* state, unsigned int number_of_bits,
     scan_xfer.tdo = output;
     scan_xfer.end_tap_state = end_tap_state;
 
-    if (ioctl(state->JTAG_driver_handle, AST_JTAG_READWRITESCAN, &scan_xfer) <
-        0)
+    if (jtag_ioctl(state, AST_JTAG_READWRITESCAN, &scan_xfer) < 0)
     {
         ASD_log(ASD_LogLevel_Error, stream, option,
                 "ioctl AST_JTAG_READWRITESCAN failed.");
@@ -419,7 +446,7 @@ STATUS perform_shift(JTAG_Handler* state, unsigned int number_of_bits,
         }
         xfer.tdio = (__u64)(uintptr_t)tdio;
     }
-    if (ioctl(state->JTAG_driver_handle, JTAG_IOCXFER, &xfer) < 0)
+    if (jtag_ioctl(state, JTAG_IOCXFER, &xfer) < 0)
     {
         ASD_log(ASD_LogLevel_Error, stream, option,
                 "ioctl JTAG_IOCXFER failed");
@@ -473,30 +500,220 @@ STATUS JTAG_wait_cycles(JTAG_Handler* state, unsigned int number_of_cycles)
 
     if (state->sw_mode)
     {
+#ifdef JTAG_BITBANG_PACKET
+        // drivers taking a bitbang_packet clock the whole array at once
+        struct bitbang_packet packet;
+        packet.data = state->bitbang_data;
+        packet.length = number_of_cycles;
+        if (jtag_ioctl(state, JTAG_IOCBITBANG, &packet) < 0)
+        {
+            ASD_log(ASD_LogLevel_Error, stream, option,
+                    "ioctl JTAG_IOCBITBANG failed");
+            return ST_ERR;
+        }
+#else
         for (unsigned int i = 0; i < number_of_cycles; i++)
         {
-            if (ioctl(state->JTAG_driver_handle, JTAG_IOCBITBANG, &state->bitbang_data[i]) < 0)
+            if (jtag_ioctl(state, JTAG_IOCBITBANG, &state->bitbang_data[i]) < 0)
             {
                 ASD_log(ASD_LogLevel_Error, stream, option,
                         "ioctl JTAG_IOCBITBANG failed");
                 return ST_ERR;
             }
         }
+#endif
     }
 #endif
     return ST_OK;
 }
 
+//
+// Copy a run of bits between LSB-first buffers, using memcpy when both
+// sides are byte aligned, which is the common case for ASD scan chunks.
+//
+static void copy_bits(unsigned char* dst, unsigned int dst_offset,
+                      const unsigned char* src, unsigned int src_offset,
+                      unsigned int bits)
+{
+    unsigned int i = 0;
+
+    if ((dst_offset % BITS_PER_BYTE) == 0 && (src_offset % BITS_PER_BYTE) == 0)
+    {
+        i = bits - (bits % BITS_PER_BYTE);
+        if (src != NULL)
+            memcpy(&dst[dst_offset / BITS_PER_BYTE],
+                   &src[src_offset / BITS_PER_BYTE], i / BITS_PER_BYTE);
+        else
+            memset(&dst[dst_offset / BITS_PER_BYTE], 0, i / BITS_PER_BYTE);
+    }
+
+    for (; i < bits; i++)
+    {
+        unsigned int s = src_offset + i;
+        unsigned int d = dst_offset + i;
+        unsigned char mask = (unsigned char)(1 << (d % BITS_PER_BYTE));
+
+        if (src != NULL && (src[s / BITS_PER_BYTE] >> (s % BITS_PER_BYTE)) & 1)
+            dst[d / BITS_PER_BYTE] |= mask;
+        else
+            dst[d / BITS_PER_BYTE] &= (unsigned char)~mask;
+    }
+}
+
+static STATUS flush_shift(JTAG_Handler* state, enum jtag_states end_tap_state)
+{
+    JTAG_Batch* batch = &state->batch;
+    unsigned int bytes = DIV_ROUND_UP(batch->bits, BITS_PER_BYTE);
+    STATUS status;
+
+    if (batch->bits == 0)
+        return ST_OK;
+
+    if (batch->num_outputs)
+        status = JTAG_shift(state, batch->bits, bytes, batch->tdi, bytes,
+                            batch->tdo, end_tap_state);
+    else
+        status = JTAG_shift(state, batch->bits, bytes, batch->tdi, 0, NULL,
+                            end_tap_state);
+
+    for (unsigned int i = 0; status == ST_OK && i < batch->num_outputs; i++)
+    {
+        JTAG_Shift_Output* out = &batch->outputs[i];
+        copy_bits(out->buffer, 0, batch->tdo, out->offset, out->bits);
+    }
+
+    batch->bits = 0;
+    batch->num_outputs = 0;
+    return status;
+}
+
+static STATUS flush_wait_cycles(JTAG_Handler* state)
+{
+    unsigned int cycles;
+
+    while (state->batch.wait_cycles)
+    {
+        cycles = state->batch.wait_cycles;
+        if (cycles > MAX_WAIT_CYCLES)
+            cycles = MAX_WAIT_CYCLES;
+        state->batch.wait_cycles -= cycles;
+        if (JTAG_wait_cycles(state, cycles) != ST_OK)
+        {
+            state->batch.wait_cycles = 0;
+            return ST_ERR;
+        }
+    }
+    return ST_OK;
+}
+
+//
+// Queue a shift. Scans ending in the shift state they started from are
+// held back and merged with the following ones; the batch is sent to the
+// driver as a single JTAG_shift once a scan leaves the shift state, the
+// batch is full, or JTAG_flush is called.
+//
+// Output buffers must stay valid until the batch has been flushed.
+//
+STATUS JTAG_shift_queue(JTAG_Handler* state, unsigned int number_of_bits,
+                        unsigned int input_bytes, unsigned char* input,
+                        unsigned int output_bytes, unsigned char* output,
+                        enum jtag_states end_tap_state)
+{
+    JTAG_Batch* batch;
+    enum jtag_states current_state;
+
+    if (state == NULL || number_of_bits > JTAG_BATCH_MAX_BITS)
+        return ST_ERR;
+
+    batch = &state->batch;
+    if (flush_wait_cycles(state) != ST_OK)
+        return ST_ERR;
+
+    JTAG_get_tap_state(state, &current_state);
+    if (current_state != jtag_shf_ir && current_state != jtag_shf_dr)
+    {
+        ASD_log(ASD_LogLevel_Error, stream, option,
+                "Shift called but the tap is not in a ShiftIR/DR tap state");
+        return ST_ERR;
+    }
+
+    if (output != NULL &&
+        output_bytes < DIV_ROUND_UP(number_of_bits, BITS_PER_BYTE))
+        return ST_ERR;
+    if (input != NULL &&
+        input_bytes < DIV_ROUND_UP(number_of_bits, BITS_PER_BYTE))
+        return ST_ERR;
+
+    if (batch->bits + number_of_bits > JTAG_BATCH_MAX_BITS ||
+        (output != NULL && batch->num_outputs == JTAG_BATCH_MAX_OUTPUTS))
+    {
+        if (flush_shift(state, current_state) != ST_OK)
+            return ST_ERR;
+    }
+
+    copy_bits(batch->tdi, batch->bits, input, 0, number_of_bits);
+    if (output != NULL)
+    {
+        batch->outputs[batch->num_outputs].buffer = output;
+        batch->outputs[batch->num_outputs].offset = batch->bits;
+        batch->outputs[batch->num_outputs].bits = number_of_bits;
+        batch->num_outputs++;
+    }
+    batch->bits += number_of_bits;
+
+    if (end_tap_state != current_state)
+        return flush_shift(state, end_tap_state);
+    return ST_OK;
+}
+
+//
+// Queue idle cycles. Consecutive waits are merged and issued together
+// before the next shift or state change.
+//
+STATUS JTAG_wait_cycles_queue(JTAG_Handler* state,
+                              unsigned int number_of_cycles)
+{
+    enum jtag_states current_state;
+
+    if (state == NULL)
+        return ST_ERR;
+
+    JTAG_get_tap_state(state, &current_state);
+    if (flush_shift(state, current_state) != ST_OK)
+        return ST_ERR;
+
+    state->batch.wait_cycles += number_of_cycles;
+    return ST_OK;
+}
+
+//
+// Issue everything queued, leaving the TAP in its current state.
+//
+STATUS JTAG_flush(JTAG_Handler* state)
+{
+    enum jtag_states current_state;
+
+    if (state == NULL)
+        return ST_ERR;
+
+    JTAG_get_tap_state(state, &current_state);
+    if (flush_shift(state, current_state) != ST_OK)
+        return ST_ERR;
+    return flush_wait_cycles(state);
+}
+
 STATUS JTAG_set_jtag_tck(JTAG_Handler* state, unsigned int tck)
 {
     if (state == NULL)
         return ST_ERR;
+    if (JTAG_flush(state) != ST_OK)
+        return ST_ERR;
 #ifdef JTAG_LEGACY_DRIVER
     struct set_tck_param params;
     params.mode = state->sw_mode ? SW_MODE : HW_MODE;
     params.tck = tck;
 
-    if (ioctl(state->JTAG_driver_handle, AST_JTAG_SET_TCK, &params) < 0)
+    if (jtag_ioctl(state, AST_JTAG_SET_TCK, &params) < 0)
     {
         ASD_log(ASD_LogLevel_Error, stream, option,
                 "ioctl AST_JTAG_SET_TCK failed");
@@ -505,7 +722,7 @@ STATUS JTAG_set_jtag_tck(JTAG_Handler* state, unsigned int tck)
 #else
     unsigned int frq = APB_FREQ / tck;
 
-    if (ioctl(state->JTAG_driver_handle, JTAG_SIOCFREQ, &frq) < 0)
+    if (jtag_ioctl(state, JTAG_SIOCFREQ, &frq) < 0)
     {
         ASD_log(ASD_LogLevel_Error, stream, option,
                 "ioctl JTAG_SIOCFREQ failed");
@@ -526,6 +743,9 @@ STATUS JTAG_set_active_chain(JTAG_Handler* state, scanChain chain)
         return ST_ERR;
     }
 
+    if (JTAG_flush(state) != ST_OK)
+        return ST_ERR;
+
     state->active_chain = &state->chains[chain];
 
     return ST_OK;
@@ -75,6 +75,8 @@ typedef unsigned long long __u64;
 #endif
 
 #define DRMAXPADSIZE 250
+#define JTAG_BATCH_MAX_BITS (MAX_DATA_SIZE * BITS_PER_BYTE)
+#define JTAG_BATCH_MAX_OUTPUTS 256
 #define IRMAXPADSIZE 2000
 #define DIV_ROUND_UP(n, d) (((n) + (d)-1) / (d))
 #define BITS_PER_BYTE 8
@@ -115,6 +117,28 @@ typedef struct JTAG_Chain_State
     JTAGScanState scan_state;
 } JTAG_Chain_State;
 
+// Scans that stay in the same ShiftIR/ShiftDR state are accumulated here
+// and sent to the driver as one transfer. Outputs record where each
+// queued scan wants its slice of TDO copied once the transfer completes.
+typedef struct JTAG_Shift_Output
+{
+    unsigned char* buffer;
+    unsigned int offset;
+    unsigned int bits;
+} JTAG_Shift_Output;
+
+typedef struct JTAG_Batch
+{
+    unsigned int bits;
+    unsigned int num_outputs;
+    unsigned int wait_cycles;
+    unsigned char tdi[MAX_DATA_SIZE];
+    unsigned char tdo[MAX_DATA_SIZE];
+    JTAG_Shift_Output outputs[JTAG_BATCH_MAX_OUTPUTS];
+} JTAG_Batch;
+
+struct JTAG_Sim;
+
 typedef struct JTAG_Handler
 {
     JTAG_Chain_State chains[MAX_SCAN_CHAINS];
@@ -122,6 +146,8 @@ typedef struct JTAG_Handler
     unsigned char padDataOne[IRMAXPADSIZE / 8];
     unsigned char padDataZero[IRMAXPADSIZE / 8];
     struct tck_bitbang bitbang_data[MAX_WAIT_CYCLES];
+    JTAG_Batch batch;
+    struct JTAG_Sim* sim;
     int JTAG_driver_handle;
     bool sw_mode;
     bool force_jtag_hw;
@@ -144,6 +170,13 @@ STATUS JTAG_shift(JTAG_Handler* state, unsigned int number_of_bits,
                   unsigned int output_bytes, unsigned char* output,
                   enum jtag_states end_tap_state);
 STATUS JTAG_wait_cycles(JTAG_Handler* state, unsigned int number_of_cycles);
+STATUS JTAG_shift_queue(JTAG_Handler* state, unsigned int number_of_bits,
+                        unsigned int input_bytes, unsigned char* input,
+                        unsigned int output_bytes, unsigned char* output,
+                        enum jtag_states end_tap_state);
+STATUS JTAG_wait_cycles_queue(JTAG_Handler* state,
+                              unsigned int number_of_cycles);
+STATUS JTAG_flush(JTAG_Handler* state);
 STATUS JTAG_set_jtag_tck(JTAG_Handler* state, unsigned int tck);
 STATUS JTAG_set_active_chain(JTAG_Handler* state, scanChain chain);
 #endif // _JTAG_HANDLER_H_
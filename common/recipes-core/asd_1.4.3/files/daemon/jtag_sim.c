@@ -0,0 +1,265 @@
+/*
+Copyright (c) 2020-present, Facebook, Inc.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "jtag_sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "logging.h"
+
+static const ASD_LogStream stream = ASD_LogStream_JTAG;
+static const ASD_LogOption option = ASD_LogOption_None;
+
+static bool in_dr_path(enum jtag_states state)
+{
+    return state == jtag_shf_dr || state == jtag_ex1_dr ||
+           state == jtag_pau_dr || state == jtag_ex2_dr;
+}
+
+static bool in_ir_path(enum jtag_states state)
+{
+    return state == jtag_shf_ir || state == jtag_ex1_ir ||
+           state == jtag_pau_ir || state == jtag_ex2_ir;
+}
+
+static unsigned int get_bit(const unsigned char* buffer, unsigned int bit)
+{
+    return (buffer[bit / BITS_PER_BYTE] >> (bit % BITS_PER_BYTE)) & 1;
+}
+
+static void set_bit(unsigned char* buffer, unsigned int bit, unsigned int val)
+{
+    if (val)
+        buffer[bit / BITS_PER_BYTE] |= (unsigned char)(1 << (bit % BITS_PER_BYTE));
+    else
+        buffer[bit / BITS_PER_BYTE] &=
+            (unsigned char)~(1 << (bit % BITS_PER_BYTE));
+}
+
+static void append_bits(JTAG_Sim* sim, uint32_t value, unsigned int bits)
+{
+    sim->chain_head = 0;
+    for (unsigned int i = 0; i < bits; i++)
+        set_bit(sim->chain, sim->chain_bits++, (value >> i) & 1);
+}
+
+static void reset_taps(JTAG_Sim* sim)
+{
+    for (unsigned int i = 0; i < sim->num_taps; i++)
+        sim->ir[i] = JTAG_SIM_IDCODE_INSTR;
+    sim->chain_bits = 0;
+    sim->chain_head = 0;
+}
+
+static void capture_dr(JTAG_Sim* sim)
+{
+    sim->chain_bits = 0;
+    for (unsigned int i = 0; i < sim->num_taps; i++)
+    {
+        if (sim->ir[i] == JTAG_SIM_IDCODE_INSTR)
+            append_bits(sim, sim->idcode[i], JTAG_SIM_IDCODE_BITS);
+        else
+            append_bits(sim, 0, 1);
+    }
+}
+
+static void capture_ir(JTAG_Sim* sim)
+{
+    sim->chain_bits = 0;
+    for (unsigned int i = 0; i < sim->num_taps; i++)
+        append_bits(sim, 0x1, sim->ir_size);
+}
+
+static void update_ir(JTAG_Sim* sim)
+{
+    unsigned int bit;
+
+    if (sim->chain_bits == 0)
+        return;
+
+    for (unsigned int i = 0; i < sim->num_taps; i++)
+    {
+        sim->ir[i] = 0;
+        for (unsigned int b = 0; b < sim->ir_size; b++)
+        {
+            bit = (sim->chain_head + i * sim->ir_size + b) % sim->chain_bits;
+            sim->ir[i] |= get_bit(sim->chain, bit) << b;
+        }
+    }
+}
+
+static void goto_state(JTAG_Sim* sim, enum jtag_states state)
+{
+    if (in_ir_path(sim->tap_state) && !in_ir_path(state))
+        update_ir(sim);
+    if (!in_dr_path(sim->tap_state) && in_dr_path(state))
+        capture_dr(sim);
+    if (!in_ir_path(sim->tap_state) && in_ir_path(state))
+        capture_ir(sim);
+    if (state == jtag_tlr)
+        reset_taps(sim);
+    sim->tap_state = state;
+}
+
+// Shift through the selected register. The chain is kept as a ring: the
+// bit at chain_head leaves on TDO and TDI takes its slot, which becomes the
+// far end of the register once the head advances.
+static void shift_chain(JTAG_Sim* sim, unsigned int bits, unsigned char* tdio,
+                        bool read)
+{
+    unsigned int n = sim->chain_bits;
+
+    for (unsigned int i = 0; i < bits; i++)
+    {
+        unsigned int tdi = get_bit(tdio, i);
+        unsigned int tdo = tdi;
+
+        if (n > 0)
+        {
+            tdo = get_bit(sim->chain, sim->chain_head);
+            set_bit(sim->chain, sim->chain_head, tdi);
+            sim->chain_head = (sim->chain_head + 1) % n;
+        }
+        if (read)
+            set_bit(tdio, i, tdo);
+    }
+}
+
+static int sim_xfer(JTAG_Sim* sim, struct jtag_xfer* xfer)
+{
+    unsigned char* tdio = (unsigned char*)(uintptr_t)xfer->tdio;
+    enum jtag_states shift_state =
+        (xfer->type == JTAG_SIR_XFER) ? jtag_shf_ir : jtag_shf_dr;
+
+    if (tdio == NULL || xfer->length > JTAG_SIM_MAX_CHAIN_BITS)
+        return -1;
+
+    goto_state(sim, shift_state);
+
+    shift_chain(sim, xfer->length, tdio,
+                (xfer->direction & JTAG_READ_XFER) != 0);
+    goto_state(sim, (enum jtag_states)xfer->endstate);
+
+    sim->stats.xfers++;
+    sim->stats.xfer_bits += xfer->length;
+    sim->stats.tck_cycles += xfer->length;
+    return 0;
+}
+
+JTAG_Sim* JTAG_sim_create(unsigned int num_taps, unsigned int ir_size)
+{
+    JTAG_Sim* sim;
+
+    if (num_taps == 0 || num_taps > JTAG_SIM_MAX_TAPS || ir_size == 0 ||
+        ir_size > 32)
+        return NULL;
+
+    sim = (JTAG_Sim*)calloc(1, sizeof(JTAG_Sim));
+    if (sim == NULL)
+        return NULL;
+
+    sim->num_taps = num_taps;
+    sim->ir_size = ir_size;
+    for (unsigned int i = 0; i < num_taps; i++)
+    {
+        // version | part number | manufacturer | 1
+        sim->idcode[i] = 0x10000000 | ((0x1000 + i) << 12) | (0x89 << 1) | 1;
+    }
+    sim->tap_state = jtag_tlr;
+    reset_taps(sim);
+    return sim;
+}
+
+void JTAG_sim_free(JTAG_Sim* sim)
+{
+    free(sim);
+}
+
+void JTAG_sim_set_latency(JTAG_Sim* sim, unsigned int usec)
+{
+    if (sim)
+        sim->ioctl_latency_us = usec;
+}
+
+//
+// Emulate the jtag driver ioctls against the loopback chain. The optional
+// latency stands in for the per-transaction cost of the real driver, so
+// benchmarks show the effect of issuing fewer ioctls.
+//
+int JTAG_sim_ioctl(JTAG_Sim* sim, unsigned long request, void* arg)
+{
+    int ret = 0;
+
+    if (sim == NULL || arg == NULL)
+        return -1;
+
+    sim->stats.ioctls++;
+    if (sim->ioctl_latency_us)
+        usleep(sim->ioctl_latency_us);
+
+    switch (request)
+    {
+        case JTAG_SIOCSTATE:
+        {
+            struct jtag_tap_state* tap_state = (struct jtag_tap_state*)arg;
+            if (tap_state->reset == JTAG_FORCE_RESET)
+                goto_state(sim, jtag_tlr);
+            goto_state(sim, (enum jtag_states)tap_state->endstate);
+            sim->stats.tap_state_changes++;
+            sim->stats.tck_cycles += tap_state->tck;
+            break;
+        }
+        case JTAG_IOCXFER:
+            ret = sim_xfer(sim, (struct jtag_xfer*)arg);
+            break;
+        case JTAG_IOCBITBANG:
+        {
+#ifdef JTAG_BITBANG_PACKET
+            struct bitbang_packet* packet = (struct bitbang_packet*)arg;
+            sim->stats.tck_cycles += packet->length;
+#else
+            sim->stats.tck_cycles++;
+#endif
+            sim->stats.bitbang_ioctls++;
+            break;
+        }
+        case JTAG_SIOCFREQ:
+        case JTAG_SIOCMODE:
+            break;
+        default:
+            ASD_log(ASD_LogLevel_Error, stream, option,
+                    "jtag sim: unsupported ioctl 0x%lx", request);
+            ret = -1;
+            break;
+    }
+
+    return ret;
+}
@@ -0,0 +1,74 @@
+/*
+Copyright (c) 2020-present, Facebook, Inc.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _JTAG_SIM_H_
+#define _JTAG_SIM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "jtag_handler.h"
+
+#define JTAG_SIM_MAX_TAPS 16
+#define JTAG_SIM_IDCODE_BITS 32
+#define JTAG_SIM_MAX_CHAIN_BITS (MAX_DATA_SIZE * BITS_PER_BYTE)
+#define JTAG_SIM_IDCODE_INSTR 0x2
+
+// Loopback model of a scan chain behind the jtag driver ioctl interface.
+// Every TAP has an IDCODE data register, selected after reset or by
+// JTAG_SIM_IDCODE_INSTR, and a one bit BYPASS register otherwise, so TDI
+// comes back on TDO delayed by the selected chain length.
+typedef struct JTAG_Sim_Stats
+{
+    uint64_t ioctls;
+    uint64_t xfers;
+    uint64_t xfer_bits;
+    uint64_t tap_state_changes;
+    uint64_t bitbang_ioctls;
+    uint64_t tck_cycles;
+} JTAG_Sim_Stats;
+
+typedef struct JTAG_Sim
+{
+    unsigned int num_taps;
+    unsigned int ir_size;
+    uint32_t idcode[JTAG_SIM_MAX_TAPS];
+    uint32_t ir[JTAG_SIM_MAX_TAPS];
+    unsigned int ioctl_latency_us;
+    enum jtag_states tap_state;
+    unsigned char chain[JTAG_SIM_MAX_CHAIN_BITS / BITS_PER_BYTE];
+    unsigned int chain_bits;
+    unsigned int chain_head;
+    JTAG_Sim_Stats stats;
+} JTAG_Sim;
+
+JTAG_Sim* JTAG_sim_create(unsigned int num_taps, unsigned int ir_size);
+void JTAG_sim_free(JTAG_Sim* sim);
+void JTAG_sim_set_latency(JTAG_Sim* sim, unsigned int usec);
+int JTAG_sim_ioctl(JTAG_Sim* sim, unsigned long request, void* arg);
+
+#endif // _JTAG_SIM_H_
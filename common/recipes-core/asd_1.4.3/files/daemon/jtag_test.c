@@ -38,6 +38,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <sys/time.h>
 #include <unistd.h>
 
+#include "jtag_sim.h"
 #include "logging.h"
 #include "mem_helper.h"
 
@@ -118,6 +119,7 @@ int jtag_test_main(int argc, char** argv)
         }
         else
         {
+            JTAG_sim_free(jtag->sim);
             free(jtag);
         }
     }
@@ -149,6 +151,9 @@ bool parse_arguments(int argc, char** argv, jtag_test_args* args)
     args->tck = DEFAULT_JTAG_TCK;
     args->log_level = DEFAULT_LOG_LEVEL;
     args->log_streams = DEFAULT_LOG_STREAMS;
+    args->sim_taps = 0;
+    args->sim_latency_us = 0;
+    args->split_bits = 0;
 
     enum
     {
@@ -158,6 +163,9 @@ bool parse_arguments(int argc, char** argv, jtag_test_args* args)
         ARG_DR_OVERSHIFT,
         ARG_LOG_LEVEL,
         ARG_LOG_STREAMS,
+        ARG_SIM,
+        ARG_SIM_LATENCY,
+        ARG_SPLIT,
         ARG_HELP
     };
 
@@ -168,6 +176,9 @@ bool parse_arguments(int argc, char** argv, jtag_test_args* args)
         {"dr-overshift", 1, NULL, ARG_DR_OVERSHIFT},
         {"log-level", 1, NULL, ARG_LOG_LEVEL},
         {"log-streams", 1, NULL, ARG_LOG_STREAMS},
+        {"sim", 1, NULL, ARG_SIM},
+        {"sim-latency", 1, NULL, ARG_SIM_LATENCY},
+        {"split", 1, NULL, ARG_SPLIT},
         {"help", 0, NULL, ARG_HELP},
         {NULL, 0, NULL, 0},
     };
@@ -230,6 +241,29 @@ bool parse_arguments(int argc, char** argv, jtag_test_args* args)
                 }
                 break;
 
+            case ARG_SIM:
+                args->sim_taps = (unsigned int)strtol(optarg, NULL, 10);
+                if (args->sim_taps == 0 || args->sim_taps > JTAG_SIM_MAX_TAPS)
+                {
+                    showUsage(argv);
+                    return false;
+                }
+                break;
+
+            case ARG_SIM_LATENCY:
+                args->sim_latency_us = (unsigned int)strtol(optarg, NULL, 10);
+                break;
+
+            case ARG_SPLIT:
+                args->split_bits = (unsigned int)strtol(optarg, NULL, 10);
+                if (args->split_bits == 0 || args->split_bits % 8 ||
+                    args->split_bits > MAX_SPLIT_BITS)
+                {
+                    showUsage(argv);
+                    return false;
+                }
+                break;
+
             case '?':
             case ARG_HELP:
             default:
@@ -316,6 +350,12 @@ void showUsage(char** argv)
         "                               %s\n"
         "                               %s\n"
         "                               %s\n"
+        "  --sim=<number>             Use a loopback simulator with [number]\n"
+        "                             TAPs instead of the jtag driver\n"
+        "  --sim-latency=<usec>       Simulated cost of each driver call\n"
+        "  --split=<bits>             Shift DR in chunks of [bits] (multiple\n"
+        "                             of 8, max %d) the way the ASD plugin\n"
+        "                             does\n"
         "  --help                     Show this list\n"
         "\n"
         "Examples:\n"
@@ -325,6 +365,9 @@ void showUsage(char** argv)
         "\n"
         "Read a register, such as SA_TAP_LR_UNIQUEID_CHAIN.\n"
         "     jtag_test --ir-value=0x22 --dr-size=0x40\n"
+        "\n"
+        "Benchmark 64 bit scans against 4 simulated TAPs.\n"
+        "     jtag_test -i 1000 --sim=4 --sim-latency=20 --split=64\n"
         "\n",
         argv[0], DEFAULT_NUMBER_TEST_ITERATIONS,
         DEFAULT_JTAG_CONTROLLER_MODE == SW_MODE ? "SW" : "HW", DEFAULT_JTAG_TCK,
@@ -339,7 +382,7 @@ void showUsage(char** argv)
         streamtostring(DEFAULT_LOG_STREAMS), streamtostring(ASD_LogStream_All),
         streamtostring(ASD_LogStream_Test), streamtostring(ASD_LogStream_I2C),
         streamtostring(ASD_LogStream_Pins), streamtostring(ASD_LogStream_JTAG),
-        streamtostring(ASD_LogStream_Network));
+        streamtostring(ASD_LogStream_Network), MAX_SPLIT_BITS);
 }
 
 JTAG_Handler* init_jtag(jtag_test_args* args)
@@ -349,11 +392,27 @@ JTAG_Handler* init_jtag(jtag_test_args* args)
     {
         ASD_log(ASD_LogLevel_Error, stream, option,
                 "Failed to initialize the driver.");
+        return NULL;
+    }
+
+    if (args->sim_taps)
+    {
+        jtag->sim = JTAG_sim_create(args->sim_taps, args->ir_shift_size);
+        if (jtag->sim == NULL)
+        {
+            ASD_log(ASD_LogLevel_Error, stream, option,
+                    "Failed to create the jtag simulator.");
+            free(jtag);
+            return NULL;
+        }
+        JTAG_sim_set_latency(jtag->sim, args->sim_latency_us);
     }
-    else if (JTAG_initialize(jtag, args->mode == SW_MODE) != ST_OK)
+
+    if (JTAG_initialize(jtag, args->mode == SW_MODE) != ST_OK)
     {
         ASD_log(ASD_LogLevel_Error, stream, option,
                 "Failed to initialize JTAG handler.");
+        JTAG_sim_free(jtag->sim);
         free(jtag);
         jtag = NULL;
     }
@@ -363,6 +422,7 @@ JTAG_Handler* init_jtag(jtag_test_args* args)
         ASD_log(ASD_LogLevel_Error, stream, option,
                 "Failed to set jtag clock divisor.");
         close(jtag->JTAG_driver_handle);
+        JTAG_sim_free(jtag->sim);
         free(jtag);
         jtag = NULL;
     }
@@ -562,9 +622,16 @@ bool jtag_test(JTAG_Handler* jtag, uncore_info* uncore, jtag_test_args* args)
         number_of_bits = (uncore->numUncores * args->dr_shift_size) +
                          (sizeof(args->tap_data_pattern) * 8);
 
-        if (JTAG_shift(jtag, number_of_bits, sizeof(args->tap_data_pattern),
-                       (unsigned char*)args->tap_data_pattern, sizeof(tdo),
-                       (unsigned char*)&tdo, jtag_rti) != ST_OK)
+        if (args->split_bits)
+        {
+            if (!split_dr_shift(jtag, args, number_of_bits, tdo))
+                return false;
+        }
+        else if (JTAG_shift(jtag, number_of_bits,
+                            sizeof(args->tap_data_pattern),
+                            (unsigned char*)args->tap_data_pattern,
+                            sizeof(tdo), (unsigned char*)&tdo,
+                            jtag_rti) != ST_OK)
         {
             ASD_log(ASD_LogLevel_Error, stream, option,
                     "Unable to read DR shift data.");
@@ -609,6 +676,47 @@ bool jtag_test(JTAG_Handler* jtag, uncore_info* uncore, jtag_test_args* args)
                     (uint64_t)tval_result.tv_usec;
 
     print_test_results(iterations, micro_seconds, total_bits);
+    if (jtag->sim)
+    {
+        ASD_log(ASD_LogLevel_Info, stream, option,
+                "Simulated driver calls: %llu (%llu transfers, %llu bitbang)",
+                jtag->sim->stats.ioctls, jtag->sim->stats.xfers,
+                jtag->sim->stats.bitbang_ioctls);
+    }
+
+    return true;
+}
+
+//
+// Shift the DR test pattern in chunks the way the ASD plugin sends scans,
+// through the queued shift path of the JTAG handler.
+//
+bool split_dr_shift(JTAG_Handler* jtag, jtag_test_args* args,
+                    unsigned int number_of_bits, unsigned char* tdo)
+{
+    unsigned char tdi[MAX_TDO_SIZE];
+    unsigned int offset, bits;
+    enum jtag_states end_state;
+
+    memset(tdi, 0, sizeof(tdi));
+    memcpy(tdi, args->tap_data_pattern, sizeof(args->tap_data_pattern));
+
+    for (offset = 0; offset < number_of_bits; offset += bits)
+    {
+        bits = number_of_bits - offset;
+        if (bits > args->split_bits)
+            bits = args->split_bits;
+        end_state = (offset + bits < number_of_bits) ? jtag_shf_dr : jtag_rti;
+
+        if (JTAG_shift_queue(jtag, bits, DIV_ROUND_UP(bits, 8),
+                             &tdi[offset / 8], DIV_ROUND_UP(bits, 8),
+                             &tdo[offset / 8], end_state) != ST_OK)
+        {
+            ASD_log(ASD_LogLevel_Error, stream, option,
+                    "Unable to queue DR shift data.");
+            return false;
+        }
+    }
 
     return true;
 }
@@ -52,6 +52,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define DEFAULT_LOG_LEVEL ASD_LogLevel_Info
 #define DEFAULT_LOG_STREAMS ASD_LogStream_Test
 
+#define MAX_SPLIT_BITS 64 // scan size used by the ASD plugin
+
 #define ICX_ID_CODE_MASK 0x0FFFFFFF
 #define ICX_ID_CODE_SIGNATURE 0x0E7BB013
 
@@ -69,6 +71,9 @@ typedef struct jtag_test_args
     unsigned char tap_data_pattern[8]; // Used for tap data comparison
     ASD_LogLevel log_level;
     ASD_LogStream log_streams;
+    unsigned int sim_taps;       // 0: use the jtag driver
+    unsigned int sim_latency_us; // simulated cost of each driver call
+    unsigned int split_bits;     // 0: shift DR in a single scan
 } jtag_test_args;
 
 typedef struct uncore_info
@@ -108,6 +113,9 @@ bool uncore_discovery(JTAG_Handler* jtag, uncore_info* uncore,
 
 bool jtag_test(JTAG_Handler* jtag, uncore_info* uncore, jtag_test_args* args);
 
+bool split_dr_shift(JTAG_Handler* jtag, jtag_test_args* args,
+                    unsigned int number_of_bits, unsigned char* tdo);
+
 void print_test_results(uint64_t iterations, uint64_t micro_seconds,
                         uint64_t total_bits);
 
@@ -114,6 +114,7 @@ class FruObjectTree : public ObjectTree {
                             DBusInterfaceBase       &interface) {
       Object* object = upObj.get();
       objectMap_.insert(std::make_pair(path, std::move(upObj)));
+      indexObject(object, path);
 
       DBus* dbus = getDBusObject(ipc_.get());
       FruService* fruService = nullptr;
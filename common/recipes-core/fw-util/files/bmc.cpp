@@ -10,6 +10,7 @@
 #include <syslog.h>
 #include <openbmc/pal.h>
 #include "pfr_bmc.h"
+#include "mtd_writer.h"
 
 using namespace std;
 
@@ -22,7 +23,6 @@ int BmcComponent::update(string image_path)
   string dev;
   int ret;
   string flash_image = image_path;
-  stringstream cmd_str;
 
   if (_mtd_name == "") {
     // Upgrade not supported
@@ -108,14 +108,13 @@ int BmcComponent::update(string image_path)
     close(fd_r);
     close(fd_w);
   }
-  cmd_str << "flashcp -v " << flash_image << " " << dev;
-  ret = system.runcmd(cmd_str.str());
+  ret = flash_mtd(system, flash_image, dev);
   if (_writable_offset > 0) {
     // this is a temp. file, remove it.
     remove(flash_image.c_str());
   }
 
-  // If flashcp cmd was successful, keep historical info that BMC fw was upgraded
+  // If flashing was successful, keep historical info that BMC fw was upgraded
   if (ret == 0) {
     syslog(LOG_CRIT, "BMC fw upgrade completed. Version: %s", get_bmc_version().c_str());
   }
@@ -2,8 +2,14 @@
 #include <list>
 #include <iostream>
 #include <fstream>
+#include <chrono>
+#include <cstring>
 #include <fcntl.h>
+#include <syslog.h>
+#include <unistd.h>
 #include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
 extern "C" {
   #include <libfdt.h>
 }
@@ -39,10 +45,51 @@ int __attribute__((weak)) fdt_next_subnode(const void *fdt, int offset)
        node = fdt_next_subnode(fdt, node))
 #endif
 
-#define FLASH_SIZE (32 * 1024 * 1024)
+// The image is mapped and walked in windows of this size. Pages of a
+// window are dropped from our RSS once it was consumed, so validating an
+// image never costs more than a window of memory on top of the page cache.
+#define IMAGE_WINDOW (1024 * 1024)
 
 using namespace std;
 
+static void drop_pages(const unsigned char *start, size_t len)
+{
+  static const uintptr_t page_mask = ~((uintptr_t)sysconf(_SC_PAGESIZE) - 1);
+  // Only whole pages inside [start, start + len) may be dropped
+  uintptr_t first = ((uintptr_t)start + ~page_mask) & page_mask;
+  uintptr_t last = ((uintptr_t)start + len) & page_mask;
+
+  if (last > first) {
+    madvise((void *)first, last - first, MADV_DONTNEED);
+  }
+}
+
+static void sha256_windowed(const unsigned char *data, size_t len,
+                            unsigned char *digest)
+{
+  SHA256_CTX ctx;
+
+  SHA256_Init(&ctx);
+  for (size_t done = 0; done < len; done += IMAGE_WINDOW) {
+    size_t chunk = min((size_t)IMAGE_WINDOW, len - done);
+    SHA256_Update(&ctx, data + done, chunk);
+    drop_pages(data + done, chunk);
+  }
+  SHA256_Final(digest, &ctx);
+}
+
+static uint32_t crc32_windowed(const unsigned char *data, size_t len)
+{
+  uLong crc = crc32(0, Z_NULL, 0);
+
+  for (size_t done = 0; done < len; done += IMAGE_WINDOW) {
+    size_t chunk = min((size_t)IMAGE_WINDOW, len - done);
+    crc = crc32(crc, data + done, chunk);
+    drop_pages(data + done, chunk);
+  }
+  return (uint32_t)crc;
+}
+
 class Checker {
   protected:
   string name;
@@ -50,7 +97,8 @@ class Checker {
   off_t size;
   public:
   Checker(string n, off_t of, off_t sz) : name(n), offset(of), size(sz) {}
-  virtual bool is_valid(const unsigned char *image) {
+  // avail is the number of bytes of the partition present in the image
+  virtual bool is_valid(const unsigned char *image, off_t avail) {
     return true;
   }
 };
@@ -74,12 +122,12 @@ class LegacyChecker : public Checker {
   public:
     LegacyChecker(string n, off_t of, off_t sz) : Checker(n, of, sz) {}
 
-  virtual bool is_valid(const unsigned char *image) {
+  virtual bool is_valid(const unsigned char *image, off_t avail) {
     uint32_t hcrc, dcrc, hcrc_c, dcrc_c;
     unsigned char hdr[HEADER_SIZE];
     const unsigned char *data;
 
-    if (size <= HEADER_SIZE) {
+    if (size <= HEADER_SIZE || avail <= HEADER_SIZE) {
       return false;
     }
     image = image + offset;
@@ -97,10 +145,10 @@ class LegacyChecker : public Checker {
     dcrc = get_word(hdr, DATA_CRC_OFFSET);
     off_t len  = (off_t)get_word(hdr, SIZE_OFFSET);
     data = image + HEADER_SIZE;
-    if (len + HEADER_SIZE > size) {
+    if (len + HEADER_SIZE > size || len + HEADER_SIZE > avail) {
       return false;
     }
-    dcrc_c = crc32(0, data, len);
+    dcrc_c = crc32_windowed(data, len);
     if (dcrc != dcrc_c) {
       return false;
     }
@@ -113,7 +161,7 @@ class FITChecker : public Checker {
   public:
   FITChecker(string n, off_t of, off_t sz, int nodes) : Checker(n, of, sz), num_nodes(nodes) {}
 
-  virtual bool is_valid(const unsigned char *image) {
+  virtual bool is_valid(const unsigned char *image, off_t avail) {
       const void *fdt = (const void *)(image + offset);
       int nodep, node, hashnode;
       size_t data_size;
@@ -123,7 +171,8 @@ class FITChecker : public Checker {
       int len = 0;
       int valid_nodes = 0;
 
-      if (size < (off_t)FDT_V17_SIZE || fdt_check_header(fdt) != 0) {
+      if (size < (off_t)FDT_V17_SIZE || avail < (off_t)FDT_V17_SIZE ||
+          fdt_check_header(fdt) != 0 || (off_t)fdt_totalsize(fdt) > avail) {
         return false;
       }
 
@@ -154,6 +203,9 @@ class FITChecker : public Checker {
             return false;
           }
           data_pos = ntohl(*(uint32_t *)data);
+          if ((off_t)data_pos + (off_t)data_size > avail) {
+            return false;
+          }
           data = (const unsigned char *)fdt + data_pos;
         } else {
           data_size = (size_t)len;
@@ -164,7 +216,7 @@ class FITChecker : public Checker {
           //description 
           return false;
         }
-        SHA256(data, data_size, shasum);
+        sha256_windowed(data, data_size, shasum);
 
         // Get the sha256 digest stored in the image */
         hashnode = fdt_subnode_offset(fdt, node, "hash@1");
@@ -246,7 +298,7 @@ class PartitionDescriptor
         return false;
       // A valid image might not take up the whole partition.
       // So image_size < offset + size is possible.
-      return checker->is_valid(image);
+      return checker->is_valid(image, min(size, image_size - offset));
     }
 };
 
@@ -315,36 +367,59 @@ class Image {
   }
   public:
   Image(string &file) : image(NULL) {
+    off_t end;
+
     fd = open(file.c_str(), O_RDONLY);
     if (fd < 0) {
       throw "Cannot open " + string(file);
     }
-    fsize = lseek(fd, 0, SEEK_END);
-    if (fsize == 0) {
+    end = lseek(fd, 0, SEEK_END);
+    if (end <= 0) {
+      close(fd);
       throw "Zero size image file " + string(file);
     }
-    lseek(fd, 0, SEEK_SET);
-    unsigned char *img = (unsigned char *)calloc(FLASH_SIZE, 1);
-    for (int bread = 0; bread < (int)fsize;) {
-      int rc = read(fd, img + bread, fsize - bread);
-      if (rc > 0) {
-        bread += rc;
-      }
+    fsize = (size_t)end;
+    // Map rather than read the image so that it is not held twice,
+    // once in the page cache and once in our heap.
+    void *img = mmap(NULL, fsize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (img == MAP_FAILED) {
+      close(fd);
+      throw "Cannot map " + string(file);
     }
+    madvise(img, fsize, MADV_SEQUENTIAL);
     image = (const unsigned char *)img;
   }
   ~Image() {
     if (image)
-      free((void *)image);
+      munmap((void *)image, fsize);
     if (fd >= 0)
       close(fd);
   }
   bool supports_machine(string &machine) {
+    static const char marker[] = "U-Boot ";
+    const size_t marker_len = sizeof(marker) - 1;
+    // Longest version string we look at: "U-Boot dddd.dd (<= 32) machine"
+    const size_t window = 15 + 34 + machine.size();
     // Just dont check in the last 256 bytes of the image. Technically we
     // need to find this in the uboot section so it should be pretty early on.
-    for (int i = 0; i < (int)fsize - 256; i++) {
-      const char *str = (const char *)&image[i];
-      if (isalnum(image[i]) && match(str, "U-Boot \\d\\d\\d\\d\\.\\d\\d ")) {
+    size_t limit = fsize > 256 ? fsize - 256 : 0;
+
+    for (size_t win = 0; win < limit; win += IMAGE_WINDOW) {
+      size_t win_end = min(win + IMAGE_WINDOW, limit);
+      // Markers starting in this window may run over its end
+      size_t scan_end = min(win_end + marker_len - 1, fsize);
+      const unsigned char *p = image + win;
+
+      while ((p = (const unsigned char *)memmem(p, scan_end - (p - image),
+                                                marker, marker_len)) != NULL &&
+             (size_t)(p - image) < win_end) {
+        const char *str = (const char *)p;
+
+        p++;
+        if ((size_t)((const unsigned char *)str - image) + window > fsize ||
+            !match(str, "U-Boot \\d\\d\\d\\d\\.\\d\\d ")) {
+          continue;
+        }
         str += 15;
         if (*str == '(') {
           for (int j = 0; j < 32 && *str != ')'; j++, str++);
@@ -355,6 +430,7 @@ class Image {
         if (istrncmp(str, machine.c_str(), machine.size()))
           return true;
       }
+      drop_pages(image + win, win_end - win);
     }
     return false;
   }
@@ -403,26 +479,41 @@ class ImageDescriptorList {
   }
 };
 
+static bool check_image(System &system, string &file, bool pfr_active)
+{
+  Image image(file);
+  string machine = system.name();
+  if (!image.supports_machine(machine)) {
+    return false;
+  }
+
+  if (pfr_active) {
+    return true;
+  }
+
+  ImageDescriptorList desc_list(system.partition_conf().c_str());
+  return desc_list.is_valid(image);
+}
+
 bool BmcComponent::is_valid(string &file, bool pfr_active)
 {
   bool valid = false;
-  try {
-    Image image(file);
-    string machine = system.name();
-    if (!image.supports_machine(machine)) {
-      return false;
-    }
-
-    if (pfr_active) {
-      return true;
-    }
+  auto start = chrono::steady_clock::now();
+  struct rusage usage;
 
-    ImageDescriptorList desc_list(system.partition_conf().c_str());
-    valid = desc_list.is_valid(image);
+  try {
+    valid = check_image(system, file, pfr_active);
   } catch(string &ex) {
     cerr << ex << endl;
     return false;
   }
+
+  auto elapsed = chrono::duration_cast<chrono::milliseconds>(
+      chrono::steady_clock::now() - start);
+  getrusage(RUSAGE_SELF, &usage);
+  syslog(LOG_INFO, "%s: %s %s in %lld ms, peak RSS %ld KB", __func__,
+         file.c_str(), valid ? "valid" : "invalid",
+         (long long)elapsed.count(), usage.ru_maxrss);
   return valid;
 }
 
@@ -0,0 +1,146 @@
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+#include <syslog.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <mtd/mtd-user.h>
+#include "mtd_writer.h"
+
+using namespace std;
+
+static ssize_t read_full(int fd, uint8_t *buf, size_t len, off_t offset)
+{
+  size_t done = 0;
+
+  while (done < len) {
+    ssize_t rc = pread(fd, buf + done, len - done, offset + done);
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc <= 0) {
+      break;
+    }
+    done += rc;
+  }
+  return done;
+}
+
+static bool write_full(int fd, const uint8_t *buf, size_t len, off_t offset)
+{
+  size_t done = 0;
+
+  while (done < len) {
+    ssize_t rc = pwrite(fd, buf + done, len - done, offset + done);
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc <= 0) {
+      return false;
+    }
+    done += rc;
+  }
+  return true;
+}
+
+int MtdWriter::get_info(int fd, struct mtd_info_user &info)
+{
+  return ioctl(fd, MEMGETINFO, &info);
+}
+
+int MtdWriter::erase(int fd, uint32_t offset, uint32_t len)
+{
+  struct erase_info_user erase = {offset, len};
+  return ioctl(fd, MEMERASE, &erase);
+}
+
+int MtdWriter::write(const string &image)
+{
+  struct mtd_info_user info;
+  struct stat st;
+  uint32_t block, nblocks, changed = 0;
+  int ret = MTD_WRITE_FAILURE;
+  int fd_i = -1, fd_m = -1;
+
+  fd_m = open(_dev.c_str(), O_RDWR | O_SYNC);
+  if (fd_m < 0) {
+    _out << "Cannot open " << _dev << endl;
+    return MTD_WRITE_FAILURE;
+  }
+  if (get_info(fd_m, info) < 0 || info.erasesize == 0) {
+    close(fd_m);
+    return MTD_WRITE_NOT_MTD;
+  }
+
+  vector<uint8_t> want(info.erasesize), have(info.erasesize);
+
+  do {
+    fd_i = open(image.c_str(), O_RDONLY);
+    if (fd_i < 0 || fstat(fd_i, &st) < 0) {
+      _out << "Cannot open " << image << endl;
+      break;
+    }
+    if ((uint64_t)st.st_size > info.size) {
+      _out << image << " is larger than " << _dev << endl;
+      break;
+    }
+    nblocks = (st.st_size + info.erasesize - 1) / info.erasesize;
+
+    for (block = 0; block < nblocks; block++) {
+      off_t offset = (off_t)block * info.erasesize;
+      size_t len = min((off_t)info.erasesize, st.st_size - offset);
+
+      _out << "\rWriting block " << block + 1 << "/" << nblocks
+           << " (" << changed << " changed)" << flush;
+
+      if (read_full(fd_i, want.data(), len, offset) != (ssize_t)len ||
+          read_full(fd_m, have.data(), len, offset) != (ssize_t)len) {
+        _out << endl << "Read failed at offset " << offset << endl;
+        break;
+      }
+      if (!memcmp(want.data(), have.data(), len)) {
+        continue;
+      }
+
+      // Past the end of the image the block is left erased, as flashcp does
+      memset(want.data() + len, 0xff, info.erasesize - len);
+      if (erase(fd_m, (uint32_t)offset, info.erasesize) < 0 ||
+          !write_full(fd_m, want.data(), info.erasesize, offset) ||
+          read_full(fd_m, have.data(), info.erasesize, offset) != (ssize_t)info.erasesize ||
+          memcmp(want.data(), have.data(), info.erasesize)) {
+        _out << endl << "Write failed at offset " << offset << endl;
+        break;
+      }
+      changed++;
+    }
+    if (block < nblocks) {
+      break;
+    }
+
+    _out << "\rWrote " << _dev << ": " << changed << " of " << nblocks
+         << " erase blocks changed" << endl;
+    syslog(LOG_INFO, "%s: %s: %u of %u erase blocks changed", __func__,
+           _dev.c_str(), changed, nblocks);
+    ret = MTD_WRITE_SUCCESS;
+  } while (0);
+
+  if (fd_i >= 0) {
+    close(fd_i);
+  }
+  close(fd_m);
+  return ret;
+}
+
+int flash_mtd(System &sys, const string &image, const string &dev)
+{
+  MtdWriter writer(dev, sys.output);
+
+  int ret = writer.write(image);
+  if (ret == MTD_WRITE_NOT_MTD) {
+    return sys.runcmd("flashcp -v " + image + " " + dev);
+  }
+  return ret == MTD_WRITE_SUCCESS ? FW_STATUS_SUCCESS : FW_STATUS_FAILURE;
+}
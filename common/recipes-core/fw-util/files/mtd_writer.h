@@ -0,0 +1,38 @@
+#ifndef _MTD_WRITER_H_
+#define _MTD_WRITER_H_
+#include <string>
+#include <iostream>
+#include <mtd/mtd-user.h>
+#include "fw-util.h"
+
+enum {
+  MTD_WRITE_SUCCESS = 0,
+  MTD_WRITE_FAILURE = -1,
+  MTD_WRITE_NOT_MTD = -2,
+};
+
+// Writes an image to an MTD device one erase block at a time. Every
+// block is read back and compared with the image first: blocks which
+// already hold the image contents are neither erased nor written, the
+// others are read back and compared again after being programmed. An
+// update interrupted by a power loss thus only rewrites what is left
+// when run again.
+class MtdWriter {
+  private:
+    std::string _dev;
+    std::ostream &_out;
+  protected:
+    // MTD ioctls, overridden to run on a regular file in the tests
+    virtual int get_info(int fd, struct mtd_info_user &info);
+    virtual int erase(int fd, uint32_t offset, uint32_t len);
+  public:
+    MtdWriter(const std::string &dev, std::ostream &out) : _dev(dev), _out(out) {}
+    virtual ~MtdWriter() {}
+    int write(const std::string &image);
+};
+
+// Flash image to dev with MtdWriter, falling back to flashcp when dev is
+// not an MTD character device.
+int flash_mtd(System &sys, const std::string &image, const std::string &dev);
+
+#endif
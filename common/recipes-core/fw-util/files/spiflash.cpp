@@ -1,4 +1,5 @@
 #include "spiflash.h"
+#include "mtd_writer.h"
 #include <fstream>
 #include <thread>
 #include <chrono>
@@ -10,7 +11,6 @@ using namespace std;
 int MTDComponent::update(std::string image)
 {
   string dev;
-  string cmd;
   string comp = this->component();
   int ret;
 
@@ -20,8 +20,7 @@ int MTDComponent::update(std::string image)
   syslog(LOG_CRIT, "Component %s upgrade initiated", comp.c_str());
 
   sys.output << "Flashing to device: " << dev << endl;
-  cmd = "flashcp -v " + image + " " + dev;
-  ret = sys.runcmd(cmd);
+  ret = flash_mtd(sys, image, dev);
   if (ret == 0) {
     syslog(LOG_CRIT, "Component %s upgrade completed", comp.c_str());
     return FW_STATUS_SUCCESS;
@@ -0,0 +1,148 @@
+#include "mtd_writer.h"
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <gtest/gtest.h>
+
+using namespace std;
+
+#define ERASE_SIZE 4096
+#define DEV_BLOCKS 8
+
+// MtdWriter running on a regular file: MEMGETINFO is answered from the
+// file size and MEMERASE fills the block with 0xff.
+class FileMtdWriter : public MtdWriter {
+  public:
+    int erases = 0;
+    int fail_block = -1;   // erase of this block fails
+    FileMtdWriter(const string &dev, ostream &out) : MtdWriter(dev, out) {}
+  protected:
+    int get_info(int fd, struct mtd_info_user &info) override {
+      struct stat st;
+      if (fstat(fd, &st) < 0) {
+        return -1;
+      }
+      memset(&info, 0, sizeof(info));
+      info.type = MTD_NORFLASH;
+      info.size = st.st_size;
+      info.erasesize = ERASE_SIZE;
+      return 0;
+    }
+    int erase(int fd, uint32_t offset, uint32_t len) override {
+      if ((int)(offset / ERASE_SIZE) == fail_block) {
+        return -1;
+      }
+      vector<uint8_t> ff(len, 0xff);
+      erases++;
+      return pwrite(fd, ff.data(), len, offset) == (ssize_t)len ? 0 : -1;
+    }
+};
+
+class MtdWriterTest : public ::testing::Test {
+  protected:
+    string dev, image;
+    vector<uint8_t> img;
+    stringstream out;
+
+    static void store(const string &name, const vector<uint8_t> &data) {
+      ofstream f(name, ios::binary | ios::trunc);
+      f.write((const char *)data.data(), data.size());
+    }
+
+    static vector<uint8_t> load(const string &name) {
+      ifstream f(name, ios::binary);
+      return vector<uint8_t>(istreambuf_iterator<char>(f),
+                             istreambuf_iterator<char>());
+    }
+
+    void SetUp() override {
+      dev = std::tmpnam(nullptr);
+      image = std::tmpnam(nullptr);
+
+      // 3.5 blocks of image over a device holding an older image
+      img.resize(ERASE_SIZE * 3 + ERASE_SIZE / 2);
+      for (size_t i = 0; i < img.size(); i++) {
+        img[i] = (uint8_t)(i * 7 + i / 251);
+      }
+      store(image, img);
+      store(dev, vector<uint8_t>(ERASE_SIZE * DEV_BLOCKS, 0x5a));
+    }
+
+    void TearDown() override {
+      remove(dev.c_str());
+      remove(image.c_str());
+    }
+
+    // what the device must hold after writing img
+    vector<uint8_t> expected(uint8_t beyond) {
+      vector<uint8_t> exp(img);
+      exp.resize(ERASE_SIZE * 4, 0xff);
+      exp.resize(ERASE_SIZE * DEV_BLOCKS, beyond);
+      return exp;
+    }
+};
+
+// TEST1: Writing to a device with other contents erases and programs every
+//        block of the image; the tail of the last block is left erased and
+//        blocks past the image are not touched.
+TEST_F(MtdWriterTest, WriteChangedBlocks) {
+  FileMtdWriter w(dev, out);
+
+  EXPECT_EQ(MTD_WRITE_SUCCESS, w.write(image));
+  EXPECT_EQ(4, w.erases);
+  EXPECT_EQ(expected(0x5a), load(dev));
+}
+
+// TEST1: Writing the image the device already holds erases nothing.
+TEST_F(MtdWriterTest, SameImageSkipsAllBlocks) {
+  FileMtdWriter w(dev, out);
+  ASSERT_EQ(MTD_WRITE_SUCCESS, w.write(image));
+
+  FileMtdWriter again(dev, out);
+  EXPECT_EQ(MTD_WRITE_SUCCESS, again.write(image));
+  EXPECT_EQ(0, again.erases);
+  EXPECT_NE(string::npos, out.str().find("0 of 4 erase blocks changed"));
+}
+
+// TEST1: An update interrupted after two blocks only rewrites the rest
+//        when run again, every block being compared with the image.
+TEST_F(MtdWriterTest, ResumeAfterInterruption) {
+  FileMtdWriter first(dev, out);
+  first.fail_block = 2;
+  EXPECT_EQ(MTD_WRITE_FAILURE, first.write(image));
+  EXPECT_EQ(2, first.erases);
+
+  // a block before the interruption was corrupted meanwhile
+  vector<uint8_t> data = load(dev);
+  data[10] ^= 0xff;
+  store(dev, data);
+
+  FileMtdWriter second(dev, out);
+  EXPECT_EQ(MTD_WRITE_SUCCESS, second.write(image));
+  EXPECT_EQ(3, second.erases);
+  EXPECT_EQ(expected(0x5a), load(dev));
+}
+
+// TEST1: An image larger than the device is refused before any erase.
+TEST_F(MtdWriterTest, ImageTooLarge) {
+  store(image, vector<uint8_t>(ERASE_SIZE * (DEV_BLOCKS + 1), 0));
+  FileMtdWriter w(dev, out);
+
+  EXPECT_EQ(MTD_WRITE_FAILURE, w.write(image));
+  EXPECT_EQ(0, w.erases);
+  EXPECT_EQ(vector<uint8_t>(ERASE_SIZE * DEV_BLOCKS, 0x5a), load(dev));
+}
+
+// TEST1: A regular file is not an MTD device, flash_mtd() then falls back
+//        to flashcp.
+TEST_F(MtdWriterTest, NotMtd) {
+  MtdWriter w(dev, out);
+
+  EXPECT_EQ(MTD_WRITE_NOT_MTD, w.write(image));
+}
@@ -29,6 +29,7 @@
 #include <fcntl.h>
 #include <sys/file.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <pthread.h>
 #include <jansson.h>
 #include <stdbool.h>
@@ -41,6 +42,7 @@
 #include <openbmc/obmc-i2c.h>
 #include <openbmc/vbs.h>
 #include <signal.h>
+#include "monitor_sched.h"
 
 #define I2C_BUS_NUM            14
 #define AST_I2C_BASE           0x1E78A000  /* I2C */
@@ -151,7 +153,7 @@ static unsigned int hb_interval = 500;
 static char *cpu_monitor_name = "BMC CPU utilization";
 static bool cpu_monitor_enabled = false;
 static unsigned int cpu_window_size = DEFAULT_WINDOW_SIZE;
-static unsigned int cpu_monitor_interval = DEFAULT_MONITOR_INTERVAL;
+static unsigned int cpu_monitor_interval_ms = DEFAULT_MONITOR_INTERVAL * 1000;
 static struct threshold_s *cpu_threshold;
 static size_t cpu_threshold_num = 0;
 
@@ -161,7 +163,7 @@ static bool mem_monitor_enabled = false;
 static bool mem_enable_panic = false;
 static int mem_min_free_kbytes = 0;
 static unsigned int mem_window_size = DEFAULT_WINDOW_SIZE;
-static unsigned int mem_monitor_interval = DEFAULT_MONITOR_INTERVAL;
+static unsigned int mem_monitor_interval_ms = DEFAULT_MONITOR_INTERVAL * 1000;
 static struct threshold_s *mem_threshold;
 static size_t mem_threshold_num = 0;
 
@@ -175,7 +177,7 @@ static bool i2c_monitor_enabled = false;
 static char *recoverable_ecc_name = "ECC Recoverable Error";
 static char *unrecoverable_ecc_name = "ECC Unrecoverable Error";
 static bool ecc_monitor_enabled = false;
-static unsigned int ecc_monitor_interval = DEFAULT_MONITOR_INTERVAL;
+static unsigned int ecc_monitor_interval_ms = DEFAULT_MONITOR_INTERVAL * 1000;
 // to show the address of ecc error or not. supported chip: AST2500 serials
 static bool ecc_addr_log = false;
 static struct threshold_s *recov_ecc_threshold;
@@ -187,12 +189,12 @@ static unsigned int ecc_unrec_max_counter = MAX_ECC_UNRECOVERABLE_ERROR_COUNTER;
 
 /* BMC Health Monitor */
 static bool regen_log_enabled = false;
-static unsigned int bmc_health_monitor_interval = DEFAULT_MONITOR_INTERVAL;
+static unsigned int bmc_health_monitor_interval_ms = DEFAULT_MONITOR_INTERVAL * 1000;
 static int regen_interval = 1200;
 
 /* Node Manager Monitor enabled */
 static bool nm_monitor_enabled = false;
-static int nm_monitor_interval = DEFAULT_MONITOR_INTERVAL;
+static unsigned int nm_monitor_interval_ms = DEFAULT_MONITOR_INTERVAL * 1000;
 static unsigned char nm_retry_threshold = 0;
 
 /* Verified-boot state check */
@@ -204,7 +206,11 @@ static bool bmc_timestamp_enabled = false;
 /* PFR status Monitor */
 extern bool pfr_monitor_enabled;
 extern void initialize_pfr_monitor_config(json_t *);
-extern void * pfr_monitor();
+extern int register_pfr_monitor(void);
+extern bool proc_monitor_enabled;
+extern void initialize_proc_monitor_config(json_t *);
+extern int register_proc_monitor(void);
+extern int proc_monitor_dump(void);
 
 static void
 initialize_threshold(const char *target, json_t *thres, struct threshold_s *t) {
@@ -290,6 +296,20 @@ static void initialize_thresholds(const char *target, json_t *array, struct thre
   }
 }
 
+/*
+ * Monitor intervals are configured in seconds, fractions are allowed for
+ * sub-second sampling.
+ */
+static unsigned int
+interval_ms(json_t *tmp) {
+  double sec = json_number_value(tmp);
+
+  if (sec * 1000 < 1) {
+    return DEFAULT_MONITOR_INTERVAL * 1000;
+  }
+  return (unsigned int)(sec * 1000);
+}
+
 static void
 initialize_hb_config(json_t *conf) {
   json_t *tmp;
@@ -319,9 +339,7 @@ initialize_cpu_config(json_t *conf) {
   }
   tmp = json_object_get(conf, "monitor_interval");
   if (tmp && json_is_number(tmp)) {
-    cpu_monitor_interval = json_integer_value(tmp);
-    if (cpu_monitor_interval <= 0)
-      cpu_monitor_interval = DEFAULT_MONITOR_INTERVAL;
+    cpu_monitor_interval_ms = interval_ms(tmp);
   }
   tmp = json_object_get(conf, "threshold");
   if (!tmp || !json_is_array(tmp)) {
@@ -357,9 +375,7 @@ initialize_mem_config(json_t *conf) {
   }
   tmp = json_object_get(conf, "monitor_interval");
   if (tmp && json_is_number(tmp)) {
-    mem_monitor_interval = json_integer_value(tmp);
-    if (mem_monitor_interval <= 0)
-      mem_monitor_interval = DEFAULT_MONITOR_INTERVAL;
+    mem_monitor_interval_ms = interval_ms(tmp);
   }
   tmp = json_object_get(conf, "threshold");
   if (!tmp || !json_is_array(tmp)) {
@@ -428,7 +444,7 @@ initialize_ecc_config(json_t *conf) {
   }
   tmp = json_object_get(conf, "monitor_interval");
   if (tmp && json_is_number(tmp)) {
-    ecc_monitor_interval = json_integer_value(tmp);
+    ecc_monitor_interval_ms = interval_ms(tmp);
   }
   tmp = json_object_get(conf, "recov_max_counter");
   if (tmp && json_is_number(tmp)) {
@@ -458,9 +474,7 @@ initialize_bmc_health_config(json_t *conf) {
   }
   tmp = json_object_get(conf, "monitor_interval");
   if (tmp && json_is_number(tmp)) {
-    bmc_health_monitor_interval = json_integer_value(tmp);
-    if (bmc_health_monitor_interval <= 0)
-      bmc_health_monitor_interval = DEFAULT_MONITOR_INTERVAL;
+    bmc_health_monitor_interval_ms = interval_ms(tmp);
   }
   tmp = json_object_get(conf, "regenerating_interval");
   if (tmp && json_is_number(tmp)) {
@@ -488,11 +502,7 @@ initialize_nm_monitor_config(json_t *conf)
   tmp = json_object_get(conf, "monitor_interval");
   if (tmp && json_is_number(tmp))
   {
-    nm_monitor_interval = json_integer_value(tmp);
-    if (nm_monitor_interval <= 0)
-    {
-      nm_monitor_interval = DEFAULT_MONITOR_INTERVAL;
-    }
+    nm_monitor_interval_ms = interval_ms(tmp);
   }
 
   tmp = json_object_get(conf, "retry_threshold");
@@ -501,7 +511,7 @@ initialize_nm_monitor_config(json_t *conf)
     nm_retry_threshold = json_integer_value(tmp);
   }
 #ifdef DEBUG
-  syslog(LOG_WARNING, "enabled:%d, monitor_interval:%d, retry_threshold:%d", nm_monitor_enabled, nm_monitor_interval, nm_retry_threshold);
+  syslog(LOG_WARNING, "enabled:%d, monitor_interval:%ums, retry_threshold:%d", nm_monitor_enabled, nm_monitor_interval_ms, nm_retry_threshold);
 #endif
   return;
 
@@ -559,6 +569,7 @@ initialize_configuration(void) {
   initialize_bmc_health_config(json_object_get(conf, "bmc_health"));
   initialize_nm_monitor_config(json_object_get(conf, "nm_monitor"));
   initialize_pfr_monitor_config(json_object_get(conf, "pfr_monitor"));
+  initialize_proc_monitor_config(json_object_get(conf, "proc_monitor"));
   initialize_vboot_config(json_object_get(conf, "verified_boot"));
   initialize_bmc_timestamp_config(json_object_get(conf, "bmc_timestamp"));
 
@@ -702,215 +713,211 @@ initilize_all_kv() {
   pal_set_def_key_value();
 }
 
-static void *
-hb_handler() {
-  while(1) {
-    /* Turn ON the HB Led*/
-    pal_set_hb_led(1);
-    msleep(hb_interval);
+static int
+hb_handler(void *arg) {
+  static int hb_led = 0;
 
-    /* Turn OFF the HB led */
-    pal_set_hb_led(0);
-    msleep(hb_interval);
-  }
-  return NULL;
+  /* Toggle the HB Led */
+  hb_led = !hb_led;
+  pal_set_hb_led(hb_led);
+  return MONITOR_PERIOD;
 }
 
-static void *
-watchdog_handler() {
-
-  /* Start watchdog in manual mode */
-  open_watchdog(0, 0);
-
-  /* Set watchdog to persistent mode so timer expiry will happen independent
-   * of this process's liveliness.
+static int
+watchdog_handler(void *arg) {
+  /*
+   * Restart the watchdog countdown. If this process is terminated,
+   * the persistent watchdog setting will cause the system to reboot after
+   * the watchdog timeout.
    */
-  watchdog_disable_magic_close();
-
-  while(1) {
-
-    sleep(5);
-
-    /*
-     * Restart the watchdog countdown. If this process is terminated,
-     * the persistent watchdog setting will cause the system to reboot after
-     * the watchdog timeout.
-     */
-    kick_watchdog();
-  }
-  return NULL;
+  kick_watchdog();
+  return MONITOR_PERIOD;
 }
 
-static void *
-i2c_mon_handler() {
+// bus devices are kept open between checks, -1 if not open
+static int i2c_bus_fd[I2C_BUS_NUM] = {
+  [0 ... I2C_BUS_NUM - 1] = -1
+};
+
+static int
+i2c_mon_handler(void *arg) {
   char i2c_bus_device[16];
-  int dev;
   int bus_status = 0;
-  int asserted_flag[I2C_BUS_NUM] = {};
+  static int asserted_flag[I2C_BUS_NUM] = {};
   bool assert_handle = 0;
   int i;
 
-  while (1) {
-    for (i = 0; i < I2C_BUS_NUM; i++) {
-      if (!ast_i2c_dev_offset[i].enabled) {
-        continue;
-      }
+  for (i = 0; i < I2C_BUS_NUM; i++) {
+    if (!ast_i2c_dev_offset[i].enabled) {
+      continue;
+    }
+    if (i2c_bus_fd[i] < 0) {
       sprintf(i2c_bus_device, "/dev/i2c-%d", i);
-      dev = open(i2c_bus_device, O_RDWR);
-      if (dev < 0) {
+      i2c_bus_fd[i] = open(i2c_bus_device, O_RDWR | O_CLOEXEC);
+      if (i2c_bus_fd[i] < 0) {
         syslog(LOG_DEBUG, "%s(): open() failed", __func__);
         continue;
       }
-      bus_status = i2c_smbus_status(dev);
-      close(dev);
-
-      assert_handle = 0;
-      if (bus_status == 0) {
-        /* Bus status is normal */
-        if (asserted_flag[i] != 0) {
-          asserted_flag[i] = 0;
-          syslog(LOG_CRIT, "DEASSERT: I2C(%d) Bus recoveried. (I2C bus index base 0)", i);
-          pal_i2c_crash_deassert_handle(i);
-        }
-      } else {
-        /* Check each case */
-        if (GETBIT(bus_status, BUS_LOCK_RECOVER_ERROR)
-            && !GETBIT(asserted_flag[i], BUS_LOCK_RECOVER_ERROR)) {
-          asserted_flag[i] = SETBIT(asserted_flag[i], BUS_LOCK_RECOVER_ERROR);
-          syslog(LOG_CRIT, "ASSERT: I2C(%d) bus is locked (Master Lock or Slave Clock Stretch). "
-                           "Recovery error. (I2C bus index base 0)", i);
-          assert_handle = 1;
-        }
-        bus_status = CLEARBIT(bus_status, BUS_LOCK_RECOVER_ERROR);
-        if (GETBIT(bus_status, BUS_LOCK_RECOVER_TIMEOUT)
-            && !GETBIT(asserted_flag[i], BUS_LOCK_RECOVER_TIMEOUT)) {
-          asserted_flag[i] = SETBIT(asserted_flag[i], BUS_LOCK_RECOVER_TIMEOUT);
-          syslog(LOG_CRIT, "ASSERT: I2C(%d) bus is locked (Master Lock or Slave Clock Stretch). "
-                           "Recovery timed out. (I2C bus index base 0)", i);
-          assert_handle = 1;
-        }
-        bus_status = CLEARBIT(bus_status, BUS_LOCK_RECOVER_TIMEOUT);
-        if (GETBIT(bus_status, BUS_LOCK_RECOVER_SUCCESS)) {
-          syslog(LOG_CRIT, "I2C(%d) bus had been locked (Master Lock or Slave Clock Stretch) "
-                           "and has been recoveried successfully. (I2C bus index base 0)", i);
-        }
-        bus_status = CLEARBIT(bus_status, BUS_LOCK_RECOVER_SUCCESS);
-        if (GETBIT(bus_status, SLAVE_DEAD_RECOVER_ERROR)
-            && !GETBIT(asserted_flag[i], SLAVE_DEAD_RECOVER_ERROR)) {
-          asserted_flag[i] = SETBIT(asserted_flag[i], SLAVE_DEAD_RECOVER_ERROR);
-          syslog(LOG_CRIT, "ASSERT: I2C(%d) Slave is dead (SDA keeps low). "
-                           "Bus recovery error. (I2C bus index base 0)", i);
-          assert_handle = 1;
-        }
-        bus_status = CLEARBIT(bus_status, SLAVE_DEAD_RECOVER_ERROR);
-        if (GETBIT(bus_status, SLAVE_DEAD_RECOVER_TIMEOUT)
-            && !GETBIT(asserted_flag[i], SLAVE_DEAD_RECOVER_TIMEOUT)) {
-          asserted_flag[i] = SETBIT(asserted_flag[i], SLAVE_DEAD_RECOVER_TIMEOUT);
-          syslog(LOG_CRIT, "ASSERT: I2C(%d) Slave is dead (SDAs keep low). "
-                           "Bus recovery timed out. (I2C bus index base 0)", i);
-          assert_handle = 1;
-        }
-        bus_status = CLEARBIT(bus_status, SLAVE_DEAD_RECOVER_TIMEOUT);
-        if (GETBIT(bus_status, SLAVE_DEAD_RECOVER_SUCCESS)) {
-          syslog(LOG_CRIT, "I2C(%d) Slave was dead. and bus has been recoveried successfully. "
-                           "(I2C bus index base 0)", i);
-        }
-        bus_status = CLEARBIT(bus_status, SLAVE_DEAD_RECOVER_SUCCESS);
-        /* Check if any undefined bit remain in bus_status */
-        if ((bus_status != 0) && !GETBIT(asserted_flag[i], UNDEFINED_CASE)) {
-          asserted_flag[i] = SETBIT(asserted_flag[i], 8);
-          syslog(LOG_CRIT, "ASSERT: I2C(%d) Undefined case. (I2C bus index base 0)", i);
-          assert_handle = 1;
-        }
+    }
+    bus_status = i2c_smbus_status(i2c_bus_fd[i]);
+    if (bus_status < 0) {
+      // reopen the bus next time
+      close(i2c_bus_fd[i]);
+      i2c_bus_fd[i] = -1;
+    }
 
-        if (assert_handle) {
-          pal_i2c_crash_assert_handle(i);
-        }
+    assert_handle = 0;
+    if (bus_status == 0) {
+      /* Bus status is normal */
+      if (asserted_flag[i] != 0) {
+        asserted_flag[i] = 0;
+        syslog(LOG_CRIT, "DEASSERT: I2C(%d) Bus recoveried. (I2C bus index base 0)", i);
+        pal_i2c_crash_deassert_handle(i);
+      }
+    } else {
+      /* Check each case */
+      if (GETBIT(bus_status, BUS_LOCK_RECOVER_ERROR)
+          && !GETBIT(asserted_flag[i], BUS_LOCK_RECOVER_ERROR)) {
+        asserted_flag[i] = SETBIT(asserted_flag[i], BUS_LOCK_RECOVER_ERROR);
+        syslog(LOG_CRIT, "ASSERT: I2C(%d) bus is locked (Master Lock or Slave Clock Stretch). "
+                         "Recovery error. (I2C bus index base 0)", i);
+        assert_handle = 1;
+      }
+      bus_status = CLEARBIT(bus_status, BUS_LOCK_RECOVER_ERROR);
+      if (GETBIT(bus_status, BUS_LOCK_RECOVER_TIMEOUT)
+          && !GETBIT(asserted_flag[i], BUS_LOCK_RECOVER_TIMEOUT)) {
+        asserted_flag[i] = SETBIT(asserted_flag[i], BUS_LOCK_RECOVER_TIMEOUT);
+        syslog(LOG_CRIT, "ASSERT: I2C(%d) bus is locked (Master Lock or Slave Clock Stretch). "
+                         "Recovery timed out. (I2C bus index base 0)", i);
+        assert_handle = 1;
+      }
+      bus_status = CLEARBIT(bus_status, BUS_LOCK_RECOVER_TIMEOUT);
+      if (GETBIT(bus_status, BUS_LOCK_RECOVER_SUCCESS)) {
+        syslog(LOG_CRIT, "I2C(%d) bus had been locked (Master Lock or Slave Clock Stretch) "
+                         "and has been recoveried successfully. (I2C bus index base 0)", i);
+      }
+      bus_status = CLEARBIT(bus_status, BUS_LOCK_RECOVER_SUCCESS);
+      if (GETBIT(bus_status, SLAVE_DEAD_RECOVER_ERROR)
+          && !GETBIT(asserted_flag[i], SLAVE_DEAD_RECOVER_ERROR)) {
+        asserted_flag[i] = SETBIT(asserted_flag[i], SLAVE_DEAD_RECOVER_ERROR);
+        syslog(LOG_CRIT, "ASSERT: I2C(%d) Slave is dead (SDA keeps low). "
+                         "Bus recovery error. (I2C bus index base 0)", i);
+        assert_handle = 1;
+      }
+      bus_status = CLEARBIT(bus_status, SLAVE_DEAD_RECOVER_ERROR);
+      if (GETBIT(bus_status, SLAVE_DEAD_RECOVER_TIMEOUT)
+          && !GETBIT(asserted_flag[i], SLAVE_DEAD_RECOVER_TIMEOUT)) {
+        asserted_flag[i] = SETBIT(asserted_flag[i], SLAVE_DEAD_RECOVER_TIMEOUT);
+        syslog(LOG_CRIT, "ASSERT: I2C(%d) Slave is dead (SDAs keep low). "
+                         "Bus recovery timed out. (I2C bus index base 0)", i);
+        assert_handle = 1;
+      }
+      bus_status = CLEARBIT(bus_status, SLAVE_DEAD_RECOVER_TIMEOUT);
+      if (GETBIT(bus_status, SLAVE_DEAD_RECOVER_SUCCESS)) {
+        syslog(LOG_CRIT, "I2C(%d) Slave was dead. and bus has been recoveried successfully. "
+                         "(I2C bus index base 0)", i);
+      }
+      bus_status = CLEARBIT(bus_status, SLAVE_DEAD_RECOVER_SUCCESS);
+      /* Check if any undefined bit remain in bus_status */
+      if ((bus_status != 0) && !GETBIT(asserted_flag[i], UNDEFINED_CASE)) {
+        asserted_flag[i] = SETBIT(asserted_flag[i], 8);
+        syslog(LOG_CRIT, "ASSERT: I2C(%d) Undefined case. (I2C bus index base 0)", i);
+        assert_handle = 1;
+      }
+
+      if (assert_handle) {
+        pal_i2c_crash_assert_handle(i);
       }
     }
-    sleep(30);
   }
-  return NULL;
+  return MONITOR_PERIOD;
 }
 
-static void *
-CPU_usage_monitor() {
+static float *cpu_utilization;
+
+static int
+CPU_usage_monitor(void *arg) {
   unsigned long long user, nice, system, idle, iowait, irq, softirq, steal, guest, guest_nice;
-  unsigned long long total_diff, idle_diff, non_idle, idle_time = 0, total = 0, pre_total = 0, pre_idle = 0;
+  unsigned long long total_diff, idle_diff, non_idle, idle_time = 0, total = 0;
+  static unsigned long long pre_total = 0, pre_idle = 0;
+  static int ready_flag = 0, timer = 0, retry = 0;
+  // /proc/stat is kept open and re-read from the start
+  static int stat_fd = -1;
   char cpu[CPU_NAME_LENGTH] = {0};
-  int i, ready_flag = 0, timer = 0, retry = 0;
+  char buf[256];
+  int i;
   float cpu_util_avg, cpu_util_total;
-  float cpu_utilization[cpu_window_size];
-  FILE *fp;
+  ssize_t len;
   int ret;
 
-  sleep(180); //Wait 180s for BMC to idle stage.
-
-  memset(cpu_utilization, 0, sizeof(float) * cpu_window_size);
-
-  while (1) {
-
-    if (retry > HEALTHD_MAX_RETRY) {
-      syslog(LOG_CRIT, "Cannot get CPU statistics. Stop %s\n", __func__);
-      return NULL;
-    }
-
-    // Get CPU statistics. Time unit: jiffies
-    fp = fopen(CPU_INFO_PATH, "r");
-    if(!fp) {
-      syslog(LOG_WARNING, "Failed to get CPU statistics.\n");
-      retry++;
-      continue;
+  if (retry > HEALTHD_MAX_RETRY) {
+    syslog(LOG_CRIT, "Cannot get CPU statistics. Stop %s\n", __func__);
+    if (stat_fd >= 0) {
+      close(stat_fd);
     }
+    return MONITOR_STOP;
+  }
 
-    ret = fscanf(fp, "%s %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
-                cpu, &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal, &guest, &guest_nice);
-    if (ret != 11) {
-      syslog(LOG_WARNING, "Cannot parse CPU statistic. Stop %s\n", __func__);
-      retry++;
-      continue;
+  // Get CPU statistics. Time unit: jiffies
+  if (stat_fd < 0) {
+    stat_fd = open(CPU_INFO_PATH, O_RDONLY | O_CLOEXEC);
+  }
+  len = (stat_fd < 0) ? -1 : pread(stat_fd, buf, sizeof(buf) - 1, 0);
+  if (len <= 0) {
+    syslog(LOG_WARNING, "Failed to get CPU statistics.\n");
+    if (stat_fd >= 0) {
+      close(stat_fd);
+      stat_fd = -1;
     }
-    retry = 0;
+    retry++;
+    return MONITOR_PERIOD;
+  }
+  buf[len] = '\0';
 
-    fclose(fp);
+  ret = sscanf(buf, "%9s %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
+              cpu, &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal, &guest, &guest_nice);
+  if (ret != 11) {
+    syslog(LOG_WARNING, "Cannot parse CPU statistic. Stop %s\n", __func__);
+    retry++;
+    return MONITOR_PERIOD;
+  }
+  retry = 0;
 
-    timer %= cpu_window_size;
+  timer %= cpu_window_size;
 
-    // Need more data to cacluate the avg. utilization. We average 60 records here.
-    if (timer == (cpu_window_size-1) && !ready_flag)
-      ready_flag = 1;
+  // Need more data to cacluate the avg. utilization. We average 60 records here.
+  if (timer == (cpu_window_size-1) && !ready_flag)
+    ready_flag = 1;
 
 
-    // guset and guest_nice are already accounted in user and nice so they are not included in total caculation
-    idle_time = idle + iowait;
-    non_idle = user + nice + system + irq + softirq + steal;
-    total = idle_time + non_idle;
+  // guset and guest_nice are already accounted in user and nice so they are not included in total caculation
+  idle_time = idle + iowait;
+  non_idle = user + nice + system + irq + softirq + steal;
+  total = idle_time + non_idle;
 
-    // For runtime caculation, we need to take into account previous value.
-    total_diff = total - pre_total;
-    idle_diff = idle_time - pre_idle;
+  // For runtime caculation, we need to take into account previous value.
+  total_diff = total - pre_total;
+  idle_diff = idle_time - pre_idle;
 
-    // These records are used to caculate the avg. utilization.
-    cpu_utilization[timer] = (float) (total_diff - idle_diff)/total_diff;
+  // These records are used to caculate the avg. utilization.
+  cpu_utilization[timer] = (float) (total_diff - idle_diff)/total_diff;
 
-    // Start to average the cpu utilization
-    if (ready_flag) {
-      cpu_util_total = 0;
-      for (i=0; i<cpu_window_size; i++) {
-        cpu_util_total += cpu_utilization[i];
-      }
-      cpu_util_avg = (cpu_util_total/cpu_window_size) * 100.0;
-      threshold_check(cpu_monitor_name, cpu_util_avg, cpu_threshold, cpu_threshold_num);
+  // Start to average the cpu utilization
+  if (ready_flag) {
+    cpu_util_total = 0;
+    for (i=0; i<cpu_window_size; i++) {
+      cpu_util_total += cpu_utilization[i];
     }
+    cpu_util_avg = (cpu_util_total/cpu_window_size) * 100.0;
+    threshold_check(cpu_monitor_name, cpu_util_avg, cpu_threshold, cpu_threshold_num);
+  }
 
-    // Record current value for next caculation
-    pre_total = total;
-    pre_idle  = idle_time;
+  // Record current value for next caculation
+  pre_total = total;
+  pre_idle  = idle_time;
 
-    timer++;
-    sleep(cpu_monitor_interval);
-  }
-  return NULL;
+  timer++;
+  return MONITOR_PERIOD;
 }
 
 static int set_panic_on_oom(void) {
@@ -947,15 +954,11 @@ static int set_panic_on_oom(void) {
   return 0;
 }
 
-static void *
-memory_usage_monitor() {
-  struct sysinfo s_info;
-  int i, error, timer = 0, ready_flag = 0, retry = 0;
-  float mem_util_avg, mem_util_total;
-  float mem_utilization[mem_window_size];
-  char cmd[128];
+static float *mem_utilization;
 
-  memset(mem_utilization, 0, sizeof(float) * mem_window_size);
+static void
+memory_usage_monitor_init(void) {
+  char cmd[128];
 
   if (mem_enable_panic) {
     set_panic_on_oom();
@@ -967,153 +970,156 @@ memory_usage_monitor() {
       syslog(LOG_ERR, "set min_free_kbytes failed");
     }
   }
+}
 
-  while (1) {
+static int
+memory_usage_monitor(void *arg) {
+  struct sysinfo s_info;
+  int i, error;
+  static int timer = 0, ready_flag = 0, retry = 0;
+  float mem_util_avg, mem_util_total;
 
-    if (retry > HEALTHD_MAX_RETRY) {
-      syslog(LOG_CRIT, "Cannot get sysinfo. Stop the %s\n", __func__);
-      return NULL;
-    }
+  if (retry > HEALTHD_MAX_RETRY) {
+    syslog(LOG_CRIT, "Cannot get sysinfo. Stop the %s\n", __func__);
+    return MONITOR_STOP;
+  }
 
-    timer %= mem_window_size;
+  timer %= mem_window_size;
 
-    // Need more data to cacluate the avg. utilization. We average 60 records here.
-    if (timer == (mem_window_size-1) && !ready_flag)
-      ready_flag = 1;
+  // Need more data to cacluate the avg. utilization. We average 60 records here.
+  if (timer == (mem_window_size-1) && !ready_flag)
+    ready_flag = 1;
 
-    // Get sys info
-    error = sysinfo(&s_info);
-    if (error) {
-      syslog(LOG_WARNING, "%s Failed to get sys info. Error: %d\n", __func__, error);
-      retry++;
-      continue;
-    }
-    retry = 0;
-
-    // These records are used to caculate the avg. utilization.
-    mem_utilization[timer] = (float) (s_info.totalram - s_info.freeram)/s_info.totalram;
+  // Get sys info
+  error = sysinfo(&s_info);
+  if (error) {
+    syslog(LOG_WARNING, "%s Failed to get sys info. Error: %d\n", __func__, error);
+    retry++;
+    return MONITOR_PERIOD;
+  }
+  retry = 0;
 
-    // Start to average the memory utilization
-    if (ready_flag) {
-      mem_util_total = 0;
-      for (i=0; i<mem_window_size; i++)
-        mem_util_total += mem_utilization[i];
+  // These records are used to caculate the avg. utilization.
+  mem_utilization[timer] = (float) (s_info.totalram - s_info.freeram)/s_info.totalram;
 
-      mem_util_avg = (mem_util_total/mem_window_size) * 100.0;
+  // Start to average the memory utilization
+  if (ready_flag) {
+    mem_util_total = 0;
+    for (i=0; i<mem_window_size; i++)
+      mem_util_total += mem_utilization[i];
 
-      threshold_check(mem_monitor_name, mem_util_avg, mem_threshold, mem_threshold_num);
-    }
+    mem_util_avg = (mem_util_total/mem_window_size) * 100.0;
 
-    timer++;
-    sleep(mem_monitor_interval);
+    threshold_check(mem_monitor_name, mem_util_avg, mem_threshold, mem_threshold_num);
   }
-  return NULL;
+
+  timer++;
+  return MONITOR_PERIOD;
 }
 
-// Thread to monitor the ECC counter
-static void *
-ecc_mon_handler() {
-  uint32_t mcr_fd = 0;
+// Monitor the ECC counter
+static int
+ecc_mon_handler(void *arg) {
+  int mcr_fd;
   uint32_t ecc_status = 0;
   uint32_t unrecover_ecc_err_addr = 0;
   uint32_t recover_ecc_err_addr = 0;
   uint16_t ecc_recoverable_error_counter = 0;
   uint8_t ecc_unrecoverable_error_counter = 0;
-  void *mcr_base_addr;
+  // the memory controller stays mapped between checks
+  static void *mcr_base_addr = NULL;
   void *mcr50_addr;
   void *mcr58_addr;
   void *mcr5c_addr;
-  int retry_err = 0;
-
-  while (1) {
-    mcr_fd = open("/dev/mem", O_RDWR | O_SYNC );
-    if (mcr_fd < 0) {
-      // In case of error opening the file, sleep for 2 sec and retry.
+  static int retry_err = 0;
+
+  if (mcr_base_addr == NULL) {
+    mcr_fd = open("/dev/mem", O_RDWR | O_SYNC | O_CLOEXEC);
+    if (mcr_fd >= 0) {
+      mcr_base_addr = mmap(NULL, PAGE_SIZE, PROT_READ|PROT_WRITE, MAP_SHARED, mcr_fd,
+          AST_MCR_BASE);
+      close(mcr_fd);
+      if (mcr_base_addr == MAP_FAILED) {
+        mcr_base_addr = NULL;
+      }
+    }
+    if (mcr_base_addr == NULL) {
+      // In case of error mapping the controller, retry after 2 sec.
       // During continuous failures, log the error every 20 minutes.
-      sleep(2);
       if (++retry_err >= 600) {
         syslog(LOG_ERR, "%s - cannot open /dev/mem", __func__);
         retry_err = 0;
       }
-      continue;
+      return 2000;
     }
-
     retry_err = 0;
+  }
 
-    mcr_base_addr = mmap(NULL, PAGE_SIZE, PROT_READ|PROT_WRITE, MAP_SHARED, mcr_fd,
-        AST_MCR_BASE);
-    mcr50_addr = (char*)mcr_base_addr + INTR_CTRL_STS_OFFSET;
-    ecc_status = *(volatile uint32_t*) mcr50_addr;
-    if (ecc_addr_log) {
-      mcr58_addr = (char*)mcr_base_addr + ADDR_FIRST_UNRECOVER_ECC_OFFSET;
-      unrecover_ecc_err_addr = *(volatile uint32_t*) mcr58_addr;
-      mcr5c_addr = (char*)mcr_base_addr + ADDR_LAST_RECOVER_ECC_OFFSET;
-      recover_ecc_err_addr = *(volatile uint32_t*) mcr5c_addr;
-    }
-    munmap(mcr_base_addr, PAGE_SIZE);
-    close(mcr_fd);
+  mcr50_addr = (char*)mcr_base_addr + INTR_CTRL_STS_OFFSET;
+  ecc_status = *(volatile uint32_t*) mcr50_addr;
+  if (ecc_addr_log) {
+    mcr58_addr = (char*)mcr_base_addr + ADDR_FIRST_UNRECOVER_ECC_OFFSET;
+    unrecover_ecc_err_addr = *(volatile uint32_t*) mcr58_addr;
+    mcr5c_addr = (char*)mcr_base_addr + ADDR_LAST_RECOVER_ECC_OFFSET;
+    recover_ecc_err_addr = *(volatile uint32_t*) mcr5c_addr;
+  }
 
-    ecc_recoverable_error_counter = (ecc_status >> 16) & 0xFF;
-    ecc_unrecoverable_error_counter = (ecc_status >> 12) & 0xF;
+  ecc_recoverable_error_counter = (ecc_status >> 16) & 0xFF;
+  ecc_unrecoverable_error_counter = (ecc_status >> 12) & 0xF;
 
-    // Check ECC recoverable error counter
-    ecc_threshold_check(recoverable_ecc_name, ecc_recoverable_error_counter,
-                        recov_ecc_threshold, recov_ecc_threshold_num, recover_ecc_err_addr);
+  // Check ECC recoverable error counter
+  ecc_threshold_check(recoverable_ecc_name, ecc_recoverable_error_counter,
+                      recov_ecc_threshold, recov_ecc_threshold_num, recover_ecc_err_addr);
 
-    // Check ECC un-recoverable error counter
-    ecc_threshold_check(unrecoverable_ecc_name, ecc_unrecoverable_error_counter,
-                        unrec_ecc_threshold, unrec_ecc_threshold_num, unrecover_ecc_err_addr);
+  // Check ECC un-recoverable error counter
+  ecc_threshold_check(unrecoverable_ecc_name, ecc_unrecoverable_error_counter,
+                      unrec_ecc_threshold, unrec_ecc_threshold_num, unrecover_ecc_err_addr);
 
-    sleep(ecc_monitor_interval);
-  }
-  return NULL;
+  return MONITOR_PERIOD;
 }
 
-static void *
-bmc_health_monitor()
+static int
+bmc_health_monitor(void *arg)
 {
-  int bmc_health_last_state = 1;
+  static int bmc_health_last_state = 1;
   int bmc_health_kv_state = 1;
   char tmp_health[MAX_VALUE_LEN];
-  int relog_counter = 0;
-  int relog_counter_criteria = regen_interval / bmc_health_monitor_interval;
+  static int relog_counter = 0;
+  int relog_counter_criteria = regen_interval * 1000 / bmc_health_monitor_interval_ms;
   size_t i;
   int ret = 0;
 
-  while(1) {
-    // get current health status from kv_store
-    memset(tmp_health, 0, MAX_VALUE_LEN);
-    ret = pal_get_key_value(BMC_HEALTH_FILE, tmp_health);
-    if (ret){
-      syslog(LOG_ERR, " %s - kv get bmc_health status failed", __func__);
-    }
-    bmc_health_kv_state = atoi(tmp_health);
-
-    // If log-util clear all fru, cleaning CPU/MEM/ECC error status
-    // After doing it, daemon will regenerate asserted log
-    // Generage a syslog every regen_interval loop counter
-    if ((relog_counter >= relog_counter_criteria) ||
-        ((bmc_health_last_state == 0) && (bmc_health_kv_state == 1))) {
-
-      for(i = 0; i < cpu_threshold_num; i++)
-        cpu_threshold[i].asserted = false;
-      for(i = 0; i < mem_threshold_num; i++)
-        mem_threshold[i].asserted = false;
-      for(i = 0; i < recov_ecc_threshold_num; i++)
-        recov_ecc_threshold[i].asserted = false;
-      for(i = 0; i < unrec_ecc_threshold_num; i++)
-        unrec_ecc_threshold[i].asserted = false;
-
-      pthread_mutex_lock(&global_error_mutex);
-      bmc_health = 0;
-      pthread_mutex_unlock(&global_error_mutex);
-      relog_counter = 0;
-    }
-    bmc_health_last_state = bmc_health_kv_state;
-    relog_counter++;
-    sleep(bmc_health_monitor_interval);
-  }
-  return NULL;
+  // get current health status from kv_store
+  memset(tmp_health, 0, MAX_VALUE_LEN);
+  ret = pal_get_key_value(BMC_HEALTH_FILE, tmp_health);
+  if (ret){
+    syslog(LOG_ERR, " %s - kv get bmc_health status failed", __func__);
+  }
+  bmc_health_kv_state = atoi(tmp_health);
+
+  // If log-util clear all fru, cleaning CPU/MEM/ECC error status
+  // After doing it, daemon will regenerate asserted log
+  // Generage a syslog every regen_interval loop counter
+  if ((relog_counter >= relog_counter_criteria) ||
+      ((bmc_health_last_state == 0) && (bmc_health_kv_state == 1))) {
+
+    for(i = 0; i < cpu_threshold_num; i++)
+      cpu_threshold[i].asserted = false;
+    for(i = 0; i < mem_threshold_num; i++)
+      mem_threshold[i].asserted = false;
+    for(i = 0; i < recov_ecc_threshold_num; i++)
+      recov_ecc_threshold[i].asserted = false;
+    for(i = 0; i < unrec_ecc_threshold_num; i++)
+      unrec_ecc_threshold[i].asserted = false;
+
+    pthread_mutex_lock(&global_error_mutex);
+    bmc_health = 0;
+    pthread_mutex_unlock(&global_error_mutex);
+    relog_counter = 0;
+  }
+  bmc_health_last_state = bmc_health_kv_state;
+  relog_counter++;
+  return MONITOR_PERIOD;
 }
 
 void check_nm_selftest_result(uint8_t fru, int result)
@@ -1189,8 +1195,8 @@ void check_nm_selftest_result(uint8_t fru, int result)
   }
 }
 
-static void *
-nm_monitor()
+static int
+nm_monitor(void *arg)
 {
   int fru;
   int ret;
@@ -1198,36 +1204,31 @@ nm_monitor()
   const uint8_t normal_status[2] = {0x55, 0x00}; // If the selftest result is 55 00, the status of the controller is okay
   uint8_t data[2]={0x0};
 
-  while (1)
+  for ( fru = 1; fru <= MAX_NUM_FRUS; fru++)
   {
-    for ( fru = 1; fru <= MAX_NUM_FRUS; fru++)
+    if ( pal_is_slot_server(fru) )
     {
-      if ( pal_is_slot_server(fru) )
+      if ( pal_is_fw_update_ongoing(fru) )
       {
-        if ( pal_is_fw_update_ongoing(fru) )
-        {
-          continue;
-        }
+        continue;
+      }
 
-        ret = pal_get_nm_selftest_result(fru, data);
-        if ( PAL_EOK == ret )
-        {
-          //if nm has the response, check the status
-          result = memcmp(data, normal_status, sizeof(normal_status));
-        }
-        else
-        {
-          //if nm has no response, suppose it is in the not support state
-          result = PAL_ENOTSUP;
-        }
-        check_nm_selftest_result(fru, result);
+      ret = pal_get_nm_selftest_result(fru, data);
+      if ( PAL_EOK == ret )
+      {
+        //if nm has the response, check the status
+        result = memcmp(data, normal_status, sizeof(normal_status));
+      }
+      else
+      {
+        //if nm has no response, suppose it is in the not support state
+        result = PAL_ENOTSUP;
       }
+      check_nm_selftest_result(fru, result);
     }
-
-    sleep(nm_monitor_interval);
   }
 
-  return NULL;
+  return MONITOR_PERIOD;
 }
 
 void
@@ -1242,61 +1243,57 @@ crit_proc_ongoing_handle(bool is_crit_proc_updating)
   last_is_crit_proc_updating = is_crit_proc_updating;
 
   if ( true == is_crit_proc_updating ) { // forbid the execution permission
-    if (system("chmod 666 /sbin/shutdown.sysvinit") != 0) {
+    if (chmod("/sbin/shutdown.sysvinit", 0666) != 0) {
       syslog(LOG_ERR, "Disabling shutdown failed\n");
     }
-    if (system("chmod 666 /sbin/halt.sysvinit") != 0) {
+    if (chmod("/sbin/halt.sysvinit", 0666) != 0) {
       syslog(LOG_ERR, "Disabling halt failed\n");
     }
-    if (system("chmod 666 /sbin/init") != 0) {
+    if (chmod("/sbin/init", 0666) != 0) {
       syslog(LOG_ERR, "Disabling init failed\n");
     }
   }
   else {
-    if (system("chmod 4755 /sbin/shutdown.sysvinit") != 0) {
+    if (chmod("/sbin/shutdown.sysvinit", S_ISUID | 0755) != 0) {
       syslog(LOG_ERR, "Enabling shutdown failed\n");
     }
-    if (system("chmod 4755 /sbin/halt.sysvinit") != 0) {
+    if (chmod("/sbin/halt.sysvinit", S_ISUID | 0755) != 0) {
       syslog(LOG_ERR, "Enabling halt failed\n");
     }
-    if (system("chmod 4755 /sbin/init") != 0) {
+    if (chmod("/sbin/init", S_ISUID | 0755) != 0) {
       syslog(LOG_ERR, "Enabling init failed\n");
     }
   }
 }
 
 //Block reboot and shutdown commands in BMC during any FW updating
-static void *
-crit_proc_monitor() {
+static int
+crit_proc_monitor(void *arg) {
 
   bool is_fw_updating = false;
   bool is_crashdump_ongoing = false;
   bool is_cplddump_ongoing = false;
 
-  while(1)
-  {
-    //if is_fw_updating == true, means BMC is Updating a Device FW
-    is_fw_updating = pal_is_fw_update_ongoing_system();
-
-    //if is_autodump_ongoing == true, modify the permission
-    is_crashdump_ongoing = pal_is_crashdump_ongoing_system();
+  //if is_fw_updating == true, means BMC is Updating a Device FW
+  is_fw_updating = pal_is_fw_update_ongoing_system();
 
-    //if is_cplddump_ongoing == true, modify the permission
-    is_cplddump_ongoing = pal_is_cplddump_ongoing_system();
+  //if is_autodump_ongoing == true, modify the permission
+  is_crashdump_ongoing = pal_is_crashdump_ongoing_system();
 
-    if ( (true == is_fw_updating) || (true == is_crashdump_ongoing) || (true == is_cplddump_ongoing) )
-    {
-      crit_proc_ongoing_handle(true);
-    }
+  //if is_cplddump_ongoing == true, modify the permission
+  is_cplddump_ongoing = pal_is_cplddump_ongoing_system();
 
-    if ( (false == is_fw_updating) && (false == is_crashdump_ongoing) && (false == is_cplddump_ongoing) )
-    {
-      crit_proc_ongoing_handle(false);
-    }
+  if ( (true == is_fw_updating) || (true == is_crashdump_ongoing) || (true == is_cplddump_ongoing) )
+  {
+    crit_proc_ongoing_handle(true);
+  }
 
-    sleep(1);
+  if ( (false == is_fw_updating) && (false == is_crashdump_ongoing) && (false == is_cplddump_ongoing) )
+  {
+    crit_proc_ongoing_handle(false);
   }
-  return NULL;
+
+  return MONITOR_PERIOD;
 }
 
 static int log_count(const char *str)
@@ -1559,66 +1556,64 @@ log_reboot_cause(char *sled_off_time)
   close(mem_fd);
 }
 
-// Thread to monitor SLED Cycles by using time stamp
-static void *
-timestamp_handler()
+// Monitor SLED Cycles by using time stamp
+static int
+timestamp_handler(void *arg)
 {
-  int count = 0;
+  static int count = 0;
   struct timespec ts;
   struct timespec mts;
   char tstr[MAX_VALUE_LEN] = {0};
   char buf[128] = {0};
-  uint8_t time_init = 0;
+  static uint8_t time_init = 0;
+  static bool started = false;
   long time_sled_on;
-  long time_sled_off;
-
-  // Read the last timestamp from KV storage
-  pal_get_key_value("timestamp_sled", tstr);
-  time_sled_off = (long) strtol(tstr, NULL, 10);
-  ctime_r(&time_sled_off, buf);
-  log_reboot_cause(buf);
-
-  while (1) {
-
-    // Make sure the time is initialized properly
-    // Since there is no battery backup, the time could be reset to build time
-    // wait 100s at most, to prevent infinite waiting
-    if ( time_init < SLED_TS_TIMEOUT ) {
-      // Read current time
-      clock_gettime(CLOCK_REALTIME, &ts);
-
-      if ( (ts.tv_sec < time_sled_off) && (++time_init < SLED_TS_TIMEOUT) ) {
-        sleep(1);
-        continue;
-      }
+  static long time_sled_off;
+
+  if (!started) {
+    // Read the last timestamp from KV storage
+    pal_get_key_value("timestamp_sled", tstr);
+    time_sled_off = (long) strtol(tstr, NULL, 10);
+    ctime_r(&time_sled_off, buf);
+    log_reboot_cause(buf);
+    started = true;
+  }
+
+  // Make sure the time is initialized properly
+  // Since there is no battery backup, the time could be reset to build time
+  // wait 100s at most, to prevent infinite waiting
+  if ( time_init < SLED_TS_TIMEOUT ) {
+    // Read current time
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    if ( (ts.tv_sec < time_sled_off) && (++time_init < SLED_TS_TIMEOUT) ) {
+      return 1000;
+    }
 
-      // If get the correct time or time sync timeout
-      time_init = SLED_TS_TIMEOUT;
+    // If get the correct time or time sync timeout
+    time_init = SLED_TS_TIMEOUT;
 
-      // Need to log SLED ON event, if this is Power-On-Reset
-      if (pal_is_bmc_por()) {
-        // Get uptime
-        clock_gettime(CLOCK_MONOTONIC, &mts);
-        // To find out when SLED was on, subtract the uptime from current time
-        time_sled_on = ts.tv_sec - mts.tv_sec;
+    // Need to log SLED ON event, if this is Power-On-Reset
+    if (pal_is_bmc_por()) {
+      // Get uptime
+      clock_gettime(CLOCK_MONOTONIC, &mts);
+      // To find out when SLED was on, subtract the uptime from current time
+      time_sled_on = ts.tv_sec - mts.tv_sec;
 
-        ctime_r(&time_sled_on, buf);
-        // Log an event if this is Power-On-Reset
-        syslog(LOG_CRIT, "SLED Powered ON at %s", buf);
-      }
-      pal_update_ts_sled();
-    }
-
-    // Store timestamp every one hour to keep track of SLED power
-    if (count++ == HB_TIMESTAMP_COUNT) {
-      pal_update_ts_sled();
-      count = 0;
+      ctime_r(&time_sled_on, buf);
+      // Log an event if this is Power-On-Reset
+      syslog(LOG_CRIT, "SLED Powered ON at %s", buf);
     }
+    pal_update_ts_sled();
+  }
 
-    sleep(HB_SLEEP_TIME);
+  // Store timestamp every one hour to keep track of SLED power
+  if (count++ == HB_TIMESTAMP_COUNT) {
+    pal_update_ts_sled();
+    count = 0;
   }
 
-  return NULL;
+  return MONITOR_PERIOD;
 }
 
 void sig_handler(int signo) {
@@ -1627,21 +1622,35 @@ void sig_handler(int signo) {
   exit(0);
 }
 
+/*
+ * Periodic monitor without fd; it may run up to a tenth of its period
+ * early so monitors with close periods share wakeups.
+ */
+static void
+add_monitor(const char *name, unsigned int period_ms, unsigned int delay_ms,
+            int flags, monitor_handler_t handler) {
+  struct monitor_desc desc = {
+    .name = name,
+    .period_ms = period_ms,
+    .jitter_ms = period_ms / 10,
+    .delay_ms = delay_ms,
+    .fd = -1,
+    .flags = flags,
+    .handler = handler,
+  };
+
+  if (monitor_register(&desc)) {
+    syslog(LOG_WARNING, "register %s monitor error\n", name);
+    exit(1);
+  }
+}
+
 int
 main(int argc, char **argv) {
-  pthread_t tid_watchdog;
-  pthread_t tid_hb_led;
-  pthread_t tid_i2c_mon;
-  pthread_t tid_cpu_monitor;
-  pthread_t tid_mem_monitor;
-  pthread_t tid_crit_proc_monitor;
-  pthread_t tid_ecc_monitor;
-  pthread_t tid_bmc_health_monitor;
-  pthread_t tid_nm_monitor;
-  pthread_t tid_pfr_monitor;
-  pthread_t tid_timestamp_handler;
-
   if (argc > 1) {
+    if (argc == 2 && !strcmp(argv[1], "--top")) {
+      return proc_monitor_dump() ? 1 : 0;
+    }
     exit(1);
   }
 
@@ -1664,115 +1673,82 @@ main(int argc, char **argv) {
 // For current platforms, we are using WDT from either fand or fscd
 // TODO: keeping this code until we make healthd as central daemon that
 //  monitors all the important daemons for the platforms.
-  if (pthread_create(&tid_watchdog, NULL, watchdog_handler, NULL)) {
-    syslog(LOG_WARNING, "pthread_create for watchdog error\n");
-    exit(1);
-  }
+  /* Start watchdog in manual mode */
+  open_watchdog(0, 0);
 
-  if (pthread_create(&tid_hb_led, NULL, hb_handler, NULL)) {
-    syslog(LOG_WARNING, "pthread_create for heartbeat error\n");
-    exit(1);
-  }
+  /* Set watchdog to persistent mode so timer expiry will happen independent
+   * of this process's liveliness.
+   */
+  watchdog_disable_magic_close();
+  add_monitor("watchdog", 5000, 5000, 0, watchdog_handler);
+
+  add_monitor("heartbeat", hb_interval, 0, 0, hb_handler);
 
   if (cpu_monitor_enabled) {
-    if (pthread_create(&tid_cpu_monitor, NULL, CPU_usage_monitor, NULL)) {
-      syslog(LOG_WARNING, "pthread_create for monitor CPU usage\n");
+    cpu_utilization = calloc(cpu_window_size, sizeof(float));
+    if (!cpu_utilization) {
+      syslog(LOG_WARNING, "allocation for monitor CPU usage failed\n");
       exit(1);
     }
+    //Wait 180s for BMC to idle stage.
+    // Offloaded: a threshold may reboot the BMC or drop caches through
+    // system(), which must not hold up the watchdog kick.
+    add_monitor("CPU usage", cpu_monitor_interval_ms, 180000, MONITOR_F_OFFLOAD,
+                CPU_usage_monitor);
   }
 
   if (mem_monitor_enabled) {
-    if (pthread_create(&tid_mem_monitor, NULL, memory_usage_monitor, NULL)) {
-      syslog(LOG_WARNING, "pthread_create for monitor memory usage\n");
+    mem_utilization = calloc(mem_window_size, sizeof(float));
+    if (!mem_utilization) {
+      syslog(LOG_WARNING, "allocation for monitor memory usage failed\n");
       exit(1);
     }
+    memory_usage_monitor_init();
+    add_monitor("memory usage", mem_monitor_interval_ms, 0, MONITOR_F_OFFLOAD,
+                memory_usage_monitor);
   }
 
   if (i2c_monitor_enabled) {
-    // Add a thread for monitoring all I2C buses crash or not
-    if (pthread_create(&tid_i2c_mon, NULL, i2c_mon_handler, NULL)) {
-      syslog(LOG_WARNING, "pthread_create for I2C errorr\n");
-      exit(1);
-    }
+    // Monitor all I2C buses crash or not
+    add_monitor("I2C", 30000, 0, MONITOR_F_OFFLOAD, i2c_mon_handler);
   }
 
   if (ecc_monitor_enabled) {
-    if (pthread_create(&tid_ecc_monitor, NULL, ecc_mon_handler, NULL)) {
-      syslog(LOG_WARNING, "pthread_create for ECC monitoring errorr\n");
-      exit(1);
-    }
+    add_monitor("ECC", ecc_monitor_interval_ms, 0, MONITOR_F_OFFLOAD,
+                ecc_mon_handler);
   }
 
   if (regen_log_enabled) {
-    if (pthread_create(&tid_bmc_health_monitor, NULL, bmc_health_monitor, NULL)) {
-      syslog(LOG_WARNING, "pthread_create for BMC Health monitoring errorr\n");
-      exit(1);
-    }
+    add_monitor("BMC health", bmc_health_monitor_interval_ms, 0,
+                MONITOR_F_OFFLOAD, bmc_health_monitor);
   }
 
   if (nm_monitor_enabled) {
-    if (pthread_create(&tid_nm_monitor, NULL, nm_monitor, NULL)) {
-      syslog(LOG_WARNING, "pthread_create for nm monitor error\n");
-      exit(1);
-    }
+    add_monitor("NM", nm_monitor_interval_ms, 0, MONITOR_F_OFFLOAD, nm_monitor);
   }
 
   if (pfr_monitor_enabled) {
-    if (pthread_create(&tid_pfr_monitor, NULL, pfr_monitor, NULL)) {
-      syslog(LOG_WARNING, "pthread_create for pfr monitor error\n");
+    if (register_pfr_monitor()) {
+      syslog(LOG_WARNING, "register pfr monitor error\n");
       exit(1);
     }
   }
 
-  if (pthread_create(&tid_crit_proc_monitor, NULL, crit_proc_monitor, NULL)) {
-    syslog(LOG_WARNING, "pthread_create for FW Update Monitor error\n");
-    exit(1);
-  }
-
-  if (bmc_timestamp_enabled) {
-    if (pthread_create(&tid_timestamp_handler, NULL, timestamp_handler, NULL)) {
-      syslog(LOG_WARNING, "pthread_create for time stamp handler error\n");
+  if (proc_monitor_enabled) {
+    if (register_proc_monitor()) {
+      syslog(LOG_WARNING, "register process monitor error\n");
       exit(1);
     }
   }
 
-
-  pthread_join(tid_watchdog, NULL);
-
-  pthread_join(tid_hb_led, NULL);
-
-  if (i2c_monitor_enabled) {
-    pthread_join(tid_i2c_mon, NULL);
-  }
-  if (cpu_monitor_enabled) {
-    pthread_join(tid_cpu_monitor, NULL);
-  }
-
-  if (mem_monitor_enabled) {
-    pthread_join(tid_mem_monitor, NULL);
-  }
-
-  if (ecc_monitor_enabled) {
-    pthread_join(tid_ecc_monitor, NULL);
-  }
-
-  if (regen_log_enabled) {
-    pthread_join(tid_bmc_health_monitor, NULL);
-  }
-
-  if (nm_monitor_enabled) {
-    pthread_join(tid_nm_monitor, NULL);
-  }
-
-  if (pfr_monitor_enabled) {
-    pthread_join(tid_pfr_monitor, NULL);
-  }
-
-  pthread_join(tid_crit_proc_monitor, NULL);
+  // runs in the scheduler loop so a busy worker pool cannot delay
+  // blocking reboot once an update starts
+  add_monitor("FW update", 1000, 0, 0, crit_proc_monitor);
 
   if (bmc_timestamp_enabled) {
-    pthread_join(tid_timestamp_handler, NULL);
+    add_monitor("time stamp", HB_SLEEP_TIME * 1000, 0, MONITOR_F_OFFLOAD,
+                timestamp_handler);
   }
 
-  return 0;
+  return monitor_sched_run() ? 1 : 0;
 }
@@ -0,0 +1,339 @@
+/*
+ * monitor_sched.c: timerfd/epoll scheduler for the healthd monitors
+ *
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include "monitor_sched.h"
+
+// epoll data of the scheduler's own fds, monitors use their index
+#define EV_TIMER  MONITOR_MAX
+#define EV_DONE   (MONITOR_MAX + 1)
+
+struct monitor {
+  struct monitor_desc desc;
+  uint64_t next;    // when to run (CLOCK_MONOTONIC ms), 0 if not timed
+  bool active;
+  bool busy;        // queued or running in a worker
+  bool pending;     // fd got ready while busy, run again when done
+  int ret;          // result of the handler run in a worker
+};
+
+static struct monitor monitors[MONITOR_MAX];
+static int num_monitors = 0;
+static int epoll_fd = -1;
+static int timer_fd = -1;
+static int done_fd = -1;
+
+/*
+ * A monitor is in at most one of the queues at a time, so MONITOR_MAX
+ * entries are enough for both.
+ */
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static struct monitor *work_queue[MONITOR_MAX];
+static int work_head = 0, work_count = 0;
+static struct monitor *done_queue[MONITOR_MAX];
+static int done_count = 0;
+
+static uint64_t
+now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int
+monitor_register(const struct monitor_desc *desc) {
+  struct monitor *m;
+
+  if (num_monitors >= MONITOR_MAX || desc->handler == NULL ||
+      (desc->period_ms == 0 && desc->fd < 0)) {
+    syslog(LOG_WARNING, "%s: cannot register monitor %s", __func__, desc->name);
+    return -1;
+  }
+
+  m = &monitors[num_monitors++];
+  memset(m, 0, sizeof(*m));
+  m->desc = *desc;
+  m->active = true;
+  return 0;
+}
+
+static void *
+monitor_worker(void *arg) {
+  struct monitor *m;
+  uint64_t one = 1;
+  int ret;
+
+  while (1) {
+    pthread_mutex_lock(&queue_mutex);
+    while (work_count == 0) {
+      pthread_cond_wait(&queue_cond, &queue_mutex);
+    }
+    m = work_queue[work_head];
+    work_head = (work_head + 1) % MONITOR_MAX;
+    work_count--;
+    pthread_mutex_unlock(&queue_mutex);
+
+    ret = m->desc.handler(m->desc.arg);
+
+    pthread_mutex_lock(&queue_mutex);
+    m->ret = ret;
+    done_queue[done_count++] = m;
+    pthread_mutex_unlock(&queue_mutex);
+
+    if (write(done_fd, &one, sizeof(one)) < 0) {
+      syslog(LOG_ERR, "%s: wakeup failed: %s", __func__, strerror(errno));
+    }
+  }
+  return NULL;
+}
+
+static void
+monitor_arm_fd(struct monitor *m, int op) {
+  struct epoll_event ev;
+
+  // one shot, so a ready fd doesn't wake the loop while the handler runs
+  ev.events = m->desc.events | EPOLLONESHOT;
+  ev.data.u64 = m - monitors;
+  if (epoll_ctl(epoll_fd, op, m->desc.fd, &ev) < 0) {
+    syslog(LOG_WARNING, "%s: cannot watch fd of %s: %s", __func__,
+           m->desc.name, strerror(errno));
+  }
+}
+
+static void monitor_dispatch(struct monitor *m);
+
+static void
+monitor_complete(struct monitor *m, int ret) {
+  m->busy = false;
+
+  if (ret == MONITOR_STOP) {
+    syslog(LOG_INFO, "%s: %s stopped", __func__, m->desc.name);
+    m->active = false;
+    if (m->desc.fd >= 0) {
+      epoll_ctl(epoll_fd, EPOLL_CTL_DEL, m->desc.fd, NULL);
+    }
+    return;
+  }
+
+  if (ret > 0) {
+    m->next = now_ms() + ret;
+  } else if (m->desc.period_ms > 0) {
+    m->next = now_ms() + m->desc.period_ms;
+  } else {
+    m->next = 0;
+  }
+
+  if (m->desc.fd >= 0) {
+    monitor_arm_fd(m, EPOLL_CTL_MOD);
+    if (m->pending) {
+      m->pending = false;
+      monitor_dispatch(m);
+    }
+  }
+}
+
+static void
+monitor_dispatch(struct monitor *m) {
+  if (!(m->desc.flags & MONITOR_F_OFFLOAD)) {
+    monitor_complete(m, m->desc.handler(m->desc.arg));
+    return;
+  }
+
+  m->busy = true;
+  pthread_mutex_lock(&queue_mutex);
+  work_queue[(work_head + work_count) % MONITOR_MAX] = m;
+  work_count++;
+  pthread_cond_signal(&queue_cond);
+  pthread_mutex_unlock(&queue_mutex);
+}
+
+static void
+monitor_collect_done(void) {
+  struct monitor *done[MONITOR_MAX];
+  uint64_t cnt;
+  int i, n;
+
+  if (read(done_fd, &cnt, sizeof(cnt)) < 0 && errno != EAGAIN) {
+    syslog(LOG_ERR, "%s: read failed: %s", __func__, strerror(errno));
+  }
+
+  pthread_mutex_lock(&queue_mutex);
+  n = done_count;
+  memcpy(done, done_queue, n * sizeof(done[0]));
+  done_count = 0;
+  pthread_mutex_unlock(&queue_mutex);
+
+  for (i = 0; i < n; i++) {
+    monitor_complete(done[i], done[i]->ret);
+  }
+}
+
+/*
+ * Arm the timer for the earliest due monitor. Returns the number of
+ * active monitors.
+ */
+static int
+monitor_arm_timer(void) {
+  struct itimerspec its;
+  uint64_t wake = UINT64_MAX;
+  int i, active = 0;
+
+  for (i = 0; i < num_monitors; i++) {
+    struct monitor *m = &monitors[i];
+
+    if (!m->active) {
+      continue;
+    }
+    active++;
+    if (!m->busy && m->next && m->next < wake) {
+      wake = m->next;
+    }
+  }
+
+  // all zero disarms the timer
+  memset(&its, 0, sizeof(its));
+  if (wake != UINT64_MAX) {
+    its.it_value.tv_sec = wake / 1000;
+    its.it_value.tv_nsec = (wake % 1000) * 1000000;
+  }
+  if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+    syslog(LOG_ERR, "%s: timerfd_settime failed: %s", __func__, strerror(errno));
+  }
+  return active;
+}
+
+static int
+monitor_sched_init(void) {
+  struct epoll_event ev;
+  pthread_t tid;
+  uint64_t now = now_ms();
+  bool offload = false;
+  int i;
+
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  done_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epoll_fd < 0 || timer_fd < 0 || done_fd < 0) {
+    syslog(LOG_CRIT, "%s: cannot create event loop: %s", __func__, strerror(errno));
+    return -1;
+  }
+
+  ev.events = EPOLLIN;
+  ev.data.u64 = EV_TIMER;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev);
+  ev.data.u64 = EV_DONE;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, done_fd, &ev);
+
+  for (i = 0; i < num_monitors; i++) {
+    struct monitor *m = &monitors[i];
+
+    if (m->desc.period_ms > 0 || m->desc.delay_ms > 0) {
+      // 0 means not timed, start at least 1ms from now
+      m->next = now + (m->desc.delay_ms ? m->desc.delay_ms : 1);
+    }
+    if (m->desc.fd >= 0) {
+      monitor_arm_fd(m, EPOLL_CTL_ADD);
+    }
+    if (m->desc.flags & MONITOR_F_OFFLOAD) {
+      offload = true;
+    }
+  }
+
+  for (i = 0; offload && i < MONITOR_WORKERS; i++) {
+    if (pthread_create(&tid, NULL, monitor_worker, NULL)) {
+      syslog(LOG_CRIT, "%s: cannot create worker thread", __func__);
+      return -1;
+    }
+    pthread_detach(tid);
+  }
+  return 0;
+}
+
+int
+monitor_sched_run(void) {
+  struct epoll_event events[MONITOR_MAX + 2];
+  uint64_t now, expirations;
+  int i, n;
+
+  if (monitor_sched_init() != 0) {
+    return -1;
+  }
+
+  while (1) {
+    // monitors due within their jitter budget share this wakeup
+    now = now_ms();
+    for (i = 0; i < num_monitors; i++) {
+      struct monitor *m = &monitors[i];
+      if (m->active && !m->busy && m->next &&
+          m->next <= now + m->desc.jitter_ms) {
+        monitor_dispatch(m);
+      }
+    }
+
+    if (monitor_arm_timer() == 0) {
+      return 0;
+    }
+
+    n = epoll_wait(epoll_fd, events, MONITOR_MAX + 2, -1);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      syslog(LOG_CRIT, "%s: epoll_wait failed: %s", __func__, strerror(errno));
+      return -1;
+    }
+
+    for (i = 0; i < n; i++) {
+      uint64_t idx = events[i].data.u64;
+
+      if (idx == EV_TIMER) {
+        if (read(timer_fd, &expirations, sizeof(expirations)) < 0 &&
+            errno != EAGAIN) {
+          syslog(LOG_ERR, "%s: timer read failed: %s", __func__, strerror(errno));
+        }
+      } else if (idx == EV_DONE) {
+        monitor_collect_done();
+      } else if (monitors[idx].active) {
+        if (monitors[idx].busy) {
+          monitors[idx].pending = true;
+        } else {
+          monitor_dispatch(&monitors[idx]);
+        }
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * monitor_sched.h
+ *
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef __MONITOR_SCHED_H__
+#define __MONITOR_SCHED_H__
+
+#include <stdint.h>
+
+/*
+ * healthd runs its monitors from a single epoll loop instead of one
+ * sleeping thread each. A monitor is a handler run every period, when
+ * its fd becomes ready, or both. Handlers which may block (IPMB, I2C,
+ * system()) are flagged MONITOR_F_OFFLOAD and run in a small worker pool;
+ * the others run in the loop and must return quickly.
+ *
+ * A handler returns MONITOR_PERIOD to run again after its period,
+ * a positive delay in milli-seconds to run again after that instead, or
+ * MONITOR_STOP to be unregistered. A monitor never runs concurrently
+ * with itself.
+ */
+
+#define MONITOR_STOP    (-1)
+#define MONITOR_PERIOD  0
+
+#define MONITOR_F_OFFLOAD 0x1
+
+#define MONITOR_MAX       32
+#define MONITOR_WORKERS   2
+
+typedef int (*monitor_handler_t)(void *arg);
+
+struct monitor_desc {
+  const char *name;
+  unsigned int period_ms;   // 0 if only run on fd events
+  unsigned int jitter_ms;   // may run this early to share a wakeup
+  unsigned int delay_ms;    // before the first run
+  int fd;                   // -1, or run when it is ready for "events"
+  uint32_t events;          // EPOLLIN, EPOLLPRI, ...
+  int flags;
+  monitor_handler_t handler;
+  void *arg;
+};
+
+/*
+ * Register a monitor, returns 0 on success. May be called before
+ * monitor_sched_run() only.
+ */
+int monitor_register(const struct monitor_desc *desc);
+
+/*
+ * Run the monitors, returns when all monitors stopped or on error.
+ */
+int monitor_sched_run(void);
+
+#endif /* __MONITOR_SCHED_H__ */
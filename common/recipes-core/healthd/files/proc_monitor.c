@@ -0,0 +1,746 @@
+/*
+ * proc_monitor.c: per-daemon resource accounting and pressure stall monitor
+ *
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <jansson.h>
+#include <openbmc/kv.h>
+#include "monitor_sched.h"
+
+/*
+ * The daemons listed in the "proc_monitor" config are sampled every
+ * monitor_interval from /proc/<pid>/{stat,statm,io}, whose fds are kept
+ * open. Over a window of samples we derive the CPU usage, the RSS growth
+ * and the I/O rate of each of them, log a critical event when one spins
+ * or leaks, and publish the results:
+ *  - in PROC_SHM_PATH for "healthd --top",
+ *  - the top PROC_TOP_NUM CPU users in the "proc_top" kv (JSON).
+ * Pressure stall triggers on /proc/pressure/{cpu,memory,io} wake us up
+ * when the system stalls, and the stall is logged with the daemon most
+ * likely responsible for it.
+ */
+
+#define PROC_MAX              32
+#define PROC_NAME_LEN         32
+#define PROC_TOP_NUM          3
+#define PROC_TOP_KEY          "proc_top"
+#define PROC_SHM_PATH         "/dev/shm/healthd_proc"
+#define PROC_SHM_MAGIC        0x434f5250 // "PROC"
+#define PSI_LOG_INTERVAL      60  // seconds between two logs of a stall
+
+#define PROC_F_SPIN           0x1
+#define PROC_F_LEAK           0x2
+
+enum {
+  PSI_CPU = 0,
+  PSI_MEM,
+  PSI_IO,
+  PSI_NUM,
+};
+
+struct proc_sample {
+  uint64_t time_ms;
+  unsigned long long ticks;     // utime + stime
+  unsigned long long io_bytes;  // read + write
+  unsigned long rss_kb;
+};
+
+struct proc_entry {
+  char name[PROC_NAME_LEN];
+  int pid;                      // -1 if not running
+  int stat_fd;
+  int statm_fd;
+  int io_fd;
+  struct proc_sample *window;
+  unsigned int head;
+  unsigned int count;
+  uint32_t flags;               // PROC_F_*
+  float cpu;                    // % of one CPU over the window
+  long rss_growth_kb;           // over the window
+  float io_kbps;
+};
+
+struct psi_res {
+  const char *name;
+  const char *path;
+  unsigned int stall_ms;        // 0 if no trigger
+  unsigned int window_ms;
+  int fd;
+  float avg10;                  // "some" stall % over the last 10 sec
+  time_t last_log;
+};
+
+/* Layout of PROC_SHM_PATH, updated under a sequence count */
+struct proc_shm_entry {
+  char name[PROC_NAME_LEN];
+  int32_t pid;
+  uint32_t flags;
+  float cpu;
+  uint32_t rss_kb;
+  int32_t rss_growth_kb;
+  float io_kbps;
+};
+
+struct proc_shm {
+  uint32_t magic;
+  uint32_t seq;                 // odd while being updated
+  uint32_t time;
+  uint32_t window_sec;
+  uint32_t num_procs;
+  float psi_avg10[PSI_NUM];     // -1 if not supported
+  struct proc_shm_entry procs[PROC_MAX];
+};
+
+bool proc_monitor_enabled = false;
+
+static unsigned int proc_monitor_interval_ms = 5000;
+static unsigned int proc_window_size = 60;
+static float proc_cpu_threshold = 60.0;
+static long proc_rss_growth_kbytes = 4096;
+static struct proc_entry procs[PROC_MAX];
+static int num_procs = 0;
+static uint64_t next_scan_ms = 0;
+static struct proc_shm *shm = NULL;
+static char top_value[MAX_VALUE_LEN];
+
+static struct psi_res psi[PSI_NUM] = {
+  [PSI_CPU] = {"CPU", "/proc/pressure/cpu", 0, 0, -1, -1, 0},
+  [PSI_MEM] = {"memory", "/proc/pressure/memory", 0, 0, -1, -1, 0},
+  [PSI_IO] = {"IO", "/proc/pressure/io", 0, 0, -1, -1, 0},
+};
+
+static uint64_t
+now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void
+initialize_psi_config(struct psi_res *res, json_t *conf) {
+  json_t *tmp;
+
+  if (!conf) {
+    return;
+  }
+  tmp = json_object_get(conf, "stall_ms");
+  if (tmp && json_is_integer(tmp) && json_integer_value(tmp) > 0) {
+    res->stall_ms = json_integer_value(tmp);
+    res->window_ms = 2000;
+  }
+  tmp = json_object_get(conf, "window_ms");
+  if (tmp && json_is_integer(tmp) && json_integer_value(tmp) > 0) {
+    res->window_ms = json_integer_value(tmp);
+  }
+}
+
+void
+initialize_proc_monitor_config(json_t *conf) {
+  json_t *tmp, *name;
+  size_t i;
+
+  if (!conf) {
+    return;
+  }
+
+  tmp = json_object_get(conf, "enabled");
+  if (!tmp || !json_is_boolean(tmp)) {
+    return;
+  }
+  if (!(proc_monitor_enabled = json_is_true(tmp))) {
+    return;
+  }
+
+  tmp = json_object_get(conf, "monitor_interval");
+  if (tmp && json_is_number(tmp) && json_number_value(tmp) * 1000 >= 1) {
+    proc_monitor_interval_ms = json_number_value(tmp) * 1000;
+  }
+
+  tmp = json_object_get(conf, "window_size");
+  if (tmp && json_is_integer(tmp) && json_integer_value(tmp) > 1) {
+    proc_window_size = json_integer_value(tmp);
+  }
+
+  tmp = json_object_get(conf, "cpu_threshold");
+  if (tmp && json_is_number(tmp)) {
+    proc_cpu_threshold = json_number_value(tmp);
+  }
+
+  tmp = json_object_get(conf, "rss_growth_kbytes");
+  if (tmp && json_is_integer(tmp)) {
+    proc_rss_growth_kbytes = json_integer_value(tmp);
+  }
+
+  tmp = json_object_get(conf, "processes");
+  if (tmp && json_is_array(tmp)) {
+    json_array_foreach(tmp, i, name) {
+      if (!json_is_string(name) || num_procs >= PROC_MAX) {
+        continue;
+      }
+      snprintf(procs[num_procs].name, PROC_NAME_LEN, "%s", json_string_value(name));
+      procs[num_procs].pid = -1;
+      procs[num_procs].stat_fd = -1;
+      procs[num_procs].statm_fd = -1;
+      procs[num_procs].io_fd = -1;
+      num_procs++;
+    }
+  }
+
+  tmp = json_object_get(conf, "pressure");
+  if (tmp && json_is_object(tmp)) {
+    initialize_psi_config(&psi[PSI_CPU], json_object_get(tmp, "cpu"));
+    initialize_psi_config(&psi[PSI_MEM], json_object_get(tmp, "memory"));
+    initialize_psi_config(&psi[PSI_IO], json_object_get(tmp, "io"));
+  }
+}
+
+static void
+proc_close(struct proc_entry *p) {
+  if (p->stat_fd >= 0) {
+    close(p->stat_fd);
+  }
+  if (p->statm_fd >= 0) {
+    close(p->statm_fd);
+  }
+  if (p->io_fd >= 0) {
+    close(p->io_fd);
+  }
+  p->stat_fd = p->statm_fd = p->io_fd = -1;
+  p->pid = -1;
+  p->head = p->count = 0;
+  p->cpu = 0;
+  p->rss_growth_kb = 0;
+  p->io_kbps = 0;
+}
+
+static int
+proc_open(struct proc_entry *p, int pid) {
+  char path[64];
+
+  p->pid = pid;
+  snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+  p->stat_fd = open(path, O_RDONLY | O_CLOEXEC);
+  snprintf(path, sizeof(path), "/proc/%d/statm", pid);
+  p->statm_fd = open(path, O_RDONLY | O_CLOEXEC);
+  // not fatal, I/O accounting may be disabled in the kernel
+  snprintf(path, sizeof(path), "/proc/%d/io", pid);
+  p->io_fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (p->stat_fd < 0 || p->statm_fd < 0) {
+    proc_close(p);
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * Daemons are matched by the base name of argv[0], or of argv[1] for
+ * interpreted ones (python3 /usr/local/bin/fscd.py), without extension.
+ */
+static bool
+proc_match(const char *cmdline, size_t len, const char *name) {
+  const char *arg = cmdline, *base, *dot;
+  int i;
+
+  for (i = 0; i < 2 && arg < cmdline + len; i++) {
+    base = strrchr(arg, '/');
+    base = base ? base + 1 : arg;
+    dot = strchr(base, '.');
+    if (dot ? (strlen(name) == (size_t)(dot - base) &&
+               !strncmp(base, name, dot - base)) : !strcmp(base, name)) {
+      return true;
+    }
+    arg += strlen(arg) + 1;
+  }
+  return false;
+}
+
+// Look up the pids of the daemons which are not running
+static void
+proc_scan(void) {
+  struct dirent *de;
+  char path[64], cmdline[256];
+  ssize_t len;
+  DIR *dir;
+  int i, fd, pid;
+
+  dir = opendir("/proc");
+  if (!dir) {
+    syslog(LOG_WARNING, "%s: cannot open /proc: %s", __func__, strerror(errno));
+    return;
+  }
+
+  while ((de = readdir(dir)) != NULL) {
+    if (!isdigit(de->d_name[0])) {
+      continue;
+    }
+    pid = atoi(de->d_name);
+    snprintf(path, sizeof(path), "/proc/%d/cmdline", pid);
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0) {
+      continue;
+    }
+    len = read(fd, cmdline, sizeof(cmdline) - 1);
+    close(fd);
+    if (len <= 0) {
+      continue;  // kernel thread
+    }
+    cmdline[len] = '\0';
+
+    for (i = 0; i < num_procs; i++) {
+      if (procs[i].pid < 0 && proc_match(cmdline, len, procs[i].name)) {
+        proc_open(&procs[i], pid);
+        break;
+      }
+    }
+  }
+  closedir(dir);
+}
+
+static ssize_t
+proc_read(int fd, char *buf, size_t size) {
+  ssize_t len;
+
+  if (fd < 0 || (len = pread(fd, buf, size - 1, 0)) <= 0) {
+    return -1;
+  }
+  buf[len] = '\0';
+  return len;
+}
+
+static int
+proc_sample(struct proc_entry *p, struct proc_sample *s) {
+  static long page_kb = 0;
+  unsigned long long utime, stime, rbytes = 0, wbytes = 0;
+  unsigned long size, resident;
+  char buf[512], *ptr;
+
+  if (!page_kb) {
+    page_kb = sysconf(_SC_PAGESIZE) / 1024;
+  }
+
+  // the command name may contain spaces and parentheses
+  if (proc_read(p->stat_fd, buf, sizeof(buf)) < 0 ||
+      !(ptr = strrchr(buf, ')')) ||
+      sscanf(ptr + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",
+             &utime, &stime) != 2) {
+    return -1;
+  }
+  if (proc_read(p->statm_fd, buf, sizeof(buf)) < 0 ||
+      sscanf(buf, "%lu %lu", &size, &resident) != 2) {
+    return -1;
+  }
+  if (proc_read(p->io_fd, buf, sizeof(buf)) > 0) {
+    if ((ptr = strstr(buf, "\nread_bytes:"))) {
+      rbytes = strtoull(ptr + 12, NULL, 10);
+    }
+    if ((ptr = strstr(buf, "\nwrite_bytes:"))) {
+      wbytes = strtoull(ptr + 13, NULL, 10);
+    }
+  }
+
+  s->time_ms = now_ms();
+  s->ticks = utime + stime;
+  s->rss_kb = resident * page_kb;
+  s->io_bytes = rbytes + wbytes;
+  return 0;
+}
+
+// Derive the usage from the oldest and newest samples of the window
+static void
+proc_update(struct proc_entry *p) {
+  static long ticks_per_sec = 0;
+  struct proc_sample *old, *new;
+  float elapsed;
+
+  if (!ticks_per_sec) {
+    ticks_per_sec = sysconf(_SC_CLK_TCK);
+  }
+
+  new = &p->window[(p->head + proc_window_size - 1) % proc_window_size];
+  old = &p->window[(p->head + proc_window_size - p->count) % proc_window_size];
+  if (p->count < 2 || new->time_ms <= old->time_ms) {
+    return;
+  }
+  elapsed = (new->time_ms - old->time_ms) / 1000.0;
+
+  p->cpu = (new->ticks - old->ticks) * 100.0 / ticks_per_sec / elapsed;
+  p->rss_growth_kb = (long)new->rss_kb - (long)old->rss_kb;
+  p->io_kbps = (new->io_bytes - old->io_bytes) / 1024.0 / elapsed;
+
+  // only judge a daemon over a full window
+  if (p->count < proc_window_size) {
+    return;
+  }
+
+  if (!(p->flags & PROC_F_SPIN) && p->cpu >= proc_cpu_threshold) {
+    p->flags |= PROC_F_SPIN;
+    syslog(LOG_CRIT, "ASSERT: %s (pid %d) CPU usage (%.2f%%) exceeds the threshold (%.2f%%).",
+           p->name, p->pid, p->cpu, proc_cpu_threshold);
+  } else if ((p->flags & PROC_F_SPIN) && p->cpu < proc_cpu_threshold * 0.9) {
+    p->flags &= ~PROC_F_SPIN;
+    syslog(LOG_CRIT, "DEASSERT: %s (pid %d) CPU usage (%.2f%%) is under the threshold (%.2f%%).",
+           p->name, p->pid, p->cpu, proc_cpu_threshold);
+  }
+
+  if (proc_rss_growth_kbytes <= 0) {
+    return;
+  }
+  if (!(p->flags & PROC_F_LEAK) && p->rss_growth_kb >= proc_rss_growth_kbytes) {
+    p->flags |= PROC_F_LEAK;
+    syslog(LOG_CRIT, "ASSERT: %s (pid %d) memory grew by %ld kB to %lu kB in %.0f sec, possible leak.",
+           p->name, p->pid, p->rss_growth_kb, new->rss_kb, elapsed);
+  } else if ((p->flags & PROC_F_LEAK) && p->rss_growth_kb <= 0) {
+    p->flags &= ~PROC_F_LEAK;
+    syslog(LOG_CRIT, "DEASSERT: %s (pid %d) memory is stable at %lu kB.",
+           p->name, p->pid, new->rss_kb);
+  }
+}
+
+static void
+psi_read(struct psi_res *res) {
+  char buf[256];
+  float avg10;
+
+  if (proc_read(res->fd, buf, sizeof(buf)) < 0 ||
+      sscanf(buf, "some avg10=%f", &avg10) != 1) {
+    res->avg10 = -1;
+    return;
+  }
+  res->avg10 = avg10;
+}
+
+static void
+proc_publish(void) {
+  struct proc_entry *top[PROC_TOP_NUM] = {NULL};
+  struct proc_shm_entry *e;
+  char value[MAX_VALUE_LEN];
+  int i, j, n, len;
+
+  if (shm) {
+    __atomic_add_fetch(&shm->seq, 1, __ATOMIC_ACQ_REL);
+    shm->time = time(NULL);
+    shm->window_sec = proc_monitor_interval_ms * proc_window_size / 1000;
+    shm->num_procs = num_procs;
+    for (i = 0; i < PSI_NUM; i++) {
+      shm->psi_avg10[i] = psi[i].avg10;
+    }
+    for (i = 0; i < num_procs; i++) {
+      e = &shm->procs[i];
+      memcpy(e->name, procs[i].name, PROC_NAME_LEN);
+      e->pid = procs[i].pid;
+      e->flags = procs[i].flags;
+      e->cpu = procs[i].cpu;
+      e->rss_kb = procs[i].count ?
+        procs[i].window[(procs[i].head + proc_window_size - 1) % proc_window_size].rss_kb : 0;
+      e->rss_growth_kb = procs[i].rss_growth_kb;
+      e->io_kbps = procs[i].io_kbps;
+    }
+    __atomic_add_fetch(&shm->seq, 1, __ATOMIC_ACQ_REL);
+  }
+
+  // insertion sort of the top CPU users
+  for (i = 0; i < num_procs; i++) {
+    if (procs[i].pid < 0 || procs[i].count == 0) {
+      continue;
+    }
+    for (j = 0; j < PROC_TOP_NUM; j++) {
+      if (!top[j] || procs[i].cpu > top[j]->cpu) {
+        memmove(&top[j + 1], &top[j], (PROC_TOP_NUM - j - 1) * sizeof(top[0]));
+        top[j] = &procs[i];
+        break;
+      }
+    }
+  }
+
+  len = snprintf(value, sizeof(value), "[");
+  for (j = 0, n = 0; j < PROC_TOP_NUM && top[j]; j++) {
+    n = snprintf(value + len, sizeof(value) - len,
+                 "%s{\"name\":\"%s\",\"pid\":%d,\"cpu\":%.1f,\"rss_kb\":%lu}",
+                 j ? "," : "", top[j]->name, top[j]->pid, top[j]->cpu,
+                 top[j]->window[(top[j]->head + proc_window_size - 1) % proc_window_size].rss_kb);
+    if (n < 0 || len + n >= (int)sizeof(value) - 1) {
+      break;
+    }
+    len += n;
+  }
+  value[len++] = ']';
+  value[len] = '\0';
+
+  // the kv store is file backed, only write it on changes
+  if (strcmp(value, top_value)) {
+    if (kv_set(PROC_TOP_KEY, value, 0, 0) == 0) {
+      strcpy(top_value, value);
+    }
+  }
+}
+
+static int
+proc_monitor(void *arg) {
+  struct proc_entry *p;
+  bool missing = false;
+  uint64_t now = now_ms();
+  int i;
+
+  for (i = 0; i < num_procs; i++) {
+    p = &procs[i];
+    if (p->pid >= 0 && proc_sample(p, &p->window[p->head]) < 0) {
+      syslog(LOG_INFO, "%s (pid %d) exited", p->name, p->pid);
+      proc_close(p);
+    }
+    if (p->pid < 0) {
+      missing = true;
+      continue;
+    }
+    p->head = (p->head + 1) % proc_window_size;
+    if (p->count < proc_window_size) {
+      p->count++;
+    }
+    proc_update(p);
+  }
+
+  // walking /proc is the expensive part, do it at most once per window
+  if (missing && now >= next_scan_ms) {
+    next_scan_ms = now + (uint64_t)proc_monitor_interval_ms * proc_window_size;
+    proc_scan();
+  }
+
+  for (i = 0; i < PSI_NUM; i++) {
+    psi_read(&psi[i]);
+  }
+  proc_publish();
+  return MONITOR_PERIOD;
+}
+
+/*
+ * Blame the running daemon with the highest usage of the stalled
+ * resource over the last window.
+ */
+static struct proc_entry *
+psi_offender(struct psi_res *res) {
+  struct proc_entry *top = NULL;
+  float val, top_val = 0;
+  int i;
+
+  for (i = 0; i < num_procs; i++) {
+    if (procs[i].pid < 0) {
+      continue;
+    }
+    if (res == &psi[PSI_CPU]) {
+      val = procs[i].cpu;
+    } else if (res == &psi[PSI_MEM]) {
+      val = procs[i].rss_growth_kb;
+    } else {
+      val = procs[i].io_kbps;
+    }
+    if (val > top_val) {
+      top = &procs[i];
+      top_val = val;
+    }
+  }
+  return top;
+}
+
+static int
+psi_monitor(void *arg) {
+  struct psi_res *res = arg;
+  struct proc_entry *p;
+  time_t now = time(NULL);
+
+  psi_read(res);
+  if (now - res->last_log < PSI_LOG_INTERVAL) {
+    return MONITOR_PERIOD;
+  }
+  res->last_log = now;
+
+  p = psi_offender(res);
+  if (p) {
+    syslog(LOG_WARNING, "%s pressure: stalled over %u ms in %u ms (avg10 %.2f%%), "
+           "top user %s (pid %d): CPU %.2f%%, RSS growth %ld kB, IO %.2f kB/s",
+           res->name, res->stall_ms, res->window_ms, res->avg10, p->name, p->pid,
+           p->cpu, p->rss_growth_kb, p->io_kbps);
+  } else {
+    syslog(LOG_WARNING, "%s pressure: stalled over %u ms in %u ms (avg10 %.2f%%)",
+           res->name, res->stall_ms, res->window_ms, res->avg10);
+  }
+  return MONITOR_PERIOD;
+}
+
+static int
+psi_init(struct psi_res *res) {
+  struct monitor_desc desc = {
+    .name = res->name,
+    .fd = -1,
+    .events = EPOLLPRI,
+    .handler = psi_monitor,
+    .arg = res,
+  };
+  char trigger[64];
+  int len;
+
+  if (!res->stall_ms) {
+    res->fd = open(res->path, O_RDONLY | O_CLOEXEC);
+    return 0;
+  }
+
+  res->fd = open(res->path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+  if (res->fd < 0) {
+    syslog(LOG_WARNING, "%s: %s not supported: %s", __func__, res->path, strerror(errno));
+    return 0;
+  }
+  len = snprintf(trigger, sizeof(trigger), "some %u %u",
+                 res->stall_ms * 1000, res->window_ms * 1000);
+  if (write(res->fd, trigger, len + 1) < 0) {
+    syslog(LOG_WARNING, "%s: cannot set trigger \"%s\" on %s: %s", __func__,
+           trigger, res->path, strerror(errno));
+    return 0;
+  }
+
+  desc.fd = res->fd;
+  return monitor_register(&desc);
+}
+
+int
+register_proc_monitor(void) {
+  struct monitor_desc desc = {
+    .name = "process usage",
+    .period_ms = proc_monitor_interval_ms,
+    .jitter_ms = proc_monitor_interval_ms / 10,
+    .fd = -1,
+    .handler = proc_monitor,
+  };
+  int i, fd;
+
+  for (i = 0; i < num_procs; i++) {
+    procs[i].window = calloc(proc_window_size, sizeof(struct proc_sample));
+    if (!procs[i].window) {
+      return -1;
+    }
+  }
+
+  fd = open(PROC_SHM_PATH, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0 || ftruncate(fd, sizeof(*shm)) < 0 ||
+      (shm = mmap(NULL, sizeof(*shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+    syslog(LOG_WARNING, "%s: cannot map %s: %s", __func__, PROC_SHM_PATH, strerror(errno));
+    shm = NULL;
+  } else {
+    memset(shm, 0, sizeof(*shm));
+    shm->magic = PROC_SHM_MAGIC;
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+
+  for (i = 0; i < PSI_NUM; i++) {
+    if (psi_init(&psi[i])) {
+      return -1;
+    }
+  }
+
+  proc_scan();
+  next_scan_ms = now_ms() + (uint64_t)proc_monitor_interval_ms * proc_window_size;
+  return monitor_register(&desc);
+}
+
+/*
+ * "healthd --top": print the usage of the monitored daemons published by
+ * the running healthd, highest CPU usage first.
+ */
+int
+proc_monitor_dump(void) {
+  struct proc_shm *map, snap;
+  struct proc_shm_entry tmp;
+  uint32_t seq;
+  int fd, i, j, retry;
+
+  fd = open(PROC_SHM_PATH, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    fprintf(stderr, "Process monitoring is not running\n");
+    return -1;
+  }
+  map = mmap(NULL, sizeof(*map), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "Cannot map %s: %s\n", PROC_SHM_PATH, strerror(errno));
+    return -1;
+  }
+
+  for (retry = 0; retry < 100; retry++) {
+    seq = __atomic_load_n(&map->seq, __ATOMIC_ACQUIRE);
+    if (seq & 1) {
+      usleep(1000);
+      continue;
+    }
+    memcpy(&snap, map, sizeof(snap));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&map->seq, __ATOMIC_RELAXED) == seq) {
+      break;
+    }
+  }
+  munmap(map, sizeof(*map));
+  if (retry == 100 || snap.magic != PROC_SHM_MAGIC || snap.num_procs > PROC_MAX) {
+    fprintf(stderr, "Process usage is not available\n");
+    return -1;
+  }
+
+  for (i = 1; i < snap.num_procs; i++) {
+    tmp = snap.procs[i];
+    for (j = i; j > 0 && snap.procs[j - 1].cpu < tmp.cpu; j--) {
+      snap.procs[j] = snap.procs[j - 1];
+    }
+    snap.procs[j] = tmp;
+  }
+
+  printf("Window: %u sec, updated %ld sec ago\n", snap.window_sec,
+         (long)(time(NULL) - snap.time));
+  for (i = 0; i < PSI_NUM; i++) {
+    if (snap.psi_avg10[i] >= 0) {
+      printf("%s pressure (avg10): %.2f%%\n", psi[i].name, snap.psi_avg10[i]);
+    }
+  }
+  printf("\n%-7s %-20s %7s %9s %12s %9s %s\n",
+         "PID", "NAME", "CPU%", "RSS(kB)", "GROWTH(kB)", "IO(kB/s)", "EVENTS");
+  for (i = 0; i < snap.num_procs; i++) {
+    struct proc_shm_entry *e = &snap.procs[i];
+
+    if (e->pid < 0) {
+      printf("%-7s %-20s\n", "-", e->name);
+      continue;
+    }
+    printf("%-7d %-20s %7.2f %9u %12d %9.2f %s%s\n", e->pid, e->name, e->cpu,
+           e->rss_kb, e->rss_growth_kb, e->io_kbps,
+           (e->flags & PROC_F_SPIN) ? "spinning " : "",
+           (e->flags & PROC_F_LEAK) ? "leaking" : "");
+  }
+  return 0;
+}
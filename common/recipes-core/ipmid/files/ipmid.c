@@ -20,6 +20,7 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#define _GNU_SOURCE     /* To get pthread_rwlockattr_setkind_np */
 #include "sdr.h"
 #include "sel.h"
 #include "fruid.h"
@@ -42,9 +43,12 @@
 #include <openbmc/ipc.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <time.h>
 #include "sensor.h"
 
 #define MAX_REQUESTS 64
+// No payload may hold more than this many of the MAX_REQUESTS threads
+#define MAX_PAYLOAD_REQUESTS (MAX_REQUESTS / 4)
 #define SIZE_IANA_ID 3
 #define SIZE_GUID 16
 
@@ -148,19 +152,81 @@ static char *drive_info_key[] =
   "wwn"
 };
 
-// TODO: Based on performance testing results, might need fine grained locks
-// Since the global data is specific to a NetFunction, adding locs at NetFn level
-static pthread_mutex_t m_chassis;
-static pthread_mutex_t m_sensor;
-static pthread_mutex_t m_app;
-static pthread_mutex_t m_storage;
-static pthread_mutex_t m_transport;
-static pthread_mutex_t m_oem;
-static pthread_mutex_t m_oem_storage;
-static pthread_mutex_t m_oem_1s;
-static pthread_mutex_t m_oem_usb_dbg;
-static pthread_mutex_t m_oem_q;
-static pthread_mutex_t m_oem_zion;
+/*
+ * Commands are serialized according to their concurrency class:
+ *  - CMD_GLOBAL: the handler may touch data shared by all slots (SEL, SDR,
+ *    LAN config, ...) and runs alone within its NetFn. This is the class
+ *    of every command not listed in g_cmd_class.
+ *  - CMD_SLOT: the handler only touches data of the requesting payload,
+ *    it is serialized with the CMD_SLOT commands of the same NetFn and
+ *    payload, and with the CMD_GLOBAL commands of its NetFn.
+ *  - CMD_REENTRANT: the handler needs no serialization.
+ */
+enum {
+  CMD_GLOBAL = 0,
+  CMD_SLOT,
+  CMD_REENTRANT,
+};
+
+// Request NetFns are even, so NetFn >> 1 indexes the locks
+#define NUM_NETFN_LOCKS 32
+
+struct netfn_lock {
+  pthread_rwlock_t lock;                  // CMD_GLOBAL write, CMD_SLOT read
+  pthread_mutex_t slot[MAX_NUM_FRUS + 1]; // CMD_SLOT, by payload_id
+};
+
+static struct netfn_lock g_netfn_lock[NUM_NETFN_LOCKS];
+static unsigned char g_cmd_class_map[NUM_NETFN_LOCKS][256];
+
+static const struct {
+  unsigned char netfn;
+  unsigned char cmd;
+  unsigned char cls;
+} g_cmd_class[] = {
+  {NETFN_CHASSIS_REQ, CMD_CHASSIS_GET_STATUS, CMD_SLOT},
+  {NETFN_CHASSIS_REQ, CMD_CHASSIS_CONTROL, CMD_SLOT},
+  {NETFN_CHASSIS_REQ, CMD_CHASSIS_IDENTIFY, CMD_SLOT},
+  {NETFN_CHASSIS_REQ, CMD_CHASSIS_GET_SYSTEM_RESTART_CAUSE, CMD_SLOT},
+  {NETFN_APP_REQ, CMD_APP_GET_DEVICE_ID, CMD_REENTRANT},
+  {NETFN_APP_REQ, CMD_APP_RESET_WDT, CMD_SLOT},
+  {NETFN_APP_REQ, CMD_APP_SET_WDT, CMD_SLOT},
+  {NETFN_APP_REQ, CMD_APP_GET_WDT, CMD_SLOT},
+  {NETFN_OEM_REQ, CMD_OEM_SET_PROC_INFO, CMD_SLOT},
+  {NETFN_OEM_REQ, CMD_OEM_GET_PROC_INFO, CMD_SLOT},
+  {NETFN_OEM_REQ, CMD_OEM_SET_DIMM_INFO, CMD_SLOT},
+  {NETFN_OEM_REQ, CMD_OEM_GET_DIMM_INFO, CMD_SLOT},
+  {NETFN_OEM_REQ, CMD_OEM_SET_POST_START, CMD_SLOT},
+  {NETFN_OEM_REQ, CMD_OEM_SET_POST_END, CMD_SLOT},
+  {NETFN_OEM_REQ, CMD_OEM_SET_PPIN_INFO, CMD_SLOT},
+  {NETFN_OEM_REQ, CMD_OEM_BYPASS_CMD, CMD_SLOT},
+  {NETFN_OEM_REQ, CMD_OEM_GET_BOARD_ID, CMD_SLOT},
+  {NETFN_OEM_REQ, CMD_OEM_GET_80PORT_RECORD, CMD_SLOT},
+  {NETFN_OEM_REQ, CMD_OEM_GET_80_PORT_DWORD_BUFFER, CMD_SLOT},
+  {NETFN_OEM_Q_REQ, CMD_OEM_Q_SET_PROC_INFO, CMD_SLOT},
+  {NETFN_OEM_Q_REQ, CMD_OEM_Q_GET_PROC_INFO, CMD_SLOT},
+  {NETFN_OEM_Q_REQ, CMD_OEM_Q_SET_DIMM_INFO, CMD_SLOT},
+  {NETFN_OEM_Q_REQ, CMD_OEM_Q_GET_DIMM_INFO, CMD_SLOT},
+  {NETFN_OEM_Q_REQ, CMD_OEM_Q_SET_DRIVE_INFO, CMD_SLOT},
+  {NETFN_OEM_Q_REQ, CMD_OEM_Q_GET_DRIVE_INFO, CMD_SLOT},
+  {NETFN_OEM_Q_REQ, CMD_OEM_Q_SET_SMU_PSP_VER, CMD_SLOT},
+  {NETFN_OEM_Q_REQ, CMD_OEM_Q_GET_SMU_PSP_VER, CMD_SLOT},
+  // Bridged requests are dispatched again by ipmi_handle()
+  {NETFN_OEM_1S_REQ, CMD_OEM_1S_MSG_IN, CMD_REENTRANT},
+  {NETFN_OEM_1S_REQ, CMD_OEM_1S_INTR, CMD_SLOT},
+  {NETFN_OEM_1S_REQ, CMD_OEM_1S_POST_BUF, CMD_SLOT},
+  {NETFN_OEM_1S_REQ, CMD_OEM_1S_PLAT_DISC, CMD_SLOT},
+  {NETFN_OEM_1S_REQ, CMD_OEM_1S_BIC_RESET, CMD_SLOT},
+  {NETFN_OEM_1S_REQ, CMD_OEM_1S_BIC_UPDATE_MODE, CMD_SLOT},
+  {NETFN_OEM_1S_REQ, CMD_OEM_1S_ASD_MSG_IN, CMD_SLOT},
+  {NETFN_OEM_1S_REQ, CMD_OEM_1S_RAS_DUMP_IN, CMD_SLOT},
+  {NETFN_OEM_1S_REQ, CMD_OEM_1S_4BYTE_POST_BUF, CMD_SLOT},
+  {NETFN_OEM_1S_REQ, CMD_OEM_1S_GET_SYS_FW_VER, CMD_SLOT},
+};
+
+// Requests being handled per payload_id
+static pthread_mutex_t m_payload = PTHREAD_MUTEX_INITIALIZER;
+static unsigned char g_payload_active[256];
 
 extern int plat_udbg_get_frame_info(uint8_t *num);
 extern int plat_udbg_get_updated_frames(uint8_t *count, uint8_t *buffer);
@@ -381,7 +447,6 @@ ipmi_handle_chassis (unsigned char *request, unsigned char req_len,
   ipmi_res_t *res = (ipmi_res_t *) response;
   unsigned char cmd = req->cmd;
 
-  pthread_mutex_lock(&m_chassis);
   switch (cmd)
   {
     case CMD_CHASSIS_GET_STATUS:
@@ -413,7 +478,6 @@ ipmi_handle_chassis (unsigned char *request, unsigned char req_len,
       res->cc = CC_INVALID_CMD;
       break;
   }
-  pthread_mutex_unlock(&m_chassis);
 }
 
 /*
@@ -522,7 +586,6 @@ ipmi_handle_sensor(unsigned char *request, unsigned char req_len,
   ipmi_res_t *res = (ipmi_res_t *) response;
   unsigned char cmd = req->cmd;
 
-  pthread_mutex_lock(&m_sensor);
   switch (cmd)
   {
     case CMD_SENSOR_PLAT_EVENT_MSG:
@@ -538,7 +601,6 @@ ipmi_handle_sensor(unsigned char *request, unsigned char req_len,
       res->cc = CC_INVALID_CMD;
       break;
   }
-  pthread_mutex_unlock(&m_sensor);
 }
 
 /*
@@ -1163,7 +1225,6 @@ ipmi_handle_app (unsigned char *request, unsigned char req_len,
   ipmi_res_t *res = (ipmi_res_t *) response;
   unsigned char cmd = req->cmd;
 
-  pthread_mutex_lock(&m_app);
   switch (cmd)
   {
     case CMD_APP_GET_DEVICE_ID:
@@ -1224,7 +1285,6 @@ ipmi_handle_app (unsigned char *request, unsigned char req_len,
       res->cc = CC_INVALID_CMD;
       break;
   }
-  pthread_mutex_unlock(&m_app);
 }
 
 /*
@@ -1645,7 +1705,6 @@ ipmi_handle_storage (unsigned char *request, unsigned char req_len,
   res->cc = CC_SUCCESS;
   *res_len = 0;
 
-  pthread_mutex_lock(&m_storage);
   switch (cmd)
   {
     case CMD_STORAGE_GET_FRUID_INFO:
@@ -1698,7 +1757,6 @@ ipmi_handle_storage (unsigned char *request, unsigned char req_len,
       break;
   }
 
-  pthread_mutex_unlock(&m_storage);
   return;
 }
 
@@ -1969,7 +2027,6 @@ ipmi_handle_transport (unsigned char *request, unsigned char req_len,
   ipmi_res_t *res = (ipmi_res_t *) response;
   unsigned char cmd = req->cmd;
 
-  pthread_mutex_lock(&m_transport);
   switch (cmd)
   {
     case CMD_TRANSPORT_SET_LAN_CONFIG:
@@ -1985,7 +2042,6 @@ ipmi_handle_transport (unsigned char *request, unsigned char req_len,
       res->cc = CC_INVALID_CMD;
       break;
   }
-  pthread_mutex_unlock(&m_transport);
 }
 
 /*
@@ -3534,7 +3590,6 @@ ipmi_handle_oem (unsigned char *request, unsigned char req_len,
   ipmi_res_t *res = (ipmi_res_t *) response;
 
   unsigned char cmd = req->cmd;
-  pthread_mutex_lock(&m_oem);
   switch (cmd)
   {
     case CMD_OEM_ADD_RAS_SEL:
@@ -3682,7 +3737,6 @@ ipmi_handle_oem (unsigned char *request, unsigned char req_len,
       res->cc = CC_INVALID_CMD;
       break;
   }
-  pthread_mutex_unlock(&m_oem);
 }
 
 static void
@@ -3694,7 +3748,6 @@ ipmi_handle_oem_storage (unsigned char *request, unsigned char req_len,
 
   unsigned char cmd = req->cmd;
 
-  pthread_mutex_lock(&m_oem_storage);
   switch (cmd)
   {
     case CMD_OEM_STOR_ADD_STRING_SEL:
@@ -3704,7 +3757,6 @@ ipmi_handle_oem_storage (unsigned char *request, unsigned char req_len,
       res->cc = CC_INVALID_CMD;
       break;
   }
-  pthread_mutex_unlock(&m_oem_storage);
 }
 
 static void
@@ -3715,7 +3767,6 @@ ipmi_handle_oem_q (unsigned char *request, unsigned char req_len,
   ipmi_res_t *res = (ipmi_res_t *) response;
 
   unsigned char cmd = req->cmd;
-  pthread_mutex_lock(&m_oem_q);
   switch (cmd)
   {
     case CMD_OEM_Q_SET_PROC_INFO:
@@ -3746,7 +3797,6 @@ ipmi_handle_oem_q (unsigned char *request, unsigned char req_len,
       res->cc = CC_INVALID_CMD;
       break;
   }
-  pthread_mutex_unlock(&m_oem_q);
 }
 
 static void
@@ -3835,17 +3885,14 @@ ipmi_handle_oem_1s(unsigned char *request, unsigned char req_len,
 
   unsigned char cmd = req->cmd;
 
-  pthread_mutex_lock(&m_oem_1s);
   switch (cmd)
   {
     case CMD_OEM_1S_MSG_IN:
       // As all bridge in messages are IPMI request
       // all IPMI request will be process by ipmi_handle
-      // which will "properly" serialize the processing according to netfn
-      // Thus it is not necessary to serialize processing of MSG-IN.
-      pthread_mutex_unlock(&m_oem_1s);
+      // which will "properly" serialize the processing according to its
+      // command class. Thus MSG-IN itself is CMD_REENTRANT.
       oem_1s_handle_ipmb_req(request, req_len, response, res_len);
-      pthread_mutex_lock(&m_oem_1s);
       break;
     case CMD_OEM_1S_INTR:
 #ifdef DEBUG
@@ -3962,7 +4009,6 @@ ipmi_handle_oem_1s(unsigned char *request, unsigned char req_len,
       *res_len = 3;
       break;
   }
-  pthread_mutex_unlock(&m_oem_1s);
 }
 
 static void
@@ -4154,7 +4200,6 @@ ipmi_handle_oem_usb_dbg(unsigned char *request, unsigned char req_len,
 
   unsigned char cmd = req->cmd;
 
-  pthread_mutex_lock(&m_oem_usb_dbg);
   switch (cmd)
   {
     case CMD_OEM_USB_DBG_GET_FRAME_INFO:
@@ -4181,7 +4226,6 @@ ipmi_handle_oem_usb_dbg(unsigned char *request, unsigned char req_len,
       *res_len = 3;
       break;
   }
-  pthread_mutex_unlock(&m_oem_usb_dbg);
 }
 
 static void
@@ -4258,7 +4302,6 @@ ipmi_handle_oem_zion(unsigned char *request, unsigned char req_len,
 
   unsigned char cmd = req->cmd;
 
-  pthread_mutex_lock(&m_oem_zion);
   switch (cmd)
   {
     case CMD_OEM_ZION_GET_SYSTEM_MODE:
@@ -4279,7 +4322,82 @@ ipmi_handle_oem_zion(unsigned char *request, unsigned char req_len,
       *res_len = 3;
       break;
   }
-  pthread_mutex_unlock(&m_oem_zion);
+}
+
+static void
+ipmi_dispatch_init(void)
+{
+  pthread_rwlockattr_t attr;
+  int i, j;
+
+  // CMD_SLOT readers must not starve the CMD_GLOBAL commands
+  pthread_rwlockattr_init(&attr);
+  pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+  for (i = 0; i < NUM_NETFN_LOCKS; i++) {
+    pthread_rwlock_init(&g_netfn_lock[i].lock, &attr);
+    for (j = 0; j <= MAX_NUM_FRUS; j++) {
+      pthread_mutex_init(&g_netfn_lock[i].slot[j], NULL);
+    }
+  }
+  pthread_rwlockattr_destroy(&attr);
+
+  // DCMI is handled by PAL and has never been serialized by ipmid
+  memset(g_cmd_class_map[NETFN_DCMI_REQ >> 1], CMD_REENTRANT,
+         sizeof(g_cmd_class_map[0]));
+  for (i = 0; i < sizeof(g_cmd_class)/sizeof(g_cmd_class[0]); i++) {
+    g_cmd_class_map[g_cmd_class[i].netfn >> 1][g_cmd_class[i].cmd] = g_cmd_class[i].cls;
+  }
+}
+
+/*
+ * Serialize the request according to its command class, waiting until
+ * the deadline at most. Returns the class to pass to ipmi_cmd_unlock(),
+ * or -1 if the deadline passed.
+ */
+static int
+ipmi_cmd_lock(unsigned char netfn, unsigned char cmd, unsigned char payload_id,
+              const struct timespec *deadline)
+{
+  struct netfn_lock *nl = &g_netfn_lock[(netfn >> 1) % NUM_NETFN_LOCKS];
+  int cls = g_cmd_class_map[(netfn >> 1) % NUM_NETFN_LOCKS][cmd];
+
+  switch (cls) {
+    case CMD_GLOBAL:
+      if (pthread_rwlock_timedwrlock(&nl->lock, deadline)) {
+        return -1;
+      }
+      break;
+    case CMD_SLOT:
+      if (pthread_rwlock_timedrdlock(&nl->lock, deadline)) {
+        return -1;
+      }
+      if (pthread_mutex_timedlock(&nl->slot[payload_id % (MAX_NUM_FRUS + 1)], deadline)) {
+        pthread_rwlock_unlock(&nl->lock);
+        return -1;
+      }
+      break;
+    default:
+      break;
+  }
+  return cls;
+}
+
+static void
+ipmi_cmd_unlock(unsigned char netfn, unsigned char payload_id, int cls)
+{
+  struct netfn_lock *nl = &g_netfn_lock[(netfn >> 1) % NUM_NETFN_LOCKS];
+
+  switch (cls) {
+    case CMD_SLOT:
+      pthread_mutex_unlock(&nl->slot[payload_id % (MAX_NUM_FRUS + 1)]);
+      pthread_rwlock_unlock(&nl->lock);
+      break;
+    case CMD_GLOBAL:
+      pthread_rwlock_unlock(&nl->lock);
+      break;
+    default:
+      break;
+  }
 }
 
 /*
@@ -4293,6 +4411,8 @@ ipmi_handle (unsigned char *request, unsigned char req_len,
   ipmi_mn_req_t *req = (ipmi_mn_req_t *) request;
   ipmi_res_t *res = (ipmi_res_t *) response;
   unsigned char netfn;
+  struct timespec deadline;
+  int cls;
   netfn = req->netfn_lun >> 2;
 
   // Provide default values in the response message
@@ -4301,6 +4421,19 @@ ipmi_handle (unsigned char *request, unsigned char req_len,
   printf("ipmi_handle netfn %x cmd %x len %d\n", netfn, req->cmd, req_len);
   *(unsigned short*)res_len = 0;
 
+  // The requester stops waiting for the response after TIMEOUT_IPMI
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += TIMEOUT_IPMI;
+  cls = ipmi_cmd_lock(netfn, req->cmd, req->payload_id, &deadline);
+  if (cls < 0) {
+    syslog(LOG_WARNING, "ipmid: netfn 0x%x cmd 0x%x from payload %u timed out waiting",
+           netfn, req->cmd, req->payload_id);
+    res->netfn_lun = (netfn + 1) << 2;
+    res->cc = CC_NODE_BUSY;
+    *(unsigned short*)res_len = IPMI_RESP_HDR_SIZE;
+    return;
+  }
+
   switch (netfn)
   {
     case NETFN_CHASSIS_REQ:
@@ -4355,6 +4488,7 @@ ipmi_handle (unsigned char *request, unsigned char req_len,
       res->netfn_lun = (netfn + 1) << 2;
       break;
   }
+  ipmi_cmd_unlock(netfn, req->payload_id, cls);
 
   // This header includes NetFunction, Command, and Completion Code
   *(unsigned short*)res_len += IPMI_RESP_HDR_SIZE;
@@ -4367,6 +4501,8 @@ conn_handler(client_t *cli) {
   unsigned char req_buf[MAX_IPMI_MSG_SIZE];
   unsigned char res_buf[MAX_IPMI_MSG_SIZE];
   size_t req_len = MAX_IPMI_MSG_SIZE, res_len = 0;
+  unsigned char payload_id;
+  bool busy;
 
   memset(req_buf, 0, sizeof(req_buf));
   memset(res_buf, 0, sizeof(res_buf));
@@ -4376,7 +4512,30 @@ conn_handler(client_t *cli) {
     return -1;
   }
 
-  ipmi_handle(req_buf, (unsigned char)req_len, res_buf, (unsigned char*)&res_len);
+  // Keep a busy payload from taking all the threads of the other ones
+  payload_id = ((ipmi_mn_req_t *)req_buf)->payload_id;
+  pthread_mutex_lock(&m_payload);
+  busy = g_payload_active[payload_id] >= MAX_PAYLOAD_REQUESTS;
+  if (!busy) {
+    g_payload_active[payload_id]++;
+  }
+  pthread_mutex_unlock(&m_payload);
+
+  if (busy) {
+    ipmi_mn_req_t *req = (ipmi_mn_req_t *)req_buf;
+    ipmi_res_t *res = (ipmi_res_t *)res_buf;
+
+    res->netfn_lun = ((req->netfn_lun >> 2) + 1) << 2;
+    res->cmd = req->cmd;
+    res->cc = CC_NODE_BUSY;
+    res_len = IPMI_RESP_HDR_SIZE;
+  } else {
+    ipmi_handle(req_buf, (unsigned char)req_len, res_buf, (unsigned char*)&res_len);
+
+    pthread_mutex_lock(&m_payload);
+    g_payload_active[payload_id]--;
+    pthread_mutex_unlock(&m_payload);
+  }
 
   if (res_len == 0) {
     return -1;
@@ -4493,16 +4652,7 @@ main (void)
   sdr_init();
   sel_init();
 
-  pthread_mutex_init(&m_chassis, NULL);
-  pthread_mutex_init(&m_sensor, NULL);
-  pthread_mutex_init(&m_app, NULL);
-  pthread_mutex_init(&m_storage, NULL);
-  pthread_mutex_init(&m_transport, NULL);
-  pthread_mutex_init(&m_oem, NULL);
-  pthread_mutex_init(&m_oem_1s, NULL);
-  pthread_mutex_init(&m_oem_usb_dbg, NULL);
-  pthread_mutex_init(&m_oem_q, NULL);
-  pthread_mutex_init(&m_oem_zion, NULL);
+  ipmi_dispatch_init();
 
   pal_get_num_slots(&max_slot_num);
   fru = 1;
@@ -4532,15 +4682,5 @@ main (void)
   }
 
 
-  pthread_mutex_destroy(&m_chassis);
-  pthread_mutex_destroy(&m_sensor);
-  pthread_mutex_destroy(&m_app);
-  pthread_mutex_destroy(&m_storage);
-  pthread_mutex_destroy(&m_transport);
-  pthread_mutex_destroy(&m_oem);
-  pthread_mutex_destroy(&m_oem_1s);
-  pthread_mutex_destroy(&m_oem_usb_dbg);
-  pthread_mutex_destroy(&m_oem_q);
-
   return 0;
 }
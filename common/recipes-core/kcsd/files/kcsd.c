@@ -61,6 +61,8 @@
 #include <signal.h>
 #include <time.h>
 #include <getopt.h>
+#include <poll.h>
+#include <sys/signalfd.h>
 
 #include <openbmc/ipmi.h>
 #include <openbmc/libgpio.h>
@@ -84,23 +86,47 @@ static const uint8_t default_add_sel_resp[5] = {0x2c, 0x44, 0x00, 0x00, 0x00};
 static const uint8_t default_add_sel_res_len = (sizeof(default_add_sel_resp) *
                                                 sizeof(uint8_t));
 
+/*
+ * Add SEL requests are acked to the host right away and queued for a
+ * single worker, so a burst of SELs doesn't stall the KCS channel. The
+ * queue is bounded; when it is full the SEL is added inline instead of
+ * being dropped.
+ */
+#define SEL_QUEUE_SIZE 64
+#define KCS_MAX_REQ    256
+
+typedef struct {
+  uint8_t sel[KCS_MAX_REQ + 1];
+  int sel_len;
+} sel_entry;
+
 static struct {
-  pthread_mutex_t acquire_lock;
-  pthread_cond_t done;
-} sel_lock =
+  pthread_mutex_t lock;
+  pthread_cond_t not_empty;
+  int head;
+  int count;
+  sel_entry entries[SEL_QUEUE_SIZE];
+} sel_queue =
 {
-  .acquire_lock = PTHREAD_MUTEX_INITIALIZER, 
-  .done = PTHREAD_COND_INITIALIZER,
+  .lock = PTHREAD_MUTEX_INITIALIZER,
+  .not_empty = PTHREAD_COND_INITIALIZER,
 };
- 
-typedef struct sel_node
-{
-  uint8_t *sel;
-  int sel_len;
-  struct sel_node *next;
-} sel_list;
 
-static sel_list *head_sel = NULL;
+/* Per command latency histogram, bucket i counts requests under 2^i ms */
+#define LAT_BUCKETS  12
+#define LAT_CMDS     64
+
+typedef struct {
+  bool used;
+  uint8_t netfn;
+  uint8_t cmd;
+  uint32_t count;
+  uint64_t total_us;
+  uint32_t max_us;
+  uint32_t hist[LAT_BUCKETS + 1];  /* last one is overflow */
+} cmd_latency;
+
+static cmd_latency latency[LAT_CMDS];
 
 static int verbose_logging = 0;
 #define KCSD_VERBOSE(fmt, args...) \
@@ -109,47 +135,28 @@ static int verbose_logging = 0;
       OBMC_INFO(fmt, ##args);      \
   } while (0)
 
-static void handle_sel_list(uint8_t *buff, int buff_len)
+static void sel_entry_fill(sel_entry *entry, uint8_t *buff, int buff_len)
 {
-
-  static sel_list *curr_sel = NULL;
-
-  sel_list *temp_sel = calloc(1, sizeof(sel_list));
-
   //the total length. payload_id + request data
-  temp_sel->sel_len = buff_len + 1;
-
-  //allocate the space to store the payload id and request data
-  temp_sel->sel = calloc(temp_sel->sel_len, sizeof(uint8_t)); 
+  entry->sel_len = buff_len + 1;
 
   //copy the request data
-  memcpy(&temp_sel->sel[1], buff, buff_len); 
+  memcpy(&entry->sel[1], buff, buff_len);
 
   //fill the payload id
-  temp_sel->sel[0] = FRU_SERVER;
-  
+  entry->sel[0] = FRU_SERVER;
+
 #ifdef DEBUG
   char data[200] = {0};
   int i;
 
-  for(i=0; i < temp_sel->sel_len; i++)
+  for(i=0; i < entry->sel_len; i++)
   {
-    snprintf(data, sizeof(data), "%s [%d]=%02X", data, i, temp_sel->sel[i]);
+    snprintf(data, sizeof(data), "%s [%d]=%02X", data, i, entry->sel[i]);
   }
 
   OBMC_WARN("[%s] Add SEL Get: %s", __func__, data);
 #endif
-
-  if ( NULL == head_sel )
-  {
-    head_sel = temp_sel;
-    curr_sel = head_sel;
-  }
-  else
-  {
-    curr_sel->next = temp_sel;
-    curr_sel = curr_sel->next;
-  }  
 }
 
 static bool is_add_sel_req(uint8_t *buff)
@@ -167,147 +174,261 @@ static void set_bmc_ready(bool ready)
     gpio_set_init_value(bmc_ready_n, GPIO_VALUE_HIGH);
 }
 
-static void *handle_add_sel(void *unused)
+static void add_sel(sel_entry *entry)
 {
   uint8_t sel_res[default_add_sel_res_len];
   uint16_t sel_res_len = 0;
-  sel_list *send_to_ipmi = NULL;
+
+  memset(sel_res, 0, default_add_sel_res_len);
+
+  lib_ipmi_handle(entry->sel, entry->sel_len, sel_res, &sel_res_len);
+
+  if ( CC_SUCCESS != sel_res[2] )
+  {
+    char data[200] = {0};
+    int i, len = 0;
+
+    for(i=0; i < entry->sel_len && len < (int)sizeof(data) - 3; i++)
+    {
+      len += snprintf(data + len, sizeof(data) - len, "%02X ", entry->sel[i]);
+    }
+
+    OBMC_WARN("[Fail] Add SEL Fail. Completion Code = 0x%02X", sel_res[2]);
+    OBMC_WARN("[Fail] SEL Raw: %s", data);
+  }
+}
+
+/* Returns false if the queue is full */
+static bool queue_sel(uint8_t *buff, int buff_len)
+{
+  pthread_mutex_lock(&sel_queue.lock);
+  if (sel_queue.count == SEL_QUEUE_SIZE) {
+    pthread_mutex_unlock(&sel_queue.lock);
+    return false;
+  }
+  sel_entry_fill(&sel_queue.entries[(sel_queue.head + sel_queue.count) % SEL_QUEUE_SIZE],
+                 buff, buff_len);
+  sel_queue.count++;
+  pthread_cond_signal(&sel_queue.not_empty);
+  pthread_mutex_unlock(&sel_queue.lock);
+  return true;
+}
+
+static void *handle_add_sel(void *unused)
+{
+  sel_entry entry;
 
   KCSD_VERBOSE("sel_handler thread started");
 
   while (1)
   {
+    pthread_mutex_lock(&sel_queue.lock);
+    while (sel_queue.count == 0)
+    {
+      pthread_cond_wait(&sel_queue.not_empty, &sel_queue.lock);
+    }
+    // copy out so the lock isn't held across the IPMI request
+    entry = sel_queue.entries[sel_queue.head];
+    sel_queue.head = (sel_queue.head + 1) % SEL_QUEUE_SIZE;
+    sel_queue.count--;
+    pthread_mutex_unlock(&sel_queue.lock);
+
+    KCSD_VERBOSE("sel_handler: processing new SEL entry");
 
-    //acquire the lock
-    pthread_mutex_lock(&sel_lock.acquire_lock);
+    add_sel(&entry);
+  }
 
-    while ( NULL == head_sel )
-    {
-      pthread_cond_wait(&sel_lock.done, &sel_lock.acquire_lock);
+  return NULL;
+}
+
+static uint64_t now_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void latency_record(uint8_t netfn, uint8_t cmd, uint64_t us)
+{
+  unsigned int idx = ((netfn << 8) | cmd) % LAT_CMDS;
+  unsigned int i, bucket;
+  cmd_latency *lat = NULL;
+
+  // open addressing, the set of commands a host sends is small
+  for (i = 0; i < LAT_CMDS; i++) {
+    cmd_latency *l = &latency[(idx + i) % LAT_CMDS];
+    if (!l->used || (l->netfn == netfn && l->cmd == cmd)) {
+      lat = l;
+      break;
     }
- 
-    //send_to_ipmi pointer the head sel
-    send_to_ipmi = head_sel;
+  }
+  if (lat == NULL) {
+    return;
+  }
 
-    //head_sel pointer to the next
-    head_sel = head_sel->next;
+  lat->used = true;
+  lat->netfn = netfn;
+  lat->cmd = cmd;
+  lat->count++;
+  lat->total_us += us;
+  if (us > lat->max_us) {
+    lat->max_us = us;
+  }
+  for (bucket = 0; bucket < LAT_BUCKETS && (us >> 10) >= (1ULL << bucket); bucket++)
+    ;
+  lat->hist[bucket]++;
+}
 
-    //release the lock         
-    pthread_mutex_unlock(&sel_lock.acquire_lock);
+static void latency_dump(void)
+{
+  char hist[LAT_BUCKETS * 12];
+  int i, b, len;
 
-    KCSD_VERBOSE("sel_handler: processing new SEL entry");
-    
-    memset(sel_res, 0, default_add_sel_res_len);
-    
-    lib_ipmi_handle(send_to_ipmi->sel, send_to_ipmi->sel_len, sel_res,
-                    &sel_res_len);
+  OBMC_INFO("KCS latency per command, buckets are <1,<2,<4,...ms");
+  for (i = 0; i < LAT_CMDS; i++) {
+    cmd_latency *l = &latency[i];
+    if (!l->used) {
+      continue;
+    }
+    len = 0;
+    for (b = 0; b <= LAT_BUCKETS; b++) {
+      len += snprintf(hist + len, sizeof(hist) - len, " %u", l->hist[b]);
+    }
+    OBMC_INFO("netfn 0x%02x cmd 0x%02x: count %u avg %llu us max %u us hist%s",
+              l->netfn, l->cmd, l->count,
+              (unsigned long long)(l->total_us / l->count), l->max_us, hist);
+  }
+}
 
-    if ( CC_SUCCESS != sel_res[2] )
-    {
-      char data[200] = {0};
-      int i;
+/* Handle one request, returns the response length */
+static unsigned short kcs_handle_req(uint8_t *req_buf, int req_len, uint8_t *res_buf)
+{
+  unsigned short res_len = 0;
 
-      for(i=0; i < send_to_ipmi->sel_len; i++)
-      {
-        snprintf(data, sizeof(data), "%02X ", send_to_ipmi->sel[i]);
-      }
+  if ( true == is_add_sel_req(req_buf)) {
+    KCSD_VERBOSE("kcs_dev: new SEL entry received");
+
+    if (!queue_sel(req_buf, req_len)) {
+      sel_entry entry;
 
-      OBMC_WARN("[Fail] Add SEL Fail. Completion Code = 0x%02X", sel_res[2]);
-      OBMC_WARN("[Fail] SEL Raw: %s", data);
+      OBMC_WARN("SEL queue full, adding SEL inline");
+      sel_entry_fill(&entry, req_buf, req_len);
+      add_sel(&entry);
     }
 
-    //free the sel buffer
-    free(send_to_ipmi->sel);
+    res_len = default_add_sel_res_len;
+    memcpy(res_buf, default_add_sel_resp, default_add_sel_res_len);
+  } else {
+    KCSD_VERBOSE("kcs_dev: send message (netfn=0x%02x, cmd=0x%02x) to ipmid",
+                 req_buf[0], req_buf[1]);
 
-    //free the node
-    free(send_to_ipmi);
-  } 
+    memmove(&req_buf[1], req_buf, req_len);
+    req_buf[0] = FRU_SERVER;
 
-  return NULL;
+    // Send to IPMI stack and get response
+    // Additional byte as we are adding and passing payload ID for MN support
+    lib_ipmi_handle(req_buf, req_len + 1, res_buf, &res_len);
+  }
+  return res_len;
 }
 
-static void *kcs_thread(void *unused) {
+/*
+ * Wait for requests with poll(). Drivers without poll support report the
+ * device always readable; the loop then falls back to sleeping 10ms when
+ * there is nothing to read. SIGUSR1 dumps the latency histograms.
+ */
+static void *kcs_thread(void *arg) {
+  int sig_fd = *(int *)arg;
+  struct pollfd fds[2];
+  struct signalfd_siginfo si;
   struct timespec req;
-  struct timespec rem;
-  unsigned char req_len;
+  ssize_t req_len;
   unsigned short res_len;
-  uint8_t req_buf[256];
+  uint8_t req_buf[KCS_MAX_REQ + 1];
   uint8_t res_buf[300];
+  uint8_t netfn, cmd;
+  uint64_t start;
+  int empty_reads = 0;
 
 #ifdef DEBUG
-  struct timespec req_tv;
-  struct timespec res_tv;
-  double temp=0;
-  char cmd[200]={0};
-  int i = 0;
+  char dbg[200]={0};
+  int i = 0, len;
 #endif
 
   KCSD_VERBOSE("kcs_dev thread started");
 
   set_bmc_ready(true);
 
-  // Setup wait time
+  // Setup wait time for drivers without poll support
   req.tv_sec = 0;
   req.tv_nsec = 10000000;//10mSec
 
+  fds[0].fd = kcs_fd;
+  fds[0].events = POLLIN;
+  fds[1].fd = sig_fd;
+  fds[1].events = POLLIN;
+
   while (1) {
-    req_len = read(kcs_fd, req_buf, sizeof(req_buf));
+    if (poll(fds, sig_fd >= 0 ? 2 : 1, -1) < 0) {
+      if (errno != EINTR) {
+        OBMC_ERROR(errno, "poll on kcs device failed");
+        nanosleep(&req, NULL);
+      }
+      continue;
+    }
+
+    if (sig_fd >= 0 && (fds[1].revents & POLLIN)) {
+      if (read(sig_fd, &si, sizeof(si)) == sizeof(si)) {
+        latency_dump();
+      }
+    }
+
+    if (!(fds[0].revents & (POLLIN | POLLERR | POLLHUP))) {
+      continue;
+    }
+
+    // the request buffer has one spare byte for the payload ID
+    req_len = read(kcs_fd, req_buf, KCS_MAX_REQ);
     if (req_len <= 0) {
-      nanosleep(&req, &rem);
+      // readable but nothing to read: no poll support, or a spurious
+      // wakeup. Only throttle once it is clearly the former.
+      if (++empty_reads > 2) {
+        nanosleep(&req, NULL);
+      }
+      continue;
+    }
+    empty_reads = 0;
+    start = now_us();
+    if (req_len < 2) {
       continue;
     }
+    netfn = req_buf[0] >> 2;
+    cmd = req_buf[1];
 
 #ifdef DEBUG
     //dump read data
-    memset(cmd, 0, 200);
-    clock_gettime(CLOCK_REALTIME, &req_tv);
-    for(i=0; i < req_len; i++) {
-      snprintf(cmd, sizeof(cmd), "%s %02x", cmd, req_buf[i]);
+    len = 0;
+    for(i=0; i < req_len && len < (int)sizeof(dbg) - 4; i++) {
+      len += snprintf(dbg + len, sizeof(dbg) - len, " %02x", req_buf[i]);
     }
-    OBMC_WARN("[ %ld.%ld ] KCS Req: %s, len=%d",
-              req_tv.tv_sec, req_tv.tv_nsec, cmd, req_len);
+    OBMC_WARN("KCS Req: %s, len=%d", dbg, (int)req_len);
 #endif
 
     TOUCH("/tmp/kcs_touch");
 
-    if ( true == is_add_sel_req(req_buf)) {
-      KCSD_VERBOSE("kcs_dev: new SEL entry received");
-
-      pthread_mutex_lock(&sel_lock.acquire_lock);
-
-      //add the request data to list
-      handle_sel_list(req_buf, req_len);
-
-      pthread_cond_signal(&sel_lock.done);
-
-      pthread_mutex_unlock(&sel_lock.acquire_lock);
-
-      res_len = default_add_sel_res_len;
-      memcpy(res_buf, default_add_sel_resp, default_add_sel_res_len);
-    } else {
-      KCSD_VERBOSE("kcs_dev: send message (netfn=0x%02x, cmd=0x%02x) to ipmid",
-                   req_buf[0], req_buf[1]);
-
-      memmove(&req_buf[1], req_buf, req_len);
-      req_buf[0] = FRU_SERVER;
-
-      // Send to IPMI stack and get response
-      // Additional byte as we are adding and passing payload ID for MN support
-      lib_ipmi_handle(req_buf, req_len + 1, res_buf, &res_len);
-    }
+    res_len = kcs_handle_req(req_buf, req_len, res_buf);
 
     res_len = write(kcs_fd, res_buf, res_len);
 
+    latency_record(netfn, cmd, now_us() - start);
+
 #ifdef DEBUG
-    memset(cmd, 0, 200);
-    clock_gettime(CLOCK_REALTIME, &res_tv);
-    for(i=0; i < res_len; i++)
-      snprintf(cmd, sizeof(cmd), "%s %02x", cmd, res_buf[i]);
-    OBMC_WARN("[ %ld.%ld ] KCS Res: %s", res_tv.tv_sec, res_tv.tv_nsec, cmd);
-
-    temp = (res_tv.tv_sec - req_tv.tv_sec -1) * 1000 +
-           (1000 + (float) ((res_tv.tv_nsec - req_tv.tv_nsec)/1000000) );
-    OBMC_WARN("KCS transaction time: %f ms ", temp);
+    len = 0;
+    for(i=0; i < res_len && len < (int)sizeof(dbg) - 4; i++)
+      len += snprintf(dbg + len, sizeof(dbg) - len, " %02x", res_buf[i]);
+    OBMC_WARN("KCS Res: %s, transaction time: %llu us", dbg,
+              (unsigned long long)(now_us() - start));
 #endif
   } /* while (1) */
 
@@ -382,6 +503,8 @@ main(int argc, char * const argv[]) {
   int ret;
   pthread_t kcs_tid;
   pthread_t add_sel_tid;
+  sigset_t mask;
+  int sig_fd;
   uint8_t kcs_channel_num = 2;
   const char *bmc_ready_n_shadow = DEFAULT_BMC_READY_GPIO_SHADOW;
   struct option long_opts[] = {
@@ -445,10 +568,22 @@ main(int argc, char * const argv[]) {
     }
   }
 
+  // the loop only waits in poll(), reads must not block it
+  fcntl(kcs_fd, F_SETFL, fcntl(kcs_fd, F_GETFL) | O_NONBLOCK);
+
+  // blocked in every thread, delivered through the kcs loop's signalfd
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGUSR1);
+  pthread_sigmask(SIG_BLOCK, &mask, NULL);
+  sig_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (sig_fd < 0) {
+    OBMC_ERROR(errno, "failed to create signalfd, no latency dumps");
+  }
+
   sleep(1);
 
   KCSD_VERBOSE("creating kcs_dev thread");
-  ret = pthread_create(&kcs_tid, NULL, kcs_thread, NULL);
+  ret = pthread_create(&kcs_tid, NULL, kcs_thread, &sig_fd);
   if (ret != 0) {
     OBMC_ERROR(ret, "failed to create kcs_dev_thread");
     return -1;
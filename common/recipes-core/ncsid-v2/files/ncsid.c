@@ -37,14 +37,12 @@
 #include <sys/un.h>
 #include <unistd.h>
 #include <stdint.h>
-#include <mqueue.h>
-#include <semaphore.h>
 #include <poll.h>
-#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 #include <arpa/inet.h>
 #include <stddef.h>
 #include <openbmc/obmc-pal.h>
-#include <semaphore.h>
 #include <time.h>
 #include <openbmc/kv.h>
 #include <openbmc/ncsi.h>
@@ -67,15 +65,30 @@
 #ifndef MAX
 #define MAX(a, b) ((a) > (b)) ? (a) : (b)
 #endif
+#ifndef MIN
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#endif
 /*
    Default config:
       - poll NIC status once every 60 seconds
 */
-/* POLL nic status every N seconds */
+/* POLL nic status every N seconds, AENs or not: a NIC reset may
+   silently disable them */
 #define NIC_STATUS_SAMPLING_DELAY  60
+/* re-check link status this long after a link/driver AEN, a burst
+   of AENs results in one poll */
+#define NIC_STATUS_AEN_HOLDOFF     1
 
-#define RX_BUF_SIZE 20
-#define fillcnt_sem_path  "/fillsem"
+/*
+   PLDM sensors are read every PLDM_SNR_MIN_INTERVAL seconds, the interval
+   of a sensor doubles up to PLDM_SNR_MAX_INTERVAL for as long as its value
+   is stable and away from its warning thresholds
+*/
+#define PLDM_SNR_MIN_INTERVAL  30
+#define PLDM_SNR_MAX_INTERVAL  240
+#define PLDM_SNR_STABLE_DELTA  1.0
+/* give up on a PLDM request not answered in N seconds */
+#define PLDM_REQ_TIMEOUT       10
 
 
 typedef struct _nl_usr_sk_t {
@@ -90,24 +103,11 @@ typedef struct generic_msg_t {
 
 static nl_usr_sk_t gSock = { .fd = -1, .sock = 0 };
 
-// libnl rx buffer struct
-static struct {
-  pthread_mutex_t rx_mutex;
-  sem_t *semfill;
-  uint8_t start; // points to first data entry
-  uint8_t end; // points to first empty buf
-  uint8_t len;
-  NCSI_NL_RSP_T *buf[RX_BUF_SIZE];
-} libnl_rx_buf = {
-  .rx_mutex = PTHREAD_MUTEX_INITIALIZER,
-  .semfill = NULL,
-  .start = 0,
-  .end = 0,
-  .len = 0,
-  .buf = {0},
-};
-
 static NCSI_NL_RSP_T aenbuf;
+static int status_tfd = -1;
+/* a Get Link Status request was sent and not answered yet */
+static bool lsts_pending = false;
+static int pldm_tfd = -1;
 
 static struct timespec last_config_ts;
 static NCSI_Get_Capabilities_Response gNicCapability = {0};
@@ -140,8 +140,21 @@ static pldm_sensor_t sensors_brcm_2b[NUM_PLDM_SENSORS] = {
 
 static pldm_ver_t pldm_ver[PLDM_RSV] = {0};
 
-// maps each PLDM IID (hence cmd) to a sensor being read
-uint8_t sensor_lookup_table[PLDM_MAX_IID] = {0};
+// outstanding PLDM requests by IID, to map each response back to the
+//   sensor being read and drop late or unexpected ones
+static struct {
+  bool busy;
+  uint8_t sensor;
+  time_t sent;
+} pldm_pending[PLDM_MAX_IID];
+
+// polling state of each sensor, pldm_sensors[] is shared with sensor-util
+static struct {
+  time_t next;
+  int interval;
+  float last_val;
+  bool valid;
+} pldm_snr_poll[NUM_PLDM_SENSORS];
 
 static pldm_sensor_t *pldm_sensors = sensors_mlx;
 
@@ -152,12 +165,11 @@ static int (*send_cmd_and_get_resp)(nl_usr_sk_t *sk, uint8_t ncsi_cmd,
                       uint16_t payload_len, unsigned char *payload,
                       NCSI_NL_RSP_T *resp_buf);
 static int (*send_nl_data)(int socket_fd, generic_msg_t *gmsg);
-static void* (*ncsi_rx_handler)(void *args);
 static int   (*send_registration_msg)(nl_usr_sk_t *sk);
 
-// ring buffer API for libnl
-int rx_buffer_add(NCSI_NL_RSP_T *pdata);
-int rx_buffer_get(NCSI_NL_RSP_T *dest);
+static void ncsi_rx_dispatch(NCSI_NL_RSP_T *rcv_buf);
+static void ncsi_status_poll_soon(void);
+static void ncsi_status_poll_now(void);
 
 static int
 prepare_ncsi_req_msg_libnl(generic_msg_t *gmsg, uint8_t ch, uint8_t cmd,
@@ -247,8 +259,7 @@ free_and_exit:
 
 static int send_nl_data_libnl(int socket_fd, generic_msg_t *gmsg)
 {
-  // calls the non-block version of nl-wrapper API
-  int ret = 0;
+  // libnl returns the response with the request, handle it right away
   NCSI_NL_RSP_T *nl_rsp = NULL;
   nl_rsp = send_nl_msg_libnl(gmsg->pmsg_libnl);
 
@@ -256,14 +267,10 @@ static int send_nl_data_libnl(int socket_fd, generic_msg_t *gmsg)
     syslog(LOG_ERR, "%s null rsp", __FUNCTION__);
     return -1;
   }
-  ret = rx_buffer_add(nl_rsp);
-  if (ret != 0) {
-    syslog(LOG_ERR, "%s failed to add rsp", __FUNCTION__);
-  }
+  ncsi_rx_dispatch(nl_rsp);
 
-  if (nl_rsp)
-    free(nl_rsp);
-  return ret;
+  free(nl_rsp);
+  return 0;
 }
 
 
@@ -824,6 +831,34 @@ free_exit:
   return ret;
 }
 
+// schedule the next read of a sensor based on its latest value
+static void
+pldm_snr_adapt(int sensor, float val)
+{
+  pldm_sensor_t *pSensor = &(pldm_sensors[sensor]);
+  struct timespec ts;
+  float delta = val - pldm_snr_poll[sensor].last_val;
+  bool stable, near_thresh;
+
+  stable = pldm_snr_poll[sensor].valid &&
+           delta < PLDM_SNR_STABLE_DELTA && delta > -PLDM_SNR_STABLE_DELTA;
+  // thresholds not reported by the NIC are 0
+  near_thresh = (pSensor->unc != 0 && val >= pSensor->unc) ||
+                (pSensor->lnc != 0 && val <= pSensor->lnc);
+
+  if (stable && !near_thresh) {
+    pldm_snr_poll[sensor].interval =
+      MIN(pldm_snr_poll[sensor].interval * 2, PLDM_SNR_MAX_INTERVAL);
+  } else {
+    pldm_snr_poll[sensor].interval = PLDM_SNR_MIN_INTERVAL;
+  }
+  pldm_snr_poll[sensor].last_val = val;
+  pldm_snr_poll[sensor].valid = true;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  pldm_snr_poll[sensor].next = ts.tv_sec + pldm_snr_poll[sensor].interval;
+}
+
 // handles PLDM_Read_Numeric_SENSOR  and PLDM_Read_State_SENSOR cmd
 static int
 handle_pldm_snr_read(NCSI_Response_Packet *resp)
@@ -837,7 +872,13 @@ handle_pldm_snr_read(NCSI_Response_Packet *resp)
   //   use PLDM cmd IID to look up which sensor this current response
   //   corresponds to
   pldm_iid = ncsiDecodePldmIID(resp);
-  sensor_id = sensor_lookup_table[pldm_iid];
+  if (pldm_iid < 0 || !pldm_pending[pldm_iid].busy) {
+    syslog(LOG_WARNING, "%s unexpected or late response, iid %d",
+           __FUNCTION__, pldm_iid);
+    return -1;
+  }
+  sensor_id = pldm_pending[pldm_iid].sensor;
+  pldm_pending[pldm_iid].busy = false;
   pltf_id = pldm_sensors[sensor_id].pltf_sensor_id;
 
 #ifdef PLDM_SNR_DBG
@@ -876,6 +917,8 @@ handle_pldm_snr_read(NCSI_Response_Packet *resp)
       syslog(LOG_WARNING, "%s sensor cache write failed", __FUNCTION__);
     }
   }
+
+  pldm_snr_adapt(sensor_id, sensor_val);
   return 0;
 }
 
@@ -922,6 +965,11 @@ process_NCSI_resp(NCSI_NL_RSP_T *buf)
   int ret = 0;
   struct timespec ts;
 
+  /* any response, failed or not, shows the NIC is answering */
+  if (cmd == NCSI_GET_LINK_STATUS) {
+    lsts_pending = false;
+  }
+
   /* chekc for command completion before processing
      response payload */
   if (cmd_response_code != RESP_COMMAND_COMPLETED) {
@@ -977,11 +1025,14 @@ process_NCSI_resp(NCSI_NL_RSP_T *buf)
 
 
 // enable platform-specific AENs
+// The response is handled by ncsi_rx_dispatch() like any other, so this
+//   can be called from the event loop without waiting for it
 void
 enable_aens(nl_usr_sk_t *sfd, uint32_t aen_enable_mask) {
 #define PAYLOAD_SIZE 8
   int ret = 0;
   unsigned char payload[PAYLOAD_SIZE]  = {0};
+  generic_msg_t gmsg;
 
   syslog(LOG_INFO, "enable aens: mask=0x%x", aen_enable_mask);
 
@@ -990,123 +1041,90 @@ enable_aens(nl_usr_sk_t *sfd, uint32_t aen_enable_mask) {
 
   memcpy(&(payload[4]), &aen_enable_mask, sizeof(uint32_t));
 
-  ret = send_cmd_and_get_resp(sfd, NCSI_AEN_ENABLE, PAYLOAD_SIZE, payload, NULL);
+  memset(&gmsg, 0, sizeof(gmsg));
+  ret = prepare_ncsi_req_msg(&gmsg, 0, NCSI_AEN_ENABLE, PAYLOAD_SIZE, payload, 0);
+  if (ret == 0) {
+    ret = send_nl_data(sfd->fd, &gmsg);
+  }
   if (ret < 0) {
     syslog(LOG_ERR, "enable_aens: failed to enable AEN");
   }
+  free_ncsi_req_msg(&gmsg);
 
   return;
 }
 
-// Thread to handle the incoming responses
-static void*
-ncsi_rx_handler_nl_usr(void *args) {
-  int sock_fd = gSock.fd;
-  struct msghdr msg;
-  struct iovec iov;
-  int msg_size = sizeof(NCSI_NL_RSP_T);
-  struct nlmsghdr *nlh = NULL;
+// Handle a response or an AEN, however it was received
+static void
+ncsi_rx_dispatch(NCSI_NL_RSP_T *rcv_buf) {
+  AEN_Packet *aen = (AEN_Packet *)rcv_buf->msg_payload;
+  int aen_type;
   int ret = 0;
-  /* msg response from kernel */
-  NCSI_NL_RSP_T *rcv_buf;
 
-  memset(&msg, 0, sizeof(msg));
-  syslog(LOG_INFO, "rx: ncsi_rx_handler thread started");
-  nlh = (struct nlmsghdr *)malloc(NLMSG_SPACE(msg_size));
-  if (!nlh) {
-    syslog(LOG_ERR, "rx: Error, failed to allocate message buffer");
-    return NULL;
-  }
-  memset(nlh, 0, NLMSG_SPACE(msg_size));
-  nlh->nlmsg_len = NLMSG_SPACE(msg_size);
-  nlh->nlmsg_pid = getpid();
-  nlh->nlmsg_flags = 0;
-
-  iov.iov_base = (void *)nlh;
-  iov.iov_len = nlh->nlmsg_len;
-  msg.msg_iov = &iov;
-  msg.msg_iovlen = 1;
-
-  // the last timestamp to call handle_ncsi_config() when processing NCSI_resp
-  last_config_ts.tv_sec = 0;
-
-  while (1) {
-    /* Read message from kernel */
-    recvmsg(sock_fd, &msg, 0);
-    rcv_buf = (NCSI_NL_RSP_T *)NLMSG_DATA(nlh);
-    if (is_aen_packet((AEN_Packet *)rcv_buf->msg_payload)) {
-      ret = process_NCSI_AEN((AEN_Packet *)rcv_buf->msg_payload);
-    } else {
-      ret = process_NCSI_resp(rcv_buf);
-    }
-
-    if (ret == NCSI_IF_REINIT) {
-      send_registration_msg(&gSock);
-      enable_aens(&gSock, aen_enable_mask);
+#if DEBUG
+  syslog(LOG_INFO, "%s rcv_buf->hdr.cmd 0x%x, hdr.len %d", __FUNCTION__, rcv_buf->hdr.cmd, rcv_buf->hdr.payload_length);
+#endif
+  if (is_aen_packet(aen)) {
+    aen_type = aen->AEN_Type;
+    ret = process_NCSI_AEN(aen);
+    // the NIC reported a change, refresh its status now rather than at
+    //   the next poll
+    if (aen_type == AEN_TYPE_LINK_STATUS_CHANGE ||
+        aen_type == AEN_TYPE_HOST_NC_DRIVER_STATUS_CHANGE) {
+      ncsi_status_poll_soon();
     }
+  } else {
+    ret = process_NCSI_resp(rcv_buf);
   }
 
-  free(nlh);
-  pthread_exit(NULL);
-}
-
-static void*
-ncsi_rx_handler_libnl(void *args) {
-  int ret = 0;
-  syslog(LOG_INFO, "%s thread started", __FUNCTION__);
-  NCSI_NL_RSP_T *rcv_buf = calloc(1, sizeof(NCSI_NL_RSP_T));
-  if (rcv_buf == NULL) {
-     syslog(LOG_INFO, "%s buf alloc failed", __FUNCTION__);
-     pthread_exit(NULL);
+  if (ret == NCSI_IF_REINIT) {
+    // requests sent before the re-init will not be answered
+    memset(pldm_pending, 0, sizeof(pldm_pending));
+    lsts_pending = false;
+    send_registration_msg(&gSock);
+    enable_aens(&gSock, aen_enable_mask);
+    // link changes during the re-init were not reported
+    ncsi_status_poll_now();
   }
+}
 
-  // the last timestamp to call handle_ncsi_config() when processing NCSI_resp
-  last_config_ts.tv_sec = 0;
+// returns true if sensor still has a request in flight, giving up on
+//   requests older than PLDM_REQ_TIMEOUT
+static bool
+pldm_snr_pending(int sensor, time_t now)
+{
+  int iid;
 
-  while (1) {
-    sem_wait(libnl_rx_buf.semfill);
-    ret = rx_buffer_get(rcv_buf);
-    if (ret != 0)
+  for (iid = 0; iid < PLDM_MAX_IID; ++iid) {
+    if (!pldm_pending[iid].busy || pldm_pending[iid].sensor != sensor)
       continue;
-#if DEBUG
-    syslog(LOG_INFO, "%s rcv_buf->hdr.cmd 0x%x, hdr.len %d", __FUNCTION__, rcv_buf->hdr.cmd, rcv_buf->hdr.payload_length);
-    syslog(LOG_INFO, "%s data 0x%x 0x%x 0x%x 0x%x 0x%x 0x%x 0x%x 0x%x", __FUNCTION__,
-            rcv_buf->msg_payload[0],
-            rcv_buf->msg_payload[1],
-            rcv_buf->msg_payload[2],
-            rcv_buf->msg_payload[3],
-            rcv_buf->msg_payload[4],
-            rcv_buf->msg_payload[5],
-            rcv_buf->msg_payload[6],
-            rcv_buf->msg_payload[7]);
-#endif
-    if (is_aen_packet((AEN_Packet *)rcv_buf->msg_payload)) {
-      ret = process_NCSI_AEN((AEN_Packet *)rcv_buf->msg_payload);
-    } else {
-      ret = process_NCSI_resp(rcv_buf);
-    }
-
-    if (ret == NCSI_IF_REINIT) {
-      send_registration_msg(&gSock);
-      enable_aens(&gSock, aen_enable_mask);
-    }
+    if (now - pldm_pending[iid].sent < PLDM_REQ_TIMEOUT)
+      return true;
+    syslog(LOG_WARNING, "tx: no response to PLDM request iid %d, sensor %d",
+           iid, pldm_sensors[sensor].pldm_sensor_id);
+    pldm_pending[iid].busy = false;
   }
-  syslog(LOG_INFO, "%s exit", __FUNCTION__);
-  pthread_exit(NULL);
+  return false;
 }
 
-
 // Main PLDM monitoring function
-// For every sensor that needs monitoring,
+// For every sensor due for a read,
 //   Generate PLDM-over-NC-SI sensor read commands, and sends it over netlink
-// Sensor read Response will be handled by the RX thread
-static int pldm_monitoring(int sock_fd)
+// Responses are matched to requests by IID in handle_pldm_snr_read()
+static int pldm_monitoring(int sock_fd, time_t now)
 {
   generic_msg_t pldm_msg;
   pldm_cmd_req pldmReq = {0};
   int ret = 0, i=0, iid=0;
 
   for (i = 0; i < NUM_PLDM_SENSORS; ++i) {
+    // the timer ticks every PLDM_SNR_MIN_INTERVAL, allow for a little skew
+    if (pldm_snr_poll[i].next > now + 1)
+      continue;
+    // don't queue a second request behind an unanswered one
+    if (pldm_snr_pending(i, now))
+      continue;
+
     memset(&pldm_msg, 0, sizeof(pldm_msg));
 
     if ((pldm_sensors[i].sensor_type == PLDM_SENSOR_TYPE_NUMERIC) ||
@@ -1125,20 +1143,25 @@ static int pldm_monitoring(int sock_fd)
       }
       if (ret)
         break; //Prepare_ncsi_req_msg failed as low memory, no reason to continue
-      // fill in the look up table, store in the sensor index to IID table
-      //  so when we received the PLDM response, we can map the response back
-      //  to sensor
+      // record the request under its IID before sending, with libnl the
+      //  response is handled before send_nl_data() returns
       iid = pldmReq.common[PLDM_IID_OFFSET] & PLDM_CM_IID_MASK;
-      sensor_lookup_table[iid] = i;
+      pldm_pending[iid].busy = true;
+      pldm_pending[iid].sensor = i;
+      pldm_pending[iid].sent = now;
     } else {
       syslog(LOG_ERR, "tx: unknown sensor type %d, pldm sensor %d\n",
              pldm_sensors[i].sensor_type, pldm_sensors[i].pldm_sensor_id);
+      continue;
     }
 
+    // retried after the current interval if there's no response
+    pldm_snr_poll[i].next = now + pldm_snr_poll[i].interval;
     ret = send_nl_data(sock_fd, &pldm_msg);
     if (ret < 0) {
       syslog(LOG_ERR, "tx: failed to send pldm_msg, status ret = %d, errno=%d\n",
              ret, errno);
+      pldm_pending[iid].busy = false;
     }
     free_ncsi_req_msg(&pldm_msg);
   }
@@ -1147,113 +1170,218 @@ static int pldm_monitoring(int sock_fd)
 }
 
 
-// Thread to send periodic NC-SI cmmands to check NIC status
-static void*
-ncsi_tx_handler(void *arg) {
-  int ret, sock_fd = gSock.fd;
-  generic_msg_t lsts_msg, vid_msg;
+// arm a periodic timer, first expiring after "delay" seconds
+static void
+ncsi_timer_arm(int tfd, int delay, int period)
+{
+  struct itimerspec its;
+
+  memset(&its, 0, sizeof(its));
+  its.it_value.tv_sec = delay;
+  its.it_value.tv_nsec = delay ? 0 : 1;  // all 0 would disarm it
+  its.it_interval.tv_sec = period;
+  if (timerfd_settime(tfd, 0, &its, NULL) < 0) {
+    syslog(LOG_ERR, "%s: timerfd_settime failed, errno=%d", __FUNCTION__, errno);
+  }
+}
 
-  syslog(LOG_INFO, "ncsi_tx_handler thread started");
-  memset(&lsts_msg, 0, sizeof(lsts_msg));
-  memset(&vid_msg, 0, sizeof(vid_msg));
-  prepare_ncsi_req_msg(&lsts_msg, 0, NCSI_GET_LINK_STATUS, 0, NULL, 0);
-  prepare_ncsi_req_msg(&vid_msg, 0, NCSI_GET_VERSION_ID, 0, NULL, 0);
+static void
+ncsi_status_poll_soon(void)
+{
+  if (status_tfd >= 0)
+    ncsi_timer_arm(status_tfd, NIC_STATUS_AEN_HOLDOFF, NIC_STATUS_SAMPLING_DELAY);
+}
 
-  while (1) {
-    /* send "Get Link status" message to NIC  */
-    ret = send_nl_data(sock_fd, &lsts_msg);
-    if (ret < 0) {
-      syslog(LOG_ERR, "tx: failed to send lsts_msg, status ret = %d, errno=%d\n",
-             ret, errno);
-    }
-    /* send "Get Version ID" message to NIC  */
-    ret = send_nl_data(sock_fd, &vid_msg);
-    if (ret < 0) {
-      syslog(LOG_ERR, "tx: failed to send vid_msg, status ret = %d, errno=%d\n",
-             ret, errno);
-    }
+static void
+ncsi_status_poll_now(void)
+{
+  if (status_tfd >= 0)
+    ncsi_timer_arm(status_tfd, 0, NIC_STATUS_SAMPLING_DELAY);
+}
 
-    if (gEnablePldmMonitoring) {
-      // read any PLDM sensors that's available
-      ret = pldm_monitoring(sock_fd);
-    }
+// periodic NC-SI commands to check NIC status, responses are handled
+//   by ncsi_rx_dispatch()
+static void
+ncsi_status_poll(generic_msg_t *lsts_msg, generic_msg_t *vid_msg)
+{
+  int ret, sock_fd = gSock.fd;
 
-    ret = check_valid_mac_addr();
-    if (ret == NCSI_IF_REINIT) {
-      send_registration_msg(&gSock);
-      enable_aens(&gSock, aen_enable_mask);
-    }
+  /* the last poll went unanswered, the NIC may have been reset and
+     lost its AEN settings */
+  if (lsts_pending) {
+    syslog(LOG_WARNING, "no response to Get Link Status, re-enabling AENs");
+    enable_aens(&gSock, aen_enable_mask);
+  }
 
-    sleep(NIC_STATUS_SAMPLING_DELAY);
+  /* send "Get Link status" message to NIC  */
+  ret = send_nl_data(sock_fd, lsts_msg);
+  if (ret < 0) {
+    syslog(LOG_ERR, "tx: failed to send lsts_msg, status ret = %d, errno=%d\n",
+           ret, errno);
+  }
+  lsts_pending = (ret >= 0);
+  /* send "Get Version ID" message to NIC  */
+  ret = send_nl_data(sock_fd, vid_msg);
+  if (ret < 0) {
+    syslog(LOG_ERR, "tx: failed to send vid_msg, status ret = %d, errno=%d\n",
+           ret, errno);
   }
 
-  free_ncsi_req_msg(&lsts_msg);
-  free_ncsi_req_msg(&vid_msg);
-  pthread_exit(NULL);
+  ret = check_valid_mac_addr();
+  if (ret == NCSI_IF_REINIT) {
+    lsts_pending = false;
+    send_registration_msg(&gSock);
+    enable_aens(&gSock, aen_enable_mask);
+    ncsi_status_poll_now();
+  }
 }
 
+// receive everything pending on the NETLINK_USER socket
+static void
+ncsi_rx_nl_usr(struct msghdr *msg)
+{
+  struct nlmsghdr *nlh = msg->msg_iov->iov_base;
 
-// Thread to setup netlink and receive AEN
-static void*
-ncsi_aen_handler(void *arg) {
-  pthread_t tid_rx;
-  pthread_t tid_tx;
-  int ret = 0;
+  while (recvmsg(gSock.fd, msg, MSG_DONTWAIT) > 0) {
+    ncsi_rx_dispatch((NCSI_NL_RSP_T *)NLMSG_DATA(nlh));
+  }
+  if (errno != EAGAIN && errno != EWOULDBLOCK) {
+    syslog(LOG_ERR, "rx: recvmsg failed, errno=%d", errno);
+  }
+}
 
-  syslog(LOG_INFO, "ncsid-v2 ncsi_aen_handler thread started\n");
+static void
+ncsi_rx_libnl(struct nl_sock *sk)
+{
+  int ret;
 
-  ret = init_nic_config(&gSock);
-  if (ret < 0)  {
-    syslog(LOG_ERR, "init_nic_config failed, ret= %d\n", ret);
+  // only set by the callback when an AEN was received
+  aenbuf.hdr.payload_length = 0;
+  ret = nl_rcv_msg(sk);
+  if (ret < 0) {
+    syslog(LOG_ERR, "%s: rc = %d\n", __FUNCTION__, ret);
+    return;
   }
+  if (aenbuf.hdr.payload_length) {
+#if DEBUG
+    syslog(LOG_INFO, "%s: AEN received\n", __FUNCTION__);
+#endif
+    ncsi_rx_dispatch(&aenbuf);
+  }
+}
 
-  if (pthread_create(&tid_rx, NULL, ncsi_rx_handler, NULL) != 0) {
-    syslog(LOG_ERR, "ncsi_aen_handler: pthread_create failed on ncsi_rx_handler, errno %d\n",
-           errno);
-    goto cleanup;
+enum {
+  EV_RX = 0,
+  EV_STATUS,
+  EV_PLDM,
+};
+
+// Single event loop for responses, AENs, NIC status polling and
+//   PLDM sensor polling
+static int
+ncsi_event_loop(struct nl_sock *aen_sk)
+{
+  struct epoll_event ev, events[8];
+  generic_msg_t lsts_msg, vid_msg;
+  struct msghdr msg;
+  struct iovec iov;
+  struct nlmsghdr *nlh = NULL;
+  struct timespec ts;
+  uint64_t expirations;
+  int msg_size = sizeof(NCSI_NL_RSP_T);
+  int efd, rx_fd = -1;
+  int i, n;
+
+  efd = epoll_create1(EPOLL_CLOEXEC);
+  status_tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  pldm_tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (efd < 0 || status_tfd < 0 || pldm_tfd < 0) {
+    syslog(LOG_ERR, "%s: failed to create event loop, errno=%d", __FUNCTION__, errno);
+    return -1;
   }
 
-  if (pthread_create(&tid_tx, NULL, ncsi_tx_handler, NULL) != 0) {
-    syslog(LOG_ERR, "ncsi_aen_handler: pthread_create failed on ncsi_tx_handler, errno %d\n",
-           errno);
-    goto cleanup;
+  if (islibnl()) {
+    if (aen_sk)
+      rx_fd = nl_poll_fd(aen_sk);
+  } else {
+    nlh = (struct nlmsghdr *)calloc(1, NLMSG_SPACE(msg_size));
+    if (!nlh) {
+      syslog(LOG_ERR, "rx: Error, failed to allocate message buffer");
+      return -1;
+    }
+    nlh->nlmsg_len = NLMSG_SPACE(msg_size);
+    nlh->nlmsg_pid = getpid();
+    iov.iov_base = (void *)nlh;
+    iov.iov_len = nlh->nlmsg_len;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    rx_fd = gSock.fd;
   }
 
-  // enable platform-specific AENs
-  enable_aens(&gSock, aen_enable_mask);
+  ev.events = EPOLLIN;
+  if (rx_fd >= 0) {
+    ev.data.u32 = EV_RX;
+    epoll_ctl(efd, EPOLL_CTL_ADD, rx_fd, &ev);
+  }
+  ev.data.u32 = EV_STATUS;
+  epoll_ctl(efd, EPOLL_CTL_ADD, status_tfd, &ev);
+  ncsi_timer_arm(status_tfd, 0, NIC_STATUS_SAMPLING_DELAY);
 
-  if (islibnl()) {
-    struct nl_sock *sk;
-    ret = setup_ncsi_mc_socket(&sk, (void *)&aenbuf);
-    if (ret < 0) {
-      syslog(LOG_ERR, "ncsi_aen_handler: error setup seocket\n");
-      goto cleanup;
+  if (gEnablePldmMonitoring) {
+    for (i = 0; i < NUM_PLDM_SENSORS; ++i) {
+      pldm_snr_poll[i].interval = PLDM_SNR_MIN_INTERVAL;
     }
+    ev.data.u32 = EV_PLDM;
+    epoll_ctl(efd, EPOLL_CTL_ADD, pldm_tfd, &ev);
+    ncsi_timer_arm(pldm_tfd, 0, PLDM_SNR_MIN_INTERVAL);
+  }
 
-    while (1) {
-      ret = nl_rcv_msg(sk);
-      if (ret <0) {
-        syslog(LOG_ERR, "ncsi_aen_handler: rc = %d\n",ret);
-        // delay 30s before checking AENs again to prevent hugging CPU resources
-        //   on error
-        sleep(30);
+  memset(&lsts_msg, 0, sizeof(lsts_msg));
+  memset(&vid_msg, 0, sizeof(vid_msg));
+  prepare_ncsi_req_msg(&lsts_msg, 0, NCSI_GET_LINK_STATUS, 0, NULL, 0);
+  prepare_ncsi_req_msg(&vid_msg, 0, NCSI_GET_VERSION_ID, 0, NULL, 0);
+
+  syslog(LOG_INFO, "%s: started, status poll every %ds", __FUNCTION__,
+         NIC_STATUS_SAMPLING_DELAY);
+
+  while (1) {
+    n = epoll_wait(efd, events, sizeof(events) / sizeof(events[0]), -1);
+    if (n < 0) {
+      if (errno == EINTR)
         continue;
+      syslog(LOG_ERR, "%s: epoll_wait failed, errno=%d", __FUNCTION__, errno);
+      break;
+    }
+
+    for (i = 0; i < n; ++i) {
+      switch (events[i].data.u32) {
+        case EV_RX:
+          if (aen_sk)
+            ncsi_rx_libnl(aen_sk);
+          else
+            ncsi_rx_nl_usr(&msg);
+          break;
+        case EV_STATUS:
+          if (read(status_tfd, &expirations, sizeof(expirations)) > 0)
+            ncsi_status_poll(&lsts_msg, &vid_msg);
+          break;
+        case EV_PLDM:
+          if (read(pldm_tfd, &expirations, sizeof(expirations)) > 0) {
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            pldm_monitoring(gSock.fd, ts.tv_sec);
+          }
+          break;
       }
-#if DEBUG
-      syslog(LOG_INFO, "ncsi_aen_handler: AEN received\n");
-#endif
-      ret = rx_buffer_add(&aenbuf);
     }
-    if (sk)
-      libnl_free_socket(sk);
   }
 
-cleanup:
-  if (tid_rx > 0)
-    pthread_join(tid_rx, NULL);
-  if (tid_tx > 0)
-    pthread_join(tid_tx, NULL);
-  pthread_exit(NULL);
+  free_ncsi_req_msg(&lsts_msg);
+  free_ncsi_req_msg(&vid_msg);
+  if (nlh)
+    free(nlh);
+  close(efd);
+  return -1;
 }
 
 
@@ -1272,107 +1400,15 @@ int setup_user_socket(nl_usr_sk_t *sfd)
 }
 
 
-int rx_buffer_get(NCSI_NL_RSP_T *dest)
-{
-  pthread_mutex_lock(&libnl_rx_buf.rx_mutex);
-  if (libnl_rx_buf.len == 0) {
-    pthread_mutex_unlock(&libnl_rx_buf.rx_mutex);
-    return -1;
-  }
-  memcpy(dest, libnl_rx_buf.buf[libnl_rx_buf.start], sizeof(NCSI_NL_RSP_T));
-  libnl_rx_buf.start = (libnl_rx_buf.start + 1) % RX_BUF_SIZE;
-  libnl_rx_buf.len--;
-  pthread_mutex_unlock(&libnl_rx_buf.rx_mutex);
-  return 0;
-}
-
-
-int rx_buffer_add(NCSI_NL_RSP_T *pdata)
-{
-  pthread_mutex_lock(&libnl_rx_buf.rx_mutex);
-  // add log for buffer full but allows overwriting old data
-  if (libnl_rx_buf.len == RX_BUF_SIZE)
-    syslog(LOG_ERR, "%s: buff full\n", __FUNCTION__);
-  memcpy(libnl_rx_buf.buf[libnl_rx_buf.end], pdata, sizeof(NCSI_NL_RSP_T));
-
-  libnl_rx_buf.end = (libnl_rx_buf.end + 1) % RX_BUF_SIZE;
-  if (libnl_rx_buf.len < RX_BUF_SIZE)
-    libnl_rx_buf.len++;
-
-  // post semfill to wake up rx thread
-  sem_post(libnl_rx_buf.semfill);
-  pthread_mutex_unlock(&libnl_rx_buf.rx_mutex);
-  return 0;
-}
-
-
-int rx_buffer_cleanup(void)
-{
-  int i;
-  for (i = 0; i < RX_BUF_SIZE; ++i)
-    if (libnl_rx_buf.buf[i])
-      free(libnl_rx_buf.buf[i]);
-  if (libnl_rx_buf.semfill)
-    sem_close(libnl_rx_buf.semfill);
-  pthread_mutex_destroy(&(libnl_rx_buf.rx_mutex));
-  return 0;
-}
-
-
-int setup_rx_buffer(void)
-{
-  int i = 0;
-  int ret = 0;
-  for (i = 0; i < RX_BUF_SIZE; ++i)
-  {
-    libnl_rx_buf.buf[i] = calloc(1, sizeof(NCSI_NL_RSP_T));
-    if (libnl_rx_buf.buf[i] == NULL) {
-      syslog(LOG_ERR, "%s: failed buf %d alloc\n", __FUNCTION__, i);
-      ret = -1;
-      goto errout;
-    }
-  }
-
-  libnl_rx_buf.semfill = sem_open(fillcnt_sem_path, O_CREAT | O_EXCL, 0644, 0);
-  if (libnl_rx_buf.semfill == SEM_FAILED) {
-    if (errno == EEXIST) {
-      libnl_rx_buf.semfill = sem_open(fillcnt_sem_path, 0);
-      if (libnl_rx_buf.semfill == SEM_FAILED) {
-        syslog(LOG_ERR, "%s: failed retry semfill\n", __FUNCTION__);
-        ret = -1;
-        goto errout;
-      }
-    } else {
-      syslog(LOG_ERR, "%s: failed semfill\n", __FUNCTION__);
-      ret = -1;
-      goto errout;
-    }
-  }
-  if (sem_init(libnl_rx_buf.semfill, 0, 0) != 0) {
-    syslog(LOG_ERR, "%s: failed semfill init\n", __FUNCTION__);
-    ret = -1;
-    goto errout;
-  }
-  return 0;
-errout:
-  rx_buffer_cleanup();
-  return ret;
-}
-
-
 int
 main(int argc, char * const argv[]) {
-  pthread_t tid_ncsi_aen_handler;
+  struct nl_sock *aen_sk = NULL;
+  int ret = 0;
 
   if (islibnl()) {
-    if (setup_rx_buffer() != 0) {
-      syslog(LOG_ERR, "%s: fail to setup rx buffer\n", __FUNCTION__);
-      return -1;
-    }
     send_cmd_and_get_resp = send_cmd_and_get_resp_libnl;
     prepare_ncsi_req_msg  = prepare_ncsi_req_msg_libnl;
     send_nl_data          = send_nl_data_libnl;
-    ncsi_rx_handler       = ncsi_rx_handler_libnl;
     send_registration_msg = send_registration_msg_libnl;
   } else {
     if (setup_user_socket(&gSock)) {
@@ -1382,26 +1418,37 @@ main(int argc, char * const argv[]) {
     send_cmd_and_get_resp = send_cmd_and_get_resp_nl_user;
     prepare_ncsi_req_msg = prepare_ncsi_req_msg_nl_user;
     send_nl_data         = send_nl_data_nl_user;
-    ncsi_rx_handler      = ncsi_rx_handler_nl_usr;
     send_registration_msg = send_registration_msg_nl_user;
     send_registration_msg(&gSock);
   }
 
-  // Create thread to handle AEN registration and Responses
-  if (pthread_create(&tid_ncsi_aen_handler, NULL, ncsi_aen_handler, NULL) < 0) {
-    syslog(LOG_ERR, "pthread_create failed on ncsi_handler\n");
-    goto cleanup;
+  syslog(LOG_INFO, "ncsid-v2 started\n");
+
+  // synchronous commands, before any response or AEN is read by the loop
+  ret = init_nic_config(&gSock);
+  if (ret < 0)  {
+    syslog(LOG_ERR, "init_nic_config failed, ret= %d\n", ret);
   }
 
-cleanup:
-  if (tid_ncsi_aen_handler > 0) {
-    pthread_join(tid_ncsi_aen_handler, NULL);
+  // listen before enabling AENs so none is missed
+  if (islibnl()) {
+    ret = setup_ncsi_mc_socket(&aen_sk, (void *)&aenbuf);
+    if (ret < 0) {
+      syslog(LOG_ERR, "%s: error setup AEN socket, polling only\n", __FUNCTION__);
+      aen_sk = NULL;
+    }
   }
+  // enable platform-specific AENs
+  enable_aens(&gSock, aen_enable_mask);
+
+  ncsi_event_loop(aen_sk);
+
+  if (aen_sk)
+    libnl_free_socket(aen_sk);
   if (gSock.fd != -1) {
     close(gSock.fd);
     gSock.fd = -1;
   }
-  rx_buffer_cleanup();
   syslog(LOG_INFO, "exit\n");
   return 0;
 }
@@ -107,6 +107,13 @@ class FRU : public Object {
       return hotPlugSupport_;
     }
 
+    /*
+     * Returns internal hotplug detection mechanism, nullptr if not supported
+     */
+    HotPlugDetectionMechanism* getHotPlugDetectionMechanism() const{
+      return hotPlugDetectionMechanism_.get();
+    }
+
     /*
      * Detect if fru is available or not and return availability status
      */
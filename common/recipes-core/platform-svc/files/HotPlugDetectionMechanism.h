@@ -19,6 +19,7 @@
  */
 
 #pragma once
+#include <cstdint>
 
 namespace openbmc {
 namespace qin {
@@ -31,6 +32,32 @@ class HotPlugDetectionMechanism {
      * Detects availability of FRU and returns whether fru is available or not
      */
     virtual bool detectAvailability() = 0;
+
+    virtual ~HotPlugDetectionMechanism() {}
+
+    /*
+     * Returns fd that signals a possible change in availability when it
+     * reports getEvents() in poll/epoll, or -1 if the mechanism has no
+     * notification and must be polled
+     */
+    virtual int getEventFd() const {
+      return -1;
+    }
+
+    /*
+     * Returns poll events to wait for on getEventFd()
+     */
+    virtual uint32_t getEvents() const {
+      return 0;
+    }
+
+    /*
+     * Consumes the pending notification on getEventFd()
+     * Returns whether availability may have changed
+     */
+    virtual bool clearEvent() {
+      return true;
+    }
 };
 } // namespace qin
 } // namespace openbmc
@@ -0,0 +1,161 @@
+/*
+ * HotPlugDetectionViaEvent.h
+ *
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#pragma once
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <glog/logging.h>
+#include "HotPlugDetectionViaPath.h"
+
+namespace openbmc {
+namespace qin {
+
+/*
+ * Path based hotplug detection that also tells when the file changes.
+ * A gpio value file whose edge could be set is waited on with POLLPRI,
+ * which the kernel raises through sysfs_notify. Other sysfs attributes
+ * give no such guarantee and are left to polling. Files outside sysfs
+ * are watched with inotify on their directory, so the file may come and
+ * go. If no event source is set up, getEventFd() returns -1 and the FRU
+ * is polled.
+ */
+class HotPlugDetectionViaEvent : public HotPlugDetectionViaPath {
+  private:
+    int fd_ = -1;                     // sysfs attribute or inotify fd
+    bool sysfs_ = false;              // fd_ is the sysfs attribute
+    std::string fileName_;            // basename of path_, for inotify
+
+    /*
+     * Requests interrupts on both edges if path_ is a gpio value.
+     * Returns false if path_ is not a gpio value or edge cannot be set.
+     */
+    bool setGpioEdge() {
+      std::string::size_type pos = path_.rfind('/');
+      if (pos == std::string::npos ||
+          path_.compare(pos + 1, std::string::npos, "value") != 0) {
+        return false;
+      }
+
+      std::ofstream edge(path_.substr(0, pos + 1) + "edge");
+      if (!edge.is_open()) {
+        return false;
+      }
+      edge << "both";
+      edge.flush();
+      return edge.good();
+    }
+
+    void initSysfs() {
+      if (!setGpioEdge()) {
+        return;
+      }
+      if ((fd_ = open(path_.c_str(), O_RDONLY | O_CLOEXEC)) < 0) {
+        LOG(WARNING) << "Could not open " << path_ << ": " << strerror(errno);
+        return;
+      }
+      sysfs_ = true;
+      // sysfs only notifies after the attribute was read once
+      clearEvent();
+    }
+
+    void initInotify() {
+      std::string::size_type pos = path_.rfind('/');
+      std::string dir = (pos == std::string::npos) ? "." :
+                        (pos == 0) ? "/" : path_.substr(0, pos);
+      fileName_ = path_.substr(pos == std::string::npos ? 0 : pos + 1);
+
+      if ((fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0) {
+        LOG(WARNING) << "inotify_init1 failed: " << strerror(errno);
+        return;
+      }
+      if (inotify_add_watch(fd_, dir.c_str(),
+                            IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE |
+                            IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM) < 0) {
+        LOG(WARNING) << "Could not watch " << dir << ": " << strerror(errno);
+        close(fd_);
+        fd_ = -1;
+      }
+    }
+
+  public:
+    /*
+     * Constructor
+     */
+    HotPlugDetectionViaEvent(const std::string & path)
+      : HotPlugDetectionViaPath(path) {
+      if (path_.compare(0, 5, "/sys/") == 0) {
+        initSysfs();
+      }
+      else {
+        initInotify();
+      }
+    }
+
+    ~HotPlugDetectionViaEvent() {
+      if (fd_ >= 0) {
+        close(fd_);
+      }
+    }
+
+    int getEventFd() const override {
+      return fd_;
+    }
+
+    uint32_t getEvents() const override {
+      return sysfs_ ? (POLLPRI | POLLERR) : POLLIN;
+    }
+
+    bool clearEvent() override {
+      char buf[4096]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+      ssize_t len;
+
+      if (fd_ < 0) {
+        return true;
+      }
+
+      if (sysfs_) {
+        // rearm by reading the attribute from the start
+        lseek(fd_, 0, SEEK_SET);
+        while (read(fd_, buf, sizeof(buf)) > 0);
+        return true;
+      }
+
+      bool changed = false;
+      while ((len = read(fd_, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + len;) {
+          struct inotify_event *ev = (struct inotify_event *)p;
+          if ((ev->mask & IN_Q_OVERFLOW) ||
+              (ev->len > 0 && fileName_.compare(ev->name) == 0)) {
+            changed = true;
+          }
+          p += sizeof(struct inotify_event) + ev->len;
+        }
+      }
+      return changed;
+    }
+};
+} // namespace qin
+} // namespace openbmc
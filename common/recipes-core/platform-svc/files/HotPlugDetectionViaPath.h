@@ -27,7 +27,7 @@ namespace openbmc {
 namespace qin {
 
 class HotPlugDetectionViaPath : public HotPlugDetectionMechanism {
-  private:
+  protected:
     std::string path_;                // Path of the file from which
                                       // status of FRU can be detected
 
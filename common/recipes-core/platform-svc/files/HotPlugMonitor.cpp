@@ -0,0 +1,166 @@
+/*
+ * HotPlugMonitor.cpp
+ *
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <glog/logging.h>
+#include "HotPlugMonitor.h"
+
+namespace openbmc {
+namespace qin {
+
+HotPlugMonitor::HotPlugMonitor(PlatformObjectTree &platformTree,
+                               int debounceMs)
+  : platformTree_(platformTree), debounce_(debounceMs) {}
+
+HotPlugMonitor::~HotPlugMonitor() {
+  if (epollFd_ >= 0) {
+    close(epollFd_);
+  }
+  if (stopFd_ >= 0) {
+    close(stopFd_);
+  }
+}
+
+int HotPlugMonitor::init() {
+  std::vector<FRU*> frus;
+  struct epoll_event ev;
+
+  if ((epollFd_ = epoll_create1(EPOLL_CLOEXEC)) < 0 ||
+      (stopFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+    LOG(ERROR) << "Could not create hotplug event loop: " << strerror(errno);
+    return 0;
+  }
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.ptr = nullptr;
+  epoll_ctl(epollFd_, EPOLL_CTL_ADD, stopFd_, &ev);
+
+  platformTree_.getHPIntDetectSupportedFrus(frus);
+  for (FRU* fru : frus) {
+    HotPlugDetectionMechanism* mechanism = fru->getHotPlugDetectionMechanism();
+    int fd = mechanism->getEventFd();
+
+    ev.events = mechanism->getEvents();
+    ev.data.ptr = fru;
+    if (fd < 0 || epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+      LOG(INFO) << "Polling hotplug of fru " << fru->getName();
+      polledFrus_.push_back(fru);
+    }
+  }
+
+  // initial state, later only notified frus are checked
+  platformTree_.checkHotPlugSupportedFrus();
+  nextPoll_ = Clock::now() + std::chrono::milliseconds(HOTPLUG_POLL_INTERVAL_MS);
+  return frus.size();
+}
+
+int HotPlugMonitor::checkFrus(std::vector<FRU*> &frus) {
+  int nofFrus = frus.size();
+  for (FRU* fru : frus) {
+    platformTree_.checkHotPlugSupportedFru(*fru);
+  }
+  frus.clear();
+  return nofFrus;
+}
+
+int HotPlugMonitor::runOnce(int timeoutMs) {
+  struct epoll_event events[16];
+  Clock::time_point end = Clock::now() + std::chrono::milliseconds(timeoutMs);
+
+  while (!stopped_) {
+    Clock::time_point now = Clock::now();
+
+    if (!notifiedFrus_.empty() && now >= debounceEnd_) {
+      return checkFrus(notifiedFrus_);
+    }
+    if (!polledFrus_.empty() && now >= nextPoll_) {
+      nextPoll_ = now + std::chrono::milliseconds(HOTPLUG_POLL_INTERVAL_MS);
+      std::vector<FRU*> frus(polledFrus_);
+      return checkFrus(frus);
+    }
+    if (timeoutMs >= 0 && now >= end) {
+      return 0;
+    }
+
+    // sleep until the earliest of timeout, debounce end and next poll
+    bool bounded = (timeoutMs >= 0);
+    Clock::time_point wake = end;
+    if (!notifiedFrus_.empty()) {
+      wake = bounded ? std::min(wake, debounceEnd_) : debounceEnd_;
+      bounded = true;
+    }
+    if (!polledFrus_.empty()) {
+      wake = bounded ? std::min(wake, nextPoll_) : nextPoll_;
+      bounded = true;
+    }
+
+    int waitMs = -1;
+    if (bounded) {
+      waitMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                 wake - now).count() + 1;
+    }
+
+    int n = epoll_wait(epollFd_, events, sizeof(events) / sizeof(events[0]),
+                       waitMs);
+    if (n < 0 && errno != EINTR) {
+      LOG(ERROR) << "epoll_wait failed: " << strerror(errno);
+      return 0;
+    }
+
+    for (int i = 0; i < n; i++) {
+      FRU* fru = (FRU*)events[i].data.ptr;
+      if (fru == nullptr) {
+        continue; // stop() woke us up, stopped_ is set
+      }
+      if (fru->getHotPlugDetectionMechanism()->clearEvent()) {
+        if (std::find(notifiedFrus_.begin(), notifiedFrus_.end(), fru) ==
+            notifiedFrus_.end()) {
+          notifiedFrus_.push_back(fru);
+        }
+        // every notification restarts the debounce window
+        debounceEnd_ = Clock::now() + debounce_;
+      }
+    }
+  }
+  return 0;
+}
+
+void HotPlugMonitor::run() {
+  while (!stopped_) {
+    runOnce(-1);
+  }
+}
+
+void HotPlugMonitor::stop() {
+  uint64_t one = 1;
+  stopped_ = true;
+  if (write(stopFd_, &one, sizeof(one)) < 0) {
+    LOG(ERROR) << "Could not wake up hotplug monitor: " << strerror(errno);
+  }
+}
+
+} // namespace qin
+} // namespace openbmc
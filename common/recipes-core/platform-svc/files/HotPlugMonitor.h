@@ -0,0 +1,95 @@
+/*
+ * HotPlugMonitor.h
+ *
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include "FRU.h"
+#include "PlatformObjectTree.h"
+
+namespace openbmc {
+namespace qin {
+
+#define HOTPLUG_DEBOUNCE_MS 50
+#define HOTPLUG_POLL_INTERVAL_MS 5000
+
+/*
+ * Waits for the notifications of the hotplug detection mechanisms of all
+ * frus supporting internal hotplug detection in one epoll set. A fru is
+ * checked once its notifications have been quiet for the debounce time,
+ * so a bouncing presence pin results in a single update. Frus whose
+ * mechanism has no notification are checked every
+ * HOTPLUG_POLL_INTERVAL_MS; without such frus there are no periodic
+ * wakeups.
+ */
+class HotPlugMonitor {
+  private:
+    typedef std::chrono::steady_clock Clock;
+
+    PlatformObjectTree &platformTree_;
+    std::chrono::milliseconds debounce_;
+    int epollFd_ = -1;
+    int stopFd_ = -1;                   // eventfd to wake up run()
+    std::atomic<bool> stopped_{false};
+    std::vector<FRU*> polledFrus_;      // frus without notification
+    std::vector<FRU*> notifiedFrus_;    // frus notified in debounce window
+    Clock::time_point debounceEnd_;     // when to check notifiedFrus_
+    Clock::time_point nextPoll_;        // when to check polledFrus_
+
+    /*
+     * Checks availability of frus and returns the number checked
+     */
+    int checkFrus(std::vector<FRU*> &frus);
+
+  public:
+    /*
+     * Constructor
+     */
+    HotPlugMonitor(PlatformObjectTree &platformTree,
+                   int debounceMs = HOTPLUG_DEBOUNCE_MS);
+
+    ~HotPlugMonitor();
+
+    /*
+     * Registers the detection mechanisms of the frus in platformTree.
+     * Returns number of frus monitored.
+     */
+    int init();
+
+    /*
+     * Waits up to timeoutMs (-1 for ever) for a fru to be due for a check,
+     * checks it and returns the number of frus checked, 0 on timeout.
+     */
+    int runOnce(int timeoutMs);
+
+    /*
+     * Monitors until stop() is called
+     */
+    void run();
+
+    /*
+     * Makes run() return, may be called from any thread
+     */
+    void stop();
+};
+
+} // namespace qin
+} // namespace openbmc
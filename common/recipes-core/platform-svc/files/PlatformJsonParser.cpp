@@ -26,7 +26,7 @@
 #include "PlatformObjectTree.h"
 #include "PlatformJsonParser.h"
 #include "HotPlugDetectionMechanism.h"
-#include "HotPlugDetectionViaPath.h"
+#include "HotPlugDetectionViaEvent.h"
 
 namespace openbmc {
 namespace qin {
@@ -156,9 +156,10 @@ void PlatformJsonParser::parseFRU(const nlohmann::json   &jObject,
                                 std::move(hotPlugDetectionMechanism));
     } else if (type.compare("path") == 0) {
       //If FRU supports path based hotplug detection
+      //changes of the file are notified via inotify or sysfs poll
       const std::string &path = hotPlugDetectionMechanismObject.at("path");
       std::unique_ptr<HotPlugDetectionMechanism> hotPlugDetectionMechanism(
-                                             new HotPlugDetectionViaPath(path));
+                                             new HotPlugDetectionViaEvent(path));
       fru = platformTree.addFRU(name,
                                 parentPath,
                                 fruJson.dump(),
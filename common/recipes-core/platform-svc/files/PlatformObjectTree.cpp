@@ -206,7 +206,7 @@ void PlatformObjectTree::addFRUtoSensorService(const FRU & fru) throw(const char
     Object* parent = fru.getParent();
 
     //Remove PlatformService Base path from FRU parent path
-    std::string fruParentPath = parent->getObjectPath().erase(0,
+    std::string fruParentPath = getObjectPath(parent).substr(
                                              platformServiceBasePath_.length());
 
     //Add FRU to SensorService
@@ -251,7 +251,7 @@ void PlatformObjectTree::removeFRUFromSensorService(const FRU & fru) throw(const
   }
 
   if (sensorService_->isAvailable()) {
-    sensorService_->removeFRU(fru.getObjectPath().erase(0,
+    sensorService_->removeFRU(getObjectPath(&fru).substr(
                                            platformServiceBasePath_.length()));
   }
 }
@@ -269,7 +269,7 @@ void PlatformObjectTree::addFRUtoFruService(const FRU & fru) throw(const char *)
     Object* parent = fru.getParent();
 
     //Remove PlatformService Base path from FRU parent path
-    std::string fruParentPath = parent->getObjectPath().erase(0,
+    std::string fruParentPath = getObjectPath(parent).substr(
                                             platformServiceBasePath_.length());
 
     //Add FRU to FruService
@@ -297,7 +297,7 @@ void PlatformObjectTree::removeFRUFromFruService(const FRU & fru) throw(const ch
   }
 
   if (fruService_->isAvailable()) {
-    fruService_->removeFRU(fru.getObjectPath().erase(0,
+    fruService_->removeFRU(getObjectPath(&fru).substr(
                                            platformServiceBasePath_.length()));
   }
 }
@@ -349,6 +349,40 @@ int PlatformObjectTree::getNofHPIntDetectSupportedFrusRec(const Object & obj) {
   return nofFrus;
 }
 
+void PlatformObjectTree::getHPIntDetectSupportedFrusRec(
+                                                  const Object & obj,
+                                                  std::vector<FRU*> &frus) {
+  for (auto &it : obj.getChildMap()) {
+    FRU* fru;
+    if ((fru = dynamic_cast<FRU*>(it.second)) != nullptr) {
+      if (fru->isIntHPDetectionSupported()) {
+        frus.push_back(fru);
+      }
+      getHPIntDetectSupportedFrusRec(*fru, frus);
+    }
+  }
+}
+
+void PlatformObjectTree::checkHotPlugSupportedFru(FRU & fru) {
+  if (fru.isIntHPDetectionSupported() == false ||
+      checkIfParentFruAvailable(fru) == false) {
+    //parent fru will check this fru when it becomes available
+    return;
+  }
+
+  bool oldAvailability = fru.isAvailable();
+  bool isAvailable = fru.detectAvailability();
+  if (oldAvailability != isAvailable) {
+    //If change in availability
+    changeInFruAvailabilityHandler(fru);
+
+    //frus under it were not checked while it was unavailable
+    if (isAvailable) {
+      checkHotPlugSupportedFrusRec(fru);
+    }
+  }
+}
+
 void PlatformObjectTree::checkHotPlugSupportedFrusRec(const Object & obj) {
   for (auto &it : obj.getChildMap()) {
     FRU* fru;
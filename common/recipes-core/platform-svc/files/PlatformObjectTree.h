@@ -156,6 +156,22 @@ class PlatformObjectTree : public ObjectTree {
       checkHotPlugSupportedFrusRec(*getObject(platformServiceBasePath_));
     }
 
+    /*
+     * Appends all frus which support internal hot plug detection to frus,
+     * including the ones under unavailable frus
+     */
+    void getHPIntDetectSupportedFrus(std::vector<FRU*> &frus) {
+      getHPIntDetectSupportedFrusRec(*getObject(platformServiceBasePath_), frus);
+    }
+
+    /*
+     * Checks availability of a single fru supporting internal hot plug
+     * detection, used when its detection mechanism reports a change.
+     * Does nothing while a parent fru is unavailable. If the fru became
+     * available, the frus under it are checked as well.
+     */
+    void checkHotPlugSupportedFru(FRU & fru);
+
     /*
      * Sets availability of fru at fruPath
      * Returns if operation is successful
@@ -194,6 +210,13 @@ class PlatformObjectTree : public ObjectTree {
      */
     int getNofHPIntDetectSupportedFrusRec(const Object & obj);
 
+    /**
+     * Appends frus which supports internal detection of hotplug
+     * under obj subtree to frus
+     */
+    void getHPIntDetectSupportedFrusRec(const Object & obj,
+                                        std::vector<FRU*> &frus);
+
     /**
      * Recursively traverses through tree at obj and checks status of frus
      * which supports internal hotplug detection
@@ -268,6 +291,7 @@ class PlatformObjectTree : public ObjectTree {
                             DBusInterfaceBase       &interface) {
       Object* object = upObj.get();
       objectMap_.insert(std::make_pair(path, std::move(upObj)));
+      indexObject(object, path);
 
       DBus* dbus = getDBusObject(ipc_.get());
       //Register with platformObjectTree object
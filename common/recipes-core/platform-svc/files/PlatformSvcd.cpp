@@ -31,6 +31,7 @@
 #include "PlatformJsonParser.h"
 #include "SensorService.h"
 #include "FruService.h"
+#include "HotPlugMonitor.h"
 using namespace openbmc::qin;
 
 // validator for the json filename
@@ -116,19 +117,14 @@ static void fruServiceOnNameVanished (GDBusConnection *connection,
 }
 
 /*
- * Monitors hotplug supported frus every 5 seconds
+ * Monitors hotplug supported frus, woken up by their detection mechanisms
  */
 static void hotPlugMonitor(PlatformObjectTree* platformTree) {
   LOG(INFO) << "hotPlugMonitor started";
 
-  if (platformTree->getNofHPIntDetectSupportedFrus() > 0) {
-    while (true) {
-      //Check for hot plug supported frus
-      platformTree->checkHotPlugSupportedFrus();
-
-      //Sleep for 5 seconds
-      std::this_thread::sleep_for(std::chrono::seconds(5));
-    }
+  HotPlugMonitor monitor(*platformTree);
+  if (monitor.init() > 0) {
+    monitor.run();
   }
   else {
     LOG(INFO) << "No Fru Supports internal hotplug detection, "
@@ -21,7 +21,9 @@
 
 #include <gtest/gtest.h>
 #include <glog/logging.h>
+#include <poll.h>
 #include "../HotPlugDetectionViaPath.h"
+#include "../HotPlugDetectionViaEvent.h"
 #include "HotPlugDetectionFile.h"
 
 using namespace openbmc::qin;
@@ -44,6 +46,58 @@ TEST(HotPlugDetectionMechanismTest, HotPlugDetectionViaPathTest) {
   ASSERT_FALSE(hpDetect.detectAvailability());
 }
 
+//Returns whether fd reports events within timeoutMs
+static bool waitForEvent(int fd, uint32_t events, int timeoutMs) {
+  struct pollfd pfd = {fd, (short)events, 0};
+  return poll(&pfd, 1, timeoutMs) > 0;
+}
+
+TEST(HotPlugDetectionMechanismTest, HotPlugDetectionViaEventTest) {
+  HotPlugDetectionFile file("/tmp/hpDetectViaEventTest");
+  HotPlugDetectionViaEvent hpDetect(file.getFileName());
+  int fd = hpDetect.getEventFd();
+
+  //regular file is watched with inotify
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(hpDetect.getEvents(), (uint32_t)POLLIN);
+  //Empty file, no notification pending
+  ASSERT_FALSE(waitForEvent(fd, hpDetect.getEvents(), 0));
+  ASSERT_FALSE(hpDetect.detectAvailability());
+
+  //write fru status to file, should be notified
+  file.writeHotPlugStatusToFile(1);
+  ASSERT_TRUE(waitForEvent(fd, hpDetect.getEvents(), 1000));
+  ASSERT_TRUE(hpDetect.clearEvent());
+  ASSERT_FALSE(waitForEvent(fd, hpDetect.getEvents(), 0));
+  ASSERT_TRUE(hpDetect.detectAvailability());
+
+  //change of other file in the directory is not a change of the fru
+  {
+    HotPlugDetectionFile other("/tmp/hpDetectViaEventTestOther");
+    other.writeHotPlugStatusToFile(0);
+  }
+  ASSERT_TRUE(waitForEvent(fd, hpDetect.getEvents(), 1000));
+  ASSERT_FALSE(hpDetect.clearEvent());
+
+  //write fru status to file, should be notified
+  file.writeHotPlugStatusToFile(0);
+  ASSERT_TRUE(waitForEvent(fd, hpDetect.getEvents(), 1000));
+  ASSERT_TRUE(hpDetect.clearEvent());
+  ASSERT_FALSE(hpDetect.detectAvailability());
+}
+
+TEST(HotPlugDetectionMechanismTest, HotPlugDetectionViaEventFallback) {
+  //directory does not exist, mechanism has to be polled
+  HotPlugDetectionViaEvent hpDetect("/tmp/hpDetectNoSuchDir/status");
+  ASSERT_LT(hpDetect.getEventFd(), 0);
+  ASSERT_TRUE(hpDetect.clearEvent());
+  ASSERT_FALSE(hpDetect.detectAvailability());
+
+  //path mechanism has no notification
+  HotPlugDetectionViaPath hpPath("/tmp/hpDetectNoSuchDir/status");
+  ASSERT_LT(hpPath.getEventFd(), 0);
+}
+
 int main (int argc, char* argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
   ::google::InitGoogleLogging(argv[0]);
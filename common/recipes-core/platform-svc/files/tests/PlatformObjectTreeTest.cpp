@@ -24,6 +24,7 @@
 #include <dbus-utils/DBus.h>
 #include "../PlatformObjectTree.h"
 #include "../PlatformJsonParser.h"
+#include "../HotPlugMonitor.h"
 #include "HotPlugDetectionFile.h"
 
 using namespace openbmc::qin;
@@ -203,6 +204,39 @@ TEST_F(PlatformObjectTreeTest, HotPlugTest) {
   ASSERT_FALSE(fru->isAvailable());
 }
 
+//Test to verify hot plug changes are picked up from notifications
+TEST_F(PlatformObjectTreeTest, HotPlugMonitorTest) {
+  FRU* fru;
+
+  //Create empty file for IntDetectExampleFRU
+  HotPlugDetectionFile file("/tmp/hpDetectViaPathTest");
+  fru = dynamic_cast<FRU*>(
+              platformTree->getObject(
+                "/org/openbmc/PlatformService/IntDetectExampleFRU"));
+  ASSERT_NE(fru, nullptr);
+
+  HotPlugMonitor monitor(*platformTree, 20);
+  //Only IntDetectExampleFRU supports internal hot plug detection
+  ASSERT_EQ(monitor.init(), 1);
+  ASSERT_FALSE(fru->isAvailable());
+
+  //Nothing changed, nothing to check
+  ASSERT_EQ(monitor.runOnce(100), 0);
+
+  //write fru available to file
+  file.writeHotPlugStatusToFile(1);
+  ASSERT_EQ(monitor.runOnce(1000), 1);
+  ASSERT_TRUE(fru->isAvailable());
+
+  //bouncing status is checked once after it settled
+  file.writeHotPlugStatusToFile(0);
+  file.writeHotPlugStatusToFile(1);
+  file.writeHotPlugStatusToFile(0);
+  ASSERT_EQ(monitor.runOnce(1000), 1);
+  ASSERT_FALSE(fru->isAvailable());
+  ASSERT_EQ(monitor.runOnce(100), 0);
+}
+
 int main (int argc, char* argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
   ::google::InitGoogleLogging(argv[0]);
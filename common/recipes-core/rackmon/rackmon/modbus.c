@@ -26,6 +26,7 @@
 #include <string.h>
 #include <errno.h>
 #include <sys/ioctl.h>
+#include <poll.h>
 #include <sched.h>
 #include <pthread.h>
 
@@ -90,37 +91,106 @@ const char* baud_to_str(speed_t baudrate) {
   return out;
 }
 
+int baud_to_int(speed_t baudrate) {
+  switch (baudrate) {
+    case B1200:    return 1200;
+    case B2400:    return 2400;
+    case B4800:    return 4800;
+    case B9600:    return 9600;
+    case B19200:   return 19200;
+    case B38400:   return 38400;
+    case B57600:   return 57600;
+    case B115200:  return 115200;
+  }
+  return 0;
+}
+
+int modbus_frame_gap_us(speed_t baudrate) {
+  int bps = baud_to_int(baudrate);
+
+  if (bps == 0 || bps > 19200) {
+    return MODBUS_FIXED_FRAME_GAP_US;
+  }
+  // 3.5 characters, rounded up
+  return (7 * MODBUS_CHAR_BITS * 1000000 + 2 * bps - 1) / (2 * bps);
+}
+
+/*
+ * Wait up to timeout_us for fd to become readable.
+ * Returns 1 if readable, 0 on timeout and -1 on error.
+ */
+static int poll_in(int fd, int timeout_us) {
+  struct pollfd pfd = {
+    .fd = fd,
+    .events = POLLIN,
+  };
+  int rv;
+
+  do {
+    rv = poll(&pfd, 1, (timeout_us + 999) / 1000);
+  } while (rv < 0 && errno == EINTR);
+  if (rv < 0) {
+    perror("poll()");
+  }
+  return rv;
+}
+
+/*
+ * Read whatever is available, straight into dst.
+ * Returns bytes read or -1 on error.
+ */
+static ssize_t read_avail(int fd, char* dst, size_t len) {
+  ssize_t read_size;
+
+  do {
+    read_size = read(fd, dst, len);
+  } while (read_size < 0 && errno == EINTR);
+  if (read_size < 0 && errno == EAGAIN) {
+    return 0;
+  }
+  if (read_size < 0) {
+    fprintf(stderr, "read error: %s\n", strerror(errno));
+  }
+  return read_size;
+}
+
 size_t read_wait(int fd, char* dst, size_t maxlen, int mdelay_us) {
-  fd_set fdset;
-  struct timeval timeout;
-  char read_buf[16];
-  size_t read_size = 0;
   size_t pos = 0;
   memset(dst, 0, maxlen);
   while(pos < maxlen) {
-    FD_ZERO(&fdset);
-    FD_SET(fd, &fdset);
-    timeout.tv_sec = 0;
-    timeout.tv_usec = mdelay_us;
-    int rv = select(fd + 1, &fdset, NULL, NULL, &timeout);
-    if(rv == -1) {
-      perror("select()");
-    } else if (rv == 0) {
+    if (poll_in(fd, mdelay_us) <= 0) {
       break;
     }
-    read_size = read(fd, read_buf, 16);
+    ssize_t read_size = read_avail(fd, dst + pos, maxlen - pos);
     if(read_size < 0) {
-      if(errno == EAGAIN) continue;
-      fprintf(stderr, "read error: %s\n", strerror(errno));
       exit(1);
     }
-    if((pos + read_size) <= maxlen) {
-      memcpy(dst + pos, read_buf, read_size);
-      pos += read_size;
-    } else {
-      return pos;
-      fprintf(stderr, "Response buffer overflowed!\n");
+    pos += read_size;
+  }
+  return pos;
+}
+
+size_t read_frame(int fd, char* dst, size_t maxlen, int timeout_us,
+                  int gap_us) {
+  size_t pos = 0;
+  int wait_us = timeout_us;
+
+  memset(dst, 0, maxlen);
+  while(pos < maxlen) {
+    if (poll_in(fd, wait_us) <= 0) {
+      break;
+    }
+    ssize_t read_size = read_avail(fd, dst + pos, maxlen - pos);
+    if(read_size < 0) {
+      break;
+    }
+    pos += read_size;
+    // an exception response is shorter than the expected reply
+    if (pos >= 2 && (dst[1] & MODBUS_EXCEPTION_FLAG) &&
+        pos >= MODBUS_EXCEPTION_LEN) {
+      break;
     }
+    wait_us = gap_us;
   }
   return pos;
 }
@@ -229,6 +299,8 @@ int modbuscmd(modbus_req *req, speed_t baudrate) {
     tio.c_cflag |= CLOCAL;
     tio.c_cflag |= CS8;
     tio.c_iflag |= INPCK;
+    // reads are driven by poll() with the frame gaps, so a read returns
+    // whatever arrived instead of waiting for a byte count or VTIME
     tio.c_cc[VMIN] = 1;
     tio.c_cc[VTIME] = 0;
     ERR_EXIT(tcsetattr(req->tty_fd,TCSANOW,&tio));
@@ -289,7 +361,11 @@ int modbuscmd(modbus_req *req, speed_t baudrate) {
     if(req->expected_len > req->dest_limit) {
       return -1;
     }
-    mb_pos = read_wait(req->tty_fd, req->dest_buf, req->expected_len, req->timeout);
+    // the response ends when the line stays idle for longer than the
+    // inter-frame gap plus whatever latency the UART adds
+    mb_pos = read_frame(req->tty_fd, req->dest_buf, req->expected_len,
+                        req->timeout,
+                        modbus_frame_gap_us(baudrate) + MODBUS_RX_LATENCY_US);
     clock_gettime(CLOCK_MONOTONIC_RAW, &read_end);
     req->dest_len = mb_pos;
     if(mb_pos >= 4) {
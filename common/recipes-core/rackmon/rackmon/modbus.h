@@ -42,6 +42,18 @@
 // Modbus constants
 #define MODBUS_READ_HOLDING_REGISTERS 3
 #define MODBUS_WRITE_HOLDING_REGISTERS 6
+#define MODBUS_EXCEPTION_FLAG 0x80
+// Slave_Addr + Function + Exception_Code + CRC
+#define MODBUS_EXCEPTION_LEN 5
+// Largest register count of a single Read Holding Registers request
+#define MODBUS_MAX_READ_REGS 125
+
+// Bits per character on the wire: start + 8 data + parity + stop
+#define MODBUS_CHAR_BITS 11
+// Spec fixes the inter-frame gap above 19200 baud
+#define MODBUS_FIXED_FRAME_GAP_US 1750
+// Delivery latency of the UART, covers USB-serial latency timers
+#define MODBUS_RX_LATENCY_US 20000
 
 #ifndef ARRAY_SIZE
 #define ARRAY_SIZE(_a) (sizeof(_a) / sizeof((_a)[0]))
@@ -95,9 +107,20 @@ void append_modbus_crc16(char* buf, size_t* len);
 void print_hex(FILE* f, char* buf, size_t len);
 const char* baud_to_str(speed_t baudrate);
 
+// Bits per second of baudrate, 0 if unknown
+int baud_to_int(speed_t baudrate);
+
+// Silent interval (3.5 characters) that separates two frames
+int modbus_frame_gap_us(speed_t baudrate);
+
 // Read until maxlen bytes or no bytes in mdelay_us microseconds
 size_t read_wait(int fd, char* dst, size_t maxlen, int mdelay_us);
 
+// Read one frame: wait up to timeout_us for its first byte, then until
+// maxlen bytes, an exception response or no bytes in gap_us microseconds
+size_t read_frame(int fd, char* dst, size_t maxlen, int timeout_us,
+                  int gap_us);
+
 int modbuscmd(modbus_req *req, speed_t baudrate);
 uint16_t modbus_crc16(char* buffer, size_t length);
 const char* modbus_strerror(int mb_err);
@@ -27,18 +27,233 @@
 #include <sys/ioctl.h>
 #include <getopt.h>
 #include <linux/serial.h>
+#include <signal.h>
 #include "modbus.h"
 
+#define MAX_SIM_PSUS 24
+#define MAX_SIM_HOLES 16
+#define DEFAULT_SIM_REGS 0x100
+// Slave_Addr + Function + Register + Count/Value + CRC
+#define MODBUS_SIM_REQ_LEN 8
+
+// Modbus exception codes
+#define MODBUS_ILLEGAL_FUNCTION 1
+#define MODBUS_ILLEGAL_DATA_ADDRESS 2
+#define MODBUS_ILLEGAL_DATA_VALUE 3
+
 void usage() {
   fprintf(stderr,
       "modbussim [-v] [-t <tty>] modbus_request modbus_reply\n"
+      "modbussim [-v] [-t <tty>] [-b <baudrate>] [-r <nregs>] [-u <reg>]... "
+      "-p <addr>[,<addr>...]\n"
       "\ttty defaults to %s\n"
       "\tmodbus request/reply should be specified in hex\n"
-      "\teg:\ta40300000008\n",
-      DEFAULT_TTY);
+      "\teg:\ta40300000008\n"
+      "\t-p emulates PSUs at the given (hex) addresses, answering\n"
+      "\t   read (3) and write (6) holding register commands until\n"
+      "\t   interrupted; register r of PSU a reads (a << 8) | (r & 0xff)\n"
+      "\t-r number of registers of each PSU (default %d)\n"
+      "\t-u (hex) register that is not implemented, reads covering it\n"
+      "\t   get an illegal data address exception\n",
+      DEFAULT_TTY, DEFAULT_SIM_REGS);
   exit(1);
 }
 
+typedef struct {
+  uint8_t addr;
+  uint16_t *regs;
+  long reads;
+  long regs_read;
+  long writes;
+  long errors;
+} sim_psu;
+
+static sim_psu psus[MAX_SIM_PSUS];
+static int num_psus = 0;
+static uint16_t num_regs = DEFAULT_SIM_REGS;
+static uint16_t holes[MAX_SIM_HOLES];
+static int num_holes = 0;
+static volatile sig_atomic_t stop_sim = 0;
+
+static void sim_stop(int sig) {
+  stop_sim = 1;
+}
+
+static sim_psu* sim_find_psu(uint8_t addr) {
+  for (int i = 0; i < num_psus; i++) {
+    if (psus[i].addr == addr) {
+      return &psus[i];
+    }
+  }
+  return NULL;
+}
+
+static int sim_add_psus(char *list) {
+  char *tok, *save = NULL;
+
+  for (tok = strtok_r(list, ",", &save); tok != NULL;
+       tok = strtok_r(NULL, ",", &save)) {
+    if (num_psus >= MAX_SIM_PSUS) {
+      fprintf(stderr, "Too many PSUs, at most %d\n", MAX_SIM_PSUS);
+      return -1;
+    }
+    psus[num_psus].addr = strtoul(tok, NULL, 16);
+    num_psus++;
+  }
+  return 0;
+}
+
+static int sim_init_regs(void) {
+  for (int i = 0; i < num_psus; i++) {
+    psus[i].regs = calloc(num_regs, sizeof(uint16_t));
+    if (psus[i].regs == NULL) {
+      return -1;
+    }
+    for (int r = 0; r < num_regs; r++) {
+      psus[i].regs[r] = (psus[i].addr << 8) | (r & 0xff);
+    }
+  }
+  return 0;
+}
+
+static int sim_is_hole(int begin, int count) {
+  for (int i = 0; i < num_holes; i++) {
+    if (holes[i] >= begin && holes[i] < begin + count) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Build the reply of an emulated PSU to req (without CRC).
+ * Returns reply length, 0 if the request is not for an emulated PSU.
+ */
+static size_t sim_reply(char *req, size_t req_len, char *reply) {
+  sim_psu *psu = sim_find_psu(req[0]);
+  uint8_t func = req[1];
+  int begin, count, exception = 0;
+  size_t len = 0;
+
+  if (psu == NULL || req_len < 6) {
+    return 0;
+  }
+
+  begin = ((uint8_t)req[2] << 8) | (uint8_t)req[3];
+  count = ((uint8_t)req[4] << 8) | (uint8_t)req[5];
+
+  reply[len++] = psu->addr;
+  switch (func) {
+  case MODBUS_READ_HOLDING_REGISTERS:
+    if (count < 1 || count > MODBUS_MAX_READ_REGS) {
+      exception = MODBUS_ILLEGAL_DATA_VALUE;
+      break;
+    }
+    if (begin + count > num_regs || sim_is_hole(begin, count)) {
+      exception = MODBUS_ILLEGAL_DATA_ADDRESS;
+      break;
+    }
+    reply[len++] = func;
+    reply[len++] = count * 2;
+    for (int r = begin; r < begin + count; r++) {
+      reply[len++] = psu->regs[r] >> 8;
+      reply[len++] = psu->regs[r] & 0xff;
+    }
+    psu->reads++;
+    psu->regs_read += count;
+    break;
+  case MODBUS_WRITE_HOLDING_REGISTERS:
+    // count is the value of the single register written
+    if (begin >= num_regs || sim_is_hole(begin, 1)) {
+      exception = MODBUS_ILLEGAL_DATA_ADDRESS;
+      break;
+    }
+    psu->regs[begin] = count;
+    memcpy(reply + len, req + 1, 5);
+    len += 5;
+    psu->writes++;
+    break;
+  default:
+    exception = MODBUS_ILLEGAL_FUNCTION;
+    break;
+  }
+
+  if (exception) {
+    reply[len++] = func | MODBUS_EXCEPTION_FLAG;
+    reply[len++] = exception;
+    psu->errors++;
+  }
+  return len;
+}
+
+static void sim_print_stats(void) {
+  printf("addr  reads  regs_read  writes  exceptions\n");
+  for (int i = 0; i < num_psus; i++) {
+    printf("%02x  %7ld  %9ld  %6ld  %10ld\n", psus[i].addr, psus[i].reads,
+           psus[i].regs_read, psus[i].writes, psus[i].errors);
+  }
+}
+
+/*
+ * Answer commands to the emulated PSUs until interrupted.
+ */
+static int sim_psus(int fd, struct termios *tio, speed_t baudrate) {
+  char modbus_buf[255];
+  char reply[2 * MODBUS_MAX_READ_REGS + 5];
+  int gap_us = modbus_frame_gap_us(baudrate) + MODBUS_RX_LATENCY_US;
+  int error = 0;
+
+  if (sim_init_regs() != 0) {
+    fprintf(stderr, "Could not allocate registers\n");
+    return 1;
+  }
+
+  signal(SIGINT, sim_stop);
+  signal(SIGTERM, sim_stop);
+
+  tio->c_cflag |= CREAD;
+  ERR_EXIT(tcsetattr(fd, TCSANOW, tio));
+
+  while (!stop_sim) {
+    // read and write single register requests are both 8 bytes long,
+    // a misaligned frame fails CRC and the gap resynchronizes
+    size_t mb_pos = read_frame(fd, modbus_buf, MODBUS_SIM_REQ_LEN, 1000000,
+                               gap_us);
+    if (mb_pos < 4) {
+      continue;
+    }
+    uint16_t crc = modbus_crc16(modbus_buf, mb_pos - 2);
+    if ((modbus_buf[mb_pos - 2] != (char)(crc >> 8)) ||
+        (modbus_buf[mb_pos - 1] != (char)(crc & 0x00FF))) {
+      if (verbose)
+        fprintf(stderr, "Got data that failed modbus CRC.\n");
+      continue;
+    }
+
+    size_t reply_len = sim_reply(modbus_buf, mb_pos - 2, reply);
+    if (reply_len == 0) {
+      continue;
+    }
+    append_modbus_crc16(reply, &reply_len);
+
+    // the master waits for the inter-frame gap before listening
+    usleep(modbus_frame_gap_us(baudrate));
+    tio->c_cflag &= ~CREAD;
+    ERR_EXIT(tcsetattr(fd, TCSANOW, tio));
+    if (write(fd, reply, reply_len) < 0) {
+      fprintf(stderr, "ERROR: could not write reply msg: %d %s\n",
+              errno, strerror(errno));
+    }
+    waitfd(fd);
+    tio->c_cflag |= CREAD;
+    ERR_EXIT(tcsetattr(fd, TCSANOW, tio));
+  }
+
+cleanup:
+  sim_print_stats();
+  return error;
+}
+
 int main(int argc, char **argv) {
     int error = 0;
     int fd;
@@ -48,15 +263,39 @@ int main(int argc, char **argv) {
     char *modbus_reply = NULL;
     size_t cmd_len = 0;
     size_t reply_len = 0;
+    speed_t baudrate = B19200;
     verbose = 0;
 
     int opt;
-    while((opt = getopt(argc, argv, "t:g:v"))) {
+    while((opt = getopt(argc, argv, "t:g:vb:p:r:u:"))) {
       if (opt == -1) break;
       switch (opt) {
       case 't':
         tty = optarg;
         break;
+      case 'b':
+        switch (atoi(optarg)) {
+        case 19200: baudrate = B19200; break;
+        case 38400: baudrate = B38400; break;
+        case 57600: baudrate = B57600; break;
+        case 115200: baudrate = B115200; break;
+        default: usage(); break;
+        }
+        break;
+      case 'p':
+        if (sim_add_psus(optarg) != 0) {
+          usage();
+        }
+        break;
+      case 'r':
+        num_regs = strtoul(optarg, NULL, 0);
+        break;
+      case 'u':
+        if (num_holes >= MAX_SIM_HOLES) {
+          usage();
+        }
+        holes[num_holes++] = strtoul(optarg, NULL, 16);
+        break;
       case 'v':
         verbose = 1;
         break;
@@ -69,7 +308,7 @@ int main(int argc, char **argv) {
       modbus_cmd = argv[optind++];
       modbus_reply = argv[optind++];
     }
-    if(modbus_cmd == NULL || modbus_reply == NULL) {
+    if(num_psus == 0 && (modbus_cmd == NULL || modbus_reply == NULL)) {
       usage();
     }
 
@@ -83,7 +322,12 @@ int main(int argc, char **argv) {
     if (verbose)
       fprintf(stderr, "[*] Putting TTY in RS485 mode\n");
     error = ioctl(fd, TIOCSRS485, &rs485conf);
-    if (error < 0) {
+    if (error < 0 && num_psus > 0) {
+      // lets the emulation run on a pty
+      fprintf(stderr, "WARNING: could not set TTY to RS485 mode: %s\n",
+          strerror(errno));
+      error = 0;
+    } else if (error < 0) {
       fprintf(stderr, "FATAL: could not set TTY to RS485 mode: %d %s\n",
           error, strerror(error));
       goto cleanup;
@@ -92,7 +336,7 @@ int main(int argc, char **argv) {
     if (verbose)
       fprintf(stderr, "[*] Setting TTY flags!\n");
     memset(&tio, 0, sizeof(tio));
-    cfsetspeed(&tio,B19200);
+    cfsetspeed(&tio,baudrate);
     tio.c_cflag |= PARENB;
     tio.c_cflag |= CLOCAL;
     tio.c_cflag |= CS8;
@@ -101,6 +345,10 @@ int main(int argc, char **argv) {
     tio.c_cc[VTIME] = 0;
     ERR_EXIT(tcsetattr(fd,TCSANOW,&tio));
 
+    if (num_psus > 0) {
+      return sim_psus(fd, &tio, baudrate);
+    }
+
     //convert hex to bytes
     cmd_len = strlen(modbus_cmd);
     if(cmd_len < 2) {
@@ -19,6 +19,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <unistd.h>
 #include <libgen.h>
@@ -36,6 +37,10 @@ static struct {
         .name = "data",
         .type = COMMAND_TYPE_DUMP_DATA_JSON,
     },
+    {
+        .name = "data_binary",
+        .type = COMMAND_TYPE_DUMP_DATA_BINARY,
+    },
     {
         .name = "status",
         .type = COMMAND_TYPE_DUMP_STATUS,
@@ -70,6 +75,8 @@ static void usage(const char *prog_name)
     for (i = 0; cmd_map[i].name != NULL; i++) {
         fprintf(stderr, " - %s\n", cmd_map[i].name);
     }
+    fprintf(stderr, "data_binary takes an optional sequence number to only "
+                    "dump readings taken after it\n");
 }
 
 int main(int argc, char **argv) {
@@ -99,7 +106,7 @@ int main(int argc, char **argv) {
     }
 
     /* Match command name with type. */
-    cmd.type = 0;
+    memset(&cmd, 0, sizeof(cmd));
     for (i = 0; cmd_map[i].name != NULL; i++) {
         if (strcmp(cmd_name, cmd_map[i].name) == 0) {
             cmd.type = cmd_map[i].type;
@@ -110,6 +117,9 @@ int main(int argc, char **argv) {
         usage(argv[0]);
         return -1;
     }
+    if (cmd.type == COMMAND_TYPE_DUMP_DATA_BINARY && argc > 2) {
+        cmd.dump_data.since_seq = strtoul(argv[2], NULL, 0);
+    }
 
     clisock = socket(AF_UNIX, SOCK_STREAM, 0);
     ERR_LOG_EXIT(clisock, "failed to create socket");
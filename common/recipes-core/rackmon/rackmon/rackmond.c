@@ -81,11 +81,12 @@ const static speed_t BAUDRATE_VALUES[] = {
 
 /*
  * REG_INT_DATA_SIZE defines the memory size required to store a specific
- * "Register Interval": uint32_t is reserved for timestamp, while the
- * remaining is to store register values (per_register_size=sizeof(u16),
- * register_count=iv->len).
+ * "Register Interval": rackmond_dump_reading is reserved for timestamp and
+ * sweep sequence, while the remaining is to store register values
+ * (per_register_size=sizeof(u16), register_count=iv->len). The same
+ * layout is used in the binary dump, so readings are copied as is.
  */
-#define REG_INT_DATA_SIZE(_iv) (sizeof(uint32_t) + \
+#define REG_INT_DATA_SIZE(_iv) (sizeof(rackmond_dump_reading) + \
                                 (sizeof(uint16_t) * (_iv)->len))
 
 #define TIME_UPDATE(_t)  do {                        \
@@ -119,6 +120,27 @@ typedef struct {
   size_t mem_pos;
 } reg_range_data_t;
 
+/*
+ * A "read group" is a run of adjacent/overlapping monitor_intervals which
+ * is fetched with a single Read Holding Registers command (up to
+ * MODBUS_MAX_READ_REGS registers), instead of one command per interval.
+ */
+typedef struct {
+  uint16_t begin;     /* first register of the group */
+  uint16_t len;       /* register count of the group */
+  int first;          /* first interval in rackmond_config.group_intervals */
+  int count;          /* number of intervals in the group */
+  int priority;       /* lower value is read first */
+} read_group_t;
+
+/*
+ * Per-PSU state of a read group.
+ */
+typedef struct {
+  time_t last_read;   /* last successful read (CLOCK_MONOTONIC seconds) */
+  bool split;         /* PSU rejects the combined read, read intervals */
+} group_state_t;
+
 typedef struct {
   uint8_t addr;
   uint32_t crc_errors;
@@ -128,6 +150,7 @@ typedef struct {
   int consecutive_failures;
   bool timeout_mode;
   time_t last_comms;
+  group_state_t *groups;
   reg_range_data_t range_data[1];
 } psu_datastore_t;
 
@@ -138,6 +161,20 @@ typedef struct {
   int fd;
 } write_buf_t;
 
+/*
+ * Immutable copy of the monitored data, published by the monitoring
+ * thread after every sweep. Dumps are formatted from it without holding
+ * the global lock, so slow clients don't stall modbus polling.
+ */
+typedef struct {
+  int refs;               // protected by snapshot_lock
+  time_t next_scan;
+  uint8_t num_active_addrs;
+  uint8_t active_addrs[MAX_ACTIVE_ADDRS];
+  size_t len;             // of data
+  char data[];            // binary dump of all readings, see rackmond.h
+} rackmond_snapshot_t;
+
 /*
  * Global rackmond config structure, protected by its mutex lock.
  */
@@ -153,6 +190,12 @@ static struct {
   reg_req_t *reqs;
   monitoring_config *config;
 
+  // coalesced reads built from config, see build_read_groups()
+  int num_groups;
+  read_group_t *groups;
+  // interval indexes ordered by register, groups refer to ranges of it
+  int *group_intervals;
+
   uint8_t num_active_addrs;
   uint8_t active_addrs[MAX_ACTIVE_ADDRS];
   psu_datastore_t* stored_data[MAX_ACTIVE_ADDRS];
@@ -166,6 +209,9 @@ static struct {
 
   int paused;
 
+  // sweep being read, stored with every reading
+  uint32_t sweep_seq;
+
   // the value we will auto-adjust to if possible
   speed_t desired_baudrate;
 
@@ -173,6 +219,7 @@ static struct {
 } rackmond_config = {
   .lock = PTHREAD_MUTEX_INITIALIZER,
   .modbus_timeout = 300000,
+  .sweep_seq = 1,
   .desired_baudrate = DEFAULT_BAUDRATE,
 };
 
@@ -276,6 +323,27 @@ cleanup:
   return error;
 }
 
+static int buf_write_hex(write_buf_t* buf, const void* from, size_t len) {
+  static const char digits[] = "0123456789abcdef";
+  const uint8_t *bytes = from;
+  char tmpbuf[512];
+  size_t i, pos = 0;
+  int error = 0;
+
+  for (i = 0; i < len; i++) {
+    if (pos == sizeof(tmpbuf)) {
+      ERR_EXIT(buf_write(buf, tmpbuf, pos));
+      pos = 0;
+    }
+    tmpbuf[pos++] = digits[bytes[i] >> 4];
+    tmpbuf[pos++] = digits[bytes[i] & 0xf];
+  }
+  ERR_EXIT(buf_write(buf, tmpbuf, pos));
+
+cleanup:
+  return error;
+}
+
 static int buf_close(write_buf_t* buf) {
   int error = 0;
   int fret = buf_flush(buf);
@@ -409,6 +477,12 @@ static int modbus_command(rs485_dev_t* dev, int timeout, char* cmd_buf,
   useconds_t delay = rackmond_config.min_delay;
   psu_datastore_t* psu = NULL;
 
+  // keep at least the inter-frame gap between a response and the next
+  // command, without sleeping longer than the line needs
+  if (delay == 0) {
+    delay = modbus_frame_gap_us(baudrate);
+  }
+
   int slot = lookup_data_slot(cmd_buf[0]);
   if (slot >= 0) {
     psu = rackmond_config.stored_data[slot];
@@ -738,7 +812,8 @@ static int check_active_psus(void) {
  * monitored registers of a specific PSU (identified by address), and
  * logically the memory area can be divided into 3 sub-areas:
  *
- * M = "config->num_intervals", and N = "iv->keep" in below picture:
+ * M = "config->num_intervals", N = "iv->keep" and G = "num_groups" in
+ * below picture:
  *
  * |--------------------------|
  * |                          |
@@ -750,22 +825,26 @@ static int check_active_psus(void) {
  * | ......                   |
  * | reg_range_data_t[M-1]    |
  * |--------------------------|
- * | timestamp(4-byte)        |
+ * | group_state_t[0]         |
+ * | ......                   |
+ * | group_state_t[G-1]       |
+ * |--------------------------|
+ * | time+seq(8-byte)         |
  * | reg_interval_0,keep#0    |
- * | timestamp(4-byte)        |
+ * | time+seq(8-byte)         |
  * | reg_interval_0,keep#1    |
  * |......                    |
- * | timestamp(4-byte)        |
+ * | time+seq(8-byte)         |
  * | reg_interval_0,keep#N-1] |
- * | timestamp(4-byte)        |
+ * | time+seq(8-byte)         |
  * | reg_interval_1,keep#0    |
- * | timestamp(4-byte)        |
+ * | time+seq(8-byte)         |
  * | reg_interval_1,keep#1    |
  * |......                    |
- * | timestamp(4-byte)        |
+ * | time+seq(8-byte)         |
  * | reg_interval_M-1,keep#0  |
  * |......                    |
- * | timestamp(4-byte)        |
+ * | time+seq(8-byte)         |
  * | reg_interval_M-1,keep#N-1|
  * |--------------------------|
  */
@@ -777,7 +856,8 @@ static psu_datastore_t* alloc_monitoring_data(uint8_t addr) {
   int i, pitch, data_size;
 
   size = sizeof(psu_datastore_t) +
-         sizeof(reg_range_data_t) * rackmond_config.config->num_intervals;
+         sizeof(reg_range_data_t) * rackmond_config.config->num_intervals +
+         sizeof(group_state_t) * rackmond_config.num_groups;
 
   for (i = 0; i < rackmond_config.config->num_intervals; i++) {
     iv = &rackmond_config.config->intervals[i];
@@ -803,6 +883,8 @@ static psu_datastore_t* alloc_monitoring_data(uint8_t addr) {
   mem = d;
   mem += (sizeof(psu_datastore_t) +
           sizeof(reg_range_data_t) * rackmond_config.config->num_intervals);
+  d->groups = mem;
+  mem += sizeof(group_state_t) * rackmond_config.num_groups;
 
   for (i = 0; i < rackmond_config.config->num_intervals; i++) {
     iv = &rackmond_config.config->intervals[i];
@@ -1018,17 +1100,183 @@ static void record_data(reg_range_data_t* rd, uint32_t time,
   int n_regs = (rd->i->len);
   int pitch = REG_INT_DATA_SIZE(rd->i);
   int mem_size = pitch * rd->i->keep;
+  rackmond_dump_reading hdr = {
+    .time = time,
+    .seq = rackmond_config.sweep_seq,
+  };
 
-  memcpy(rd->mem_begin + rd->mem_pos, &time, sizeof(time));
-  rd->mem_pos += sizeof(time);
+  memcpy(rd->mem_begin + rd->mem_pos, &hdr, sizeof(hdr));
+  rd->mem_pos += sizeof(hdr);
   memcpy(rd->mem_begin + rd->mem_pos, regs, n_regs * sizeof(uint16_t));
   rd->mem_pos += n_regs * sizeof(uint16_t);
   rd->mem_pos = rd->mem_pos % mem_size;
 }
 
+static time_t monotonic_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec;
+}
+
+/*
+ * Store registers of one interval read from the PSU.
+ */
+static void store_interval_data(psu_datastore_t *mdata, reg_range_data_t *rd,
+                                uint16_t *regs, uint32_t timestamp) {
+  monitor_interval* iv = rd->i;
+
+  if (iv->flags & MONITOR_FLAG_ONLY_CHANGES) {
+    int pitch = REG_INT_DATA_SIZE(iv);
+    int lastpos = rd->mem_pos - pitch;
+    if (lastpos < 0) {
+      lastpos = (pitch * iv->keep) - pitch;
+    }
+    if (!memcmp(rd->mem_begin + lastpos + sizeof(rackmond_dump_reading),
+          regs, sizeof(uint16_t) * iv->len) &&
+       memcmp(rd->mem_begin, "\x00\x00\x00\x00", 4)) {
+      return;
+    }
+
+    if (rackmond_config.status_log) {
+      time_t rawt;
+      struct tm* ti;
+      char timestr[80];
+
+      time(&rawt);
+      ti = localtime(&rawt);
+      strftime(timestr, sizeof(timestr), "%b %e %T", ti);
+      fprintf(rackmond_config.status_log,
+              "%s: Change to status register %02x on address %02x. "
+              "New value: %02x\n",
+              timestr, iv->begin, mdata->addr, regs[0]);
+      fflush(rackmond_config.status_log);
+    }
+  }
+
+  global_lock();
+  if (iv->begin == REGISTER_PSU_BAUDRATE) {
+    uint16_t baudrate_value = regs[0] >> 8;
+    mdata->supports_baudrate = (baudrate_value != 0);
+    mdata->baudrate = BAUDRATE_VALUES[baudrate_value];
+  }
+  record_data(rd, timestamp, regs);
+  global_unlock();
+}
+
+static void count_read_error(psu_datastore_t *mdata, int err,
+                             uint16_t begin, uint16_t len) {
+  if (err != READ_ERROR_RESPONSE && err != PSU_TIMEOUT_RESPONSE) {
+    log("Error %d reading %02x registers at %02x from %02x\n",
+        err, len, begin, mdata->addr);
+    if(err == MODBUS_BAD_CRC) {
+      mdata->crc_errors++;
+    }
+    if(err == MODBUS_RESPONSE_TIMEOUT) {
+      mdata->timeout_errors++;
+    }
+  }
+}
+
+/*
+ * Read every interval of a read group from the PSU, as one command unless
+ * the PSU rejected the combined read before.
+ */
+static int fetch_read_group(psu_datastore_t *mdata, int g, speed_t baudrate) {
+  read_group_t *grp = &rackmond_config.groups[g];
+  group_state_t *gs = &mdata->groups[g];
+  uint32_t timestamp;
+  int k, err = 0;
+  bool any = false;
+
+  if (!gs->split) {
+    uint16_t regs[grp->len];
+
+    err = read_holding_reg(&rackmond_config.rs485,
+                           rackmond_config.modbus_timeout, mdata->addr,
+                           grp->begin, grp->len, regs, baudrate);
+    if (err == 0) {
+      TIME_UPDATE(timestamp);
+      for (k = grp->first; k < grp->first + grp->count; k++) {
+        reg_range_data_t *rd =
+          &mdata->range_data[rackmond_config.group_intervals[k]];
+        store_interval_data(mdata, rd, regs + (rd->i->begin - grp->begin),
+                            timestamp);
+      }
+      gs->last_read = monotonic_sec();
+      return 0;
+    }
+    if (err != READ_ERROR_RESPONSE || grp->count == 1) {
+      count_read_error(mdata, err, grp->begin, grp->len);
+      return err;
+    }
+
+    // some registers of the group are not implemented by this PSU model
+    OBMC_INFO("PSU %02x rejects reading %d registers at %02x, "
+              "reading its %d intervals separately",
+              mdata->addr, grp->len, grp->begin, grp->count);
+    gs->split = true;
+  }
+
+  for (k = grp->first; k < grp->first + grp->count; k++) {
+    reg_range_data_t *rd =
+      &mdata->range_data[rackmond_config.group_intervals[k]];
+    monitor_interval *iv = rd->i;
+    uint16_t regs[iv->len];
+
+    err = read_holding_reg(&rackmond_config.rs485,
+                           rackmond_config.modbus_timeout, mdata->addr,
+                           iv->begin, iv->len, regs, baudrate);
+    if (err != 0) {
+      count_read_error(mdata, err, iv->begin, iv->len);
+      continue;
+    }
+    TIME_UPDATE(timestamp);
+    store_interval_data(mdata, rd, regs, timestamp);
+    any = true;
+  }
+  if (any) {
+    gs->last_read = monotonic_sec();
+  }
+  return err;
+}
+
+typedef struct {
+  psu_datastore_t *psu;
+  int group;
+  speed_t baudrate;
+} read_item_t;
+
+/*
+ * Order of reads in a sweep: by priority, then least recently read first,
+ * so status registers of all PSUs are read before the bulk data and a
+ * sweep cut short resumes with what it missed. Groups holding an interval
+ * flagged MONITOR_FLAG_ONLY_CHANGES have priority 0 and come first, all
+ * other groups have priority 1 (see interval_priority()).
+ */
+static int sub_read_items(const void* va, const void* vb) {
+  const read_item_t *a = va, *b = vb;
+  int pa = rackmond_config.groups[a->group].priority;
+  int pb = rackmond_config.groups[b->group].priority;
+  time_t ta = a->psu->groups[a->group].last_read;
+  time_t tb = b->psu->groups[b->group].last_read;
+
+  if (pa != pb) {
+    return pa - pb;
+  }
+  if (ta != tb) {
+    return (ta < tb) ? -1 : 1;
+  }
+  if (a->psu->addr != b->psu->addr) {
+    return (int)a->psu->addr - (int)b->psu->addr;
+  }
+  return a->group - b->group;
+}
+
 static int fetch_monitored_data(void) {
-  int pos;
+  int pos, i;
   int error = 0;
+  int num_items = 0;
+  read_item_t *items = NULL;
 
   if (global_lock() != 0) {
     return -1;
@@ -1043,13 +1291,16 @@ static int fetch_monitored_data(void) {
     global_unlock();
     goto cleanup;
   }
-  global_unlock();
 
-  for (pos = 0; pos < ARRAY_SIZE(rackmond_config.stored_data); pos++) {
-    check_graceful_exit();
+  items = calloc(ARRAY_SIZE(rackmond_config.stored_data) *
+                 rackmond_config.num_groups, sizeof(read_item_t));
+  if (items == NULL) {
+    global_unlock();
+    OBMC_WARN("failed to allocate read schedule");
+    return -1;
+  }
 
-    int r;
-    uint8_t addr;
+  for (pos = 0; pos < ARRAY_SIZE(rackmond_config.stored_data); pos++) {
     psu_datastore_t *mdata = rackmond_config.stored_data[pos];
     speed_t baudrate;
 
@@ -1057,92 +1308,195 @@ static int fetch_monitored_data(void) {
       continue;
     }
 
-    addr = mdata->addr;
+    if (check_psu_baudrate(mdata, &baudrate) != 0) {
+      OBMC_WARN("Unable to check baudrate for PSU at addr %02x", mdata->addr);
+      continue;
+    }
 
-    if (global_lock() != 0) {
-      return -1;
+    for (i = 0; i < rackmond_config.num_groups; i++) {
+      items[num_items].psu = mdata;
+      items[num_items].group = i;
+      items[num_items].baudrate = baudrate;
+      num_items++;
     }
+  }
+  global_unlock();
 
-    error = check_psu_baudrate(mdata, &baudrate);
+  qsort(items, num_items, sizeof(read_item_t), sub_read_items);
 
-    global_unlock();
+  for (i = 0; i < num_items; i++) {
+    check_graceful_exit();
 
-    if (error != 0) {
-      OBMC_WARN("Unable to check baudrate for PSU at addr %02x", addr);
+    // stop early when a PSU update pauses monitoring
+    if (rackmond_config.paused == 1) {
+      break;
+    }
+
+    fetch_read_group(items[i].psu, items[i].group, items[i].baudrate);
+  }
+
+cleanup:
+  free(items);
+  return error;
+}
+
+static time_t search_at = 0;
+
+static pthread_mutex_t snapshot_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define snapshot_lock()   mutex_lock_helper(&snapshot_mutex, "snapshot_lock")
+#define snapshot_unlock() mutex_unlock_helper(&snapshot_mutex, "snapshot_lock")
+// latest published snapshot, NULL until configured
+static rackmond_snapshot_t *snapshot = NULL;
+
+/*
+ * Number of readings stored for a range: the ring is filled from its
+ * start, so the first slot without a timestamp ends the readings.
+ */
+static int range_num_readings(reg_range_data_t *rd) {
+  int pitch = REG_INT_DATA_SIZE(rd->i);
+  uint32_t time;
+  int n;
+
+  for (n = 0; n < rd->i->keep; n++) {
+    memcpy(&time, rd->mem_begin + n * pitch, sizeof(time));
+    if (time == 0) {
+      break;
+    }
+  }
+  return n;
+}
+
+/*
+ * Copy the monitored data of all PSUs into a new snapshot, laid out as
+ * the binary dump. Called with global lock held.
+ */
+static rackmond_snapshot_t* build_snapshot(void) {
+  rackmond_snapshot_t *snap;
+  rackmond_dump_header hdr;
+  size_t size = sizeof(hdr);
+  char *pos;
+  int i, j;
+
+  memset(&hdr, 0, sizeof(hdr));
+  for (i = 0; i < ARRAY_SIZE(rackmond_config.stored_data); i++) {
+    psu_datastore_t *pdata = rackmond_config.stored_data[i];
+    if (pdata == NULL) {
       continue;
     }
+    hdr.num_psus++;
+    size += sizeof(rackmond_dump_psu);
+    for (j = 0; j < rackmond_config.config->num_intervals; j++) {
+      reg_range_data_t *rd = &pdata->range_data[j];
+      size += sizeof(rackmond_dump_range) +
+              REG_INT_DATA_SIZE(rd->i) * range_num_readings(rd);
+    }
+  }
 
-    for (r = 0; r < rackmond_config.config->num_intervals; r++) {
+  snap = malloc(sizeof(rackmond_snapshot_t) + size);
+  if (snap == NULL) {
+    return NULL;
+  }
+  snap->refs = 1;
+  snap->next_scan = search_at;
+  snap->num_active_addrs = rackmond_config.num_active_addrs;
+  memcpy(snap->active_addrs, rackmond_config.active_addrs,
+         sizeof(snap->active_addrs));
+  snap->len = size;
 
-      int err;
-      uint32_t timestamp;
-      reg_range_data_t* rd = &mdata->range_data[r];
-      monitor_interval* iv = rd->i;
-      uint16_t regs[iv->len];
+  hdr.magic = RACKMOND_DUMP_MAGIC;
+  hdr.version = RACKMOND_DUMP_VERSION;
+  hdr.seq = rackmond_config.sweep_seq;
+  TIME_UPDATE(hdr.time);
+  memcpy(snap->data, &hdr, sizeof(hdr));
+  pos = snap->data + sizeof(hdr);
 
-      err = read_holding_reg(&rackmond_config.rs485,
-                             rackmond_config.modbus_timeout, addr,
-                             iv->begin, iv->len, regs, baudrate);
-      sched_yield();
-      if (err != 0) {
-        if (err != READ_ERROR_RESPONSE && err != PSU_TIMEOUT_RESPONSE) {
-          log("Error %d reading %02x registers at %02x from %02x\n",
-              err, iv->len, iv->begin, addr);
-          if(err == MODBUS_BAD_CRC) {
-            mdata->crc_errors++;
-          }
-          if(err == MODBUS_RESPONSE_TIMEOUT) {
-            mdata->timeout_errors++;
-          }
-        }
-        continue;
-      }
+  for (i = 0; i < ARRAY_SIZE(rackmond_config.stored_data); i++) {
+    psu_datastore_t *pdata = rackmond_config.stored_data[i];
+    rackmond_dump_psu psu;
 
-      TIME_UPDATE(timestamp);
-      if (iv->flags & MONITOR_FLAG_ONLY_CHANGES) {
-        int pitch = REG_INT_DATA_SIZE(iv);
-        int lastpos = rd->mem_pos - pitch;
-        if (lastpos < 0) {
-          lastpos = (pitch * iv->keep) - pitch;
-        }
-        if (!memcmp(rd->mem_begin + lastpos + sizeof(timestamp),
-              regs, sizeof(uint16_t) * iv->len) &&
-           memcmp(rd->mem_begin, "\x00\x00\x00\x00", 4)) {
-          continue;
-        }
+    if (pdata == NULL) {
+      continue;
+    }
+    psu.addr = pdata->addr;
+    psu.timeout_mode = pdata->timeout_mode;
+    psu.num_ranges = rackmond_config.config->num_intervals;
+    psu.crc_errors = pdata->crc_errors;
+    psu.timeout_errors = pdata->timeout_errors;
+    psu.baudrate = baud_to_int(pdata->baudrate);
+    psu.last_comms = pdata->last_comms;
+    memcpy(pos, &psu, sizeof(psu));
+    pos += sizeof(psu);
+
+    for (j = 0; j < psu.num_ranges; j++) {
+      reg_range_data_t *rd = &pdata->range_data[j];
+      rackmond_dump_range range = {
+        .begin = rd->i->begin,
+        .len = rd->i->len,
+        .num_readings = range_num_readings(rd),
+        .flags = rd->i->flags,
+      };
+      size_t data_size = REG_INT_DATA_SIZE(rd->i) * range.num_readings;
+
+      memcpy(pos, &range, sizeof(range));
+      pos += sizeof(range);
+      memcpy(pos, rd->mem_begin, data_size);
+      pos += data_size;
+    }
+  }
 
-        if (rackmond_config.status_log) {
-          time_t rawt;
-          struct tm* ti;
-          char timestr[80];
-
-          time(&rawt);
-          ti = localtime(&rawt);
-          strftime(timestr, sizeof(timestr), "%b %e %T", ti);
-          fprintf(rackmond_config.status_log,
-                  "%s: Change to status register %02x on address %02x. "
-                  "New value: %02x\n",
-                  timestr, iv->begin, addr, regs[0]);
-          fflush(rackmond_config.status_log);
-        }
-      }
+  return snap;
+}
 
-      global_lock();
-      if (iv->begin == REGISTER_PSU_BAUDRATE) {
-        uint16_t baudrate_value = regs[0] >> 8;
-        mdata->supports_baudrate = (baudrate_value != 0);
-        mdata->baudrate = BAUDRATE_VALUES[baudrate_value];
-      }
-      record_data(rd, timestamp, regs);
-      global_unlock();
-    } /* for each monitor_interval */
-  } /* for each psu */
+static void put_snapshot(rackmond_snapshot_t *snap) {
+  int refs;
 
-cleanup:
-  return error;
+  if (snap == NULL) {
+    return;
+  }
+  snapshot_lock();
+  refs = --snap->refs;
+  snapshot_unlock();
+  if (refs == 0) {
+    free(snap);
+  }
 }
 
-static time_t search_at = 0;
+/*
+ * Reference the latest snapshot, release it with put_snapshot().
+ */
+static rackmond_snapshot_t* get_snapshot(void) {
+  rackmond_snapshot_t *snap;
+
+  snapshot_lock();
+  snap = snapshot;
+  if (snap != NULL) {
+    snap->refs++;
+  }
+  snapshot_unlock();
+  return snap;
+}
+
+/*
+ * Replace the published snapshot and start the next sweep sequence.
+ * Readers keep the old snapshot until they are done with it.
+ * Called with global lock held.
+ */
+static void publish_snapshot(void) {
+  rackmond_snapshot_t *snap, *old;
+
+  snap = build_snapshot();
+  if (snap == NULL) {
+    OBMC_WARN("failed to allocate data snapshot");
+    return;
+  }
+  rackmond_config.sweep_seq++;
+
+  snapshot_lock();
+  old = snapshot;
+  snapshot = snap;
+  snapshot_unlock();
+  put_snapshot(old);
+}
 
 void* monitoring_loop(void* arg) {
 
@@ -1166,17 +1520,22 @@ void* monitoring_loop(void* arg) {
     }
 
     /*
-     * Please be aware it takes ~9 seconds for rackmond to go through 6
-     * PSUs and collect all the data, which means the minimum data refresh
-     * interval is 9 seconds (for a specific PSU register, when fetching
-     * data in a dead loop).
-     * Adding a small delay has little impact when 6 PSUs are connected,
-     * means CPU usage and data refresh interval is similar with or without
-     * delay. But such delay saves a lot of CPU resources when no PSU is
-     * connected: CPU usage goes from ~10% (dead loop) to ~0% when delay
-     * is introduced.
+     * A sweep sends one command per read group (adjacent monitor
+     * intervals coalesced) and PSU, back to back with only the modbus
+     * inter-frame gap between them, so the data refresh interval of a
+     * register is the sweep time plus this delay.
+     * The delay saves a lot of CPU resources when no PSU is connected:
+     * CPU usage goes from ~10% (dead loop) to ~0% when delay is
+     * introduced.
      */
     fetch_monitored_data();
+
+    if (global_lock() == 0) {
+      if (rackmond_config.config != NULL && !rackmond_config.paused) {
+        publish_snapshot();
+      }
+      global_unlock();
+    }
     sleep(PSU_REFRESH_DATA_INTERVAL);
   }
   return NULL;
@@ -1251,6 +1610,81 @@ static int run_cmd_raw_modbus(rackmond_command* cmd, write_buf_t *wb)
   return 0;
 }
 
+static int sub_interval_idxs(const void* va, const void* vb) {
+  monitor_interval *a = &rackmond_config.config->intervals[*(int*)va];
+  monitor_interval *b = &rackmond_config.config->intervals[*(int*)vb];
+
+  if (a->begin != b->begin) {
+    return (int)a->begin - (int)b->begin;
+  }
+  return (int)a->len - (int)b->len;
+}
+
+static int interval_priority(monitor_interval *iv) {
+  // status registers are watched for changes (MONITOR_FLAG_ONLY_CHANGES),
+  // read them first: 0 for flagged intervals, 1 for everything else
+  return (iv->flags & MONITOR_FLAG_ONLY_CHANGES) ? 0 : 1;
+}
+
+/*
+ * Merge adjacent or overlapping monitor_intervals of the configuration
+ * into read groups of at most MODBUS_MAX_READ_REGS registers.
+ * Called with global lock held.
+ */
+static int build_read_groups(void) {
+  int i, n = rackmond_config.config->num_intervals;
+  read_group_t *grp = NULL;
+
+  rackmond_config.group_intervals = calloc(n, sizeof(int));
+  rackmond_config.groups = calloc(n, sizeof(read_group_t));
+  if (rackmond_config.group_intervals == NULL ||
+      rackmond_config.groups == NULL) {
+    free(rackmond_config.group_intervals);
+    free(rackmond_config.groups);
+    rackmond_config.group_intervals = NULL;
+    rackmond_config.groups = NULL;
+    return -1;
+  }
+
+  for (i = 0; i < n; i++) {
+    rackmond_config.group_intervals[i] = i;
+  }
+  qsort(rackmond_config.group_intervals, n, sizeof(int), sub_interval_idxs);
+
+  rackmond_config.num_groups = 0;
+  for (i = 0; i < n; i++) {
+    monitor_interval *iv =
+      &rackmond_config.config->intervals[rackmond_config.group_intervals[i]];
+    int end = iv->begin + iv->len;
+
+    if (grp != NULL && iv->begin <= grp->begin + grp->len) {
+      int grp_end = grp->begin + grp->len;
+      if (end > grp_end) {
+        grp_end = end;
+      }
+      if (grp_end - grp->begin <= MODBUS_MAX_READ_REGS) {
+        grp->len = grp_end - grp->begin;
+        grp->count++;
+        if (interval_priority(iv) < grp->priority) {
+          grp->priority = interval_priority(iv);
+        }
+        continue;
+      }
+    }
+
+    grp = &rackmond_config.groups[rackmond_config.num_groups++];
+    grp->begin = iv->begin;
+    grp->len = iv->len;
+    grp->first = i;
+    grp->count = 1;
+    grp->priority = interval_priority(iv);
+  }
+
+  OBMC_INFO("%d monitor intervals coalesced into %d reads",
+            n, rackmond_config.num_groups);
+  return 0;
+}
+
 static int run_cmd_set_config(rackmond_command* cmd, write_buf_t *wb)
 {
   int error = 0;
@@ -1272,56 +1706,79 @@ static int run_cmd_set_config(rackmond_command* cmd, write_buf_t *wb)
   }
 
   memcpy(rackmond_config.config, &cmd->set_config.config, config_size);
+  if (build_read_groups() != 0) {
+    free(rackmond_config.config);
+    rackmond_config.config = NULL;
+    BAIL("failed to allocate read groups");
+  }
   OBMC_INFO("got configuration");
   TIME_UPDATE(search_at);
+  publish_snapshot();
 
 cleanup:
   global_unlock();
   return error;
 }
 
+/*
+ * Skip the readings of a range in a snapshot
+ */
+static const char* skip_readings(const char *pos, rackmond_dump_range *range) {
+  return pos + range->num_readings *
+               (sizeof(rackmond_dump_reading) + range->len * sizeof(uint16_t));
+}
+
 static int run_cmd_dump_status(rackmond_command* cmd, write_buf_t *wb)
 {
-  if (global_lock() != 0) {
-    return -1;
+  rackmond_snapshot_t *snap = get_snapshot();
+  rackmond_dump_header hdr;
+  rackmond_dump_psu psu;
+  rackmond_dump_range range;
+  const char *pos;
+  time_t now;
+  int i, j;
+
+  if (snap == NULL) {
+    buf_printf(wb, "Unconfigured\n");
+    return 0;
   }
 
-  if (rackmond_config.config == NULL) {
-    buf_printf(wb, "Unconfigured\n");
-  } else {
-    int i;
-    time_t now;
+  TIME_UPDATE(now);
+  memcpy(&hdr, snap->data, sizeof(hdr));
+  pos = snap->data + sizeof(hdr);
 
-    TIME_UPDATE(now);
-    buf_printf(wb, "Monitored PSUs:\n");
-    for (i = 0; i < ARRAY_SIZE(rackmond_config.stored_data); i++) {
-      if (rackmond_config.stored_data[i] == NULL) {
-        continue;
-      }
+  buf_printf(wb, "Monitored PSUs:\n");
+  for (i = 0; i < hdr.num_psus; i++) {
+    char baudrate[16] = "<unknown>";
 
-      speed_t baudrate = rackmond_config.stored_data[i]->baudrate;
-      buf_printf(wb, "PSU addr %02x - crc errors: %d, timeouts: %d, baud rate: %s",
-                 rackmond_config.stored_data[i]->addr,
-                 rackmond_config.stored_data[i]->crc_errors,
-                 rackmond_config.stored_data[i]->timeout_errors,
-                 baud_to_str(baudrate));
-      if (rackmond_config.stored_data[i]->timeout_mode) {
-        time_t until = rackmond_config.stored_data[i]->last_comms + NON_COMMUNICATION_TIMEOUT;
-        buf_printf(wb, " (in timeout mode for the next %d seconds)", until - now);
-      }
-      buf_printf(wb, "\n");
+    memcpy(&psu, pos, sizeof(psu));
+    pos += sizeof(psu);
+    for (j = 0; j < psu.num_ranges; j++) {
+      memcpy(&range, pos, sizeof(range));
+      pos = skip_readings(pos + sizeof(range), &range);
     }
 
-    buf_printf(wb, "Active on last scan: ");
-    for (i = 0; i < rackmond_config.num_active_addrs; i++) {
-      buf_printf(wb, "%02x ", rackmond_config.active_addrs[i]);
+    if (psu.baudrate != 0) {
+      snprintf(baudrate, sizeof(baudrate), "%u", psu.baudrate);
+    }
+    buf_printf(wb, "PSU addr %02x - crc errors: %d, timeouts: %d, baud rate: %s",
+               psu.addr, psu.crc_errors, psu.timeout_errors, baudrate);
+    if (psu.timeout_mode) {
+      time_t until = psu.last_comms + NON_COMMUNICATION_TIMEOUT;
+      buf_printf(wb, " (in timeout mode for the next %d seconds)", until - now);
     }
     buf_printf(wb, "\n");
-    buf_printf(wb, "Next scan in %d seconds.\n", search_at - now);
   }
 
- global_unlock();
- return 0;
+  buf_printf(wb, "Active on last scan: ");
+  for (i = 0; i < snap->num_active_addrs; i++) {
+    buf_printf(wb, "%02x ", snap->active_addrs[i]);
+  }
+  buf_printf(wb, "\n");
+  buf_printf(wb, "Next scan in %d seconds.\n", snap->next_scan - now);
+
+  put_snapshot(snap);
+  return 0;
 }
 
 static int run_cmd_force_scan(rackmond_command* cmd, write_buf_t *wb)
@@ -1343,70 +1800,138 @@ static int run_cmd_force_scan(rackmond_command* cmd, write_buf_t *wb)
 
 static int run_cmd_dump_json(rackmond_command* cmd, write_buf_t *wb)
 {
-  if (global_lock() != 0) {
-    return -1;
+  rackmond_snapshot_t *snap = get_snapshot();
+  rackmond_dump_header hdr;
+  rackmond_dump_psu psu;
+  rackmond_dump_range range;
+  rackmond_dump_reading reading;
+  const char *pos;
+  uint32_t now;
+  int i, j, k;
+
+  if (snap == NULL) {
+    buf_write(wb, "[]", 2);
+    return 0;
   }
 
-  if (rackmond_config.config == NULL) {
-    buf_write(wb, "[]", 2);
-  } else {
-    int i, j, c;
-    uint32_t now;
-    int data_pos = 0;
-
-    TIME_UPDATE(now);
-    buf_write(wb, "[", 1);
-    while (rackmond_config.stored_data[data_pos] != NULL &&
-           data_pos < MAX_ACTIVE_ADDRS) {
-      psu_datastore_t *pdata = rackmond_config.stored_data[data_pos];
-
-      buf_printf(wb, "{\"addr\":%d,\"crc_fails\":%d,\"timeouts\":%d,"
-                 "\"now\":%d,\"ranges\":[",
-                 pdata->addr, pdata->crc_errors, pdata->timeout_errors, now);
-
-      for (i = 0; i < rackmond_config.config->num_intervals; i++) {
-        uint32_t time;
-        reg_range_data_t *rd = &pdata->range_data[i];
-        char* mem_pos = rd->mem_begin;
-
-        buf_printf(wb,"{\"begin\":%d,\"readings\":[", rd->i->begin);
-        // want to cut the list off early just before
-        // the first entry with time == 0
-        memcpy(&time, mem_pos, sizeof(time));
-        for(j = 0; j < rd->i->keep && time != 0; j++) {
-          mem_pos += sizeof(time);
-          buf_printf(wb, "{\"time\":%d,\"data\":\"", time);
-          for(c = 0; c < rd->i->len * 2; c++) {
-            buf_printf(wb, "%02x", *mem_pos);
-            mem_pos++;
-          }
-          buf_write(wb, "\"}", 2);
-          memcpy(&time, mem_pos, sizeof(time));
-          if (time == 0) {
-            break;
-          }
-          if ((j+1) < rd->i->keep) {
-            buf_write(wb, ",", 1);
-          }
-        }
-        buf_write(wb, "]}", 2);
-        if ((i+1) < rackmond_config.config->num_intervals) {
+  TIME_UPDATE(now);
+  memcpy(&hdr, snap->data, sizeof(hdr));
+  pos = snap->data + sizeof(hdr);
+
+  buf_write(wb, "[", 1);
+  for (i = 0; i < hdr.num_psus; i++) {
+    memcpy(&psu, pos, sizeof(psu));
+    pos += sizeof(psu);
+
+    buf_printf(wb, "{\"addr\":%d,\"crc_fails\":%d,\"timeouts\":%d,"
+               "\"now\":%d,\"ranges\":[",
+               psu.addr, psu.crc_errors, psu.timeout_errors, now);
+
+    for (j = 0; j < psu.num_ranges; j++) {
+      memcpy(&range, pos, sizeof(range));
+      pos += sizeof(range);
+
+      buf_printf(wb,"{\"begin\":%d,\"readings\":[", range.begin);
+      for (k = 0; k < range.num_readings; k++) {
+        memcpy(&reading, pos, sizeof(reading));
+        pos += sizeof(reading);
+        buf_printf(wb, "{\"time\":%d,\"data\":\"", reading.time);
+        buf_write_hex(wb, pos, range.len * sizeof(uint16_t));
+        pos += range.len * sizeof(uint16_t);
+        buf_write(wb, "\"}", 2);
+        if ((k+1) < range.num_readings) {
           buf_write(wb, ",", 1);
         }
       }
+      buf_write(wb, "]}", 2);
+      if ((j+1) < psu.num_ranges) {
+        buf_write(wb, ",", 1);
+      }
+    }
+
+    if ((i+1) < hdr.num_psus) {
+      buf_write(wb, "]},", 3);
+    } else {
+      buf_write(wb, "]}", 2);
+    }
+  }
+  buf_write(wb, "]", 1);
+
+  put_snapshot(snap);
+  return 0;
+}
+
+/*
+ * Binary dump of the latest snapshot, see rackmond.h. With since_seq set
+ * only readings of later sweeps are included; a since_seq ahead of the
+ * snapshot (rackmond restarted) gets all readings.
+ */
+static int run_cmd_dump_binary(rackmond_command* cmd, write_buf_t *wb)
+{
+  rackmond_snapshot_t *snap = get_snapshot();
+  uint32_t since = cmd->dump_data.since_seq;
+  rackmond_dump_header hdr;
+  rackmond_dump_psu psu;
+  rackmond_dump_range range;
+  rackmond_dump_reading reading;
+  const char *pos;
+  size_t pitch;
+  int i, j, k;
+
+  if (snap == NULL) {
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = RACKMOND_DUMP_MAGIC;
+    hdr.version = RACKMOND_DUMP_VERSION;
+    TIME_UPDATE(hdr.time);
+    buf_write(wb, &hdr, sizeof(hdr));
+    return 0;
+  }
+
+  memcpy(&hdr, snap->data, sizeof(hdr));
+  if (since == 0 || since > hdr.seq) {
+    buf_write(wb, snap->data, snap->len);
+    put_snapshot(snap);
+    return 0;
+  }
+
+  hdr.since_seq = since;
+  buf_write(wb, &hdr, sizeof(hdr));
+  pos = snap->data + sizeof(hdr);
+
+  for (i = 0; i < hdr.num_psus; i++) {
+    memcpy(&psu, pos, sizeof(psu));
+    buf_write(wb, (void *)pos, sizeof(psu));
+    pos += sizeof(psu);
+
+    for (j = 0; j < psu.num_ranges; j++) {
+      int num_readings;
+
+      memcpy(&range, pos, sizeof(range));
+      pos += sizeof(range);
+      pitch = sizeof(reading) + range.len * sizeof(uint16_t);
+      num_readings = range.num_readings;
+
+      // the range header carries the count, so count before writing
+      range.num_readings = 0;
+      for (k = 0; k < num_readings; k++) {
+        memcpy(&reading, pos + k * pitch, sizeof(reading));
+        if (reading.seq > since) {
+          range.num_readings++;
+        }
+      }
+      buf_write(wb, &range, sizeof(range));
 
-      data_pos++;
-      if (data_pos < MAX_ACTIVE_ADDRS &&
-          rackmond_config.stored_data[data_pos] != NULL) {
-        buf_write(wb, "]},", 3);
-      } else {
-        buf_write(wb, "]}", 2);
+      for (k = 0; k < num_readings; k++) {
+        memcpy(&reading, pos + k * pitch, sizeof(reading));
+        if (reading.seq > since) {
+          buf_write(wb, (void *)(pos + k * pitch), pitch);
+        }
       }
+      pos += num_readings * pitch;
     }
-    buf_write(wb, "]", 1);
   }
 
-  global_unlock();
+  put_snapshot(snap);
   return 0;
 }
 
@@ -1474,6 +1999,10 @@ static struct {
     .name = "force_scan",
     .handler = run_cmd_force_scan,
   },
+  [COMMAND_TYPE_DUMP_DATA_BINARY] = {
+    .name = "dump_data_binary",
+    .handler = run_cmd_dump_binary,
+  },
 };
 
 static int do_command(int sock, rackmond_command* cmd) {
@@ -45,6 +45,58 @@ typedef struct set_config_command {
   monitoring_config config;
 } set_config_command;
 
+// Binary dump of the monitored data
+// Only readings taken after sweep "since_seq" are returned, 0 for all of
+// them; pass the "seq" of the previous dump to get the changes since.
+typedef struct dump_data_command {
+  uint32_t since_seq;
+} dump_data_command;
+
+/*
+ * The binary dump is a rackmond_dump_header followed by "num_psus" times
+ *   rackmond_dump_psu
+ *   "num_ranges" times
+ *     rackmond_dump_range
+ *     "num_readings" times
+ *       rackmond_dump_reading
+ *       uint16_t registers["len"]
+ * in host byte order and without padding between the records, so records
+ * following an odd register count are not aligned.
+ */
+#define RACKMOND_DUMP_MAGIC   0x444d4b52 // "RKMD"
+#define RACKMOND_DUMP_VERSION 1
+
+typedef struct rackmond_dump_header {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t num_psus;
+  uint32_t seq;        // sweep the data was published after
+  uint32_t since_seq;  // readings are newer than this sweep
+  uint32_t time;       // when the data was published
+} rackmond_dump_header;
+
+typedef struct rackmond_dump_psu {
+  uint8_t addr;
+  uint8_t timeout_mode;
+  uint16_t num_ranges;
+  uint32_t crc_errors;
+  uint32_t timeout_errors;
+  uint32_t baudrate;   // bits per second, 0 if unknown
+  uint32_t last_comms;
+} rackmond_dump_psu;
+
+typedef struct rackmond_dump_range {
+  uint16_t begin;
+  uint16_t len;
+  uint16_t num_readings;
+  uint16_t flags;
+} rackmond_dump_range;
+
+typedef struct rackmond_dump_reading {
+  uint32_t time;
+  uint32_t seq;        // sweep the registers were read in
+} rackmond_dump_reading;
+
 enum {
   COMMAND_TYPE_NONE = 0,
   COMMAND_TYPE_RAW_MODBUS,
@@ -54,6 +106,7 @@ enum {
   COMMAND_TYPE_START_MONITORING,
   COMMAND_TYPE_DUMP_STATUS,
   COMMAND_TYPE_FORCE_SCAN,
+  COMMAND_TYPE_DUMP_DATA_BINARY,
   COMMAND_TYPE_MAX,
 };
 
@@ -62,6 +115,7 @@ typedef struct rackmond_command {
   union {
     raw_modbus_command raw_modbus;
     set_config_command set_config;
+    dump_data_command dump_data;
   };
 } rackmond_command;
 
@@ -22,6 +22,7 @@
 #include <glog/logging.h>
 #include <gio/gio.h>
 #include "DBusSensorInterface.h"
+#include "DBusSensorTreeInterface.h"
 #include "Sensor.h"
 
 namespace openbmc {
@@ -79,15 +80,35 @@ void DBusSensorInterface::sensorRead(GDBusMethodInvocation* invocation,
                                         obj->getValue()));
 }
 
-void DBusSensorInterface::sensorRawRead(GDBusMethodInvocation* invocation,
+void DBusSensorInterface::sensorRawRead(GDBusConnection*       connection,
+                                        GDBusMethodInvocation* invocation,
                                         gpointer               arg) {
   Sensor* obj = static_cast<Sensor*>(arg);
   LOG(INFO) << "sensorRawRead of " << obj->getName();
+  ReadResult lastStatus = obj->getLastReadStatus();
+  float lastValue = obj->getValue();
   obj->sensorRawRead();
   g_dbus_method_invocation_return_value(invocation,
                                         g_variant_new("(id)",
                                         obj->getLastReadStatus(),
                                         obj->getValue()));
+
+  // keep subscribers of the FRU readings in sync with single reads too
+  FRU* fru = obj->getFru();
+  if (fru != nullptr && (obj->getLastReadStatus() != lastStatus ||
+                         obj->getValue() != lastValue)) {
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a(yid)"));
+    g_variant_builder_add(&builder,
+                          "(yid)",
+                          obj->getId(),
+                          obj->getLastReadStatus(),
+                          obj->getValue());
+    DBusSensorTreeInterface::emitSensorReadingsChanged(
+                                        connection,
+                                        fru,
+                                        g_variant_builder_end(&builder));
+  }
 }
 
 void DBusSensorInterface::getSensorObject(GDBusMethodInvocation* invocation,
@@ -129,7 +150,7 @@ void DBusSensorInterface::methodCallBack(
     sensorRead(invocation, arg);
   }
   else if (g_strcmp0(methodName, "sensorRawRead") == 0) {
-    sensorRawRead(invocation, arg);
+    sensorRawRead(connection, invocation, arg);
   }
   else if (g_strcmp0(methodName, "getSensorObject") == 0) {
     getSensorObject(invocation, arg);
@@ -71,9 +71,11 @@ class DBusSensorInterface: public DBusInterfaceBase {
 
     /**
      * Callback for sensorRawRead method
-     * Invokes rawRead on sensor and returns value and read status
+     * Invokes rawRead on sensor and returns value and read status,
+     * a changed reading is also broadcast with sensorReadingsChanged
     */
-    static void sensorRawRead(GDBusMethodInvocation* invocation,
+    static void sensorRawRead(GDBusConnection*       connection,
+                              GDBusMethodInvocation* invocation,
                               gpointer               arg);
 
     /**
@@ -56,6 +56,15 @@ static const char* xml =
   "    <method name='getSensorObjects'>"
   "      <arg type='a(syids)' name='sensorlist' direction='out'/>"
   "    </method>"
+  "    <method name='getFruSensorReadings'>"
+  "      <arg type='y' name='fruId' direction='in'/>"
+  "      <arg type='b' name='rawRead' direction='in'/>"
+  "      <arg type='a(yid)' name='readings' direction='out'/>"
+  "    </method>"
+  "    <signal name='sensorReadingsChanged'>"
+  "      <arg type='y' name='fruId'/>"
+  "      <arg type='a(yid)' name='readings'/>"
+  "    </signal>"
   "    <method name='addFRU'>"
   "      <arg type='s' name='fruParentPath' direction='in'/>"
   "      <arg type='s' name='fruJsonString' direction='in'/>"
@@ -226,7 +235,7 @@ void DBusSensorServiceInterface::methodCallBack(
   }
   else {
     // For remaining methods call DBusSensorTreeInterface::methodCallBack
-    // Pass SensorService object (sensorTree->getObject(objectPath)) as arg
+    // which resolves the SensorService object from objectPath
     DBusSensorTreeInterface::methodCallBack(connection,
                                             sender,
                                             objectPath,
@@ -234,7 +243,7 @@ void DBusSensorServiceInterface::methodCallBack(
                                             methodName,
                                             parameters,
                                             invocation,
-                                            sensorTree->getObject(objectPath));
+                                            sensorTree);
   }
 }
 
@@ -25,6 +25,7 @@
 #include "DBusSensorTreeInterface.h"
 #include "FRU.h"
 #include "Sensor.h"
+#include "SensorObjectTree.h"
 
 namespace openbmc {
 namespace qin {
@@ -57,6 +58,15 @@ static const char* xml =
   "    <method name='getSensorObjects'>"
   "      <arg type='a(syids)' name='sensorlist' direction='out'/>"
   "    </method>"
+  "    <method name='getFruSensorReadings'>"
+  "      <arg type='y' name='fruId' direction='in'/>"
+  "      <arg type='b' name='rawRead' direction='in'/>"
+  "      <arg type='a(yid)' name='readings' direction='out'/>"
+  "    </method>"
+  "    <signal name='sensorReadingsChanged'>"
+  "      <arg type='y' name='fruId'/>"
+  "      <arg type='a(yid)' name='readings'/>"
+  "    </signal>"
   "  </interface>"
   "</node>";
 
@@ -128,195 +138,69 @@ void DBusSensorTreeInterface::getFRUList(GDBusMethodInvocation* invocation,
 }
 
 
-/*
-* Helper function, locates FRU with fruName under subtree and returns its path
-*/
-static std::string getFruPathByNameRec(Object* obj, std::string fruName) {
-  std::string path;
-
-  for (auto &it : obj->getChildMap()) {
-    if (dynamic_cast<FRU*>(it.second) != nullptr) {
-      //Child is FRU
-      if (fruName.compare(it.first) == 0){
-        // FRU found
-        path = it.first;
-        break;
-      }
-      else {
-        path = getFruPathByNameRec(it.second, fruName);
-        if (!path.empty()){
-          // If sensor is located no need to search more
-          path = it.first + "/" + path;
-          break;
-        }
-      }
-    }
-  }
-
-  return path;
-}
-
 void DBusSensorTreeInterface::getFruPathByName(
                                           GDBusMethodInvocation* invocation,
                                           GVariant*              parameters,
-                                          gpointer               arg){
-  Object* obj = static_cast<Object*>(arg);
+                                          SensorObjectTree*      sensorTree,
+                                          Object*                obj){
   const gchar *fruName;
   g_variant_get(parameters, "(&s)", &fruName);
 
   LOG(INFO) << "getFruPathByName of " << fruName << " from " << obj->getName();
-  std::string path = getFruPathByNameRec(obj, std::string(fruName));
-
-  if (!path.empty()) {
-    path = getPathToCurrentObject(obj) + "/" + path;
-  }
+  FRU* fru = sensorTree->findObjectByName<FRU>(fruName, obj);
 
   g_dbus_method_invocation_return_value(invocation,
-                                        g_variant_new("(s)", path.c_str()));
-}
-
-/*
-* Helper function, locates FRU with fruId under subtree and returns its path
-*/
-static std::string getFruPathByIdRec(Object* obj, uint8_t fruId) {
-  std::string path;
-
-  for (auto &it : obj->getChildMap()) {
-    if (dynamic_cast<FRU*>(it.second) != nullptr) {
-      //Child is sensor device
-      if (fruId == ((FRU*)it.second)->getId()){
-        // FRU found
-        path = it.first;
-        break;
-      }
-      else {
-        path = getFruPathByIdRec(it.second, fruId);
-        if (!path.empty()){
-          // If sensor is located no need to search more
-          path = it.first + "/" + path;
-          break;
-        }
-      }
-    }
-  }
-  return path;
+                                        g_variant_new("(s)",
+                                        sensorTree->getObjectPath(fru).c_str()));
 }
 
 void DBusSensorTreeInterface::getFruPathById(GDBusMethodInvocation* invocation,
                                              GVariant*              parameters,
-                                             gpointer               arg){
-  Object* obj = static_cast<Object*>(arg);
-  gchar fruId;
+                                             SensorObjectTree*      sensorTree,
+                                             Object*                obj){
+  uint8_t fruId;
   g_variant_get(parameters, "(y)", &fruId);
 
-  LOG(INFO) << "getFruPathById of " << fruId << " from " << obj->getName();
-  std::string path = getFruPathByIdRec(obj, fruId);
-
-  if (!path.empty()) {
-    path = getPathToCurrentObject(obj) + "/" + path;
-  }
+  LOG(INFO) << "getFruPathById of " << (int)fruId << " from " << obj->getName();
+  FRU* fru = sensorTree->findObjectById<FRU>(fruId, obj);
 
   g_dbus_method_invocation_return_value(invocation,
-                                        g_variant_new("(s)", path.c_str()));
-}
-
-/*
-* Helper function, locates Sensor with sensorName under subtree and
-* returns its path
-*/
-static std::string getSensorPathByNameRec(Object* obj,
-                                          std::string sensorName) {
-  std::string path;
-
-  for (auto &it : obj->getChildMap()) {
-    if (dynamic_cast<FRU*>(it.second) != nullptr) {
-      //Child is FRU
-      path = getSensorPathByNameRec(it.second, sensorName);
-      if (!path.empty()){
-        // If sensor is located no need to search more
-        path = it.first + "/" + path;
-        break;
-      }
-    }
-    else if (dynamic_cast<Sensor*>(it.second) != nullptr) {
-      //Child is sensor object
-      if (sensorName.compare(it.second->getName()) == 0) {
-        path = it.second->getName();
-        break;
-      }
-    }
-  }
-
-  return path;
+                                        g_variant_new("(s)",
+                                        sensorTree->getObjectPath(fru).c_str()));
 }
 
 void DBusSensorTreeInterface::getSensorPathByName(
                                              GDBusMethodInvocation* invocation,
                                              GVariant*              parameters,
-                                             gpointer               arg) {
-  Object* obj = static_cast<Object*>(arg);
+                                             SensorObjectTree*      sensorTree,
+                                             Object*                obj) {
   const gchar *sensorName;
   g_variant_get(parameters, "(&s)", &sensorName);
 
   LOG(INFO) << "getSensorPath of " << sensorName << " from " << obj->getName();
-  std::string path = getSensorPathByNameRec(obj, std::string(sensorName));
-
-  if (!path.empty()) {
-    path = getPathToCurrentObject(obj) + "/" + path;
-  }
+  Sensor* sensor = sensorTree->findObjectByName<Sensor>(sensorName, obj);
 
   g_dbus_method_invocation_return_value(invocation,
-                                        g_variant_new("(s)", path.c_str()));
-}
-
-/*
-* Helper function, locates Sensor with id under subtree and returns its path
-*/
-static std::string getSensorPathByIdRec(Object* obj, uint16_t id) {
-  std::string path;
-
-  for (auto &it : obj->getChildMap()) {
-    if (dynamic_cast<FRU*>(it.second) != nullptr) {
-      //Child is FRU
-      path = getSensorPathByIdRec(it.second, id);
-      if (!path.empty()){
-        // If sensor is located no need to search more
-        path = it.first + "/" + path;
-        break;
-      }
-    }
-    else if (dynamic_cast<Sensor*>(it.second) != nullptr) {
-      //Child is sensor object
-      if (((Sensor*) it.second)->getId() == id) {
-        path = it.second->getName();
-        break;
-      }
-    }
-  }
-
-  return path;
+                                        g_variant_new("(s)",
+                                        sensorTree->getObjectPath(sensor).c_str()));
 }
 
 void DBusSensorTreeInterface::getSensorPathById(
                                              GDBusMethodInvocation* invocation,
                                              GVariant*              parameters,
-                                             gpointer               arg) {
-  Object* obj = static_cast<Object*>(arg);
-
+                                             SensorObjectTree*      sensorTree,
+                                             Object*                obj) {
   uint8_t id;
   g_variant_get(parameters, "(y)", &id);
 
   LOG(INFO) << "getSensorPathById of " << (int)id
             << " from " << obj->getName();
 
-  std::string path = getSensorPathByIdRec(obj, id);
-
-  if (!path.empty()) {
-    path = getPathToCurrentObject(obj) + "/" + path;
-  }
+  Sensor* sensor = sensorTree->findObjectById<Sensor>(id, obj);
 
   g_dbus_method_invocation_return_value(invocation,
-                                        g_variant_new("(s)", path.c_str()));
+                                        g_variant_new("(s)",
+                                        sensorTree->getObjectPath(sensor).c_str()));
 }
 
 /**
@@ -361,6 +245,101 @@ void DBusSensorTreeInterface::getSensorObjects(
   g_variant_builder_unref(builder);
 }
 
+void DBusSensorTreeInterface::emitSensorReadingsChanged(
+                                           GDBusConnection* connection,
+                                           FRU*             fru,
+                                           GVariant*        readings) {
+  GError* error = nullptr;
+
+  g_dbus_connection_emit_signal(connection,
+                                nullptr,
+                                fru->getObjectPath().c_str(),
+                                "org.openbmc.SensorTree",
+                                "sensorReadingsChanged",
+                                g_variant_new("(y@a(yid))",
+                                              fru->getId(),
+                                              readings),
+                                &error);
+  if (error != nullptr) {
+    LOG(ERROR) << "sensorReadingsChanged of " << fru->getName()
+               << " failed: " << error->message;
+    g_error_free(error);
+  }
+}
+
+void DBusSensorTreeInterface::getFruSensorReadings(
+                                           GDBusConnection*       connection,
+                                           GDBusMethodInvocation* invocation,
+                                           GVariant*              parameters,
+                                           SensorObjectTree*      sensorTree,
+                                           Object*                obj) {
+  uint8_t fruId;
+  gboolean rawRead;
+  bool changed = false;
+  g_variant_get(parameters, "(yb)", &fruId, &rawRead);
+
+  FRU* fru = dynamic_cast<FRU*>(obj);
+  if (fru == nullptr || fru->getId() != fruId) {
+    fru = sensorTree->findObjectById<FRU>(fruId, obj);
+  }
+
+  if (fru == nullptr) {
+    g_dbus_method_invocation_return_error(invocation,
+                                          G_DBUS_ERROR,
+                                          G_DBUS_ERROR_INVALID_ARGS,
+                                          "FRU %d does not exist",
+                                          (int)fruId);
+    return;
+  }
+
+  GVariantBuilder builder;
+  GVariantBuilder changedBuilder;
+  g_variant_builder_init(&builder, G_VARIANT_TYPE("a(yid)"));
+  g_variant_builder_init(&changedBuilder, G_VARIANT_TYPE("a(yid)"));
+
+  for (auto &it : fru->getChildMap()) {
+    Sensor* sensor = dynamic_cast<Sensor*>(it.second);
+    if (sensor == nullptr) {
+      continue;
+    }
+
+    if (rawRead) {
+      ReadResult lastStatus = sensor->getLastReadStatus();
+      float lastValue = sensor->getValue();
+
+      sensor->sensorRawRead();
+      if (sensor->getLastReadStatus() != lastStatus ||
+          sensor->getValue() != lastValue) {
+        g_variant_builder_add(&changedBuilder,
+                              "(yid)",
+                              sensor->getId(),
+                              sensor->getLastReadStatus(),
+                              sensor->getValue());
+        changed = true;
+      }
+    }
+
+    g_variant_builder_add(&builder,
+                          "(yid)",
+                          sensor->getId(),
+                          sensor->getLastReadStatus(),
+                          sensor->getValue());
+  }
+
+  g_dbus_method_invocation_return_value(invocation,
+                                        g_variant_new("(a(yid))", &builder));
+
+  // one signal per sweep carrying only what changed
+  if (changed) {
+    emitSensorReadingsChanged(connection,
+                              fru,
+                              g_variant_builder_end(&changedBuilder));
+  }
+  else {
+    g_variant_builder_clear(&changedBuilder);
+  }
+}
+
 void DBusSensorTreeInterface::methodCallBack(
                           GDBusConnection*       connection,
                           const char*            sender,
@@ -370,26 +349,40 @@ void DBusSensorTreeInterface::methodCallBack(
                           GVariant*              parameters,
                           GDBusMethodInvocation* invocation,
                           gpointer               arg) {
-  // arg should be a pointer to Object in object-tree
+  // arg should be a pointer to SensorObjectTree
   DCHECK(arg != nullptr) << "Empty object passed to callback";
 
+  SensorObjectTree* sensorTree = static_cast<SensorObjectTree*>(arg);
+  Object* obj = sensorTree->getObject(objectPath);
+  if (obj == nullptr) {
+    // the object may have been removed after the method call was queued
+    g_dbus_method_invocation_return_dbus_error(
+        invocation,
+        "org.freedesktop.DBus.Error.UnknownObject",
+        "Object not in sensorTree");
+    return;
+  }
+
   if (g_strcmp0(methodName, "getSensorPathByName") == 0) {
-    getSensorPathByName(invocation, parameters, arg);
+    getSensorPathByName(invocation, parameters, sensorTree, obj);
   }
   else if (g_strcmp0(methodName, "getSensorPathById") == 0) {
-    getSensorPathById(invocation, parameters, arg);
+    getSensorPathById(invocation, parameters, sensorTree, obj);
   }
   else if (g_strcmp0(methodName, "getFRUList") == 0) {
-    getFRUList(invocation, arg);
+    getFRUList(invocation, obj);
   }
   else if (g_strcmp0(methodName, "getFruPathByName") == 0) {
-    getFruPathByName(invocation, parameters, arg);
+    getFruPathByName(invocation, parameters, sensorTree, obj);
   }
   else if (g_strcmp0(methodName, "getFruPathById") == 0) {
-    getFruPathById(invocation, parameters, arg);
+    getFruPathById(invocation, parameters, sensorTree, obj);
   }
   else if (g_strcmp0(methodName, "getSensorObjects") == 0) {
-    getSensorObjects(invocation, arg);
+    getSensorObjects(invocation, obj);
+  }
+  else if (g_strcmp0(methodName, "getFruSensorReadings") == 0) {
+    getFruSensorReadings(connection, invocation, parameters, sensorTree, obj);
   }
 }
 
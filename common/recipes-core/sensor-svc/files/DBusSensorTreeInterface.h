@@ -21,10 +21,13 @@
 
 #pragma once
 #include <dbus-utils/DBusInterfaceBase.h>
+#include "FRU.h"
 
 namespace openbmc {
 namespace qin {
 
+class SensorObjectTree;
+
 class DBusSensorTreeInterface: public DBusInterfaceBase {
   public:
     /**
@@ -54,6 +57,16 @@ class DBusSensorTreeInterface: public DBusInterfaceBase {
                                GDBusMethodInvocation* invocation,
                                gpointer               arg);
 
+    /**
+     * Emits sensorReadingsChanged on the object path of fru with the
+     * (id, readStatus, value) entries in readings. Clients keeping a
+     * local copy of the readings apply these instead of polling.
+     * readings is consumed if it is floating.
+     */
+    static void emitSensorReadingsChanged(GDBusConnection* connection,
+                                          FRU*             fru,
+                                          GVariant*        readings);
+
   private:
     /**
      * Callback for getSensorPathById method
@@ -61,7 +74,8 @@ class DBusSensorTreeInterface: public DBusInterfaceBase {
      */
     static void getSensorPathById(GDBusMethodInvocation* invocation,
                                   GVariant*              parameters,
-                                  gpointer               arg);
+                                  SensorObjectTree*      sensorTree,
+                                  Object*                obj);
 
     /**
      * Callback for getSensorPathByName method
@@ -69,7 +83,8 @@ class DBusSensorTreeInterface: public DBusInterfaceBase {
      */
     static void getSensorPathByName(GDBusMethodInvocation* invocation,
                                     GVariant*              parameters,
-                                    gpointer               arg);
+                                    SensorObjectTree*      sensorTree,
+                                    Object*                obj);
 
     /**
      * Callback for getSensorObjectPaths method
@@ -91,7 +106,8 @@ class DBusSensorTreeInterface: public DBusInterfaceBase {
      */
     static void getFruPathByName(GDBusMethodInvocation* invocation,
                                  GVariant*              parameters,
-                                 gpointer               arg);
+                                 SensorObjectTree*      sensorTree,
+                                 Object*                obj);
 
     /**
      * Callback for getFruPathbyId method
@@ -99,7 +115,8 @@ class DBusSensorTreeInterface: public DBusInterfaceBase {
      */
     static void getFruPathById(GDBusMethodInvocation* invocation,
                                GVariant*              parameters,
-                               gpointer               arg);
+                               SensorObjectTree*      sensorTree,
+                               Object*                obj);
 
     /**
      * Callback for getSensorObjects method
@@ -107,6 +124,18 @@ class DBusSensorTreeInterface: public DBusInterfaceBase {
      */
     static void getSensorObjects(GDBusMethodInvocation* invocation,
                                  gpointer               arg);
+
+    /**
+     * Callback for getFruSensorReadings method
+     * Returns (id, readStatus, value) of all sensors of the FRU in one
+     * reply. With rawRead set the sensors are read first and the
+     * readings that changed are broadcast with sensorReadingsChanged.
+     */
+    static void getFruSensorReadings(GDBusConnection*       connection,
+                                     GDBusMethodInvocation* invocation,
+                                     GVariant*              parameters,
+                                     SensorObjectTree*      sensorTree,
+                                     Object*                obj);
 };
 
 } // namespace qin
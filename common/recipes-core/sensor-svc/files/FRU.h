@@ -62,6 +62,13 @@ class FRU : public Object {
       return fruId_;
     }
 
+    /*
+    * Returns fruId for the ObjectTree id index
+    */
+    int getIndexId() const override {
+      return fruId_;
+    }
+
     /*
     * Checks if FRU is on
     */
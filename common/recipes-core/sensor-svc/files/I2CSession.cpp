@@ -0,0 +1,172 @@
+/*
+ * I2CSession.cpp
+ *
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <glog/logging.h>
+#include "I2CSession.h"
+
+#ifndef I2C_RDWR_IOCTL_MAX_MSGS
+#define I2C_RDWR_IOCTL_MAX_MSGS 42
+#endif
+
+namespace openbmc {
+namespace qin {
+
+I2CSessionManager& I2CSessionManager::getInstance() {
+  static I2CSessionManager instance;
+  return instance;
+}
+
+I2CSessionManager::~I2CSessionManager() {
+  for (auto &it : fds_) {
+    close(it.second);
+  }
+}
+
+int I2CSessionManager::getFd(uint8_t busId) {
+  auto it = fds_.find(busId);
+  if (it != fds_.end()) {
+    return it->second;
+  }
+
+  char fn[32];
+  snprintf(fn, sizeof(fn), "/dev/i2c-%d", busId);
+  int fd = open(fn, O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    LOG(WARNING) << "Failed to open " << fn << ": " << strerror(errno);
+    return -1;
+  }
+
+  fds_[busId] = fd;
+  return fd;
+}
+
+void I2CSessionManager::closeFd(uint8_t busId) {
+  auto it = fds_.find(busId);
+  if (it != fds_.end()) {
+    close(it->second);
+    fds_.erase(it);
+  }
+}
+
+bool I2CSessionManager::readWords(uint8_t busId,
+                                  uint8_t slaveAddr,
+                                  std::vector<WordRead> &reads) {
+  std::lock_guard<std::mutex> guard(lock_);
+  int fd;
+
+  if ((fd = getFd(busId)) < 0) {
+    return false;
+  }
+
+  auto xfer = [&](std::vector<struct i2c_msg> &msgs) {
+    struct i2c_rdwr_ioctl_data data;
+    data.msgs = msgs.data();
+    data.nmsgs = msgs.size();
+    if (!msgs.empty() && ioctl(fd, I2C_RDWR, &data) < 0) {
+      LOG(WARNING) << "I2C_RDWR failed on bus " << (int)busId
+                   << " addr 0x" << std::hex << (int)slaveAddr
+                   << ": " << strerror(errno);
+      if (errno == EBADF || errno == ENODEV) {
+        closeFd(busId);
+      }
+      return false;
+    }
+    msgs.clear();
+    return true;
+  };
+
+  // page selected for the pending reads, -1 if none yet
+  int page = -1;
+
+  // every read needs at most a PAGE write, a register write and a read,
+  // laid out as 2 + 1 + 2 bytes per read in bufs
+  std::vector<struct i2c_msg> msgs;
+  std::vector<uint8_t> bufs(reads.size() * 5);
+  uint8_t* buf = bufs.data();
+
+  for (size_t i = 0; i < reads.size(); i++) {
+    WordRead &rd = reads[i];
+    struct i2c_msg msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.addr = slaveAddr >> 1;
+
+    // flush when the read doesn't fit, the next batch selects its page again
+    if (msgs.size() + 2 > I2C_RDWR_IOCTL_MAX_MSGS) {
+      if (!xfer(msgs)) {
+        return false;
+      }
+      page = -1;
+    }
+
+    // PAGE goes in a transfer of its own, as some devices only switch
+    // page at the STOP condition
+    if (rd.page != I2C_SESSION_NO_PAGE && rd.page != page) {
+      if (!xfer(msgs)) {
+        return false;
+      }
+      std::vector<struct i2c_msg> pageMsg(1, msg);
+      buf[0] = PMBUS_PAGE;
+      buf[1] = rd.page;
+      pageMsg[0].flags = 0;
+      pageMsg[0].len = 2;
+      pageMsg[0].buf = buf;
+      if (!xfer(pageMsg)) {
+        return false;
+      }
+      page = rd.page;
+    }
+    buf += 2;
+
+    buf[0] = rd.reg;
+    msg.flags = 0;
+    msg.len = 1;
+    msg.buf = buf;
+    msgs.push_back(msg);
+    buf += 1;
+
+    msg.flags = I2C_M_RD;
+    msg.len = 2;
+    msg.buf = buf;
+    msgs.push_back(msg);
+    buf += 2;
+  }
+
+  if (!xfer(msgs)) {
+    return false;
+  }
+
+  for (size_t i = 0; i < reads.size(); i++) {
+    uint8_t* rx = &bufs[i * 5 + 3];
+    reads[i].value = rx[0] | (rx[1] << 8);
+  }
+
+  return true;
+}
+
+} // namespace qin
+} // namespace openbmc
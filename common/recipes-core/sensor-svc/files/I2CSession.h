@@ -0,0 +1,81 @@
+/*
+ * I2CSession.h: I2C bus handles shared by the sensor access mechanisms
+ *
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#pragma once
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace openbmc {
+namespace qin {
+
+#define I2C_SESSION_NO_PAGE 0xFF
+#define PMBUS_PAGE 0x00
+
+/*
+ * Keeps one open /dev/i2c-N per bus for the life of sensor-svc.
+ * No PMBus PAGE state is kept between transactions: other processes
+ * (vr-util, power-util, ...) may change PAGE at any time, so PAGE is
+ * written again ahead of every combined transaction of register reads.
+ */
+class I2CSessionManager {
+  public:
+    struct WordRead {
+      uint8_t page;     // page to select, I2C_SESSION_NO_PAGE if none
+      uint8_t reg;      // register to read
+      uint16_t value;   // little endian word read, set on success
+    };
+
+    static I2CSessionManager& getInstance();
+
+    /*
+     * Reads a 16-bit register for every entry of reads from the device at
+     * 8-bit address slaveAddr. A PAGE write is a transaction of its own,
+     * ending with a STOP, as some devices only switch page then; it is
+     * followed by the reads of that page as one combined I2C_RDWR
+     * transaction. PAGE is written again when the page changes and ahead
+     * of every transaction when the reads don't fit in one.
+     * Returns false if the bus cannot be opened or a transfer fails.
+     */
+    bool readWords(uint8_t busId,
+                   uint8_t slaveAddr,
+                   std::vector<WordRead> &reads);
+
+  private:
+    std::mutex lock_;
+    std::map<uint8_t, int> fds_;       // bus to open /dev/i2c-N
+
+    I2CSessionManager() {}
+    ~I2CSessionManager();
+
+    /*
+     * Returns fd of the bus, opening it on first use. lock_ must be held.
+     */
+    int getFd(uint8_t busId);
+
+    /*
+     * Drops the fd of the bus after an error. lock_ must be held.
+     */
+    void closeFd(uint8_t busId);
+};
+
+} // namespace qin
+} // namespace openbmc
@@ -33,7 +33,7 @@ namespace qin {
 class Sensor : public Object{
   private:
     uint8_t id_ = 0xFF;                           // Sensor Id
-    float value_;                                 // Last Read Sensor Value
+    float value_ = 0;                             // Last Read Sensor Value
     std::string unit_;                            // Unit of Sensor
     std::unique_ptr<SensorAccessMechanism> sensorAccess_;
                                                   // sensorAccess mechanism
@@ -65,6 +65,13 @@ class Sensor : public Object{
      */
     uint8_t getId();
 
+    /*
+     * Returns Sensor Id for the ObjectTree id index
+     */
+    int getIndexId() const override {
+      return id_;
+    }
+
     /*
      * Returns Sensor Value
      */
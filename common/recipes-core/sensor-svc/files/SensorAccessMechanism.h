@@ -54,6 +54,8 @@ protected:
   bool checkAccessConditions(Sensor* s);
 
 public:
+  virtual ~SensorAccessMechanism() {}
+
   bool setAccessConditions(uint8_t accessCondition) {
     this->accessCondition_ = accessCondition;
   }
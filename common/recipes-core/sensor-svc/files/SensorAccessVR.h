@@ -22,23 +22,29 @@
 #include <cstdint>
 #include <string>
 #include "SensorAccessMechanism.h"
+#include "I2CSession.h"
 #include <sys/stat.h>
+#include <sys/inotify.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <syslog.h>
+#include <algorithm>
 #include <chrono>
+#include <map>
+#include <mutex>
 #include <thread>
+#include <vector>
 #include <cstring>
-#include <linux/i2c.h>
-#include <linux/i2c-dev.h>
-#include <sys/ioctl.h>
 #include <glog/logging.h>
-#include <openbmc/obmc-i2c.h>
 
 namespace openbmc {
 namespace qin {
 
-#define MAX_READ_RETRY 10
+#define MAX_READ_RETRY 3
+#define READ_RETRY_DELAY_MS 10
+#define VR_READING_FRESH_MS 500
+#define VR_UPDATE_IN_PROGRESS_DIR "/tmp"
+#define VR_UPDATE_IN_PROGRESS_FILE "stop_monitor_vr"
 #define VR_UPDATE_IN_PROGRESS "/tmp/stop_monitor_vr"
 #define VR_TIMEOUT 500 * 4 // 4 including temp, current, power, volt
 #define VR_TELEMETRY_VOLT 0x1A
@@ -46,121 +52,148 @@ namespace qin {
 #define VR_TELEMETRY_POWER 0x2D
 #define VR_TELEMETRY_TEMP 0x29
 
-
-
-class SensorAccessVR : public SensorAccessMechanism {
+/*
+ * Tracks VR_UPDATE_IN_PROGRESS with inotify on its directory so the flag
+ * is not stat'ed on every reading. Falls back to access() if inotify is
+ * unavailable or its queue overflowed.
+ */
+class VRUpdateFlag {
   private:
-    uint8_t busId_;
-    uint8_t loop_;
-    uint8_t reg_;
-    uint8_t slaveAddr_;
+    int fd_ = -1;
+    bool set_ = false;
 
-  public:
-    SensorAccessVR(uint8_t busId,
-                   uint8_t loop,
-                   uint8_t reg,
-                   uint8_t slaveAddr) {
-      this->busId_ = busId;
-      this->loop_ = loop;
-      this->reg_ = reg;
-      this->slaveAddr_ = slaveAddr;
+    VRUpdateFlag() {
+      fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+      if (fd_ >= 0 &&
+          inotify_add_watch(fd_, VR_UPDATE_IN_PROGRESS_DIR,
+                            IN_CREATE | IN_DELETE |
+                            IN_MOVED_TO | IN_MOVED_FROM) < 0) {
+        LOG(WARNING) << "Cannot watch " << VR_UPDATE_IN_PROGRESS_DIR
+                     << ": " << strerror(errno);
+        close(fd_);
+        fd_ = -1;
+      }
+      // take the initial state after the watch is in place
+      set_ = (access(VR_UPDATE_IN_PROGRESS, F_OK) == 0);
     }
 
-    bool preRawRead(Sensor* s, float* value) override;
+    ~VRUpdateFlag() {
+      if (fd_ >= 0) {
+        close(fd_);
+      }
+    }
 
-    void rawRead(Sensor* s, float *value) override{
-      int fd;
-      char fn[32];
-      unsigned int retry = MAX_READ_RETRY;
-      int ret;
-      uint8_t tcount, rcount;
-      uint8_t tbuf[16] = {0};
-      uint8_t rbuf[16] = {0};
+  public:
+    static VRUpdateFlag& getInstance() {
+      static VRUpdateFlag instance;
+      return instance;
+    }
 
-      readResult_ = READING_NA;
+    bool isSet() {
+      if (fd_ < 0) {
+        return access(VR_UPDATE_IN_PROGRESS, F_OK) == 0;
+      }
 
-      static uint16_t vrUpdateInProgressCount = 0;
-      if ( access(VR_UPDATE_IN_PROGRESS, F_OK) == 0 )
-      {
-        //Avoid sensord unmonitoring vr sensors
-        //due to unexpected condition happen during vr_update
-        if ( vrUpdateInProgressCount > VR_TIMEOUT)
-        {
-          remove(VR_UPDATE_IN_PROGRESS);
-          vrUpdateInProgressCount = 0;
+      char buf[4096]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+      ssize_t len;
+      while ((len = read(fd_, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + len;) {
+          struct inotify_event *ev = (struct inotify_event *)p;
+          if (ev->mask & IN_Q_OVERFLOW) {
+            set_ = (access(VR_UPDATE_IN_PROGRESS, F_OK) == 0);
+          } else if (ev->len > 0 &&
+                     strcmp(ev->name, VR_UPDATE_IN_PROGRESS_FILE) == 0) {
+            set_ = (ev->mask & (IN_CREATE | IN_MOVED_TO)) != 0;
+          }
+          p += sizeof(struct inotify_event) + ev->len;
         }
-
-        syslog(LOG_WARNING,
-               "[%d]Stop Monitor VR Volt due to VR update is in progress\n",
-               vrUpdateInProgressCount++);
-        LOG(INFO) << "VR update in progress ";
-        return;
-      }
-      else {
-        vrUpdateInProgressCount = 0;
       }
+      return set_;
+    }
 
-      snprintf(fn, sizeof(fn), "/dev/i2c-%d", busId_);
-      while (retry) {
-        fd = open(fn, O_RDWR);
-        if (fd < 0) {
-          retry--;
-          LOG(WARNING) << "i2c_io failed for bus -1 ";
-          std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        } else {
-          break;
-        }
+    /*
+     * Removes the flag file, used when an update seems to be stuck.
+     */
+    void clear() {
+      remove(VR_UPDATE_IN_PROGRESS);
+      set_ = false;
+    }
+};
 
-        if(retry == 0)
-          goto error_exit;
-      }
+/*
+ * Reads one telemetry register of one rail (PMBus page) of a VR.
+ * All SensorAccessVR of the same device are read together: the first
+ * rawRead of a sweep fetches every rail of the device in one combined
+ * I2C_RDWR transaction through I2CSessionManager and the other sensors
+ * of the device pick up their word from that transaction.
+ */
+class SensorAccessVR : public SensorAccessMechanism {
+  private:
+    typedef std::chrono::steady_clock Clock;
 
-      // Set the page for read
-      tbuf[0] = 0x00;
-      tbuf[1] = loop_;
-
-      tcount = 2;
-      rcount = 0;
-
-      retry = MAX_READ_RETRY;
-      while (retry) {
-        ret = i2c_rdwr_msg_transfer(fd, slaveAddr_, tbuf, tcount, rbuf, rcount);
-        if (ret) {
-          retry--;
-          LOG(WARNING) << "i2c_io failed for bus ";
-          std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        } else {
-          break;
-        }
+    uint8_t busId_;
+    uint8_t loop_;
+    uint8_t reg_;
+    uint8_t slaveAddr_;
+    bool pending_ = false;      // raw_ read by a sibling, not consumed yet
+    uint16_t raw_ = 0;
+    Clock::time_point readAt_;
 
-        if(retry == 0)
-          goto error_exit;
-      }
+    static std::mutex& devicesLock() {
+      static std::mutex lock;
+      return lock;
+    }
 
-      // Read 2 bytes from register
-      tbuf[0] = reg_;
+    // bus << 8 | addr to all VR sensors of the device
+    static std::map<uint16_t, std::vector<SensorAccessVR*>>& devices() {
+      static std::map<uint16_t, std::vector<SensorAccessVR*>> devices;
+      return devices;
+    }
 
-      tcount = 1;
-      rcount = 2;
+    uint16_t deviceKey() const {
+      return (busId_ << 8) | slaveAddr_;
+    }
 
-      retry = MAX_READ_RETRY;
-      while(retry) {
-        ret = i2c_rdwr_msg_transfer(fd, slaveAddr_, tbuf, tcount, rbuf, rcount);
-        if (ret) {
-          LOG(WARNING) << "i2c_io failed for bus 2";
-          retry--;
-          std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        } else {
-          break;
-        }
+    /*
+     * Reads all rails of the device of this sensor and hands the words to
+     * the sibling sensors. devicesLock() must be held.
+     */
+    bool readDevice() {
+      std::vector<SensorAccessVR*> &group = devices()[deviceKey()];
+      std::vector<I2CSessionManager::WordRead> reads;
 
-        if (retry == 0)
-          goto error_exit;
+      // sorted by loop so each page is selected at most once
+      std::sort(group.begin(), group.end(),
+                [](const SensorAccessVR* a, const SensorAccessVR* b) {
+                  return a->loop_ < b->loop_;
+                });
+      for (SensorAccessVR* vr : group) {
+        reads.push_back({vr->loop_, vr->reg_, 0});
       }
 
-      readResult_ = READING_SUCCESS;
+      I2CSessionManager &session = I2CSessionManager::getInstance();
+      for (unsigned int retry = 0; retry < MAX_READ_RETRY; retry++) {
+        if (session.readWords(busId_, slaveAddr_, reads)) {
+          Clock::time_point now = Clock::now();
+          for (size_t i = 0; i < group.size(); i++) {
+            group[i]->raw_ = reads[i].value;
+            group[i]->readAt_ = now;
+            group[i]->pending_ = true;
+          }
+          return true;
+        }
+        LOG(WARNING) << "i2c_io failed for bus " << (int)busId_;
+        std::this_thread::sleep_for(
+            std::chrono::milliseconds(READ_RETRY_DELAY_MS));
+      }
+      return false;
+    }
+
+    static void convert(uint8_t reg, uint16_t word, float *value) {
+      uint8_t rbuf[2] = {(uint8_t)(word & 0xFF), (uint8_t)(word >> 8)};
 
-      switch (reg_) {
+      switch (reg) {
         case VR_TELEMETRY_VOLT: {
           *value = ((rbuf[1] & 0x0F) * 256 + rbuf[0] ) * 1.25;
           *value /= 1000;
@@ -199,12 +232,71 @@ class SensorAccessVR : public SensorAccessMechanism {
           break;
         }
       }
+    }
 
-    error_exit:
-      if (fd > 0) {
-        close(fd);
+  public:
+    SensorAccessVR(uint8_t busId,
+                   uint8_t loop,
+                   uint8_t reg,
+                   uint8_t slaveAddr) {
+      this->busId_ = busId;
+      this->loop_ = loop;
+      this->reg_ = reg;
+      this->slaveAddr_ = slaveAddr;
+
+      std::lock_guard<std::mutex> guard(devicesLock());
+      devices()[deviceKey()].push_back(this);
+    }
+
+    ~SensorAccessVR() {
+      std::lock_guard<std::mutex> guard(devicesLock());
+      std::vector<SensorAccessVR*> &group = devices()[deviceKey()];
+      group.erase(std::remove(group.begin(), group.end(), this), group.end());
+      if (group.empty()) {
+        devices().erase(deviceKey());
       }
     }
+
+    bool preRawRead(Sensor* s, float* value) override;
+
+    void rawRead(Sensor* s, float *value) override{
+      readResult_ = READING_NA;
+
+      static uint16_t vrUpdateInProgressCount = 0;
+      VRUpdateFlag &flag = VRUpdateFlag::getInstance();
+      if (flag.isSet())
+      {
+        //Avoid sensord unmonitoring vr sensors
+        //due to unexpected condition happen during vr_update
+        if ( vrUpdateInProgressCount > VR_TIMEOUT)
+        {
+          flag.clear();
+          vrUpdateInProgressCount = 0;
+        }
+
+        syslog(LOG_WARNING,
+               "[%d]Stop Monitor VR Volt due to VR update is in progress\n",
+               vrUpdateInProgressCount++);
+        LOG(INFO) << "VR update in progress ";
+        return;
+      }
+      else {
+        vrUpdateInProgressCount = 0;
+      }
+
+      std::lock_guard<std::mutex> guard(devicesLock());
+      // a sibling read this rail recently, otherwise read the whole device
+      if (!pending_ || Clock::now() - readAt_ >
+                       std::chrono::milliseconds(VR_READING_FRESH_MS)) {
+        if (!readDevice()) {
+          return;
+        }
+      }
+
+      pending_ = false;
+      readResult_ = READING_SUCCESS;
+      convert(reg_, raw_, value);
+    }
 };
 
 } // namespace qin
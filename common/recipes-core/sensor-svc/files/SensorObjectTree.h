@@ -160,15 +160,15 @@ class SensorObjectTree : public ObjectTree {
                             DBusInterfaceBase       &interface) {
       Object* object = upObj.get();
       objectMap_.insert(std::make_pair(path, std::move(upObj)));
+      indexObject(object, path);
 
       DBus* dbus = getDBusObject(ipc_.get());
-      SensorService* sensorService = nullptr;
-      FRU* fru = nullptr;
 
-      // SensorService registers sensorTree object on dbus
-      // sensorTree access is required to perform add
-      // and delete opeartion at SensorService object path
-      if ((sensorService = dynamic_cast<SensorService*>(object)) != nullptr) {
+      // SensorService and FRUs register sensorTree object on dbus
+      // sensorTree access is required to perform add and delete
+      // operation at SensorService object path and for the indexed
+      // lookups of the SensorTree interface
+      if (dynamic_cast<Sensor*>(object) == nullptr) {
         dbus->registerObject(path, interface, this);
       }
       else {
@@ -18,14 +18,29 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
 #include <syslog.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <regex.h>
+#include <spawn.h>
+#include <time.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
+#include <zlib.h>
 #include <openbmc/pal.h>
+#include <openbmc/i2c_eeprom.h>
+#if defined(CONFIG_FBY2_ND)
+#include <facebook/bic.h>
+#include <facebook/fby2_sensor.h>
+#endif
 
 #define MAX_REC_NUM 4
 #define MAX_RI_NUM  3
@@ -40,29 +55,37 @@
 #define MFIH_MAGIC_TAG "/@MFG_ss"
 
 #define MAX_REASON_DESC 1024
-#define DEFAULT_REASON_FILE_NAME "/tmp/snapshot-reason-dft"
+#define DEFAULT_REASON_FILE_NAME "snapshot-reason-dft"
 
 // extra pw to prevent accidental clear of RMA data
 #define CLEAR_PW      "571932"
 
-#define TMP_SS_PATH   "/tmp/_snapshot"
-#define TMP_LOG_FILE  TMP_SS_PATH"/log.txt"
-#define TMP_POST_FILE TMP_SS_PATH"/postcode.txt"
-#define TMP_TARBALL   TMP_SS_PATH"/ss.tgz"
+// members of the snapshot tarball, besides the reason file
+#define SS_LOG_FILE   "log.txt"
+#define SS_POST_FILE  "postcode.txt"
+
+#define MAX_LOG_LINES 50
+#define MAX_POST_LEN  256
+#define TAR_BLOCK     512
 
 #define FRUID_PATH "/tmp/fruid_slot%u.bin"
 #define OEM_REC_TYPE 0xFA
 
 #define EEPROM_BUS  3     // i2c_1
 #define EEPROM_ADDR 0xA2  // 8-bit address
+#define EEPROM_PAGE 32    // write page of the 24C64
+#define EEPROM_XFER 16    // kept small for the BIC master write-read
+
+#define LOG_UTIL_PATH "/usr/local/bin/log-util"
 
-#define log_system(cmd)                                                     \
-do {                                                                        \
-  int sysret = system(cmd);                                                 \
-  if (sysret)                                                               \
-    syslog(LOG_WARNING, "%s: system command failed, cmd: \"%s\",  ret: %d", \
-            __func__, cmd, sysret);                                         \
-} while(0)
+extern char **environ;
+
+// a snapshot being assembled in memory
+typedef struct _ss_buf {
+  uint8_t *data;
+  size_t len;
+  size_t size;
+} ss_buf;
 
 typedef struct _info_hdr {
   uint8_t magic_tag[8];
@@ -83,6 +106,26 @@ static info_rec m_info_rec[MAX_REC_NUM] = {
   {0x2800, 0x0C00},
 };
 
+static uint8_t m_slot_id;
+
+static int
+eeprom_bic_xfer(void *priv, uint8_t *wbuf, size_t wcnt, uint8_t *rbuf, size_t rcnt) {
+  uint8_t slot_id = *(uint8_t *)priv;
+  uint8_t dummy[1];
+
+  return bic_master_write_read(slot_id, EEPROM_BUS, EEPROM_ADDR, wbuf, wcnt,
+                               rbuf ? rbuf : dummy, rcnt);
+}
+
+static const struct i2c_eeprom m_eeprom = {
+  .xfer = eeprom_bic_xfer,
+  .priv = &m_slot_id,
+  .addr_width = 2,
+  .page_size = EEPROM_PAGE,
+  .max_write = EEPROM_XFER,
+  .max_read = EEPROM_XFER,
+};
+
 
 static void
 print_usage_help(void) {
@@ -185,9 +228,9 @@ check_info_rec(uint8_t slot_id) {
 
 static int
 is_ih_exist(uint8_t slot_id, uint8_t info_type, uint8_t idx, uint16_t *checksum, int *fsize) {
-  uint8_t wbuf[32], rbuf[64];
+  uint8_t rbuf[64];
   char *magic_tag;
-  int ret, offset;
+  int offset;
   info_hdr *ih;
 
   if (info_type == TYPE_MFG) {
@@ -198,10 +241,7 @@ is_ih_exist(uint8_t slot_id, uint8_t info_type, uint8_t idx, uint16_t *checksum,
   }
 
   offset = m_info_rec[idx].offset;
-  wbuf[0] = (offset >> 8) & 0xFF;
-  wbuf[1] = offset & 0xFF;
-  ret = bic_master_write_read(slot_id, EEPROM_BUS, EEPROM_ADDR, wbuf, 2, rbuf, BLOCK_SIZE);
-  if (ret != 0) {
+  if (i2c_eeprom_read(&m_eeprom, offset, rbuf, BLOCK_SIZE) != 0) {
     printf("read failed 0x%x, len = %d\n", offset, BLOCK_SIZE);
     return 0;
   }
@@ -222,48 +262,341 @@ is_ih_exist(uint8_t slot_id, uint8_t info_type, uint8_t idx, uint16_t *checksum,
 }
 
 static int
-util_create_default_reason(char *buf_data) {
-  FILE *f = fopen(DEFAULT_REASON_FILE_NAME, "w");
-  if (f == NULL) {
-      printf("Error creating default reason file!\n");
-      return -1;
+ss_reserve(ss_buf *ss, size_t len) {
+  uint8_t *data;
+  size_t size;
+
+  if (ss->len + len <= ss->size) {
+    return 0;
+  }
+  size = ss->size ? ss->size : 4096;
+  while (size < ss->len + len) {
+    size *= 2;
+  }
+  data = realloc(ss->data, size);
+  if (data == NULL) {
+    return -1;
   }
+  ss->data = data;
+  ss->size = size;
+  return 0;
+}
 
-  // store at most MAX_REASON_DESC characters to file
-  fprintf(f, "%.*s\n", MAX_REASON_DESC, buf_data);
+static int
+ss_append(ss_buf *ss, const void *data, size_t len) {
+  if (ss_reserve(ss, len)) {
+    return -1;
+  }
+  memcpy(ss->data + ss->len, data, len);
+  ss->len += len;
+  return 0;
+}
 
-  fclose(f);
+static int
+ss_printf(ss_buf *ss, const char *fmt, ...) {
+  va_list ap;
+  int len;
+
+  va_start(ap, fmt);
+  len = vsnprintf(NULL, 0, fmt, ap);
+  va_end(ap);
+  if (len < 0 || ss_reserve(ss, len + 1)) {
+    return -1;
+  }
+  va_start(ap, fmt);
+  vsnprintf((char *)ss->data + ss->len, len + 1, fmt, ap);
+  va_end(ap);
+  ss->len += len;
   return 0;
 }
 
+/*
+ * Append a regular file to the ustar archive in <tar>.
+ */
+static int
+tar_add_file(ss_buf *tar, const char *name, const ss_buf *file, time_t mtime) {
+  uint8_t hdr[TAR_BLOCK] = {0};
+  unsigned int sum = 0;
+  size_t pad;
+  int i;
+
+  snprintf((char *)&hdr[0], 100, "./%s", name);
+  snprintf((char *)&hdr[100], 8, "%07o", 0644);
+  snprintf((char *)&hdr[108], 8, "%07o", 0);
+  snprintf((char *)&hdr[116], 8, "%07o", 0);
+  snprintf((char *)&hdr[124], 12, "%011o", (unsigned int)file->len);
+  snprintf((char *)&hdr[136], 12, "%011lo", (unsigned long)mtime);
+  hdr[156] = '0';
+  memcpy(&hdr[257], "ustar", 6);
+  memcpy(&hdr[263], "00", 2);
+  snprintf((char *)&hdr[265], 32, "root");
+  snprintf((char *)&hdr[297], 32, "root");
+
+  memset(&hdr[148], ' ', 8);
+  for (i = 0; i < TAR_BLOCK; i++) {
+    sum += hdr[i];
+  }
+  snprintf((char *)&hdr[148], 8, "%06o", sum);
+
+  pad = (TAR_BLOCK - file->len % TAR_BLOCK) % TAR_BLOCK;
+  if (ss_append(tar, hdr, TAR_BLOCK) || ss_append(tar, file->data, file->len) ||
+      ss_reserve(tar, pad)) {
+    return -1;
+  }
+  memset(tar->data + tar->len, 0, pad);
+  tar->len += pad;
+  return 0;
+}
 
+/*
+ * The last MAX_LOG_LINES critical log lines of the slot and the shared
+ * FRUs. The lines come from log-util itself so the format stays the one
+ * of "log-util all --print"; only the egrep and tail stages of the former
+ * shell pipeline are done here.
+ */
 static int
-util_store_snapshot(uint8_t slot_id, uint8_t info_type, char *cmdline_opt) {
-  uint8_t wbuf[64], rbuf[64], ih_buf[IH_SIZE], ih_offs, idx, max_idx;
-  uint16_t sum;
-  char cmd[256], *magic_tag;
-  int ret, fsize, offset, len, i;
-  info_hdr *ih = (info_hdr *)ih_buf;
-  struct stat st = {0};
+get_logs(uint8_t slot_id, ss_buf *out) {
+  char *ring[MAX_LOG_LINES] = {NULL};
+  char pattern[64], *line = NULL;
+  regex_t sel_re;
+  size_t line_size = 0;
+  ssize_t len;
+  char *argv[] = {"log-util", "all", "--print", NULL};
+  posix_spawn_file_actions_t actions;
+  int i, head = 0, count = 0, ret = 0, status, pipefd[2];
+  pid_t pid;
+  FILE *fp;
+
+  snprintf(pattern, sizeof(pattern), "(slot%u|spb|nic|all)", slot_id);
+  if (regcomp(&sel_re, pattern, REG_EXTENDED | REG_NOSUB)) {
+    return -1;
+  }
+
+  // run log-util directly, without a shell, and read its output
+  if (pipe2(pipefd, O_CLOEXEC)) {
+    regfree(&sel_re);
+    return -1;
+  }
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, pipefd[1], STDOUT_FILENO);
+  ret = posix_spawn(&pid, LOG_UTIL_PATH, &actions, NULL, argv, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  close(pipefd[1]);
+  fp = ret ? NULL : fdopen(pipefd[0], "r");
+  if (fp == NULL) {
+    syslog(LOG_WARNING, "%s: cannot run %s", __func__, LOG_UTIL_PATH);
+    close(pipefd[0]);
+    if (ret == 0) {
+      waitpid(pid, NULL, 0);
+    }
+    regfree(&sel_re);
+    return -1;
+  }
+  while ((len = getline(&line, &line_size, fp)) > 0) {
+    if (regexec(&sel_re, line, 0, NULL, 0)) {
+      continue;
+    }
+    free(ring[head]);
+    ring[head] = line;
+    line = NULL;
+    line_size = 0;
+    head = (head + 1) % MAX_LOG_LINES;
+    if (count < MAX_LOG_LINES) {
+      count++;
+    }
+  }
+  free(line);
+  fclose(fp);
+  if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+      WEXITSTATUS(status) != 0) {
+    syslog(LOG_WARNING, "%s: %s failed", __func__, LOG_UTIL_PATH);
+  }
+  regfree(&sel_re);
+
+  for (i = 0; i < count; i++) {
+    line = ring[(head - count + i + MAX_LOG_LINES) % MAX_LOG_LINES];
+    if (ret == 0 && ss_append(out, line, strlen(line))) {
+      ret = -1;
+    }
+  }
+  for (i = 0; i < MAX_LOG_LINES; i++) {
+    free(ring[i]);
+  }
+  return ret;
+}
+
+#if defined(CONFIG_FBY2_ND)
+/*
+ * Northdome servers keep 32-bit POST codes, printed as bic-util does.
+ */
+static int
+get_dword_postcodes(uint8_t slot_id, ss_buf *out) {
+  uint32_t *buf;
+  uint32_t len = 0, i;
+  int ret;
+
+  buf = calloc(MAX_POSTCODE_NUM, sizeof(uint32_t));
+  if (buf == NULL) {
+    return -1;
+  }
+
+  ret = bic_request_post_buffer_dword_data(slot_id, buf, MAX_POSTCODE_NUM, &len);
+  if (ret) {
+    ret = ss_printf(out, "bic_request_post_buffer_dword_data returns %d\n", ret);
+    free(buf);
+    return ret;
+  }
+
+  ret = ss_printf(out, "%u dword\n", len);
+  for (i = 0; i < len && !ret; i++) {
+    if (!(i % 4) && i) {
+      ret = ss_printf(out, "\n");
+    }
+    if (!ret) {
+      ret = ss_printf(out, "[%08X] ", buf[i]);
+    }
+  }
+  if (!ret) {
+    ret = ss_printf(out, "\n");
+  }
+  free(buf);
+  return ret;
+}
+#endif
+
+static int
+get_postcodes(uint8_t slot_id, ss_buf *out) {
+  uint8_t buf[MAX_POST_LEN] = {0};
+  uint8_t len = 0;
+  int ret, i;
+
+#if defined(CONFIG_FBY2_ND)
+  uint8_t server_type = 0xFF;
+
+  if (fby2_get_server_type(slot_id, &server_type) < 0) {
+    return ss_printf(out, "Cannot get server type. 0x%x\n", server_type);
+  }
+  if (server_type == SERVER_TYPE_ND) {
+    return get_dword_postcodes(slot_id, out);
+  }
+#endif
+
+  ret = bic_get_post_buf(slot_id, buf, &len);
+  if (ret) {
+    return ss_printf(out, "bic_get_post_buf returns %d\n", ret);
+  }
+
+  ret = ss_printf(out, "%u bytes\n", len);
+  for (i = 0; i < len && !ret; i++) {
+    ret = ss_printf(out, "%02X%s", buf[i], ((i % 16) == 15 || i == len - 1) ? "\n" : " ");
+  }
+  return ret;
+}
+
+static int
+get_reason(const char *cmdline_opt, ss_buf *out, const char **name) {
+  char buf[MAX_REASON_DESC + 1];
+  struct stat st;
+  size_t len;
   FILE *fp;
-  char *reason_file = cmdline_opt;
 
   // check if user specified a file containing "reason string"
   if (stat(cmdline_opt, &st) != 0) {
-    // file doesn't exist, treat it as stdin and create a file instead
     printf("Reason file doesn't exist, assume stdin\n");
-    ret = util_create_default_reason(reason_file);
-    if (!ret) {
-      reason_file = DEFAULT_REASON_FILE_NAME;
-    } else {
-      return ret;
-    }
+    *name = DEFAULT_REASON_FILE_NAME;
+    // store at most MAX_REASON_DESC characters
+    return ss_printf(out, "%.*s\n", MAX_REASON_DESC, cmdline_opt);
   }
 
   if (st.st_size > MAX_REASON_DESC) {
-    printf("%s is too large\n", reason_file);
+    printf("%s is too large\n", cmdline_opt);
+    return -1;
+  }
+
+  fp = fopen(cmdline_opt, "rb");
+  if (fp == NULL) {
+    printf("unable to get the %s fp %s\n", cmdline_opt, strerror(errno));
     return -1;
   }
+  len = fread(buf, 1, sizeof(buf), fp);
+  fclose(fp);
+  *name = cmdline_opt;
+  return ss_append(out, buf, len);
+}
+
+/*
+ * Build the gzip'ed tarball of the reason, the logs and the POST codes.
+ */
+static int
+build_snapshot(uint8_t slot_id, char *cmdline_opt, ss_buf *tgz) {
+  ss_buf reason = {0}, logs = {0}, post = {0}, tar = {0};
+  const char *reason_name = NULL;
+  char *reason_path = NULL;
+  time_t now = time(NULL);
+  z_stream strm;
+  int ret = -1;
+
+  do {
+    if (get_reason(cmdline_opt, &reason, &reason_name)) {
+      break;
+    }
+
+    printf("Getting logs...\n");
+    if (get_logs(slot_id, &logs)) {
+      syslog(LOG_WARNING, "%s: cannot read logs", __func__);
+    }
+
+    printf("Getting POST codes...\n");
+    if (get_postcodes(slot_id, &post)) {
+      break;
+    }
+
+    reason_path = strdup(reason_name);
+    if (reason_path == NULL ||
+        tar_add_file(&tar, basename(reason_path), &reason, now) ||
+        tar_add_file(&tar, SS_LOG_FILE, &logs, now) ||
+        tar_add_file(&tar, SS_POST_FILE, &post, now) ||
+        ss_reserve(&tar, 2 * TAR_BLOCK)) {
+      break;
+    }
+    // end of archive
+    memset(tar.data + tar.len, 0, 2 * TAR_BLOCK);
+    tar.len += 2 * TAR_BLOCK;
+
+    memset(&strm, 0, sizeof(strm));
+    if (deflateInit2(&strm, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+      break;
+    }
+    if (ss_reserve(tgz, deflateBound(&strm, tar.len)) == 0) {
+      strm.next_in = tar.data;
+      strm.avail_in = tar.len;
+      strm.next_out = tgz->data;
+      strm.avail_out = tgz->size;
+      if (deflate(&strm, Z_FINISH) == Z_STREAM_END) {
+        tgz->len = strm.total_out;
+        ret = 0;
+      }
+    }
+    deflateEnd(&strm);
+  } while (0);
+
+  free(reason_path);
+  free(reason.data);
+  free(logs.data);
+  free(post.data);
+  free(tar.data);
+  return ret;
+}
+
+static int
+util_store_snapshot(uint8_t slot_id, uint8_t info_type, char *cmdline_opt) {
+  uint8_t ih_buf[IH_SIZE], idx, max_idx;
+  uint16_t sum;
+  char *magic_tag;
+  int ret, fsize, offset, i;
+  info_hdr *ih = (info_hdr *)ih_buf;
+  ss_buf tgz = {0};
 
   max_idx = (info_type == TYPE_MFG) ? MAX_MFI_NUM : MAX_RI_NUM;
   for (idx = 0; idx < max_idx; idx++) {
@@ -275,34 +608,11 @@ util_store_snapshot(uint8_t slot_id, uint8_t info_type, char *cmdline_opt) {
     return -1;
   }
 
-  snprintf(cmd, sizeof(cmd), "rm -rf %s", TMP_SS_PATH);
-  log_system(cmd);
-  mkdir(TMP_SS_PATH, 0755);
-
-  snprintf(cmd, sizeof(cmd), "cp %s %s/", reason_file, TMP_SS_PATH);
-  log_system(cmd);
-
-  printf("Getting logs...\n");
-  snprintf(cmd, sizeof(cmd), "/usr/local/bin/log-util all --print | egrep '(slot%u|spb|nic|all)' | /usr/bin/tail -n 50 > %s",
-           slot_id, TMP_LOG_FILE);
-  log_system(cmd);
-
-  printf("Getting POST codes...\n");
-  snprintf(cmd, sizeof(cmd), "/usr/bin/bic-util slot%u --get_post_code > %s", slot_id, TMP_POST_FILE);
-  log_system(cmd);
-
-  if (chdir(TMP_SS_PATH)) {
-    syslog(LOG_WARNING, "chdir failed, dir path: %s", TMP_SS_PATH);
+  if (build_snapshot(slot_id, cmdline_opt, &tgz)) {
+    printf("unable to build the snapshot\n");
+    free(tgz.data);
     return -1;
   }
-  snprintf(cmd, sizeof(cmd), "tar czf %s ./*", TMP_TARBALL);
-  log_system(cmd);
-
-  fp = fopen(TMP_TARBALL, "rb");
-  if (fp == NULL) {
-    printf("unable to get the %s fp %s\n", TMP_TARBALL, strerror(errno));
-    return errno;
-  }
 
   if (info_type == TYPE_MFG) {
     idx = MAX_RI_NUM;
@@ -311,38 +621,32 @@ util_store_snapshot(uint8_t slot_id, uint8_t info_type, char *cmdline_opt) {
     magic_tag = RIH_MAGIC_TAG;
   }
 
-  fseek(fp, 0L, SEEK_END);
-  fsize = ftell(fp);
+  fsize = tgz.len;
   printf("File Size: %d\n", fsize);
   if ((fsize + IH_SIZE) > m_info_rec[idx].size) {
     printf("file is too large\n");
-    fclose(fp);
+    free(tgz.data);
     return -1;
   }
   printf("Storing to EEPROM...\n");
 
   sum = 0;
-  rewind(fp);
-  offset = m_info_rec[idx].offset + IH_SIZE;
-  while ((len = fread(&wbuf[2], 1, BLOCK_SIZE, fp)) > 0) {
-    wbuf[0] = (offset >> 8) & 0xFF;
-    wbuf[1] = offset & 0xFF;
-    ret = bic_master_write_read(slot_id, EEPROM_BUS, EEPROM_ADDR, wbuf, 2+len, rbuf, 0);
-    if (ret != 0) {
-      printf("write failed 0x%x, len = %d\n", offset, len);
-      fclose(fp);
-      return ret;
-    }
-
-    for (i = 0; i < len; i++) {
-      sum += wbuf[i+2];
-    }
+  for (i = 0; i < fsize; i++) {
+    sum += tgz.data[i];
+  }
 
-    offset += len;
-    msleep(10);
+  offset = m_info_rec[idx].offset + IH_SIZE;
+  ret = i2c_eeprom_write(&m_eeprom, offset, tgz.data, fsize);
+  if (ret == 0) {
+    ret = i2c_eeprom_verify(&m_eeprom, offset, tgz.data, fsize);
+  }
+  free(tgz.data);
+  if (ret != 0) {
+    printf("write failed 0x%x, len = %d: %s\n", offset, fsize, strerror(errno));
+    return ret;
   }
-  fclose(fp);
 
+  // the header goes last, so an interrupted store leaves the area empty
   memset(ih_buf, 0x00, IH_SIZE);
   memcpy(ih->magic_tag, magic_tag, 8);
   ih->version = 0x01;
@@ -350,27 +654,13 @@ util_store_snapshot(uint8_t slot_id, uint8_t info_type, char *cmdline_opt) {
   ih->size = fsize;
 
   offset = m_info_rec[idx].offset;
-  ih_offs = 0;
-  fsize = IH_SIZE;
-  while (fsize > 0) {
-    if (ih_offs) {
-      msleep(10);
-    }
-
-    wbuf[0] = (offset >> 8) & 0xFF;
-    wbuf[1] = offset & 0xFF;
-    len = (fsize > BLOCK_SIZE) ? BLOCK_SIZE : fsize;
-    memcpy(&wbuf[2], &ih_buf[ih_offs], len);
-    ret = bic_master_write_read(slot_id, EEPROM_BUS, EEPROM_ADDR, wbuf, 2+len, rbuf, 0);
-    if (ret != 0) {
-      printf("write failed 0x%x, len = %d\n", offset, len);
-      fclose(fp);
-      return ret;
-    }
-
-    offset += len;
-    ih_offs += len;
-    fsize -= len;
+  ret = i2c_eeprom_write(&m_eeprom, offset, ih_buf, IH_SIZE);
+  if (ret == 0) {
+    ret = i2c_eeprom_verify(&m_eeprom, offset, ih_buf, IH_SIZE);
+  }
+  if (ret != 0) {
+    printf("write failed 0x%x, len = %d: %s\n", offset, IH_SIZE, strerror(errno));
+    return ret;
   }
 
   return 0;
@@ -379,9 +669,9 @@ util_store_snapshot(uint8_t slot_id, uint8_t info_type, char *cmdline_opt) {
 static int
 util_dump_snapshot(uint8_t slot_id, uint8_t info_type, uint8_t idx, char *dump_file) {
   FILE *fp;
-  uint8_t wbuf[32], rbuf[64];
+  uint8_t *rbuf;
   uint16_t checksum = 0, sum;
-  int ret, fsize = 0, offset, len, i;
+  int ret, fsize = 0, offset, i;
 
   if (is_ih_exist(slot_id, info_type, idx, &checksum, &fsize) != 1) {
     printf("no data to read\n");
@@ -398,32 +688,32 @@ util_dump_snapshot(uint8_t slot_id, uint8_t info_type, uint8_t idx, char *dump_f
   }
   printf("Dumping from EEPROM...\n");
 
-  sum = 0;
   offset = m_info_rec[idx].offset + IH_SIZE;
-  while (fsize > 0) {
-    len = (fsize > BLOCK_SIZE) ? BLOCK_SIZE : fsize;
-    wbuf[0] = (offset >> 8) & 0xFF;
-    wbuf[1] = offset & 0xFF;
-    ret = bic_master_write_read(slot_id, EEPROM_BUS, EEPROM_ADDR, wbuf, 2, rbuf, len);
-    if (ret != 0) {
-      printf("read failed 0x%x, len = %d\n", offset, len);
-      fclose(fp);
-      return ret;
-    }
-
-    if ((ret = fwrite(rbuf, 1, len, fp)) != len) {
-      printf("write file failed 0x%x, len = (%d / %d)\n", offset, ret, len);
-      fclose(fp);
-      return ret;
-    }
+  if (fsize < 0 || (fsize + IH_SIZE) > m_info_rec[idx].size ||
+      (rbuf = malloc(fsize ? fsize : 1)) == NULL) {
+    printf("invalid file size %d\n", fsize);
+    fclose(fp);
+    return -1;
+  }
+  if (i2c_eeprom_read(&m_eeprom, offset, rbuf, fsize) != 0) {
+    printf("read failed 0x%x, len = %d\n", offset, fsize);
+    free(rbuf);
+    fclose(fp);
+    return -1;
+  }
 
-    for (i = 0; i < len; i++) {
-      sum += rbuf[i];
-    }
+  if ((ret = fwrite(rbuf, 1, fsize, fp)) != fsize) {
+    printf("write file failed, len = (%d / %d)\n", ret, fsize);
+    free(rbuf);
+    fclose(fp);
+    return -1;
+  }
 
-    offset += len;
-    fsize -= len;
+  sum = 0;
+  for (i = 0; i < fsize; i++) {
+    sum += rbuf[i];
   }
+  free(rbuf);
   fclose(fp);
 
   if (checksum != sum) {
@@ -462,31 +752,13 @@ util_dump_snapshot_all(uint8_t slot_id, char *dump_file) {
 
 static int
 util_clear_snapshot(uint8_t slot_id, uint8_t idx) {
-  uint8_t wbuf[64], rbuf[64], ih_buf[IH_SIZE], ih_offs;
-  int ret, fsize, offset, len;
+  uint8_t ih_buf[IH_SIZE];
+  int offset = m_info_rec[idx].offset;
 
   memset(ih_buf, 0xff, IH_SIZE);
-  offset = m_info_rec[idx].offset;
-  ih_offs = 0;
-  fsize = IH_SIZE;
-  while (fsize > 0) {
-    if (ih_offs) {
-      msleep(10);
-    }
-
-    wbuf[0] = (offset >> 8) & 0xFF;
-    wbuf[1] = offset & 0xFF;
-    len = (fsize > BLOCK_SIZE) ? BLOCK_SIZE : fsize;
-    memcpy(&wbuf[2], &ih_buf[ih_offs], len);
-    ret = bic_master_write_read(slot_id, EEPROM_BUS, EEPROM_ADDR, wbuf, 2+len, rbuf, 0);
-    if (ret != 0) {
-      printf("write failed 0x%x, len = %d\n", offset, len);
-      return ret;
-    }
-
-    offset += len;
-    ih_offs += len;
-    fsize -= len;
+  if (i2c_eeprom_write(&m_eeprom, offset, ih_buf, IH_SIZE) != 0) {
+    printf("write failed 0x%x, len = %d\n", offset, IH_SIZE);
+    return -1;
   }
 
   return 0;
@@ -526,6 +798,7 @@ main(int argc, char **argv) {
     goto err_exit;
   }
 
+  m_slot_id = slot_id;
   check_info_rec(slot_id);
 
   if (!strcmp(argv[2], "--set")) {
@@ -1,3 +1,4 @@
+#include <stdlib.h>
 #include <unistd.h>
 
 #include "ast-jtag-intf.h"
@@ -17,6 +18,11 @@ void __attribute__((constructor)) ast_jtag_init(void)
   }
 }
 
+void ast_jtag_set_ops(struct jtag_ops *ops)
+{
+  jtag_ops = ops;
+}
+
 
 void ast_jtag_set_mode(unsigned int mode)
 {
@@ -62,3 +68,148 @@ int ast_jtag_tdo_xfer(unsigned char enddr, unsigned int len, unsigned int *tdio)
 {
   return jtag_ops->tdo_xfer(enddr, len, tdio);
 }
+
+/*
+ * Generic batch execution for backends without a native one: idle cycles
+ * queued back to back are merged, everything else is issued in order.
+ */
+static int ast_jtag_scan_each(struct jtag_scan_op *ops, unsigned int count)
+{
+  unsigned int i, tck;
+  unsigned char end;
+  int ret = 0;
+
+  for (i = 0; i < count && !ret; i++) {
+    switch (ops[i].type) {
+      case JTAG_SCAN_IR:
+        ret = jtag_ops->sir_xfer(ops[i].end, ops[i].len, ops[i].tdi);
+        break;
+      case JTAG_SCAN_DR_WRITE:
+        ret = jtag_ops->tdi_xfer(ops[i].end, ops[i].len, ops[i].tdio);
+        break;
+      case JTAG_SCAN_DR_READ:
+        ret = jtag_ops->tdo_xfer(ops[i].end, ops[i].len, ops[i].tdio);
+        break;
+      case JTAG_SCAN_IDLE:
+        tck = ops[i].len;
+        end = ops[i].end;
+        while (i + 1 < count && ops[i+1].type == JTAG_SCAN_IDLE) {
+          tck += ops[++i].len;
+          end = ops[i].end;
+        }
+        // the driver counts tck in a byte
+        while (tck > 0 && !ret) {
+          unsigned char n = (tck > 255) ? 255 : tck;
+          ret = jtag_ops->run_test_idle(0, end, n);
+          tck -= n;
+        }
+        break;
+      default:
+        ret = -1;
+        break;
+    }
+  }
+
+  return ret;
+}
+
+int ast_jtag_queue_init(struct jtag_scan_queue *q, unsigned int size)
+{
+  q->ops = calloc(size, sizeof(struct jtag_scan_op));
+  if (q->ops == NULL) {
+    return -1;
+  }
+
+  q->count = 0;
+  q->size = size;
+  return 0;
+}
+
+void ast_jtag_queue_free(struct jtag_scan_queue *q)
+{
+  free(q->ops);
+  q->ops = NULL;
+  q->count = q->size = 0;
+}
+
+static int ast_jtag_queue_add(struct jtag_scan_queue *q, unsigned char type,
+                              unsigned char end, unsigned int len,
+                              unsigned int tdi, unsigned int *tdio)
+{
+  struct jtag_scan_op *op;
+
+  if (q->ops == NULL) {
+    return -1;
+  }
+
+  // a full queue is submitted first, so callers may queue without bound
+  if (q->count >= q->size && ast_jtag_queue_flush(q) < 0) {
+    return -1;
+  }
+
+  op = &q->ops[q->count++];
+  op->type = type;
+  op->end = end;
+  op->len = len;
+  op->tdi = tdi;
+  op->tdio = tdio;
+  return 0;
+}
+
+int ast_jtag_queue_sir(struct jtag_scan_queue *q, unsigned char endir, unsigned int len, unsigned int tdi)
+{
+  if (len > 32) {
+    return -1;
+  }
+
+  return ast_jtag_queue_add(q, JTAG_SCAN_IR, endir, len, tdi, NULL);
+}
+
+int ast_jtag_queue_tdi(struct jtag_scan_queue *q, unsigned char enddr, unsigned int len, unsigned int *tdio)
+{
+  if (tdio == NULL) {
+    return -1;
+  }
+
+  return ast_jtag_queue_add(q, JTAG_SCAN_DR_WRITE, enddr, len, 0, tdio);
+}
+
+int ast_jtag_queue_tdo(struct jtag_scan_queue *q, unsigned char enddr, unsigned int len, unsigned int *tdio)
+{
+  if (tdio == NULL) {
+    return -1;
+  }
+
+  return ast_jtag_queue_add(q, JTAG_SCAN_DR_READ, enddr, len, 0, tdio);
+}
+
+int ast_jtag_queue_idle(struct jtag_scan_queue *q, unsigned char end, unsigned int tck)
+{
+  if (tck == 0) {
+    return 0;
+  }
+
+  return ast_jtag_queue_add(q, JTAG_SCAN_IDLE, end, tck, 0, NULL);
+}
+
+/*
+ * Submit everything queued so far. Read buffers of queued DR reads are
+ * filled when this returns.
+ */
+int ast_jtag_queue_flush(struct jtag_scan_queue *q)
+{
+  int ret;
+
+  if (q->count == 0) {
+    return 0;
+  }
+
+  if (jtag_ops->scan_batch) {
+    ret = jtag_ops->scan_batch(q->ops, q->count);
+  } else {
+    ret = ast_jtag_scan_each(q->ops, q->count);
+  }
+
+  q->count = 0;
+  return ret;
+}
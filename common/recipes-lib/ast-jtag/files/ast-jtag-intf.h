@@ -1,6 +1,8 @@
 #ifndef _AST_JTAG_INTF_H_
 #define _AST_JTAG_INTF_H_
 
+#include "ast-jtag.h"
+
 struct jtag_ops {
   int (*open)();
   void (*close)();
@@ -11,6 +13,10 @@ struct jtag_ops {
   int (*sir_xfer)(unsigned char,unsigned int, unsigned int);
   int (*tdo_xfer)(unsigned char, unsigned int, unsigned int*);
   int (*tdi_xfer)(unsigned char, unsigned int, unsigned int*);
+  int (*scan_batch)(struct jtag_scan_op*, unsigned int);  // optional
 };
 
+void ast_jtag_init(void);
+void ast_jtag_set_ops(struct jtag_ops *ops);
+
 #endif
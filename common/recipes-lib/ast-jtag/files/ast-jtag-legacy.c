@@ -260,6 +260,7 @@ struct jtag_ops astjtag_ops = {
   _ast_jtag_run_test_idle,
   _ast_jtag_sir_xfer,
   _ast_jtag_tdo_xfer,
-  _ast_jtag_tdi_xfer
+  _ast_jtag_tdi_xfer,
+  NULL
 };
 
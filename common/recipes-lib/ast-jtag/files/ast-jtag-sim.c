@@ -0,0 +1,230 @@
+/*
+ * ast-jtag software TAP simulator
+ *
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "ast-jtag-intf.h"
+#include "ast-jtag.h"
+
+/*
+ * The TAP is tracked at the granularity the driver API exposes: every scan
+ * passes through Shift-IR/Shift-DR and finishes in the requested end state.
+ * End states follow the driver convention, TLRESET/IDLE park in
+ * Run-Test/Idle and anything else parks in the matching Pause state.
+ */
+static struct jtag_sim_device *sim_dev = NULL;
+static struct jtag_sim_stats sim_stats;
+static unsigned int sim_ir = 0;
+static unsigned int sim_state = JTAG_STATE_TLRESET;
+static unsigned int sim_freq = 1000000;
+static int sim_opened = 0;
+
+static unsigned int sim_end_state(unsigned char end, unsigned int pause)
+{
+  if (end == JTAG_STATE_TLRESET || end == JTAG_STATE_IDLE) {
+    return JTAG_STATE_IDLE;
+  }
+
+  return pause;
+}
+
+static int _sim_jtag_open(void)
+{
+  if (sim_dev == NULL) {
+    return -1;
+  }
+
+  sim_opened = 1;
+  return 0;
+}
+
+static void _sim_jtag_close(void)
+{
+  sim_opened = 0;
+}
+
+static void _sim_jtag_set_mode(unsigned int mode)
+{
+}
+
+static unsigned int _sim_get_jtag_freq(void)
+{
+  return sim_freq;
+}
+
+static int _sim_set_jtag_freq(unsigned int freq)
+{
+  sim_freq = freq;
+  return 0;
+}
+
+static int _sim_jtag_run_test_idle(unsigned char reset, unsigned char end, unsigned char tck)
+{
+  if (!sim_opened) {
+    return -1;
+  }
+
+  sim_stats.ops++;
+  if (reset) {
+    sim_state = JTAG_STATE_TLRESET;
+    if (sim_dev->reset) {
+      sim_dev->reset(sim_dev->priv);
+    }
+  }
+
+  if (tck) {
+    sim_stats.idle_tck += tck;
+    if (sim_dev->run_idle) {
+      sim_dev->run_idle(sim_dev->priv, tck);
+    }
+  }
+
+  sim_state = sim_end_state(end, JTAG_STATE_PAUSEDR);
+  return 0;
+}
+
+static int _sim_jtag_sir_xfer(unsigned char endir, unsigned int len, unsigned int tdi)
+{
+  if (!sim_opened || len > 32) {
+    return -1;
+  }
+
+  sim_stats.ops++;
+  sim_stats.ir_scans++;
+  sim_ir = (len < 32) ? (tdi & ((1U << len) - 1)) : tdi;
+  if (sim_dev->update_ir) {
+    sim_dev->update_ir(sim_dev->priv, sim_ir);
+  }
+
+  sim_state = sim_end_state(endir, JTAG_STATE_PAUSEIR);
+  return 0;
+}
+
+static int sim_shift_dr(unsigned char enddr, unsigned int len,
+                        const unsigned int *tdi, unsigned int *tdo)
+{
+  if (!sim_opened) {
+    return -1;
+  }
+
+  sim_stats.ops++;
+  sim_stats.dr_scans++;
+  if (tdo) {
+    memset(tdo, 0, ((len + 31) / 32) * sizeof(unsigned int));
+  }
+  if (sim_dev->shift_dr) {
+    sim_dev->shift_dr(sim_dev->priv, sim_ir, len, tdi, tdo);
+  }
+
+  sim_state = sim_end_state(enddr, JTAG_STATE_PAUSEDR);
+  return 0;
+}
+
+static int _sim_jtag_tdi_xfer(unsigned char enddr, unsigned int len, unsigned int *tdio)
+{
+  if (tdio == NULL) {
+    return -1;
+  }
+
+  return sim_shift_dr(enddr, len, tdio, NULL);
+}
+
+static int _sim_jtag_tdo_xfer(unsigned char enddr, unsigned int len, unsigned int *tdio)
+{
+  if (tdio == NULL) {
+    return -1;
+  }
+
+  return sim_shift_dr(enddr, len, NULL, tdio);
+}
+
+static int _sim_jtag_scan_batch(struct jtag_scan_op *ops, unsigned int count)
+{
+  unsigned int i, tck;
+  int ret = 0;
+
+  sim_stats.batches++;
+  for (i = 0; i < count && !ret; i++) {
+    switch (ops[i].type) {
+      case JTAG_SCAN_IR:
+        ret = _sim_jtag_sir_xfer(ops[i].end, ops[i].len, ops[i].tdi);
+        break;
+      case JTAG_SCAN_DR_WRITE:
+        ret = _sim_jtag_tdi_xfer(ops[i].end, ops[i].len, ops[i].tdio);
+        break;
+      case JTAG_SCAN_DR_READ:
+        ret = _sim_jtag_tdo_xfer(ops[i].end, ops[i].len, ops[i].tdio);
+        break;
+      case JTAG_SCAN_IDLE:
+        for (tck = ops[i].len; tck > 0 && !ret; ) {
+          unsigned char n = (tck > 255) ? 255 : tck;
+          ret = _sim_jtag_run_test_idle(0, ops[i].end, n);
+          tck -= n;
+        }
+        break;
+      default:
+        ret = -1;
+        break;
+    }
+  }
+
+  return ret;
+}
+
+struct jtag_ops simjtag_ops = {
+  _sim_jtag_open,
+  _sim_jtag_close,
+  _sim_jtag_set_mode,
+  _sim_get_jtag_freq,
+  _sim_set_jtag_freq,
+  _sim_jtag_run_test_idle,
+  _sim_jtag_sir_xfer,
+  _sim_jtag_tdo_xfer,
+  _sim_jtag_tdi_xfer,
+  _sim_jtag_scan_batch
+};
+
+/*
+ * ast_jtag_sim_attach
+ *
+ * Route all ast_jtag_* calls to the simulator with @dev as the only
+ * device in the chain.
+ */
+void ast_jtag_sim_attach(struct jtag_sim_device *dev)
+{
+  sim_dev = dev;
+  sim_ir = 0;
+  sim_state = JTAG_STATE_TLRESET;
+  memset(&sim_stats, 0, sizeof(sim_stats));
+  ast_jtag_set_ops(&simjtag_ops);
+}
+
+void ast_jtag_sim_detach(void)
+{
+  sim_dev = NULL;
+  sim_opened = 0;
+  ast_jtag_init();
+}
+
+void ast_jtag_sim_get_stats(struct jtag_sim_stats *stats)
+{
+  memcpy(stats, &sim_stats, sizeof(sim_stats));
+  stats->state = sim_state;
+}
@@ -7,6 +7,10 @@ typedef uint32_t __u32;
 typedef uint64_t __u64;
 #include "jtag.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /******************************************************************************************************************/
 void ast_jtag_set_mode(unsigned int mode);
 int ast_jtag_open(void);
@@ -18,4 +22,67 @@ int ast_jtag_sir_xfer(unsigned char endir, unsigned int len, unsigned int tdi);
 int ast_jtag_tdo_xfer(unsigned char enddr, unsigned int len, unsigned int *tdio);
 int ast_jtag_tdi_xfer(unsigned char enddr, unsigned int len, unsigned int *tdio);
 
+/******************************************************************************************************************/
+/* Scan queue: accumulate IR/DR shifts and idle cycles, then submit them as one batch */
+enum {
+  JTAG_SCAN_IR = 0,
+  JTAG_SCAN_DR_WRITE,
+  JTAG_SCAN_DR_READ,
+  JTAG_SCAN_IDLE,
+};
+
+struct jtag_scan_op {
+  unsigned char type;
+  unsigned char end;      // end state
+  unsigned int len;       // bits to shift, or tck cycles for JTAG_SCAN_IDLE
+  unsigned int tdi;       // instruction for JTAG_SCAN_IR
+  unsigned int *tdio;     // DR data, must stay valid until the queue is flushed
+};
+
+struct jtag_scan_queue {
+  struct jtag_scan_op *ops;
+  unsigned int count;
+  unsigned int size;
+};
+
+int ast_jtag_queue_init(struct jtag_scan_queue *q, unsigned int size);
+void ast_jtag_queue_free(struct jtag_scan_queue *q);
+int ast_jtag_queue_sir(struct jtag_scan_queue *q, unsigned char endir, unsigned int len, unsigned int tdi);
+int ast_jtag_queue_tdi(struct jtag_scan_queue *q, unsigned char enddr, unsigned int len, unsigned int *tdio);
+int ast_jtag_queue_tdo(struct jtag_scan_queue *q, unsigned char enddr, unsigned int len, unsigned int *tdio);
+int ast_jtag_queue_idle(struct jtag_scan_queue *q, unsigned char end, unsigned int tck);
+int ast_jtag_queue_flush(struct jtag_scan_queue *q);
+
+/******************************************************************************************************************/
+/* Software TAP simulator, replaces the driver backend for host-side testing */
+struct jtag_sim_device {
+  void *priv;
+  /* called on Update-IR with the shifted instruction */
+  void (*update_ir)(void *priv, unsigned int ir);
+  /* called on a DR scan; tdi is NULL for reads, tdo is NULL for writes */
+  void (*shift_dr)(void *priv, unsigned int ir, unsigned int len,
+                   const unsigned int *tdi, unsigned int *tdo);
+  /* called for Run-Test/Idle cycles */
+  void (*run_idle)(void *priv, unsigned int tck);
+  /* called when the TAP enters Test-Logic-Reset */
+  void (*reset)(void *priv);
+};
+
+struct jtag_sim_stats {
+  unsigned int batches;   // scan_batch submissions
+  unsigned int ops;       // individual operations executed
+  unsigned int ir_scans;
+  unsigned int dr_scans;
+  unsigned long idle_tck;
+  unsigned int state;     // TAP state after the last operation
+};
+
+void ast_jtag_sim_attach(struct jtag_sim_device *dev);
+void ast_jtag_sim_detach(void);
+void ast_jtag_sim_get_stats(struct jtag_sim_stats *stats);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
 #endif /* __AST_JTAG_H__ */
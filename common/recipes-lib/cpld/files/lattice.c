@@ -8,6 +8,11 @@
 
 #define MAX_RETRY 4000
 #define LATTICE_COL_SIZE 128
+#define LATTICE_QUEUE_SIZE 256
+#define LATTICE_BATCH_ROWS 64
+#define LATTICE_ROW_PROG_US 1000      // RUNTEST IDLE 1.00E-003 SEC per row in the SVF flow
+#define LATTICE_MIN_IDLE_TCK 15       // RUNTEST IDLE 15 TCK as in the SVF flow
+#define LATTICE_DEFAULT_FREQ 1000000
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
 
 typedef struct
@@ -133,100 +138,131 @@ ShiftData(char *data, unsigned int *result, int len)
   return ret;
 }
 
+/*
+ * All LCMXO2 scans go through one queue; helpers that need TDO data flush
+ * it, everything else is submitted together with the next read.
+ */
+static struct jtag_scan_queue lattice_q;
+
+/*convert a delay to Run-Test/Idle cycles at the current TCK rate*/
+static unsigned int
+LCMXO2Family_Delay_TCK(unsigned int usec)
+{
+  unsigned long long tck = ast_get_jtag_freq();
+
+  if (tck == 0)
+  {
+    tck = LATTICE_DEFAULT_FREQ;
+  }
+
+  tck = (tck * usec) / 1000000;
+  if (tck < LATTICE_MIN_IDLE_TCK)
+  {
+    tck = LATTICE_MIN_IDLE_TCK;
+  }
+
+  return (unsigned int)tck;
+}
+
 static unsigned int
 LCMXO2Family_Check_Device_Status(int mode)
 {
   int RETRY = MAX_RETRY;
   unsigned int buf[4] = {0};
+  unsigned int ins, len, shift, mask;
 
   switch (mode)
   {
     case CHECK_BUSY:
-//      ast_jtag_run_test_idle(0, JTAG_STATE_TLRESET, 3);
-      do
-      {
-	ast_jtag_sir_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_LSC_CHECK_BUSY);
-	usleep(1000);
-
-	buf[0] = 0x0;
-
-	ast_jtag_tdo_xfer(JTAG_STATE_TLRESET, 8, &buf[0]);
-
-	buf[0] = (buf[0] >> 7) & 0x1;
-
-	if (buf[0] == 0x0)
-	{
-	  break;
-	}
-	RETRY--;
-
-      } while ( RETRY );
+      ins = LCMXO2_LSC_CHECK_BUSY;
+      len = 8;
+      shift = 7;
+      mask = 0x1;
       break;
 
     case CHECK_STATUS:
-//      ast_jtag_run_test_idle(0, JTAG_STATE_TLRESET, 3);
-      do
-      {
-	ast_jtag_sir_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_LSC_READ_STATUS);
-	usleep(1000);
-
-	buf[0] = 0x0;
-
-	ast_jtag_tdo_xfer(JTAG_STATE_TLRESET, 32, &buf[0]);
-
-	buf[0] = (buf[0] >> 12) & 0x3;
-
-	if (buf[0] == 0x0)
-	{
-	  break;
-	}
-	RETRY--;
-      } while ( RETRY );
+      ins = LCMXO2_LSC_READ_STATUS;
+      len = 32;
+      shift = 12;
+      mask = 0x3;
       break;
 
     default:
+      return buf[0];
+  }
+
+  // the first poll rides on the batch already queued, only retries sleep
+  do
+  {
+    buf[0] = 0x0;
+    ast_jtag_queue_sir(&lattice_q, JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, ins);
+    ast_jtag_queue_idle(&lattice_q, JTAG_STATE_TLRESET, LATTICE_MIN_IDLE_TCK);
+    ast_jtag_queue_tdo(&lattice_q, JTAG_STATE_TLRESET, len, &buf[0]);
+    if (ast_jtag_queue_flush(&lattice_q) < 0)
+    {
+      return mask;
+    }
+
+    buf[0] = (buf[0] >> shift) & mask;
+    if (buf[0] == 0x0)
+    {
       break;
+    }
 
-  }
+    usleep(1000);
+    RETRY--;
+  } while ( RETRY );
 
   return buf[0];
 }
 
-/*write cf data*/
+/*
+ * Program rows with LSC_PROG_INCR_NV. Each row is followed by the row
+ * programming time of Run-Test/Idle and a busy check, which go to the
+ * driver together with the row in a single batch.
+ */
 static int
-LCMXO2Family_SendCFdata(CPLDInfo *dev_info)
+LCMXO2Family_SendRows(unsigned int *data, unsigned int lines, int verbose)
 {
-  int ret = 0;
-  int CurrentAddr = 0;
-  int i;
-  unsigned status;
+  unsigned int i, status, tck;
 
-  for (i = 0; i < dev_info->CF_Line; i++)
-  {
-    printf("Writing Data: %d/%d (%.2f%%) \r",(i+1), dev_info->CF_Line, (((i+1)/(float)dev_info->CF_Line)*100));
-
-    CurrentAddr = (i * LATTICE_COL_SIZE) / 32;
-
-    //RUNTEST    IDLE    15 TCK    1.00E-003 SEC;
-//    ast_jtag_run_test_idle(0, JTAG_STATE_TLRESET, 3);
+  tck = LCMXO2Family_Delay_TCK(LATTICE_ROW_PROG_US);
 
+  for (i = 0; i < lines; i++)
+  {
     //set page to program page
-    ast_jtag_sir_xfer(JTAG_STATE_PAUSEIR, LATTICE_INS_LENGTH, LCMXO2_LSC_PROG_INCR_NV);
+    ast_jtag_queue_sir(&lattice_q, JTAG_STATE_PAUSEIR, LATTICE_INS_LENGTH, LCMXO2_LSC_PROG_INCR_NV);
 
     //send data
-    ast_jtag_tdi_xfer(JTAG_STATE_TLRESET, LATTICE_COL_SIZE, &dev_info->CF[CurrentAddr]);
+    ast_jtag_queue_tdi(&lattice_q, JTAG_STATE_TLRESET, LATTICE_COL_SIZE, &data[(i * LATTICE_COL_SIZE) / 32]);
 
-    //usleep(1000);
+    //RUNTEST IDLE for the row programming time
+    ast_jtag_queue_idle(&lattice_q, JTAG_STATE_TLRESET, tck);
 
+    //the next row may only be shifted in once the device is ready
     status = LCMXO2Family_Check_Device_Status(CHECK_BUSY);
     if (status != 0)
     {
-      printf("[%s]Write CF Error, status = %x\n", __func__, status);
-      ret = -1;
-      break;
+      printf("[%s]Write Error at row %d, status = %x\n", __func__, i, status);
+      return -1;
+    }
+
+    if (verbose && ((((i + 1) % LATTICE_BATCH_ROWS) == 0) || ((i + 1) == lines)))
+    {
+      printf("Writing Data: %d/%d (%.2f%%) \r",(i+1), lines, (((i+1)/(float)lines)*100));
     }
   }
 
+  return 0;
+}
+
+/*write cf data*/
+static int
+LCMXO2Family_SendCFdata(CPLDInfo *dev_info)
+{
+  int ret;
+
+  ret = LCMXO2Family_SendRows(dev_info->CF, dev_info->CF_Line, 1);
   printf("\n");
 
   return ret;
@@ -236,37 +272,7 @@ LCMXO2Family_SendCFdata(CPLDInfo *dev_info)
 static int
 LCMXO2Family_SendUFMdata(CPLDInfo *dev_info)
 {
-  int ret = 0;
-  int CurrentAddr = 0;
-  int i;
-  unsigned int status;
-
-  for (i = 0; i < dev_info->UFM_Line; i++)
-  {
-    CurrentAddr = (i * LATTICE_COL_SIZE) / 32;
-
-    //RUNTEST    IDLE    15 TCK    1.00E-003 SEC;
-//    ast_jtag_run_test_idle(0, JTAG_STATE_TLRESET, 3);
-
-    //set page to program page
-    ast_jtag_sir_xfer(JTAG_STATE_PAUSEIR, LATTICE_INS_LENGTH, LCMXO2_LSC_PROG_INCR_NV);
-
-    //send data
-    ast_jtag_tdi_xfer(JTAG_STATE_TLRESET, LATTICE_COL_SIZE, &dev_info->UFM[CurrentAddr]);
-
-    //usleep(1000);
-
-    status = LCMXO2Family_Check_Device_Status(CHECK_BUSY);
-    if (status != 0)
-    {
-      printf("[%s]Write UFM Error, status = %x\n", __func__, status);
-      ret = -1;
-      break;
-    }
-
-  }
-
-  return ret;
+  return LCMXO2Family_SendRows(dev_info->UFM, dev_info->UFM_Line, 0);
 }
 
 /*check the size of cf and ufm*/
@@ -576,53 +582,70 @@ LCMXO2Family_JED_File_Parser(FILE *jed_fd, CPLDInfo *dev_info, int cf_size, int
 static int
 LCMXO2Family_cpld_verify(CPLDInfo *dev_info)
 {
-  int i;
-  int result;
-  int current_addr = 0;
+  int i, j, n;
+  int row_words = LATTICE_COL_SIZE / 32;
   unsigned int buff[4] = {0};
+  unsigned int *rows;
   int ret = 0;
 
-//  ast_jtag_run_test_idle(0, JTAG_STATE_TLRESET, 3);
-  ast_jtag_sir_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_LSC_INIT_ADDRESS);
+  rows = (unsigned int *)malloc(LATTICE_BATCH_ROWS * LATTICE_COL_SIZE / 8);
+  if (rows == NULL)
+  {
+    return -1;
+  }
+
+  ast_jtag_queue_sir(&lattice_q, JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_LSC_INIT_ADDRESS);
 
   buff[0] = 0x04;
-  ast_jtag_tdi_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, &buff[0]);
-  usleep(1000);
+  ast_jtag_queue_tdi(&lattice_q, JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, &buff[0]);
+  ast_jtag_queue_idle(&lattice_q, JTAG_STATE_TLRESET, LCMXO2Family_Delay_TCK(1000));
 
-//  ast_jtag_run_test_idle(0, JTAG_STATE_TLRESET, 3);
-  ast_jtag_sir_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_LSC_READ_INCR_NV);
-  usleep(1000);
+  ast_jtag_queue_sir(&lattice_q, JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_LSC_READ_INCR_NV);
+  ast_jtag_queue_idle(&lattice_q, JTAG_STATE_TLRESET, LCMXO2Family_Delay_TCK(1000));
 
 #ifdef CPLD_DEBUG
   printf("[%s] dev_info->CF_Line: %d\n", __func__, dev_info->CF_Line);
 #endif
 
-  for(i = 0; i < dev_info->CF_Line; i++)
+  for(i = 0; i < dev_info->CF_Line && ret == 0; i += n)
   {
-    printf("Verify Data: %d/%d (%.2f%%) \r",(i+1), dev_info->CF_Line, (((i+1)/(float)dev_info->CF_Line)*100));
-
-    current_addr = (i * LATTICE_COL_SIZE) / 32;
-
-    memset(buff, 0, sizeof(buff));
+    n = dev_info->CF_Line - i;
+    if (n > LATTICE_BATCH_ROWS)
+    {
+      n = LATTICE_BATCH_ROWS;
+    }
 
-    ast_jtag_tdo_xfer(JTAG_STATE_TLRESET, LATTICE_COL_SIZE, buff);
+    //read back a batch of rows with a single submission
+    memset(rows, 0, n * LATTICE_COL_SIZE / 8);
+    for (j = 0; j < n; j++)
+    {
+      ast_jtag_queue_tdo(&lattice_q, JTAG_STATE_TLRESET, LATTICE_COL_SIZE, &rows[j * row_words]);
+    }
+    if (ast_jtag_queue_flush(&lattice_q) < 0)
+    {
+      ret = -1;
+      break;
+    }
 
-    result = memcmp(buff, &dev_info->CF[current_addr], sizeof(unsigned int));
+    printf("Verify Data: %d/%d (%.2f%%) \r",(i+n), dev_info->CF_Line, (((i+n)/(float)dev_info->CF_Line)*100));
 
-    if (result)
+    for (j = 0; j < n; j++)
     {
-
+      if (memcmp(&rows[j * row_words], &dev_info->CF[(i + j) * row_words], LATTICE_COL_SIZE / 8))
+      {
 #ifdef CPLD_DEBUG
-      printf("\nPage#%d (%x %x %x %x) did not match with CF (%x %x %x %x)\n",
-	     i, buff[0], buff[1], buff[2], buff[3],
-	     dev_info->CF[current_addr], dev_info->CF[current_addr+1],
-	     dev_info->CF[current_addr+2], dev_info->CF[current_addr+3]);
+        unsigned int *r = &rows[j * row_words];
+        unsigned int *c = &dev_info->CF[(i + j) * row_words];
+        printf("\nPage#%d (%x %x %x %x) did not match with CF (%x %x %x %x)\n",
+               i + j, r[0], r[1], r[2], r[3], c[0], c[1], c[2], c[3]);
 #endif
-      ret = -1;
-      break;
+        ret = -1;
+        break;
+      }
     }
   }
 
+  free(rows);
   printf("\n");
 
   if (-1 == ret)
@@ -650,10 +673,9 @@ LCMXO2Family_cpld_Start()
   printf("[%s] Enter transparent mode!\n", __func__);
 #endif
 
-//  ast_jtag_run_test_idle(0, JTAG_STATE_TLRESET, 3);
-  ast_jtag_sir_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_ISC_ENABLE_X);
+  ast_jtag_queue_sir(&lattice_q, JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_ISC_ENABLE_X);
   dr_data[0] = 0x08;
-  ast_jtag_tdi_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, dr_data);
+  ast_jtag_queue_tdi(&lattice_q, JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, dr_data);
 
   //LSC_CHECK_BUSY(0xF0) instruction
   dr_data[0] = LCMXO2Family_Check_Device_Status(CHECK_BUSY);
@@ -693,8 +715,7 @@ LCMXO2Family_cpld_End()
   int ret = 0;
   unsigned int status;
 
-//  ast_jtag_run_test_idle(0, JTAG_STATE_TLRESET, 3);
-  ast_jtag_sir_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_ISC_PROGRAM_DONE);
+  ast_jtag_queue_sir(&lattice_q, JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_ISC_PROGRAM_DONE);
 
 #ifdef CPLD_DEBUG
   printf("[%s] Program DONE bit\n", __func__);
@@ -726,7 +747,11 @@ LCMXO2Family_cpld_End()
 
   //Exit the programming mode
   //Shift in ISC DISABLE(0x26) instruction
-  ast_jtag_sir_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_ISC_DISABLE);
+  ast_jtag_queue_sir(&lattice_q, JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_ISC_DISABLE);
+  if (ast_jtag_queue_flush(&lattice_q) < 0)
+  {
+    ret = -1;
+  }
 
   return ret;
 }
@@ -739,6 +764,7 @@ LCMXO2Family_cpld_Check_ID()
   int i;
 
   //RUNTEST IDLE
+  ast_jtag_queue_flush(&lattice_q);
   ast_jtag_run_test_idle(1, JTAG_STATE_TLRESET, 3);
 
 #ifdef CPLD_DEBUG
@@ -746,9 +772,13 @@ LCMXO2Family_cpld_Check_ID()
 #endif
 
   //Check the IDCODE_PUB
-  ast_jtag_sir_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_IDCODE_PUB);
+  ast_jtag_queue_sir(&lattice_q, JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_IDCODE_PUB);
   dr_data[0] = 0x0;
-  ast_jtag_tdo_xfer(JTAG_STATE_TLRESET, 32, dr_data);
+  ast_jtag_queue_tdo(&lattice_q, JTAG_STATE_TLRESET, 32, dr_data);
+  if (ast_jtag_queue_flush(&lattice_q) < 0)
+  {
+    return -1;
+  }
 
 #ifdef CPLD_DEBUG
   printf("[%s] ID Code: %x\n", __func__, dr_data[0]);
@@ -771,11 +801,14 @@ LCMXO2Family_cpld_Get_id(unsigned int *dev_id)
 {
   unsigned int dr_data[4] = {0};
 
-//  ast_jtag_run_test_idle(0, JTAG_STATE_TLRESET, 3);
   //Check the IDCODE_PUB
-  ast_jtag_sir_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_IDCODE_PUB);
+  ast_jtag_queue_sir(&lattice_q, JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_IDCODE_PUB);
   dr_data[0] = 0x0;
-  ast_jtag_tdo_xfer(JTAG_STATE_TLRESET, 32, dr_data);
+  ast_jtag_queue_tdo(&lattice_q, JTAG_STATE_TLRESET, 32, dr_data);
+  if (ast_jtag_queue_flush(&lattice_q) < 0)
+  {
+    return -1;
+  }
 
   *dev_id = dr_data[0];
 
@@ -788,9 +821,8 @@ LCMXO2Family_cpld_Erase(int erase_type)
   unsigned int dr_data[4] = {0};
   int ret = 0;
 
-//  ast_jtag_run_test_idle(0, JTAG_STATE_TLRESET, 3);
   //Erase the Flash
-  ast_jtag_sir_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_ISC_ERASE);
+  ast_jtag_queue_sir(&lattice_q, JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_ISC_ERASE);
 
 #ifdef CPLD_DEBUG
   printf("[%s] ERASE(0x0E)!\n", __func__);
@@ -807,7 +839,7 @@ LCMXO2Family_cpld_Erase(int erase_type)
       break;
   }
 
-  ast_jtag_tdi_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, dr_data);
+  ast_jtag_queue_tdi(&lattice_q, JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, dr_data);
 
   dr_data[0] = LCMXO2Family_Check_Device_Status(CHECK_BUSY);
 
@@ -855,9 +887,8 @@ LCMXO2Family_cpld_program(CPLDInfo *dev_info)
   //Program CFG
   printf("[%s] Program CFG \n", __func__);
 #endif
-//  ast_jtag_run_test_idle(0, JTAG_STATE_TLRESET, 3);
   //Shift in LSC_INIT_ADDRESS(0x46) instruction
-  ast_jtag_sir_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_LSC_INIT_ADDRESS);
+  ast_jtag_queue_sir(&lattice_q, JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_LSC_INIT_ADDRESS);
 
 #ifdef CPLD_DEBUG
   printf("[%s] INIT_ADDRESS(0x46) \n", __func__);
@@ -871,9 +902,8 @@ LCMXO2Family_cpld_program(CPLDInfo *dev_info)
 
   if (dev_info->UFM_Line)
   {
-//    ast_jtag_run_test_idle(0, JTAG_STATE_TLRESET, 3);
     //program UFM
-    ast_jtag_sir_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_LSC_INIT_ADDR_UFM);
+    ast_jtag_queue_sir(&lattice_q, JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_LSC_INIT_ADDR_UFM);
 
     ret = LCMXO2Family_SendUFMdata(dev_info);
     if (ret < 0)
@@ -903,15 +933,14 @@ LCMXO2Family_cpld_program(CPLDInfo *dev_info)
 
   //Write UserCode
   dr_data[0] = dev_info->Version;
-  ast_jtag_tdi_xfer(JTAG_STATE_TLRESET, 32, dr_data);
+  ast_jtag_queue_tdi(&lattice_q, JTAG_STATE_TLRESET, 32, dr_data);
 
 #ifdef CPLD_DEBUG
   printf("[%s] Write USERCODE: %x\n", __func__, dr_data[0]);
 #endif
 
-//  ast_jtag_run_test_idle(0, JTAG_STATE_TLRESET, 3);
-  ast_jtag_sir_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_ISC_PROGRAM_USERCOD);
-  usleep(2000);
+  ast_jtag_queue_sir(&lattice_q, JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_ISC_PROGRAM_USERCOD);
+  ast_jtag_queue_idle(&lattice_q, JTAG_STATE_TLRESET, LCMXO2Family_Delay_TCK(2000));
 
 #ifdef CPLD_DEBUG
   printf("[%s] PROGRAM USERCODE(0xC2)\n", __func__);
@@ -957,7 +986,7 @@ LCMXO2Family_cpld_Get_Ver(unsigned int *ver)
   }
 
   //Shift in READ USERCODE(0xC0) instruction;
-  ast_jtag_sir_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_USERCODE);
+  ast_jtag_queue_sir(&lattice_q, JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_USERCODE);
 
 #ifdef CPLD_DEBUG
   printf("[%s] READ USERCODE(0xC0)\n", __func__);
@@ -965,7 +994,11 @@ LCMXO2Family_cpld_Get_Ver(unsigned int *ver)
 
   //Read UserCode
   dr_data[0] = 0;
-  ast_jtag_tdo_xfer(JTAG_STATE_TLRESET, 32, dr_data);
+  ast_jtag_queue_tdo(&lattice_q, JTAG_STATE_TLRESET, 32, dr_data);
+  if (ast_jtag_queue_flush(&lattice_q) < 0)
+  {
+    return -1;
+  }
   *ver = dr_data[0];
 
   ret = LCMXO2Family_cpld_End();
@@ -1081,6 +1114,9 @@ error_exit:
 static int cpld_dev_open(cpld_intf_t intf, uint8_t id, void *attr)
 {
   if (intf == INTF_JTAG) {
+    if (ast_jtag_queue_init(&lattice_q, LATTICE_QUEUE_SIZE) < 0) {
+      return -1;
+    }
     ast_jtag_set_mode(JTAG_XFER_HW_MODE);
     return ast_jtag_open();
   } else {
@@ -1092,6 +1128,8 @@ static int cpld_dev_open(cpld_intf_t intf, uint8_t id, void *attr)
 static int cpld_dev_close(cpld_intf_t intf)
 {
   if (intf == INTF_JTAG) {
+    ast_jtag_queue_flush(&lattice_q);
+    ast_jtag_queue_free(&lattice_q);
     ast_jtag_close();
   } else {
     printf("[%s] Interface type %d is not supported\n", __func__, intf);
@@ -0,0 +1,228 @@
+/*
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include <openbmc/ast-jtag.h>
+#include "cpld.h"
+#include "lattice.h"
+
+using namespace std;
+
+#define SIM_IDCODE 0x012BC043  // LCMXO2-4000HC
+#define SIM_ROW_BUSY_TCK 1000     // 1 ms at the 1 MHz simulated TCK
+#define SIM_SLOW_ROW_BUSY_TCK 5000
+#define SIM_ERASE_BUSY_TCK 100
+
+/*
+ * LCMXO2 model behind the software TAP: a row array addressed by an
+ * auto-incrementing pointer, a busy counter drained by Run-Test/Idle
+ * cycles, and a fail flag raised when a row is shifted in while busy.
+ */
+struct MachXO2 {
+  vector<array<unsigned int, 4>> rows;
+  unsigned int ptr = 0;
+  unsigned int busy = 0;
+  bool enabled = false;
+  bool fail = false;
+  unsigned int usercode = 0;
+  unsigned int usercode_shadow = 0;
+  unsigned int stuck_row = ~0U;
+  unsigned int slow_row = ~0U;
+
+  static void update_ir(void *priv, unsigned int ir) {
+    MachXO2 *d = static_cast<MachXO2 *>(priv);
+    switch (ir) {
+      case LCMXO2_LSC_INIT_ADDRESS:
+      case LCMXO2_LSC_INIT_ADDR_UFM:
+        d->ptr = 0;
+        break;
+      case LCMXO2_ISC_PROGRAM_USERCOD:
+        d->usercode = d->usercode_shadow;
+        d->busy = SIM_ROW_BUSY_TCK;
+        break;
+      case LCMXO2_ISC_DISABLE:
+        d->enabled = false;
+        break;
+    }
+  }
+
+  static void shift_dr(void *priv, unsigned int ir, unsigned int len,
+                       const unsigned int *tdi, unsigned int *tdo) {
+    MachXO2 *d = static_cast<MachXO2 *>(priv);
+    // the USERCODE is shifted in ahead of ISC_PROGRAM_USERCOD
+    if (tdi && len == 32) {
+      d->usercode_shadow = tdi[0];
+    }
+    switch (ir) {
+      case LCMXO2_IDCODE_PUB:
+        if (tdo) tdo[0] = SIM_IDCODE;
+        break;
+      case LCMXO2_ISC_ENABLE_X:
+        d->enabled = true;
+        break;
+      case LCMXO2_ISC_ERASE:
+        if (tdi) {
+          for (auto &r : d->rows) r.fill(0);
+          d->busy = SIM_ERASE_BUSY_TCK;
+        }
+        break;
+      case LCMXO2_LSC_PROG_INCR_NV:
+        if (tdi && len == 128) {
+          if (d->busy || !d->enabled) {
+            d->fail = true;
+          }
+          if (d->ptr >= d->rows.size()) {
+            d->rows.resize(d->ptr + 1);
+          }
+          memcpy(d->rows[d->ptr].data(), tdi, 16);
+          if (d->ptr == d->stuck_row) {
+            d->rows[d->ptr][0] ^= 1;
+          }
+          d->busy = (d->ptr == d->slow_row) ? SIM_SLOW_ROW_BUSY_TCK
+                                            : SIM_ROW_BUSY_TCK;
+          d->ptr++;
+        }
+        break;
+      case LCMXO2_LSC_READ_INCR_NV:
+        if (tdo && d->ptr < d->rows.size()) {
+          memcpy(tdo, d->rows[d->ptr].data(), 16);
+        }
+        d->ptr++;
+        break;
+      case LCMXO2_LSC_CHECK_BUSY:
+        if (tdo) tdo[0] = d->busy ? 0x80 : 0;
+        break;
+      case LCMXO2_LSC_READ_STATUS:
+        if (tdo) tdo[0] = (d->fail ? (1 << 13) : 0) | (d->busy ? (1 << 12) : 0);
+        break;
+      case LCMXO2_USERCODE:
+        if (tdo) tdo[0] = d->usercode;
+        break;
+    }
+  }
+
+  static void run_idle(void *priv, unsigned int tck) {
+    MachXO2 *d = static_cast<MachXO2 *>(priv);
+    d->busy = (d->busy > tck) ? d->busy - tck : 0;
+  }
+};
+
+static const char *jed_path = "/tmp/lattice_test.jed";
+
+class LatticeTest : public ::testing::Test {
+ protected:
+  MachXO2 dev;
+  struct jtag_sim_device sim;
+  vector<array<unsigned int, 4>> image;
+  unsigned int version = 0x12345678;
+
+  void SetUp() {
+    unsigned int checksum = 0;
+    FILE *fp = fopen(jed_path, "w");
+    ASSERT_NE(fp, nullptr);
+
+    for (unsigned int i = 0; i < 300; i++) {
+      image.push_back({i * 0x01010101U, ~i, i << 16, 0xA5A5A5A5U ^ i});
+    }
+
+    fprintf(fp, "QF%zu*\n", image.size() * 128);
+    fprintf(fp, "L000000\n");
+    for (auto &row : image) {
+      for (int b = 0; b < 128; b++) {
+        fputc(((row[b / 32] >> (b % 32)) & 1) ? '1' : '0', fp);
+      }
+      fputc('\n', fp);
+      for (auto w : row) {
+        checksum += (w >> 24) + ((w >> 16) & 0xff) + ((w >> 8) & 0xff) + (w & 0xff);
+      }
+    }
+    fprintf(fp, "*\n");
+    fprintf(fp, "NOTE User Electronic Signature Data*\n");
+    fprintf(fp, "UH%08X*\n", version);
+    fprintf(fp, "C%04X*\n", checksum & 0xffff);
+    fclose(fp);
+
+    sim.priv = &dev;
+    sim.update_ir = MachXO2::update_ir;
+    sim.shift_dr = MachXO2::shift_dr;
+    sim.run_idle = MachXO2::run_idle;
+    sim.reset = nullptr;
+    ast_jtag_sim_attach(&sim);
+    ASSERT_EQ(cpld_intf_open(LCMXO2_4000HC, INTF_JTAG, NULL), 0);
+  }
+
+  void TearDown() {
+    cpld_intf_close(INTF_JTAG);
+    ast_jtag_sim_detach();
+    unlink(jed_path);
+  }
+};
+
+TEST_F(LatticeTest, ProgramAndVerify) {
+  struct jtag_sim_stats stats;
+  unsigned int ver = 0;
+
+  ASSERT_EQ(cpld_program((char *)jed_path, NULL, 0), 0);
+  ASSERT_FALSE(dev.fail);
+  ASSERT_EQ(dev.rows.size(), image.size());
+  for (size_t i = 0; i < image.size(); i++) {
+    ASSERT_EQ(dev.rows[i], image[i]) << "row " << i;
+  }
+
+  // a row, its idle time and busy check go to the driver in one batch
+  ast_jtag_sim_get_stats(&stats);
+  ASSERT_LT(stats.batches, image.size() + 64);
+
+  ASSERT_EQ(cpld_get_ver(&ver), 0);
+  ASSERT_EQ(ver, version);
+}
+
+TEST_F(LatticeTest, VerifyMismatch) {
+  dev.stuck_row = 123;
+  ASSERT_NE(cpld_program((char *)jed_path, NULL, 0), 0);
+}
+
+TEST_F(LatticeTest, QueueOrdering) {
+  struct jtag_scan_queue q;
+  unsigned int id = 0, busy = 0xff;
+
+  ASSERT_EQ(ast_jtag_queue_init(&q, 2), 0);
+  // more operations than the queue holds: it flushes itself in order
+  ASSERT_EQ(ast_jtag_queue_sir(&q, JTAG_STATE_TLRESET, 8, LCMXO2_IDCODE_PUB), 0);
+  ASSERT_EQ(ast_jtag_queue_tdo(&q, JTAG_STATE_TLRESET, 32, &id), 0);
+  ASSERT_EQ(ast_jtag_queue_sir(&q, JTAG_STATE_TLRESET, 8, LCMXO2_LSC_CHECK_BUSY), 0);
+  ASSERT_EQ(ast_jtag_queue_tdo(&q, JTAG_STATE_TLRESET, 8, &busy), 0);
+  ASSERT_EQ(ast_jtag_queue_flush(&q), 0);
+  ast_jtag_queue_free(&q);
+
+  ASSERT_EQ(id, (unsigned int)SIM_IDCODE);
+  ASSERT_EQ(busy, 0u);
+}
+
+TEST_F(LatticeTest, SlowRow) {
+  // a row still busy after the row time is waited for, not overwritten
+  dev.slow_row = 42;
+  ASSERT_EQ(cpld_program((char *)jed_path, NULL, 0), 0);
+  ASSERT_FALSE(dev.fail);
+  ASSERT_EQ(dev.rows[42], image[42]);
+  ASSERT_EQ(dev.rows[43], image[43]);
+}
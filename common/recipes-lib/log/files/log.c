@@ -27,6 +27,10 @@
 #include <time.h>
 #include <assert.h>
 #include <syslog.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <linux/limits.h>
@@ -42,6 +46,13 @@
 
 #define LOG_BUF_MAX_SIZE	512
 
+/*
+ * Async logging: ring slots (power of 2), and how often the drainer
+ * wakes up on its own to report repeats and drops.
+ */
+#define LOG_RING_SIZE		128
+#define LOG_DRAIN_IDLE_MS	1000
+
 struct obmclog_desc {
 	char ident[NAME_MAX];
 
@@ -75,6 +86,41 @@ static struct obmclog_desc my_ldesc = {
         .log_devices = LOG_DEV_STD_STREAM,
 };
 
+/*
+ * Bounded multi-producer ring: a slot is free for position <pos> when
+ * its <seq> is pos, and holds a message when <seq> is pos + 1.
+ */
+struct log_slot {
+	unsigned long seq;
+	int prio;
+	time_t time;
+	char msg[LOG_BUF_MAX_SIZE];
+};
+
+struct log_ring {
+	struct log_slot *slots;
+	unsigned long tail;		/* next position for producers */
+	unsigned long head;		/* next position for the drainer */
+	int enabled;
+	int writers;			/* producers inside log_enqueue() */
+	int sleeping;			/* drainer waits on <wake_fd> */
+	int stop;
+	int wake_fd;
+	unsigned int rate;
+	pthread_t drainer;
+	struct obmc_log_stats stats;
+};
+
+static struct log_ring my_ring = {
+	.wake_fd = -1,
+};
+
+/*
+ * Serializes the drainer's use of the log devices with obmc_log_set_*
+ * and obmc_log_unset_*.
+ */
+static pthread_mutex_t dev_lock = PTHREAD_MUTEX_INITIALIZER;
+
 int obmc_log_init(const char *ident, int min_prio, int options)
 {
 	if (ident == NULL || !IS_VALID_LOG_PRIO(min_prio)) {
@@ -96,6 +142,8 @@ int obmc_log_init(const char *ident, int min_prio, int options)
 
 void obmc_log_destroy(void)
 {
+	obmc_log_unset_async();
+
 	if (my_ldesc.priv_flags & LOG_FLAG_CONFIGURED) {
 		if (LOG_DEVICE_IS_SET(&my_ldesc, LOG_DEV_SYSLOG))
 			closelog();
@@ -111,6 +159,7 @@ void obmc_log_destroy(void)
 
 static void format_log_message(char *buf,
 			       int size,
+			       time_t t_now,
 			       const char *fmt,
 			       va_list vargs)
 {
@@ -118,8 +167,8 @@ static void format_log_message(char *buf,
 
 	/* Add time stamp. */
 	if (my_ldesc.priv_flags & OBMC_LOG_FMT_TIMESTAMP) {
-		time_t t_now = time(NULL);
-		struct tm *tm_now = localtime(&t_now);
+		struct tm tm_buf;
+		struct tm *tm_now = localtime_r(&t_now, &tm_buf);
 		if (tm_now != NULL) {
 			len = strftime(buf, size, "%D %T ", tm_now);
 			assert(len != 0); /* no buffer overflow */
@@ -150,6 +199,216 @@ static void format_log_message(char *buf,
 	}
 }
 
+static void format_log_line(char *buf, int size, time_t t_now,
+			    const char *fmt, ...)
+{
+	va_list vargs;
+
+	va_start(vargs, fmt);
+	format_log_message(buf, size, t_now, fmt, vargs);
+	va_end(vargs);
+}
+
+/*
+ * Hot path of async logging: claim a slot, format the body into it and
+ * publish it. Never blocks; the message is dropped if the ring is full.
+ */
+static void log_enqueue(int prio, const char *fmt, va_list vargs)
+{
+	struct log_slot *slot;
+	unsigned long pos, seq;
+	uint64_t one = 1;
+	long diff;
+
+	pos = __atomic_load_n(&my_ring.tail, __ATOMIC_RELAXED);
+	for (;;) {
+		slot = &my_ring.slots[pos & (LOG_RING_SIZE - 1)];
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		diff = (long)(seq - pos);
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&my_ring.tail, &pos,
+							pos + 1, 1,
+							__ATOMIC_RELAXED,
+							__ATOMIC_RELAXED))
+				break;
+		} else if (diff < 0) {
+			__atomic_add_fetch(&my_ring.stats.dropped, 1,
+					   __ATOMIC_RELAXED);
+			return;
+		} else {
+			pos = __atomic_load_n(&my_ring.tail, __ATOMIC_RELAXED);
+		}
+	}
+
+	slot->prio = prio;
+	slot->time = time(NULL);
+	vsnprintf(slot->msg, sizeof(slot->msg), fmt, vargs);
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+	__atomic_add_fetch(&my_ring.stats.queued, 1, __ATOMIC_RELAXED);
+
+	/* Pairs with the fence in log_drainer() before it goes to sleep. */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&my_ring.sleeping, __ATOMIC_RELAXED) &&
+	    __atomic_exchange_n(&my_ring.sleeping, 0, __ATOMIC_RELAXED)) {
+		if (write(my_ring.wake_fd, &one, sizeof(one)) < 0) {
+			/* The drainer wakes up on its own eventually. */
+		}
+	}
+}
+
+/* Write one message to the devices, with dev_lock held. */
+static void log_deliver(int prio, time_t t, const char *msg)
+{
+	char buf[LOG_BUF_MAX_SIZE + NAME_MAX + 32];
+
+	if (LOG_DEVICE_IS_SET(&my_ldesc, LOG_DEV_SYSLOG))
+		syslog(LOG_MAKEPRI(my_ldesc.syslog_facility, prio), "%s", msg);
+
+	if (my_ldesc.log_devices & ~LOG_DEV_SYSLOG) {
+		format_log_line(buf, sizeof(buf), t, "%s", msg);
+
+		/* Streams are flushed once per batch by the drainer. */
+		if (LOG_DEVICE_IS_SET(&my_ldesc, LOG_DEV_STD_STREAM))
+			fputs(buf, prio >= LOG_INFO ? stdout : stderr);
+		if (LOG_DEVICE_IS_SET(&my_ldesc, LOG_DEV_FILE))
+			fputs(buf, my_ldesc.file_fp);
+	}
+}
+
+struct log_drain_state {
+	int prev_prio;
+	time_t prev_time;
+	char prev_msg[LOG_BUF_MAX_SIZE];
+	unsigned int repeats;		/* of prev_msg, not delivered yet */
+	unsigned long limited;		/* not reported yet */
+	unsigned long dropped;		/* reported so far */
+	unsigned int tokens;
+	time_t refill;
+};
+
+static void log_flush_repeats(struct log_drain_state *st)
+{
+	char buf[64];
+
+	if (st->repeats == 0)
+		return;
+	snprintf(buf, sizeof(buf), "last message repeated %u times",
+		 st->repeats);
+	log_deliver(st->prev_prio, st->prev_time, buf);
+	st->repeats = 0;
+}
+
+static void log_report_shed(struct log_drain_state *st, time_t now)
+{
+	char buf[96];
+	unsigned long dropped;
+
+	if (st->limited > 0) {
+		snprintf(buf, sizeof(buf),
+			 "%lu messages suppressed by rate limit", st->limited);
+		log_deliver(LOG_WARNING, now, buf);
+		st->limited = 0;
+	}
+
+	dropped = __atomic_load_n(&my_ring.stats.dropped, __ATOMIC_RELAXED);
+	if (dropped != st->dropped) {
+		snprintf(buf, sizeof(buf),
+			 "%lu messages dropped, log queue full",
+			 dropped - st->dropped);
+		log_deliver(LOG_WARNING, now, buf);
+		st->dropped = dropped;
+	}
+}
+
+static void log_process(struct log_drain_state *st, int prio, time_t t,
+			const char *msg)
+{
+	if (st->prev_msg[0] != '\0' && prio == st->prev_prio &&
+	    strcmp(msg, st->prev_msg) == 0) {
+		st->repeats++;
+		__atomic_add_fetch(&my_ring.stats.repeated, 1,
+				   __ATOMIC_RELAXED);
+		return;
+	}
+	log_flush_repeats(st);
+
+	st->prev_prio = prio;
+	st->prev_time = t;
+	snprintf(st->prev_msg, sizeof(st->prev_msg), "%s", msg);
+
+	if (my_ring.rate != 0) {
+		if (t != st->refill) {
+			st->tokens = my_ring.rate;
+			st->refill = t;
+		}
+		if (st->tokens == 0) {
+			st->limited++;
+			__atomic_add_fetch(&my_ring.stats.rate_limited, 1,
+					   __ATOMIC_RELAXED);
+			return;
+		}
+		st->tokens--;
+	}
+	log_report_shed(st, t);
+	log_deliver(prio, t, msg);
+}
+
+static void *log_drainer(void *arg)
+{
+	struct log_drain_state st;
+	struct log_slot *slot;
+	struct pollfd pfd;
+	uint64_t cnt;
+	int n, stop;
+
+	memset(&st, 0, sizeof(st));
+	pfd.fd = my_ring.wake_fd;
+	pfd.events = POLLIN;
+
+	for (;;) {
+		stop = __atomic_load_n(&my_ring.stop, __ATOMIC_ACQUIRE);
+
+		pthread_mutex_lock(&dev_lock);
+		for (n = 0; ; n++) {
+			slot = &my_ring.slots[my_ring.head & (LOG_RING_SIZE - 1)];
+			if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) !=
+			    my_ring.head + 1)
+				break;
+			log_process(&st, slot->prio, slot->time, slot->msg);
+			__atomic_store_n(&slot->seq, my_ring.head + LOG_RING_SIZE,
+					 __ATOMIC_RELEASE);
+			my_ring.head++;
+		}
+		if (n == 0 || stop) {
+			/* Idle: nothing held back is worth waiting for. */
+			log_flush_repeats(&st);
+			log_report_shed(&st, time(NULL));
+		}
+		fflush(stdout);
+		fflush(stderr);
+		if (LOG_DEVICE_IS_SET(&my_ldesc, LOG_DEV_FILE))
+			fflush(my_ldesc.file_fp);
+		pthread_mutex_unlock(&dev_lock);
+
+		if (stop)
+			break;
+		if (n > 0)
+			continue;
+
+		__atomic_store_n(&my_ring.sleeping, 1, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) !=
+		    my_ring.head + 1 &&
+		    !__atomic_load_n(&my_ring.stop, __ATOMIC_ACQUIRE))
+			poll(&pfd, 1, LOG_DRAIN_IDLE_MS);
+		__atomic_store_n(&my_ring.sleeping, 0, __ATOMIC_RELAXED);
+		if (read(my_ring.wake_fd, &cnt, sizeof(cnt)) < 0) {
+			/* EAGAIN: woken up by the timeout */
+		}
+	}
+	return NULL;
+}
+
 int obmc_log_by_prio(int prio, const char *fmt, ...)
 {
 	va_list vargs, dup_vargs;
@@ -164,6 +423,18 @@ int obmc_log_by_prio(int prio, const char *fmt, ...)
 
 	va_start(vargs, fmt);
 
+	if (__atomic_load_n(&my_ring.enabled, __ATOMIC_ACQUIRE)) {
+		/* Pairs with obmc_log_unset_async(). */
+		__atomic_add_fetch(&my_ring.writers, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&my_ring.enabled, __ATOMIC_SEQ_CST)) {
+			log_enqueue(prio, fmt, vargs);
+			__atomic_sub_fetch(&my_ring.writers, 1, __ATOMIC_RELEASE);
+			va_end(vargs);
+			return 0;
+		}
+		__atomic_sub_fetch(&my_ring.writers, 1, __ATOMIC_RELEASE);
+	}
+
 	/* Dump log to syslogd. */
 	if (LOG_DEVICE_IS_SET(&my_ldesc, LOG_DEV_SYSLOG)) {
 		int sprio = LOG_MAKEPRI(my_ldesc.syslog_facility, prio);
@@ -174,7 +445,7 @@ int obmc_log_by_prio(int prio, const char *fmt, ...)
 
 	if (my_ldesc.log_devices & ~LOG_DEV_SYSLOG) {
 		va_copy(dup_vargs, vargs);
-		format_log_message(buf, sizeof(buf), fmt, dup_vargs);
+		format_log_message(buf, sizeof(buf), time(NULL), fmt, dup_vargs);
 		va_end(dup_vargs);
 
 		/* Dump log to standard stream. */
@@ -235,9 +506,11 @@ int obmc_log_set_syslog(int option, int facility)
 {
 	CHECK_SET_DEVICE(&my_ldesc, LOG_DEV_SYSLOG);
 
+	pthread_mutex_lock(&dev_lock);
 	my_ldesc.syslog_facility = facility;
 	openlog(my_ldesc.ident, option, facility);
 	LOG_DEVICE_SET(&my_ldesc, LOG_DEV_SYSLOG);
+	pthread_mutex_unlock(&dev_lock);
 	return 0;
 }
 
@@ -245,9 +518,11 @@ void obmc_log_unset_syslog(void)
 {
 	CHECK_UNSET_DEVICE(&my_ldesc, LOG_DEV_SYSLOG);
 
+	pthread_mutex_lock(&dev_lock);
 	LOG_DEVICE_UNSET(&my_ldesc, LOG_DEV_SYSLOG);
 	my_ldesc.syslog_facility = 0;
 	closelog();
+	pthread_mutex_unlock(&dev_lock);
 }
 
 int obmc_log_set_file(const char *log_file)
@@ -264,10 +539,12 @@ int obmc_log_set_file(const char *log_file)
 	if (fp == NULL)
 		return -1;
 
+	pthread_mutex_lock(&dev_lock);
 	strncpy(my_ldesc.file_path, log_file,
 		sizeof(my_ldesc.file_path) - 1);
 	my_ldesc.file_fp = fp;
 	LOG_DEVICE_SET(&my_ldesc, LOG_DEV_FILE);
+	pthread_mutex_unlock(&dev_lock);
 	return 0;
 }
 
@@ -277,10 +554,12 @@ void obmc_log_unset_file(void)
 
 	assert(my_ldesc.file_fp != NULL);
 
+	pthread_mutex_lock(&dev_lock);
 	LOG_DEVICE_UNSET(&my_ldesc, LOG_DEV_FILE);
 	fclose(my_ldesc.file_fp);
 	my_ldesc.file_fp = NULL;
 	my_ldesc.file_path[0] = '\0';
+	pthread_mutex_unlock(&dev_lock);
 }
 
 int obmc_log_set_std_stream(void)
@@ -298,6 +577,81 @@ void obmc_log_unset_std_stream(void)
 	LOG_DEVICE_UNSET(&my_ldesc, LOG_DEV_STD_STREAM);
 }
 
+int obmc_log_set_async(unsigned int rate)
+{
+	int i;
+
+	CHECK_IF_CONFIGURED(&my_ldesc);
+	if (my_ring.slots != NULL) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	my_ring.slots = calloc(LOG_RING_SIZE, sizeof(struct log_slot));
+	if (my_ring.slots == NULL)
+		return -1;
+	for (i = 0; i < LOG_RING_SIZE; i++)
+		my_ring.slots[i].seq = i;
+	my_ring.head = my_ring.tail = 0;
+	my_ring.rate = rate;
+	my_ring.stop = 0;
+	memset(&my_ring.stats, 0, sizeof(my_ring.stats));
+
+	my_ring.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (my_ring.wake_fd < 0)
+		goto error;
+	errno = pthread_create(&my_ring.drainer, NULL, log_drainer, NULL);
+	if (errno != 0)
+		goto error;
+
+	__atomic_store_n(&my_ring.enabled, 1, __ATOMIC_SEQ_CST);
+	return 0;
+
+error:
+	if (my_ring.wake_fd >= 0)
+		close(my_ring.wake_fd);
+	my_ring.wake_fd = -1;
+	free(my_ring.slots);
+	my_ring.slots = NULL;
+	return -1;
+}
+
+void obmc_log_unset_async(void)
+{
+	uint64_t one = 1;
+
+	if (my_ring.slots == NULL)
+		return;
+
+	/* New messages go the synchronous way, wait for those in flight. */
+	__atomic_store_n(&my_ring.enabled, 0, __ATOMIC_SEQ_CST);
+	while (__atomic_load_n(&my_ring.writers, __ATOMIC_SEQ_CST) != 0)
+		sched_yield();
+
+	__atomic_store_n(&my_ring.stop, 1, __ATOMIC_RELEASE);
+	if (write(my_ring.wake_fd, &one, sizeof(one)) < 0) {
+		/* The drainer wakes up on its own eventually. */
+	}
+	pthread_join(my_ring.drainer, NULL);
+
+	close(my_ring.wake_fd);
+	my_ring.wake_fd = -1;
+	free(my_ring.slots);
+	my_ring.slots = NULL;
+}
+
+void obmc_log_get_stats(struct obmc_log_stats *stats)
+{
+	stats->queued = __atomic_load_n(&my_ring.stats.queued,
+					__ATOMIC_RELAXED);
+	stats->dropped = __atomic_load_n(&my_ring.stats.dropped,
+					 __ATOMIC_RELAXED);
+	stats->rate_limited = __atomic_load_n(&my_ring.stats.rate_limited,
+					      __ATOMIC_RELAXED);
+	stats->repeated = __atomic_load_n(&my_ring.stats.repeated,
+					  __ATOMIC_RELAXED);
+}
+
 
 #ifdef OBMC_LOG_UNITTEST
 
@@ -352,6 +706,24 @@ int main(int argc, char **argv)
 	DUMP_TEST_MESSAGES();
 #undef MSG_PREFIX
 
+	if (obmc_log_set_async(0) != 0) {
+		perror("obmc_log_set_async failed");
+		return -1;
+	}
+#define MSG_PREFIX "[prio=debug,dev=all,async]"
+	DUMP_TEST_MESSAGES();
+	DUMP_TEST_MESSAGES();
+#undef MSG_PREFIX
+	obmc_log_unset_async();
+	{
+		struct obmc_log_stats stats;
+
+		obmc_log_get_stats(&stats);
+		printf("async: queued=%lu dropped=%lu rate_limited=%lu "
+		       "repeated=%lu\n", stats.queued, stats.dropped,
+		       stats.rate_limited, stats.repeated);
+	}
+
 	obmc_log_unset_syslog();
 	obmc_log_unset_file();
 	obmc_log_unset_std_stream();
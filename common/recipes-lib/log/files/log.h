@@ -142,6 +142,41 @@ extern int obmc_log_set_std_stream(void);
  */
 extern void obmc_log_unset_std_stream(void);
 
+/*
+ * Deliver messages from a background thread instead of the caller's.
+ *
+ * obmc_log_by_prio() then only formats the message body into a slot of
+ * a lock-free ring and returns; a drainer thread adds the prefix and
+ * writes messages to the configured devices in batches. Consecutive
+ * duplicates are folded into "last message repeated N times", and at
+ * most <rate> messages per second are delivered (0 for no limit).
+ * Messages which find the ring full are dropped and counted.
+ *
+ * Call it after daemonizing: the drainer thread does not survive fork().
+ *
+ * Returns:
+ *     0 for success, and -1 on failures.
+ */
+extern int obmc_log_set_async(unsigned int rate);
+
+/*
+ * Deliver all queued messages, stop the drainer and return to logging
+ * on the caller's thread. It's no-op if async logging was never enabled.
+ */
+extern void obmc_log_unset_async(void);
+
+struct obmc_log_stats {
+	unsigned long queued;		/* accepted into the ring */
+	unsigned long dropped;		/* ring was full */
+	unsigned long rate_limited;	/* over the rate limit */
+	unsigned long repeated;		/* folded into "repeated N times" */
+};
+
+/*
+ * Get the async logging counters, all zero if it was never enabled.
+ */
+extern void obmc_log_get_stats(struct obmc_log_stats *stats);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -22,6 +22,8 @@
 #include <stdbool.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 
 #include "misc-utils.h"
 
@@ -72,3 +74,169 @@ int device_write_buff(const char *device, const char *value) {
 
     return 0;
 }
+
+/*
+ * Cache of opened device (sysfs attribute) files, so that daemons polling
+ * the same attributes don't pay an open()/close() per access. sysfs
+ * regenerates an attribute when it is read from offset 0, so a cached fd
+ * is re-read with pread() and re-written with pwrite() at offset 0.
+ */
+#define DEV_CACHE_BUCKETS	64
+
+struct dev_cache_entry {
+	struct dev_cache_entry *next;
+	int rd_fd;
+	int wr_fd;
+	char path[];
+};
+
+static struct dev_cache_entry *dev_cache[DEV_CACHE_BUCKETS];
+static pthread_mutex_t dev_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned int dev_cache_hash(const char *path)
+{
+	unsigned int hash = 5381;
+
+	while (*path)
+		hash = hash * 33 + (unsigned char)*path++;
+	return hash % DEV_CACHE_BUCKETS;
+}
+
+static struct dev_cache_entry *dev_cache_lookup(const char *device)
+{
+	struct dev_cache_entry *entry;
+	unsigned int hash = dev_cache_hash(device);
+
+	for (entry = dev_cache[hash]; entry != NULL; entry = entry->next) {
+		if (strcmp(entry->path, device) == 0)
+			return entry;
+	}
+
+	entry = malloc(sizeof(*entry) + strlen(device) + 1);
+	if (entry == NULL)
+		return NULL;
+	strcpy(entry->path, device);
+	entry->rd_fd = -1;
+	entry->wr_fd = -1;
+	entry->next = dev_cache[hash];
+	dev_cache[hash] = entry;
+	return entry;
+}
+
+static void dev_cache_entry_close(struct dev_cache_entry *entry)
+{
+	if (entry->rd_fd >= 0)
+		close(entry->rd_fd);
+	if (entry->wr_fd >= 0)
+		close(entry->wr_fd);
+	entry->rd_fd = -1;
+	entry->wr_fd = -1;
+}
+
+/*
+ * Perform a read (<value> is NULL) or a write of the device through its
+ * cached fd. The fd is re-opened once if it went stale, for example when
+ * the device was unbound and bound again.
+ */
+static int dev_cache_io(const char *device, char *buf, size_t size,
+			const char *value)
+{
+	struct dev_cache_entry *entry;
+	int *fd, retry, rc = 0;
+	ssize_t len;
+
+	pthread_mutex_lock(&dev_cache_lock);
+	entry = dev_cache_lookup(device);
+	if (entry == NULL) {
+		pthread_mutex_unlock(&dev_cache_lock);
+		return ENOMEM;
+	}
+	fd = (value == NULL) ? &entry->rd_fd : &entry->wr_fd;
+
+	for (retry = 0; retry < 2; retry++) {
+		if (*fd < 0) {
+			*fd = open(device, (value == NULL ? O_RDONLY : O_WRONLY) |
+				   O_CLOEXEC);
+			if (*fd < 0) {
+				rc = errno;
+				break;
+			}
+		}
+
+		if (value == NULL)
+			len = pread(*fd, buf, size - 1, 0);
+		else
+			len = pwrite(*fd, value, strlen(value), 0);
+		if (len >= 0) {
+			if (value == NULL)
+				buf[len] = '\0';
+			rc = 0;
+			break;
+		}
+
+		rc = errno;
+		close(*fd);
+		*fd = -1;
+		if (rc != ENODEV && rc != ENOENT && rc != ESTALE)
+			break;
+	}
+
+	pthread_mutex_unlock(&dev_cache_lock);
+	return rc;
+}
+
+/*
+ * Read the content of the given device through a cached file descriptor.
+ * <buf> is always NUL terminated.
+ *
+ * Return:
+ *   On success, zero is returned.
+ *   On error, errno is returned.
+ */
+int device_cache_read(const char *device, char *buf, size_t size)
+{
+	if (device == NULL || buf == NULL || size == 0)
+		return EINVAL;
+
+	return dev_cache_io(device, buf, size, NULL);
+}
+
+/*
+ * Write buffer to the given device through a cached file descriptor.
+ *
+ * Return:
+ *   On success, zero is returned.
+ *   On error, errno is returned.
+ */
+int device_cache_write(const char *device, const char *value)
+{
+	if (device == NULL || value == NULL)
+		return EINVAL;
+
+	return dev_cache_io(device, NULL, 0, value);
+}
+
+/*
+ * Close the cached file descriptors of the given device, or of all the
+ * devices if <device> is NULL.
+ */
+void device_cache_close(const char *device)
+{
+	struct dev_cache_entry **pentry, *entry;
+	int i;
+
+	pthread_mutex_lock(&dev_cache_lock);
+	for (i = 0; i < DEV_CACHE_BUCKETS; i++) {
+		pentry = &dev_cache[i];
+		while ((entry = *pentry) != NULL) {
+			if (device == NULL || strcmp(entry->path, device) == 0) {
+				*pentry = entry->next;
+				dev_cache_entry_close(entry);
+				free(entry);
+			} else {
+				pentry = &entry->next;
+			}
+		}
+	}
+	pthread_mutex_unlock(&dev_cache_lock);
+}
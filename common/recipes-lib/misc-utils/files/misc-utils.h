@@ -86,6 +86,9 @@ bool str_endswith(const char *str, const char *pattern);
  */
 int device_read(const char *device, int *value);
 int device_write_buff(const char *device, const char *value);
+int device_cache_read(const char *device, char *buf, size_t size);
+int device_cache_write(const char *device, const char *value);
+void device_cache_close(const char *device);
 
 /*
  * File IO utility functions.
@@ -26,6 +26,7 @@ int main(int argc, char **argv)
 	test_str_pattern(&test_info);
 	test_file_read(&test_info);
 	test_file_write(&test_info);
+	test_device_cache(&test_info);
 	test_path_exists(&test_info);
 	test_path_split(&test_info);
 	test_path_join(&test_info);
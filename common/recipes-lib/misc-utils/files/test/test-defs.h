@@ -62,6 +62,7 @@ void test_str_strip(struct test_stats *stats);
 void test_str_pattern(struct test_stats *stats);
 void test_file_read(struct test_stats *stats);
 void test_file_write(struct test_stats *stats);
+void test_device_cache(struct test_stats *stats);
 void test_path_exists(struct test_stats *stats);
 void test_path_split(struct test_stats *stats);
 void test_path_join(struct test_stats *stats);
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "test-defs.h"
+
+#define DEV_BUF_MAX	32
+#define TEST_DEV_FILE	"/tmp/this_is_a_device_cache_file.txt"
+
+/*
+ * test device_cache_read() and device_cache_write() functions.
+ */
+void test_device_cache(struct test_stats *stats)
+{
+	int rc;
+	char buf[DEV_BUF_MAX];
+
+	LOG_DEBUG("test device_cache_read() and device_cache_write()\n");
+	stats->num_total++;
+
+	if (device_write_buff(TEST_DEV_FILE, "1234") != 0) {
+		LOG_ERR("failed to create %s\n", TEST_DEV_FILE);
+		stats->num_errors++;
+		return;
+	}
+
+	rc = device_cache_read(TEST_DEV_FILE, buf, sizeof(buf));
+	if (rc != 0 || strcmp(buf, "1234") != 0) {
+		LOG_ERR("failed to read %s: %s\n", TEST_DEV_FILE, strerror(rc));
+		stats->num_errors++;
+		goto cleanup;
+	}
+
+	/* the cached fd must see a write done through another fd */
+	device_write_buff(TEST_DEV_FILE, "5678");
+	rc = device_cache_read(TEST_DEV_FILE, buf, sizeof(buf));
+	if (rc != 0 || strcmp(buf, "5678") != 0) {
+		LOG_ERR("stale read of %s: <%s>\n", TEST_DEV_FILE, buf);
+		stats->num_errors++;
+		goto cleanup;
+	}
+
+	rc = device_cache_write(TEST_DEV_FILE, "4321");
+	if (rc == 0)
+		rc = device_cache_read(TEST_DEV_FILE, buf, sizeof(buf));
+	if (rc != 0 || strcmp(buf, "4321") != 0) {
+		LOG_ERR("failed to write %s: %s\n", TEST_DEV_FILE, strerror(rc));
+		stats->num_errors++;
+		goto cleanup;
+	}
+
+	/* short buffers are truncated and terminated */
+	rc = device_cache_read(TEST_DEV_FILE, buf, 3);
+	if (rc != 0 || strcmp(buf, "43") != 0) {
+		LOG_ERR("failed to truncate read of %s: <%s>\n", TEST_DEV_FILE, buf);
+		stats->num_errors++;
+	}
+
+cleanup:
+	device_cache_close(NULL);
+	unlink(TEST_DEV_FILE);
+}
@@ -24,6 +24,10 @@
 #include <errno.h>
 #include <syslog.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
 #include <net/if.h>
 #include <openbmc/ncsi.h>
 #include <netlink/genl/genl.h>
@@ -43,12 +47,43 @@
 // re-used from
 // https://github.com/sammj/ncsi-netlink
 
-static void free_ncsi_msg(struct ncsi_msg *msg)
+static struct nla_policy ncsi_genl_policy[NCSI_ATTR_MAX + 1] = {
+	[NCSI_ATTR_IFINDEX] =      { .type = NLA_U32 },
+	[NCSI_ATTR_PACKAGE_LIST] = { .type = NLA_NESTED },
+	[NCSI_ATTR_PACKAGE_ID] =   { .type = NLA_U32 },
+	[NCSI_ATTR_CHANNEL_ID] =   { .type = NLA_U32 },
+	[NCSI_ATTR_DATA] =         { .type = NLA_BINARY },
+	[NCSI_ATTR_MULTI_FLAG] =   { .type = NLA_FLAG },
+	[NCSI_ATTR_PACKAGE_MASK] = { .type = NLA_U32 },
+	[NCSI_ATTR_CHANNEL_MASK] = { .type = NLA_U32 },
+};
+
+// NCSI family and AEN group ids, resolved once per process
+static pthread_mutex_t ncsi_genl_lock = PTHREAD_MUTEX_INITIALIZER;
+static int ncsi_genl_family = -1;
+static int ncsi_genl_mcgroup = -1;
+
+static int ncsi_genl_resolve(struct nl_sock *sk, bool mcgroup)
 {
-	if (msg->msg)
-		nlmsg_free(msg->msg);
-	if (msg->sk)
-		nl_socket_free(msg->sk);
+	int rc = 0;
+
+	pthread_mutex_lock(&ncsi_genl_lock);
+	if (ncsi_genl_family < 0) {
+		ncsi_genl_family = genl_ctrl_resolve(sk, "NCSI");
+		if (ncsi_genl_family < 0) {
+			syslog(LOG_ERR, "Could not resolve NCSI\n");
+			rc = ncsi_genl_family;
+		}
+	}
+	if (rc == 0 && mcgroup && ncsi_genl_mcgroup < 0) {
+		ncsi_genl_mcgroup = genl_ctrl_resolve_grp(sk, "NCSI", NCSI_GENL_AEN_MCGROUP);
+		if (ncsi_genl_mcgroup < 0) {
+			syslog(LOG_ERR, "Could not resolve AEN MC group. err %d\n", ncsi_genl_mcgroup);
+			rc = ncsi_genl_mcgroup;
+		}
+	}
+	pthread_mutex_unlock(&ncsi_genl_lock);
+	return rc;
 }
 
 static int aen_cb(struct nl_msg *msg, void *arg)
@@ -59,17 +94,6 @@ static int aen_cb(struct nl_msg *msg, void *arg)
 	char *ncsi_rsp;
 	NCSI_NL_RSP_T *dst_buf = (NCSI_NL_RSP_T *) arg;
 
-	static struct nla_policy ncsi_genl_policy[NCSI_ATTR_MAX + 1] = {
-		[NCSI_ATTR_IFINDEX] =      { .type = NLA_U32 },
-		[NCSI_ATTR_PACKAGE_LIST] = { .type = NLA_NESTED },
-		[NCSI_ATTR_PACKAGE_ID] =   { .type = NLA_U32 },
-		[NCSI_ATTR_CHANNEL_ID] =   { .type = NLA_U32 },
-		[NCSI_ATTR_DATA] =         { .type = NLA_BINARY },
-		[NCSI_ATTR_MULTI_FLAG] =   { .type = NLA_FLAG },
-		[NCSI_ATTR_PACKAGE_MASK] = { .type = NLA_U32 },
-		[NCSI_ATTR_CHANNEL_MASK] = { .type = NLA_U32 },
-	};
-
 	rc = genlmsg_parse(hdr, 0, tb, NCSI_ATTR_MAX, ncsi_genl_policy);
 	if (rc) {
 		syslog(LOG_ERR, "Failed to parse ncsi info callback\n");
@@ -108,8 +132,7 @@ static int aen_cb(struct nl_msg *msg, void *arg)
 
 int setup_ncsi_mc_socket(struct nl_sock **sk, unsigned char *dst)
 {
-	int rc, id = 0;
-	int mcgroup = 0;
+	int rc;
 
 	*sk = nl_socket_alloc();
 	if (!(*sk)) {
@@ -123,20 +146,11 @@ int setup_ncsi_mc_socket(struct nl_sock **sk, unsigned char *dst)
 		goto err;
 	}
 
-	id = genl_ctrl_resolve(*sk, "NCSI");
-	if (id < 0) {
-		syslog(LOG_ERR, "Could not resolve NCSI\n");
-		goto err;
-	}
-
 	// resolve AEN MC group and add to socket
-	mcgroup = genl_ctrl_resolve_grp(*sk, "NCSI", NCSI_GENL_AEN_MCGROUP);
-    if (mcgroup < 0) {
-        syslog(LOG_ERR, "Could not resolve AEN MC group. err %d\n", mcgroup);
+	if (ncsi_genl_resolve(*sk, true) < 0)
 		goto err;
-	}
 
-    rc = nl_socket_add_memberships(*sk, mcgroup, 0);
+    rc = nl_socket_add_memberships(*sk, ncsi_genl_mcgroup, 0);
     if (rc) {
         syslog(LOG_ERR, "Could not register to the multicast group. %d\n", rc);
 		goto err;
@@ -152,246 +166,413 @@ err:
 	return -1;
 }
 
-int setup_ncsi_message(struct ncsi_msg *msg, int cmd, int flags)
+struct ncsi_nl_slot {
+	bool used;
+	bool done;
+	int ret;
+	uint32_t seq;
+	NCSI_NL_RSP_T *rsp;
+};
+
+struct ncsi_nl_session {
+	struct nl_sock *sk;
+	struct nl_cb *cb;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	bool reading;      // a thread is receiving for everybody
+	bool broken;       // socket error, reopen before the next command
+	struct ncsi_nl_slot slot[NCSI_NL_MAX_INFLIGHT];
+};
+
+static struct ncsi_nl_slot *session_find(struct ncsi_nl_session *s, uint32_t seq)
 {
-	int rc, id;
-
-	if (!msg)
-		return -1;
-
-	memset(msg, 0, sizeof(*msg));
-	errno = 0;
+	int i;
 
-	msg->sk = nl_socket_alloc();
-	if (!msg->sk) {
-		syslog(LOG_ERR, "Could not alloc socket\n");
-		return -1;
+	for (i = 0; i < NCSI_NL_MAX_INFLIGHT; i++) {
+		if (s->slot[i].used && !s->slot[i].done && s->slot[i].seq == seq)
+			return &s->slot[i];
 	}
-
-	rc = genl_connect(msg->sk);
-	if (rc) {
-		syslog(LOG_ERR, "genl_connect() failed\n");
-		goto out;
-	}
-
-	id = genl_ctrl_resolve(msg->sk, "NCSI");
-	if (id < 0) {
-		syslog(LOG_ERR, "Could not resolve NCSI\n");
-		rc = id;
-		goto out;
-	}
-
-	msg->msg = nlmsg_alloc();
-	if (!msg->msg) {
-		syslog(LOG_ERR, "Failed to allocate message\n");
-		rc = -1;
-		goto out;
-	};
-
-	msg->hdr = genlmsg_put(msg->msg, NL_AUTO_PORT, NL_AUTO_SEQ, id, 0,
-			flags, cmd, 0);
-
-	if (!msg->hdr) {
-		syslog(LOG_ERR, "Failed to create header\n");
-		rc = -1;
-		goto out;
-	}
-
-	msg->ret = 1;
-	return 0;
-
-out:
-	if (errno)
-		syslog(LOG_ERR, "\t%m\n");
-	free_ncsi_msg(msg);
-	return rc;
+	return NULL;
 }
 
-
-static int send_cb(struct nl_msg *msg, void *arg)
+static int session_valid_cb(struct nl_msg *msg, void *arg)
 {
+	struct ncsi_nl_session *s = (struct ncsi_nl_session *)arg;
 	struct nlmsghdr *hdr = nlmsg_hdr(msg);
 	struct nlattr *tb[NCSI_ATTR_MAX + 1] = {0};
+	struct ncsi_nl_slot *slot;
 	int rc, data_len, len;
 	char *ncsi_rsp;
-	struct ncsi_msg *ncsi_msg = (struct ncsi_msg *)arg;
-
-	static struct nla_policy ncsi_genl_policy[NCSI_ATTR_MAX + 1] = {
-		[NCSI_ATTR_IFINDEX] =      { .type = NLA_U32 },
-		[NCSI_ATTR_PACKAGE_LIST] = { .type = NLA_NESTED },
-		[NCSI_ATTR_PACKAGE_ID] =   { .type = NLA_U32 },
-		[NCSI_ATTR_CHANNEL_ID] =   { .type = NLA_U32 },
-		[NCSI_ATTR_DATA] =         { .type = NLA_BINARY },
-		[NCSI_ATTR_MULTI_FLAG] =   { .type = NLA_FLAG },
-		[NCSI_ATTR_PACKAGE_MASK] = { .type = NLA_U32 },
-		[NCSI_ATTR_CHANNEL_MASK] = { .type = NLA_U32 },
-	};
-
-	DBG_PRINT("%s called\n", __FUNCTION__);
+
+	DBG_PRINT("%s called, seq %u\n", __FUNCTION__, hdr->nlmsg_seq);
+	slot = session_find(s, hdr->nlmsg_seq);
+	if (!slot) {
+		syslog(LOG_WARNING, "Drop NC-SI response with unknown seq %u\n", hdr->nlmsg_seq);
+		return NL_SKIP;
+	}
+	slot->done = true;
+	slot->ret = -1;
+
 	rc = genlmsg_parse(hdr, 0, tb, NCSI_ATTR_MAX, ncsi_genl_policy);
-	DBG_PRINT("%s rc = %d\n", __FUNCTION__, rc);
 	if (rc) {
 		syslog(LOG_ERR, "Failed to parse ncsi info callback\n");
-		return rc;
+		return NL_SKIP;
 	}
 
+	// the kernel reports a command which timed out without data
 	if (!tb[NCSI_ATTR_DATA]) {
 		syslog(LOG_ERR, "null data attribute\n");
-		errno = EFAULT;
-		return -1;
+		return NL_SKIP;
 	}
 
 	data_len = nla_len(tb[NCSI_ATTR_DATA]);
 	if (data_len < sizeof(CTRL_MSG_HDR_t)) {
 		syslog(LOG_ERR, "short ncsi data, %u\n", data_len);
-		errno = ERANGE;
-		return -1;
+		return NL_SKIP;
 	}
 
 	/* len includes payload + checksum + FCS */
 	len = data_len - sizeof(CTRL_MSG_HDR_t);
-	if (len > sizeof(ncsi_msg->rsp->msg_payload)) {
-		len = sizeof(ncsi_msg->rsp->msg_payload);
+	if (len > sizeof(slot->rsp->msg_payload)) {
+		len = sizeof(slot->rsp->msg_payload);
 	}
 
 	ncsi_rsp = nla_data(tb[NCSI_ATTR_DATA]);
 	// parse the first 16 bytes of NCSI response (the header area) to get
 	//  payload length
 	CTRL_MSG_HDR_t *pNcsiHdr = (CTRL_MSG_HDR_t *)(void*)(ncsi_rsp);
-	ncsi_msg->rsp->hdr.payload_length = ntohs(pNcsiHdr->Payload_Length);
+	slot->rsp->hdr.payload_length = ntohs(pNcsiHdr->Payload_Length);
 
 	// copy NC-SI response, skip NCSI header bytes
-	memcpy(ncsi_msg->rsp->msg_payload, (void*)(ncsi_rsp + sizeof(CTRL_MSG_HDR_t)),
+	memcpy(slot->rsp->msg_payload, (void*)(ncsi_rsp + sizeof(CTRL_MSG_HDR_t)),
 	       len);
 
 #ifdef DEBUG_LIBNL
 	int i = 0;
 	DBG_PRINT("%s, data len %d\n", __FUNCTION__, data_len);
-  DBG_PRINT("%s, NCSI Response len %d\n", __FUNCTION__, ncsi_msg->rsp->hdr.payload_length);
+	DBG_PRINT("%s, NCSI Response len %d\n", __FUNCTION__, slot->rsp->hdr.payload_length);
 	DBG_PRINT("payload:\n");
-	ncsi_rsp = nla_data(tb[NCSI_ATTR_DATA]);
-
 	for (i = 0; i < data_len; ++i) {
 		DBG_PRINT("0x%x ", *(ncsi_rsp+i));
 	}
 	DBG_PRINT("\n");
 #endif
 
-	// indicating callback has been completed
-	ncsi_msg->ret = 0;
-	return 0;
+	slot->ret = 0;
+	return NL_OK;
 }
 
+static int session_err_cb(struct sockaddr_nl *nla, struct nlmsgerr *err, void *arg)
+{
+	struct ncsi_nl_session *s = (struct ncsi_nl_session *)arg;
+	struct ncsi_nl_slot *slot = session_find(s, err->msg.nlmsg_seq);
+
+	syslog(LOG_ERR, "NC-SI command seq %u failed: %s\n", err->msg.nlmsg_seq,
+	       strerror(-err->error));
+	if (slot) {
+		slot->done = true;
+		slot->ret = -1;
+	}
+	return NL_SKIP;
+}
 
-int run_command_send(int ifindex, NCSI_NL_MSG_T *nl_msg, NCSI_NL_RSP_T *rsp)
+static int session_connect(struct ncsi_nl_session *s)
 {
-	struct ncsi_msg msg;
-	struct ncsi_pkt_hdr *hdr = {0};
-	int rc = 0;
-	int payload_len = nl_msg->payload_length;
-	int package = (nl_msg->channel_id & 0xE0) >> 5;
+	s->sk = nl_socket_alloc_cb(s->cb);
+	if (!s->sk) {
+		syslog(LOG_ERR, "Could not alloc socket\n");
+		return -1;
+	}
+	if (genl_connect(s->sk)) {
+		syslog(LOG_ERR, "genl_connect() failed\n");
+		goto err;
+	}
+	if (ncsi_genl_resolve(s->sk, false) < 0)
+		goto err;
+
+	// responses are matched by sequence number in session_valid_cb,
+	// they need not come back in order
+	nl_socket_disable_seq_check(s->sk);
+	if (nl_socket_set_nonblocking(s->sk) < 0) {
+		syslog(LOG_ERR, "Failed to set socket non-blocking\n");
+		goto err;
+	}
+	s->broken = false;
+	return 0;
 
-	uint8_t *pData, *pCtrlPktPayload;
+err:
+	nl_socket_free(s->sk);
+	s->sk = NULL;
+	return -1;
+}
 
-	// allocate a  contiguous buffer space to hold ncsi message
-	//  (header + Control Packet payload)
-	pData = calloc(1, sizeof(struct ncsi_pkt_hdr) + payload_len);
-	if (!pData) {
-		syslog(LOG_ERR, "Failed to allocate buffer for control packet, %m\n");
-		goto out;
+struct ncsi_nl_session *ncsi_nl_session_open(void)
+{
+	struct ncsi_nl_session *s;
+	pthread_condattr_t cattr;
+
+	s = calloc(1, sizeof(*s));
+	if (!s) {
+		syslog(LOG_ERR, "Failed to allocate NC-SI session, %m\n");
+		return NULL;
 	}
-	// prepare buffer to be copied to netlink msg
-	hdr = (struct ncsi_pkt_hdr *)pData;
-	pCtrlPktPayload = pData + sizeof(struct ncsi_pkt_hdr);
-	memcpy(pCtrlPktPayload, nl_msg->msg_payload, payload_len);
 
-	rc = setup_ncsi_message(&msg, NCSI_CMD_SEND_CMD, 0);
-	if (rc)
-		return -1;
+	s->cb = nl_cb_alloc(NL_CB_DEFAULT);
+	if (!s->cb) {
+		free(s);
+		return NULL;
+	}
+	nl_cb_set(s->cb, NL_CB_VALID, NL_CB_CUSTOM, session_valid_cb, s);
+	nl_cb_err(s->cb, NL_CB_CUSTOM, session_err_cb, s);
+
+	if (session_connect(s) < 0) {
+		nl_cb_put(s->cb);
+		free(s);
+		return NULL;
+	}
+
+	pthread_mutex_init(&s->lock, NULL);
+	pthread_condattr_init(&cattr);
+	pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+	pthread_cond_init(&s->cond, &cattr);
+	pthread_condattr_destroy(&cattr);
+	return s;
+}
+
+void ncsi_nl_session_close(struct ncsi_nl_session *s)
+{
+	if (!s)
+		return;
+	if (s->sk)
+		nl_socket_free(s->sk);
+	nl_cb_put(s->cb);
+	pthread_cond_destroy(&s->cond);
+	pthread_mutex_destroy(&s->lock);
+	free(s);
+}
+
+int ncsi_nl_submit(struct ncsi_nl_session *s, int ifindex,
+                   NCSI_NL_MSG_T *nl_msg, NCSI_NL_RSP_T *rsp)
+{
+	struct nl_msg *msg = NULL;
+	struct nlattr *attr;
+	struct ncsi_pkt_hdr *hdr;
+	struct ncsi_nl_slot *slot = NULL;
+	int rc, i, handle = -1;
+	int payload_len = nl_msg->payload_length;
+	int package = (nl_msg->channel_id & 0xE0) >> 5;
+	int channel = nl_msg->channel_id & 0x1F;
+	uint8_t *pData;
 
-	nl_msg->channel_id &= 0x1F;
 	DBG_PRINT("send cmd, ifindex %d, package %d, channel %d, cmd 0x%x\n",
-			ifindex, package, nl_msg->channel_id, nl_msg->cmd);
+			ifindex, package, channel, nl_msg->cmd);
 
-	msg.rsp = rsp;
-	msg.rsp->hdr.cmd = nl_msg->cmd;
+	msg = nlmsg_alloc();
+	if (!msg) {
+		syslog(LOG_ERR, "Failed to allocate message\n");
+		return -1;
+	}
 
-	rc = nla_put_u32(msg.msg, NCSI_ATTR_IFINDEX, ifindex);
-	if (rc) {
-		syslog(LOG_ERR, "Failed to add ifindex, %m\n");
+	if (!genlmsg_put(msg, NL_AUTO_PORT, NL_AUTO_SEQ, ncsi_genl_family, 0, 0,
+	                 NCSI_CMD_SEND_CMD, 0)) {
+		syslog(LOG_ERR, "Failed to create header\n");
 		goto out;
 	}
 
-	if (package >= 0) {
-		rc = nla_put_u32(msg.msg, NCSI_ATTR_PACKAGE_ID, package);
-		if (rc) {
-			syslog(LOG_ERR, "Failed to add package id, %m\n");
-			goto out;
-		}
+	if (nla_put_u32(msg, NCSI_ATTR_IFINDEX, ifindex) ||
+	    nla_put_u32(msg, NCSI_ATTR_PACKAGE_ID, package) ||
+	    nla_put_u32(msg, NCSI_ATTR_CHANNEL_ID, channel)) {
+		syslog(LOG_ERR, "Failed to add ifindex/package/channel, %m\n");
+		goto out;
 	}
 
-	rc = nla_put_u32(msg.msg, NCSI_ATTR_CHANNEL_ID, nl_msg->channel_id);
-	if (rc) {
-		syslog(LOG_ERR, "Failed to add channel, %m\n");
+	// NC-SI packet header + Control Packet payload, built in place
+	attr = nla_reserve(msg, NCSI_ATTR_DATA, sizeof(struct ncsi_pkt_hdr) + payload_len);
+	if (!attr) {
+		syslog(LOG_ERR, "Failed to add opcode, %m\n");
+		goto out;
 	}
-
-
+	pData = nla_data(attr);
+	memset(pData, 0, sizeof(struct ncsi_pkt_hdr));
+	hdr = (struct ncsi_pkt_hdr *)pData;
 	hdr->type = nl_msg->cmd;
 	hdr->length = htons(payload_len);  // NC-SI command payload length
-	rc = nla_put(msg.msg, NCSI_ATTR_DATA,
-		sizeof(struct ncsi_pkt_hdr) + payload_len, (void *)pData);
-	if (rc) {
-		syslog(LOG_ERR, "Failed to add opcode, %m\n");
+	memcpy(pData + sizeof(struct ncsi_pkt_hdr), nl_msg->msg_payload, payload_len);
+
+	rsp->hdr.cmd = nl_msg->cmd;
+
+	pthread_mutex_lock(&s->lock);
+	for (i = 0; i < NCSI_NL_MAX_INFLIGHT; i++) {
+		if (!s->slot[i].used) {
+			slot = &s->slot[i];
+			handle = i;
+			break;
+		}
 	}
-	nl_socket_disable_seq_check(msg.sk);
-	rc = nl_socket_modify_cb(msg.sk, NL_CB_VALID, NL_CB_CUSTOM, send_cb, &msg);
-	if (rc) {
-		syslog(LOG_ERR, "Failed to modify callback function, %m\n");
-		goto out;
+	if (!slot) {
+		syslog(LOG_ERR, "Too many NC-SI commands in flight\n");
+		goto unlock;
+	}
+	if (s->broken || !s->sk) {
+		if (s->sk)
+			nl_socket_free(s->sk);
+		s->sk = NULL;
+		if (session_connect(s) < 0) {
+			handle = -1;
+			goto unlock;
+		}
 	}
 
-	rc = nl_send_auto(msg.sk, msg.msg);
+	rc = nl_send_auto(s->sk, msg);
 	if (rc < 0) {
-		syslog(LOG_ERR, "Failed to send message, %m\n");
-		goto out;
+		syslog(LOG_ERR, "Failed to send message, %s\n", nl_geterror(rc));
+		s->broken = true;
+		handle = -1;
+		goto unlock;
 	}
+	slot->used = true;
+	slot->done = false;
+	slot->ret = -1;
+	slot->seq = nlmsg_hdr(msg)->nlmsg_seq;
+	slot->rsp = rsp;
+
+unlock:
+	pthread_mutex_unlock(&s->lock);
+out:
+	nlmsg_free(msg);
+	return handle;
+}
 
-	while (msg.ret == 1) {
-		rc = nl_recvmsgs_default(msg.sk);
-		DBG_PRINT("%s, rc = %d\n", __FUNCTION__, rc);
-		if (rc) {
-			syslog(LOG_ERR, "Failed to receive message, rc=%d %m\n", rc);
-			goto out;
+// Receive everything queued on the socket, with s->lock held
+static int session_drain(struct ncsi_nl_session *s)
+{
+	int rc, i;
+
+	for (i = 0; i < 64; i++) {
+		rc = nl_recvmsgs(s->sk, s->cb);
+		if (rc == -NLE_AGAIN)
+			return 0;
+		if (rc < 0 && rc != -NLE_MSG_TRUNC) {
+			syslog(LOG_ERR, "Failed to receive message, rc=%d %s\n", rc, nl_geterror(rc));
+			s->broken = true;
+			return -1;
 		}
 	}
+	return 0;
+}
 
-out:
-	free_ncsi_msg(&msg);
-	if (pData)
-		free(pData);
-	return rc;
+/*
+ * One waiter at a time receives and completes whatever arrived, for all
+ * commands in flight; the others sleep until their response was handled
+ * or they get to receive themselves.
+ */
+int ncsi_nl_complete(struct ncsi_nl_session *s, int handle, int timeout_ms)
+{
+	struct ncsi_nl_slot *slot;
+	struct timespec deadline, now;
+	struct pollfd pfd;
+	int remaining, ret = 0;
+
+	if (handle < 0 || handle >= NCSI_NL_MAX_INFLIGHT)
+		return -1;
+	slot = &s->slot[handle];
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += timeout_ms / 1000;
+	deadline.tv_nsec += (timeout_ms % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	pthread_mutex_lock(&s->lock);
+	while (!slot->done && ret == 0) {
+		if (s->reading) {
+			if (pthread_cond_timedwait(&s->cond, &s->lock, &deadline) == ETIMEDOUT)
+				break;
+			continue;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		remaining = (deadline.tv_sec - now.tv_sec) * 1000 +
+		            (deadline.tv_nsec - now.tv_nsec) / 1000000;
+		if (remaining <= 0 || s->broken)
+			break;
+
+		s->reading = true;
+		pfd.fd = nl_socket_get_fd(s->sk);
+		pfd.events = POLLIN;
+		pthread_mutex_unlock(&s->lock);
+		do {
+			ret = poll(&pfd, 1, remaining);
+		} while (ret < 0 && errno == EINTR);
+		pthread_mutex_lock(&s->lock);
+		s->reading = false;
+
+		ret = (ret > 0) ? session_drain(s) : 0;
+		// let another waiter take over receiving
+		pthread_cond_broadcast(&s->cond);
+	}
+
+	if (slot->done) {
+		ret = slot->ret;
+	} else {
+		syslog(LOG_ERR, "NC-SI command seq %u timed out\n", slot->seq);
+		ret = -1;
+	}
+	slot->used = false;
+	pthread_mutex_unlock(&s->lock);
+	return ret;
+}
+
+int ncsi_nl_send_cmd(struct ncsi_nl_session *s, NCSI_NL_MSG_T *nl_msg,
+                     NCSI_NL_RSP_T *rsp)
+{
+	unsigned int ifindex;
+	int handle;
+
+	ifindex = if_nametoindex(nl_msg->dev_name);
+	// if_nametoindex returns 0 on error
+	if (ifindex == 0) {
+		syslog(LOG_ERR, "Invalid netdev %s %m\n", nl_msg->dev_name);
+		return -1;
+	}
+
+	handle = ncsi_nl_submit(s, ifindex, nl_msg, rsp);
+	if (handle < 0)
+		return -1;
+	return ncsi_nl_complete(s, handle, NCSI_NL_TIMEOUT_MS);
+}
+
+static pthread_mutex_t default_session_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct ncsi_nl_session *default_session = NULL;
+
+static struct ncsi_nl_session *get_default_session(void)
+{
+	pthread_mutex_lock(&default_session_lock);
+	if (!default_session)
+		default_session = ncsi_nl_session_open();
+	pthread_mutex_unlock(&default_session_lock);
+	return default_session;
 }
 
 // Sending data to kernel via netlink libnl
 NCSI_NL_RSP_T * send_nl_msg_libnl(NCSI_NL_MSG_T *nl_msg)
 {
   NCSI_NL_RSP_T *ret_buf = NULL;
-  unsigned int ifindex = 0;  // network interface (e.g. eth0)'s ifindex
+  struct ncsi_nl_session *s;
 
-  ifindex = if_nametoindex(nl_msg->dev_name);
-  // if_nametoindex returns 0 on error
-  if (ifindex == 0) {
-    syslog(LOG_ERR, "Invalid netdev %s %m\n", nl_msg->dev_name);
+  s = get_default_session();
+  if (!s)
     return NULL;
-  }
 
   ret_buf = calloc(1, sizeof(NCSI_NL_RSP_T));
   if (!ret_buf) {
-    syslog(LOG_ERR, "Failed to allocate rspbuf %d  %m\n", sizeof(NCSI_NL_RSP_T));
+    syslog(LOG_ERR, "Failed to allocate rspbuf %zu  %m\n", sizeof(NCSI_NL_RSP_T));
     return NULL;
   }
 
-  if (run_command_send(ifindex, nl_msg, ret_buf)) {
+  if (ncsi_nl_send_cmd(s, nl_msg, ret_buf)) {
 	syslog(LOG_ERR, "run cmd send failed");
     free(ret_buf);
     return NULL;
@@ -406,6 +587,15 @@ int nl_rcv_msg(struct nl_sock *sk)
   return nl_recvmsgs_default(sk);
 }
 
+// fd of the socket, switched to non-blocking, for callers waiting on it
+// with poll/epoll before calling nl_rcv_msg
+int nl_poll_fd(struct nl_sock *sk)
+{
+  if (nl_socket_set_nonblocking(sk) < 0)
+    return -1;
+  return nl_socket_get_fd(sk);
+}
+
 // wrapper for freeing socket
 int libnl_free_socket(struct nl_sock *sk)
 {
@@ -74,20 +74,37 @@ struct ncsi_pkt_hdr {
 	__be32        reserved1[2]; /* Reserved                 */
 };
 
-struct ncsi_msg {
-	struct nl_sock  *sk;
-	struct nl_msg   *msg;
-	struct nlmsghdr *hdr;
-	NCSI_NL_RSP_T   *rsp;
-	int             ret;
-};
+/*
+ * Long-lived NC-SI netlink session. The socket is connected and the NCSI
+ * family resolved once; responses are matched to commands by netlink
+ * sequence number, so up to NCSI_NL_MAX_INFLIGHT commands, for any
+ * channel, may be outstanding. A session may be shared by threads.
+ */
+#define NCSI_NL_MAX_INFLIGHT 8
+#define NCSI_NL_TIMEOUT_MS   10000
+
+struct ncsi_nl_session;
 
+struct ncsi_nl_session *ncsi_nl_session_open(void);
+void ncsi_nl_session_close(struct ncsi_nl_session *s);
+// Sends the command, rsp is filled in when it completes. Returns a
+// handle for ncsi_nl_complete(), or -1.
+int ncsi_nl_submit(struct ncsi_nl_session *s, int ifindex,
+                   NCSI_NL_MSG_T *nl_msg, NCSI_NL_RSP_T *rsp);
+// Waits for a submitted command. Returns 0 once rsp is filled in, -1 on
+// error or timeout. The handle is released in both cases.
+int ncsi_nl_complete(struct ncsi_nl_session *s, int handle, int timeout_ms);
+// submit + complete
+int ncsi_nl_send_cmd(struct ncsi_nl_session *s, NCSI_NL_MSG_T *nl_msg,
+                     NCSI_NL_RSP_T *rsp);
 
 // APIs
+// Runs on a process-wide session, opened on first use
 NCSI_NL_RSP_T * send_nl_msg_libnl(NCSI_NL_MSG_T *nl_msg);
 int setup_ncsi_mc_socket(struct nl_sock **sk, unsigned char *dst);
 int islibnl(void);
 int nl_rcv_msg(struct nl_sock *sk);
+int nl_poll_fd(struct nl_sock *sk);
 int libnl_free_socket(struct nl_sock *sk);
 #ifdef __cplusplus
 } // extern "C"
@@ -25,6 +25,10 @@
 #include <openbmc/obmc-i2c.h>
 #include <time.h>
 #include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
 #include "nvme-mi.h"
 
 // Helper function for msleep
@@ -40,96 +44,369 @@ msleep(int msec) {
   }
 }
 
-/* Read a byte from NVMe-MI 0x6A. Need to give a bus and a byte address for reading. */
-int
-nvme_read_byte(const char *i2c_bus_device, uint8_t item, uint8_t *value) {
-  int dev;
-  int ret;
-  int32_t res;
-  int retry = 0;
+/*
+ * The bus fds are kept open across calls, with the slave address already
+ * set, since drive status is polled periodically and NVMe-MI is the only
+ * user of 0x6A. Each bus has its own lock so a scan can run the buses in
+ * parallel while transactions on one bus stay serialized.
+ */
+#define NVME_MAX_BUSES 32
+#define NVME_RETRY 5
+
+typedef struct {
+  char path[32];
+  int fd;
+  pthread_mutex_t lock;
+} nvme_bus_t;
+
+static nvme_bus_t nvme_buses[NVME_MAX_BUSES];
+static int nvme_num_buses = 0;
+static pthread_mutex_t nvme_buses_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static nvme_bus_t *
+nvme_bus_get(const char *i2c_bus_device) {
+  nvme_bus_t *bus = NULL;
+  int i;
+
+  if (strlen(i2c_bus_device) >= sizeof(bus->path)) {
+    return NULL;
+  }
+
+  pthread_mutex_lock(&nvme_buses_lock);
+  for (i = 0; i < nvme_num_buses; i++) {
+    if (!strcmp(nvme_buses[i].path, i2c_bus_device)) {
+      bus = &nvme_buses[i];
+      break;
+    }
+  }
+  if (bus == NULL && nvme_num_buses < NVME_MAX_BUSES) {
+    bus = &nvme_buses[nvme_num_buses++];
+    strcpy(bus->path, i2c_bus_device);
+    bus->fd = -1;
+    pthread_mutex_init(&bus->lock, NULL);
+  }
+  pthread_mutex_unlock(&nvme_buses_lock);
+
+  if (bus == NULL) {
+    syslog(LOG_WARNING, "%s(): too many buses, %s not cached", __func__, i2c_bus_device);
+  }
+  return bus;
+}
 
-  dev = open(i2c_bus_device, O_RDWR);
-  if (dev < 0) {
-    syslog(LOG_DEBUG, "%s(): open() failed", __func__);
+/* Called with bus->lock held. */
+static int
+nvme_bus_open(nvme_bus_t *bus) {
+  if (bus->fd >= 0) {
+    return bus->fd;
+  }
+
+  bus->fd = open(bus->path, O_RDWR | O_CLOEXEC);
+  if (bus->fd < 0) {
+    syslog(LOG_DEBUG, "%s(): open() %s failed", __func__, bus->path);
     return -1;
   }
 
-  ret = ioctl(dev, I2C_SLAVE, I2C_NVME_INTF_ADDR);
-  if (ret < 0) {
+  if (ioctl(bus->fd, I2C_SLAVE, I2C_NVME_INTF_ADDR) < 0) {
     syslog(LOG_DEBUG, "%s(): ioctl() assigning i2c addr failed", __func__);
-    close(dev);
+    close(bus->fd);
+    bus->fd = -1;
     return -1;
   }
+  return bus->fd;
+}
 
-  res = i2c_smbus_read_byte_data(dev, item);
-  retry = 0;
-  while ((retry < 5) && (res < 0)) {
-    msleep(100);
-    res = i2c_smbus_read_byte_data(dev, item);
-    if (res < 0)
-      retry++;
-    else
-      break;
+/* Called with bus->lock held, after a failed transaction. */
+static void
+nvme_bus_reset(nvme_bus_t *bus) {
+  // The adapter may have gone away (hot-plugged mux), open it again next time
+  if (errno == ENODEV || errno == ENXIO || errno == EBADF) {
+    close(bus->fd);
+    bus->fd = -1;
   }
+}
 
-  if (res < 0) {
-    syslog(LOG_DEBUG, "%s(): i2c_smbus_read_byte_data failed", __func__);
-    close(dev);
+/*
+ * Run one transaction on the cached fd of the bus with the usual retries.
+ * xfer returns < 0 on failure.
+ */
+static int
+nvme_bus_xfer(const char *i2c_bus_device,
+              int (*xfer)(int fd, void *arg), void *arg) {
+  nvme_bus_t *bus;
+  int fd, ret = -1;
+  int retry;
+
+  bus = nvme_bus_get(i2c_bus_device);
+  if (bus == NULL) {
     return -1;
   }
 
-  *value = (uint8_t) res;
+  pthread_mutex_lock(&bus->lock);
+  for (retry = 0; retry <= NVME_RETRY; retry++) {
+    if (retry) {
+      msleep(100);
+    }
+    fd = nvme_bus_open(bus);
+    if (fd < 0) {
+      continue;
+    }
+    ret = xfer(fd, arg);
+    if (ret >= 0) {
+      break;
+    }
+    nvme_bus_reset(bus);
+  }
+  pthread_mutex_unlock(&bus->lock);
+
+  return ret;
+}
+
+typedef struct {
+  uint8_t cmd;
+  uint8_t len;
+  uint8_t *buf;
+} nvme_xfer_t;
 
-  close(dev);
+static int
+nvme_xfer_byte(int fd, void *arg) {
+  nvme_xfer_t *x = arg;
+  int32_t res;
+
+  res = i2c_smbus_read_byte_data(fd, x->cmd);
+  if (res >= 0) {
+    x->buf[0] = (uint8_t)res;
+  }
+  return res;
+}
+
+static int
+nvme_xfer_word(int fd, void *arg) {
+  nvme_xfer_t *x = arg;
+  int32_t res;
+  uint16_t word;
+
+  res = i2c_smbus_read_word_data(fd, x->cmd);
+  if (res >= 0) {
+    word = (uint16_t)res;
+    memcpy(x->buf, &word, sizeof(word));
+  }
+  return res;
+}
+
+/* Read a byte from NVMe-MI 0x6A. Need to give a bus and a byte address for reading. */
+int
+nvme_read_byte(const char *i2c_bus_device, uint8_t item, uint8_t *value) {
+  nvme_xfer_t x = {.cmd = item, .len = 1, .buf = value};
 
+  if (nvme_bus_xfer(i2c_bus_device, nvme_xfer_byte, &x) < 0) {
+    syslog(LOG_DEBUG, "%s(): i2c_smbus_read_byte_data failed", __func__);
+    return -1;
+  }
   return 0;
 }
 
 /* Read a word from NVMe-MI 0x6A. Need to give a bus and a byte address for reading. */
 int
 nvme_read_word(const char *i2c_bus_device, uint8_t item, uint16_t *value) {
-  int dev;
-  int ret;
-  int32_t res;
-  int retry = 0;
+  nvme_xfer_t x = {.cmd = item, .len = 2, .buf = (uint8_t *)value};
 
-  dev = open(i2c_bus_device, O_RDWR);
-  if (dev < 0) {
-    syslog(LOG_DEBUG, "%s(): open() failed", __func__);
+  if (nvme_bus_xfer(i2c_bus_device, nvme_xfer_word, &x) < 0) {
+    syslog(LOG_DEBUG, "%s(): i2c_smbus_read_word_data failed", __func__);
     return -1;
   }
+  return 0;
+}
 
-  ret = ioctl(dev, I2C_SLAVE, I2C_NVME_INTF_ADDR);
-  if (ret < 0) {
-    syslog(LOG_DEBUG, "%s(): ioctl() assigning i2c addr failed", __func__);
-    close(dev);
-    return -1;
+/* SMBus PEC, CRC-8 with polynomial x^8 + x^2 + x + 1 */
+static uint8_t
+nvme_crc8(uint8_t crc, const uint8_t *data, int len) {
+  int i, j;
+
+  for (i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (j = 0; j < 8; j++) {
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
   }
+  return crc;
+}
 
-  res = i2c_smbus_read_word_data(dev, item);
-  retry = 0;
-  while ((retry < 5) && (res < 0)) {
-    msleep(100);
-    res = i2c_smbus_read_word_data(dev, item);
-    if (res < 0)
-      retry++;
-    else
-      break;
+/*
+ * Every block of the basic management data is laid out as an SMBus block
+ * read response for its own command code: a length byte, the data, and a
+ * PEC over the address, command, address and response.
+ */
+static int
+nvme_pec_check(const uint8_t *buf, uint8_t cmd, uint8_t len) {
+  uint8_t hdr[3] = {I2C_NVME_INTF_ADDR << 1, cmd, (I2C_NVME_INTF_ADDR << 1) | 1};
+  uint8_t crc;
+
+  if (buf[cmd] != len) {
+    return -1;
   }
+  crc = nvme_crc8(0, hdr, sizeof(hdr));
+  crc = nvme_crc8(crc, &buf[cmd], len + 1);
+  return crc == buf[cmd + len + 1] ? 0 : -1;
+}
 
-  if (res < 0) {
-    syslog(LOG_DEBUG, "%s(): i2c_smbus_read_byte_data failed", __func__);
-    close(dev);
+static int
+nvme_xfer_basic_mgmt(int fd, void *arg) {
+  nvme_xfer_t *x = arg;
+
+  // One read of the whole structure, the drive auto-increments the offset
+  if (i2c_smbus_read_i2c_block_data(fd, x->cmd, x->len, x->buf) != x->len) {
+    return -1;
+  }
+  // Only the status block has to be good, the identification block is
+  // checked by the caller as not every drive implements it
+  if (nvme_pec_check(x->buf, NVME_STATUS_CMD, NVME_STATUS_LEN)) {
+    // a corrupted transfer is worth a retry like a NAK
+    syslog(LOG_DEBUG, "%s(): status block PEC mismatch", __func__);
+    errno = EBADMSG;
     return -1;
   }
+  return 0;
+}
+
+static int
+nvme_serial_num_read_bytes(const char *i2c_bus_device, uint8_t *value) {
+  int count;
+
+  for (count = 0; count < SERIAL_NUM_SIZE; count++) {
+    if (nvme_read_byte(i2c_bus_device, NVME_SERIAL_NUM_REG + count, value + count) < 0) {
+      syslog(LOG_DEBUG, "%s(): nvme_read_byte failed", __func__);
+      return -1;
+    }
+  }
+  return 0;
+}
 
-  *value = (uint16_t) res;
+/*
+ * Read the NVMe-MI basic management data structure (offsets 0 to 31) in a
+ * single transaction and fill the matching fields of data. The rest of
+ * data is left untouched.
+ * The status block and the identification block are validated separately.
+ * If the block read fails, the fields are read one by one; if only the
+ * identification block is bad, the vendor ID and serial number are.
+ * Returns 0 if all fields were read, NVME_MGMT_ID_INVALID if only the status
+ * fields (sflgs, warning, temp, pdlu) were, and -1 on failure.
+ */
+int
+nvme_basic_mgmt_read(const char *i2c_bus_device, ssd_data *data) {
+  uint8_t buf[NVME_BASIC_MGMT_SIZE];
+  nvme_xfer_t x = {.cmd = NVME_STATUS_CMD, .len = sizeof(buf), .buf = buf};
 
-  close(dev);
+  if (data == NULL) {
+    return -1;
+  }
 
+  if (nvme_bus_xfer(i2c_bus_device, nvme_xfer_basic_mgmt, &x) < 0) {
+    syslog(LOG_DEBUG, "%s(): block read of basic management data from %s failed",
+           __func__, i2c_bus_device);
+    if (nvme_sflgs_read(i2c_bus_device, &data->sflgs) ||
+        nvme_smart_warning_read(i2c_bus_device, &data->warning) ||
+        nvme_temp_read(i2c_bus_device, &data->temp) ||
+        nvme_pdlu_read(i2c_bus_device, &data->pdlu)) {
+      return -1;
+    }
+  } else {
+    data->sflgs = buf[NVME_SFLGS_REG];
+    data->warning = buf[NVME_WARNING_REG];
+    data->temp = buf[NVME_TEMP_REG];
+    data->pdlu = buf[NVME_PDLU_REG];
+
+    // length 0xFF means the drive does not implement the block
+    if (nvme_pec_check(buf, NVME_ID_CMD, NVME_ID_LEN) == 0) {
+      data->vendor = (buf[NVME_VENDOR_REG] << 8) | buf[NVME_VENDOR_REG + 1];
+      memcpy(data->serial_num, &buf[NVME_SERIAL_NUM_REG], SERIAL_NUM_SIZE);
+      return 0;
+    }
+    syslog(LOG_DEBUG, "%s(): identification block from %s is not valid (len 0x%02X)",
+           __func__, i2c_bus_device, buf[NVME_ID_CMD]);
+  }
+
+  if (nvme_vendor_read(i2c_bus_device, &data->vendor) ||
+      nvme_serial_num_read_bytes(i2c_bus_device, data->serial_num)) {
+    return NVME_MGMT_ID_INVALID;
+  }
   return 0;
 }
 
+typedef struct {
+  const char **i2c_bus_devices;
+  ssd_data *data;
+  int *status;
+  int num;
+  int first;
+} nvme_scan_t;
+
+static void *
+nvme_scan_bus(void *arg) {
+  nvme_scan_t *scan = arg;
+  const char *bus = scan->i2c_bus_devices[scan->first];
+  int i;
+
+  // the drives of one bus, in order
+  for (i = scan->first; i < scan->num; i++) {
+    if (strcmp(scan->i2c_bus_devices[i], bus)) {
+      continue;
+    }
+    scan->status[i] = nvme_basic_mgmt_read(bus, &scan->data[i]);
+  }
+  return NULL;
+}
+
+/*
+ * Read the basic management data of num drives, one thread per distinct
+ * bus. Drives sharing a bus are read one after the other. status[i] is set
+ * to the result of nvme_basic_mgmt_read() for i2c_bus_devices[i]. Returns
+ * the number of drives read successfully.
+ */
+int
+nvme_basic_mgmt_scan(const char **i2c_bus_devices, int num, ssd_data *data, int *status) {
+  nvme_scan_t scans[NVME_MAX_BUSES];
+  pthread_t tids[NVME_MAX_BUSES];
+  nvme_scan_t inline_scan;
+  int i, j, nscan = 0, ok = 0;
+
+  if (i2c_bus_devices == NULL || data == NULL || status == NULL || num <= 0) {
+    return -1;
+  }
+
+  for (i = 0; i < num; i++) {
+    status[i] = -1;
+    for (j = 0; j < i; j++) {
+      if (!strcmp(i2c_bus_devices[i], i2c_bus_devices[j])) {
+        break;
+      }
+    }
+    if (j < i) {
+      continue;  // this bus already has its thread
+    }
+
+    if (nscan < NVME_MAX_BUSES) {
+      scans[nscan] = (nvme_scan_t){i2c_bus_devices, data, status, num, i};
+      if (pthread_create(&tids[nscan], NULL, nvme_scan_bus, &scans[nscan]) == 0) {
+        nscan++;
+        continue;
+      }
+    }
+    inline_scan = (nvme_scan_t){i2c_bus_devices, data, status, num, i};
+    nvme_scan_bus(&inline_scan);
+  }
+
+  for (i = 0; i < nscan; i++) {
+    pthread_join(tids[i], NULL);
+  }
+
+  for (i = 0; i < num; i++) {
+    if (status[i] == 0) {
+      ok++;
+    }
+  }
+  return ok;
+}
+
 /* Read NVMe-MI Status Flags. Need to give a bus for reading. */
 int
 nvme_sflgs_read(const char *i2c_bus_device, uint8_t *value) {
@@ -210,23 +487,26 @@ nvme_vendor_read(const char *i2c_bus_device, uint16_t *value) {
 /* Read NVMe-MI Serial Number. Need to give a bus for reading. */
 int
 nvme_serial_num_read(const char *i2c_bus_device, uint8_t *value, int size) {
+  ssd_data ssd;
   int ret;
-  uint8_t reg = NVME_SERIAL_NUM_REG;
-  int count;
 
   if(size != SERIAL_NUM_SIZE) {
     syslog(LOG_DEBUG, "%s(): the array size is wrong", __func__);
     return -1;
   }
 
-  for(count = 0; count < SERIAL_NUM_SIZE; count++) {
-    ret = nvme_read_byte(i2c_bus_device, reg + count, value + count);
-    if(ret < 0) {
-      syslog(LOG_DEBUG, "%s(): nvme_read_byte failed", __func__);
-      return -1;
-    }
+  ret = nvme_basic_mgmt_read(i2c_bus_device, &ssd);
+  if (ret == 0) {
+    memcpy(value, ssd.serial_num, SERIAL_NUM_SIZE);
+    return 0;
   }
-  return 0;
+  if (ret == NVME_MGMT_ID_INVALID) {
+    // the serial number byte reads were already tried
+    syslog(LOG_DEBUG, "%s(): nvme_basic_mgmt_read failed", __func__);
+    return -1;
+  }
+  // the status fields failed, the serial number may still be readable
+  return nvme_serial_num_read_bytes(i2c_bus_device, value);
 }
 
 int
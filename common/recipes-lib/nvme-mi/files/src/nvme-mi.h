@@ -29,6 +29,20 @@
 #define SERIAL_NUM_SIZE 20
 #define PART_NUM_SIZE 40
 
+/*
+ * Basic management command data structure: two SMBus blocks, the drive
+ * status at command code 0 and the vendor ID and serial number at 8,
+ * each with a length byte and a trailing PEC.
+ */
+#define NVME_STATUS_CMD 0x00
+#define NVME_STATUS_LEN 6
+#define NVME_ID_CMD 0x08
+#define NVME_ID_LEN 22
+#define NVME_BASIC_MGMT_SIZE 32
+
+/* nvme_basic_mgmt_read(): status fields read, vendor ID and serial number not */
+#define NVME_MGMT_ID_INVALID 1
+
 /* NVMe-MI Temperature Definition Code */
 #define TEMP_HIGHER_THAN_127 0x7F
 #define TEPM_LOWER_THAN_n60 0xC4
@@ -173,6 +187,8 @@ int nvme_temp_read(const char *i2c_bus, uint8_t *value);
 int nvme_pdlu_read(const char *i2c_bus, uint8_t *value);
 int nvme_vendor_read(const char *i2c_bus, uint16_t *value);
 int nvme_serial_num_read(const char *i2c_bus, uint8_t *value, int size);
+int nvme_basic_mgmt_read(const char *i2c_bus, ssd_data *data);
+int nvme_basic_mgmt_scan(const char **i2c_bus, int num, ssd_data *data, int *status);
 
 int check_nvme_fileds_valid(uint8_t block_len, t_key_value_pair *tmp_decoding);
 int nvme_sflgs_decode(uint8_t value, t_status_flags *status_flag_decoding);
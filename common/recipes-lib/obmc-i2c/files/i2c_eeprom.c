@@ -0,0 +1,194 @@
+/*
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This file contains code to program I2C EEPROMs over any I2C master
+ * which can issue a write-then-read transfer.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "i2c_eeprom.h"
+
+#define ACK_POLL_INTERVAL_US	500
+
+static uint64_t now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static size_t eeprom_set_addr(const struct i2c_eeprom *eeprom,
+			      uint8_t *wbuf, uint32_t offset)
+{
+	if (eeprom->addr_width == 1) {
+		wbuf[0] = offset & 0xFF;
+	} else {
+		wbuf[0] = (offset >> 8) & 0xFF;
+		wbuf[1] = offset & 0xFF;
+	}
+	return eeprom->addr_width;
+}
+
+static int eeprom_valid(const struct i2c_eeprom *eeprom)
+{
+	if (eeprom == NULL || eeprom->xfer == NULL ||
+	    (eeprom->addr_width != 1 && eeprom->addr_width != 2) ||
+	    eeprom->page_size == 0 ||
+	    (eeprom->page_size & (eeprom->page_size - 1)) ||
+	    eeprom->max_read == 0) {
+		errno = EINVAL;
+		return 0;
+	}
+	return 1;
+}
+
+int i2c_eeprom_wait_ready(const struct i2c_eeprom *eeprom, uint32_t offset)
+{
+	uint8_t wbuf[2];
+	size_t wcnt;
+	unsigned int timeout;
+	uint64_t deadline;
+
+	if (!eeprom_valid(eeprom))
+		return -1;
+
+	timeout = eeprom->write_timeout_ms ? eeprom->write_timeout_ms :
+		  I2C_EEPROM_WRITE_TIMEOUT_MS;
+	deadline = now_ms() + timeout;
+
+	/*
+	 * Writing the word address alone only moves the EEPROM's address
+	 * pointer, so it is a harmless probe.
+	 */
+	wcnt = eeprom_set_addr(eeprom, wbuf, offset);
+	while (eeprom->xfer(eeprom->priv, wbuf, wcnt, NULL, 0) != 0) {
+		if (now_ms() > deadline) {
+			errno = ETIMEDOUT;
+			return -1;
+		}
+		usleep(ACK_POLL_INTERVAL_US);
+	}
+	return 0;
+}
+
+int i2c_eeprom_read(const struct i2c_eeprom *eeprom, uint32_t offset,
+		    uint8_t *buf, size_t len)
+{
+	uint8_t wbuf[2];
+	size_t wcnt, count;
+
+	if (!eeprom_valid(eeprom))
+		return -1;
+
+	while (len > 0) {
+		count = len < eeprom->max_read ? len : eeprom->max_read;
+		wcnt = eeprom_set_addr(eeprom, wbuf, offset);
+		if (eeprom->xfer(eeprom->priv, wbuf, wcnt, buf, count) != 0) {
+			errno = EIO;
+			return -1;
+		}
+		offset += count;
+		buf += count;
+		len -= count;
+	}
+	return 0;
+}
+
+int i2c_eeprom_write(const struct i2c_eeprom *eeprom, uint32_t offset,
+		     const uint8_t *buf, size_t len)
+{
+	uint8_t *wbuf;
+	size_t max_write, wcnt, count;
+	int ret = 0;
+
+	if (!eeprom_valid(eeprom))
+		return -1;
+
+	max_write = eeprom->max_write ? eeprom->max_write : eeprom->page_size;
+	if (max_write > eeprom->page_size)
+		max_write = eeprom->page_size;
+	wbuf = malloc(eeprom->addr_width + max_write);
+	if (wbuf == NULL)
+		return -1;
+
+	while (len > 0) {
+		/* up to the end of the page, a burst wraps around within it */
+		count = eeprom->page_size - (offset & (eeprom->page_size - 1));
+		if (count > max_write)
+			count = max_write;
+		if (count > len)
+			count = len;
+
+		wcnt = eeprom_set_addr(eeprom, wbuf, offset);
+		memcpy(&wbuf[wcnt], buf, count);
+		if (eeprom->xfer(eeprom->priv, wbuf, wcnt + count, NULL, 0) != 0) {
+			errno = EIO;
+			ret = -1;
+			break;
+		}
+		if (i2c_eeprom_wait_ready(eeprom, offset) != 0) {
+			ret = -1;
+			break;
+		}
+		offset += count;
+		buf += count;
+		len -= count;
+	}
+
+	free(wbuf);
+	return ret;
+}
+
+int i2c_eeprom_verify(const struct i2c_eeprom *eeprom, uint32_t offset,
+		      const uint8_t *buf, size_t len)
+{
+	uint8_t *rbuf;
+	size_t count;
+	int ret = 0;
+
+	if (!eeprom_valid(eeprom))
+		return -1;
+
+	rbuf = malloc(eeprom->max_read);
+	if (rbuf == NULL)
+		return -1;
+
+	while (len > 0) {
+		count = len < eeprom->max_read ? len : eeprom->max_read;
+		if (i2c_eeprom_read(eeprom, offset, rbuf, count) != 0) {
+			ret = -1;
+			break;
+		}
+		if (memcmp(rbuf, buf, count) != 0) {
+			errno = EIO;
+			ret = -1;
+			break;
+		}
+		offset += count;
+		buf += count;
+		len -= count;
+	}
+
+	free(rbuf);
+	return ret;
+}
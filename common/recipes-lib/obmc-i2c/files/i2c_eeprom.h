@@ -0,0 +1,105 @@
+/*
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This file contains code to program I2C EEPROMs over any I2C master
+ * which can issue a write-then-read transfer.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef _OPENBMC_I2C_EEPROM_H_
+#define _OPENBMC_I2C_EEPROM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Access to a 24Cxx style EEPROM through a caller supplied transfer
+ * function, so the same code serves EEPROMs on a local bus and behind a
+ * remote master (for example a bridge IC's "master write-read" command).
+ *
+ * Writes are split into bursts which never cross a write page, and the
+ * end of each internal write cycle is detected by ACK polling: the
+ * EEPROM doesn't acknowledge its address until the cycle is done.
+ */
+
+/*
+ * Write <wcnt> bytes, then read <rcnt> bytes after a repeated start.
+ * <rbuf> is NULL when <rcnt> is 0.
+ *
+ * Return:
+ *   0 for success, and non-zero on failures, including a NACK.
+ */
+typedef int (*i2c_eeprom_xfer_t)(void *priv, uint8_t *wbuf, size_t wcnt,
+				 uint8_t *rbuf, size_t rcnt);
+
+#define I2C_EEPROM_WRITE_TIMEOUT_MS	25	/* tWR is 5 to 10 ms */
+
+struct i2c_eeprom {
+	i2c_eeprom_xfer_t xfer;
+	void *priv;
+	size_t addr_width;	/* bytes of word address, 1 or 2 */
+	size_t page_size;	/* write page size, a power of 2 */
+	size_t max_write;	/* data bytes per write transfer, 0 for page_size */
+	size_t max_read;	/* bytes per read transfer */
+	unsigned int write_timeout_ms;	/* 0 for I2C_EEPROM_WRITE_TIMEOUT_MS */
+};
+
+/*
+ * Read <len> bytes at <offset>, in transfers of at most max_read bytes.
+ *
+ * Return:
+ *   0 for success, and -1 on failures.
+ */
+int i2c_eeprom_read(const struct i2c_eeprom *eeprom, uint32_t offset,
+		    uint8_t *buf, size_t len);
+
+/*
+ * Write <len> bytes at <offset>, and wait for the last write cycle to
+ * complete.
+ *
+ * Return:
+ *   0 for success, and -1 on failures (errno is ETIMEDOUT if the EEPROM
+ *   stayed busy).
+ */
+int i2c_eeprom_write(const struct i2c_eeprom *eeprom, uint32_t offset,
+		     const uint8_t *buf, size_t len);
+
+/*
+ * Compare <len> bytes at <offset> with <buf>, in bulk reads.
+ *
+ * Return:
+ *   0 if they match, and -1 on mismatch (errno is EIO) or failures.
+ */
+int i2c_eeprom_verify(const struct i2c_eeprom *eeprom, uint32_t offset,
+		      const uint8_t *buf, size_t len);
+
+/*
+ * Poll the EEPROM until it acknowledges, i.e. its write cycle is done.
+ *
+ * Return:
+ *   0 for success, and -1 on timeout.
+ */
+int i2c_eeprom_wait_ready(const struct i2c_eeprom *eeprom, uint32_t offset);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* _OPENBMC_I2C_EEPROM_H_ */
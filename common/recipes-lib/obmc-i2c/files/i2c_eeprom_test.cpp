@@ -0,0 +1,187 @@
+/*
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <gtest/gtest.h>
+#include "i2c_eeprom.h"
+
+#define EEPROM_SIZE 8192  // 24C64
+#define EEPROM_PAGE 32
+
+/*
+ * Simulated 24C64: 2 address bytes, a burst wraps around within its write
+ * page like on the real part, and the device NACKs everything for
+ * <busy_polls> transfers after each write.
+ */
+struct FakeEeprom {
+  std::vector<uint8_t> mem = std::vector<uint8_t>(EEPROM_SIZE, 0xFF);
+  uint32_t ptr = 0;
+  int busy = 0;
+  int busy_polls = 2;     // NACKed transfers after a write, -1 forever
+  int fail_xfer = -1;     // transfer number which fails, -1 for none
+  int xfers = 0;
+  int polls = 0;
+  std::vector<std::pair<uint32_t, size_t>> bursts;  // data writes
+  std::vector<size_t> reads;                        // read lengths
+
+  static int xfer(void *priv, uint8_t *wbuf, size_t wcnt,
+                  uint8_t *rbuf, size_t rcnt) {
+    FakeEeprom *dev = static_cast<FakeEeprom *>(priv);
+
+    if (dev->xfers++ == dev->fail_xfer) {
+      return -1;
+    }
+    if (dev->busy != 0) {
+      dev->polls++;
+      if (dev->busy > 0) {
+        dev->busy--;
+      }
+      return -1;
+    }
+    if (wcnt < 2) {
+      return -1;
+    }
+
+    dev->ptr = ((wbuf[0] << 8) | wbuf[1]) % EEPROM_SIZE;
+    if (wcnt > 2) {
+      uint32_t page = dev->ptr & ~(EEPROM_PAGE - 1);
+      dev->bursts.push_back({dev->ptr, wcnt - 2});
+      for (size_t i = 2; i < wcnt; i++) {
+        dev->mem[dev->ptr] = wbuf[i];
+        dev->ptr = page | ((dev->ptr + 1) & (EEPROM_PAGE - 1));
+      }
+      dev->busy = dev->busy_polls;
+    }
+    if (rcnt > 0) {
+      dev->reads.push_back(rcnt);
+      for (size_t i = 0; i < rcnt; i++) {
+        rbuf[i] = dev->mem[dev->ptr];
+        dev->ptr = (dev->ptr + 1) % EEPROM_SIZE;
+      }
+    }
+    return 0;
+  }
+};
+
+class I2cEepromTest : public ::testing::Test {
+  protected:
+    FakeEeprom dev;
+    struct i2c_eeprom eeprom;
+    std::vector<uint8_t> data;
+
+    void SetUp() {
+      memset(&eeprom, 0, sizeof(eeprom));
+      eeprom.xfer = FakeEeprom::xfer;
+      eeprom.priv = &dev;
+      eeprom.addr_width = 2;
+      eeprom.page_size = EEPROM_PAGE;
+      eeprom.max_write = 16;
+      eeprom.max_read = 16;
+      eeprom.write_timeout_ms = 5;
+
+      for (int i = 0; i < 100; i++) {
+        data.push_back((uint8_t)(i * 3 + 1));
+      }
+    }
+};
+
+TEST_F(I2cEepromTest, WriteSplitsAtPageBoundaries) {
+  ASSERT_EQ(i2c_eeprom_write(&eeprom, 20, data.data(), data.size()), 0);
+
+  // 20..31 up to the page end, then max_write sized bursts
+  std::vector<std::pair<uint32_t, size_t>> expected = {
+    {20, 12}, {32, 16}, {48, 16}, {64, 16}, {80, 16}, {96, 16}, {112, 8},
+  };
+  EXPECT_EQ(dev.bursts, expected);
+  for (auto &b : dev.bursts) {
+    EXPECT_EQ(b.first / EEPROM_PAGE, (b.first + b.second - 1) / EEPROM_PAGE);
+  }
+  EXPECT_EQ(std::vector<uint8_t>(dev.mem.begin() + 20, dev.mem.begin() + 120),
+            data);
+  EXPECT_EQ(dev.mem[19], 0xFF);
+  EXPECT_EQ(dev.mem[120], 0xFF);
+}
+
+TEST_F(I2cEepromTest, MaxWriteLimitedToPage) {
+  eeprom.max_write = 0;  // page_size
+  ASSERT_EQ(i2c_eeprom_write(&eeprom, 20, data.data(), data.size()), 0);
+
+  std::vector<std::pair<uint32_t, size_t>> expected = {
+    {20, 12}, {32, 32}, {64, 32}, {96, 24},
+  };
+  EXPECT_EQ(dev.bursts, expected);
+}
+
+TEST_F(I2cEepromTest, AckPollWaitsForWriteCycle) {
+  dev.busy_polls = 3;
+  ASSERT_EQ(i2c_eeprom_write(&eeprom, 0, data.data(), 16), 0);
+  EXPECT_EQ(dev.polls, 3);
+  // one more probe, acknowledged, ends the wait
+  EXPECT_EQ(dev.xfers, 1 + 3 + 1);
+}
+
+TEST_F(I2cEepromTest, AckPollTimeout) {
+  dev.busy_polls = -1;
+  errno = 0;
+  EXPECT_EQ(i2c_eeprom_write(&eeprom, 0, data.data(), data.size()), -1);
+  EXPECT_EQ(errno, ETIMEDOUT);
+  // the write stops after the first burst
+  EXPECT_EQ(dev.bursts.size(), 1u);
+  EXPECT_GT(dev.polls, 1);
+}
+
+TEST_F(I2cEepromTest, ReadSplitsAtMaxRead) {
+  ASSERT_EQ(i2c_eeprom_write(&eeprom, 20, data.data(), data.size()), 0);
+
+  std::vector<uint8_t> buf(data.size());
+  ASSERT_EQ(i2c_eeprom_read(&eeprom, 20, buf.data(), buf.size()), 0);
+  EXPECT_EQ(buf, data);
+  EXPECT_EQ(dev.reads, std::vector<size_t>({16, 16, 16, 16, 16, 16, 4}));
+}
+
+TEST_F(I2cEepromTest, VerifyMismatch) {
+  ASSERT_EQ(i2c_eeprom_write(&eeprom, 20, data.data(), data.size()), 0);
+  EXPECT_EQ(i2c_eeprom_verify(&eeprom, 20, data.data(), data.size()), 0);
+
+  dev.mem[20 + 70] ^= 0x01;
+  dev.reads.clear();
+  errno = 0;
+  EXPECT_EQ(i2c_eeprom_verify(&eeprom, 20, data.data(), data.size()), -1);
+  EXPECT_EQ(errno, EIO);
+  // mismatch in the fifth read, no further reads
+  EXPECT_EQ(dev.reads.size(), 5u);
+}
+
+TEST_F(I2cEepromTest, TransferError) {
+  dev.fail_xfer = 0;
+  errno = 0;
+  EXPECT_EQ(i2c_eeprom_write(&eeprom, 0, data.data(), data.size()), -1);
+  EXPECT_EQ(errno, EIO);
+  EXPECT_TRUE(dev.bursts.empty());
+}
+
+TEST_F(I2cEepromTest, InvalidConfig) {
+  uint8_t buf[4];
+
+  eeprom.page_size = 24;
+  errno = 0;
+  EXPECT_EQ(i2c_eeprom_read(&eeprom, 0, buf, sizeof(buf)), -1);
+  EXPECT_EQ(errno, EINVAL);
+  EXPECT_EQ(dev.xfers, 0);
+}
@@ -19,7 +19,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <fcntl.h>
@@ -32,27 +36,247 @@
 //#define DEBUG
 #define SYSFS_SLAVE_QUEUE "/sys/bus/i2c/devices/%d-10%02x/slave-mqueue"
 #define NIC_SLAVE_ADDR 0x64
+#define MCTP_DEFAULT_TIMEOUT_MS (6*1000)
+// Upper bound of packets fed to libmctp per wakeup
+#define MCTP_MAX_DRAIN 1024
+// The slave mqueue may not signal POLLPRI again until it is read, so the
+// poll only bounds the wait between reads
+#define MCTP_POLL_SLICE_MS 50
 
 // TODO:
 //      Migrate this library to C++ if BMC need to support MCTP over PCIe
 
+static void pending_fill(struct obmc_mctp_pending *pend, void *msg, size_t len,
+                         bool tag_owner, uint8_t tag)
+{
+  struct obmc_mctp_hdr *p = (struct obmc_mctp_hdr *)pend->buf;
+  size_t max = pend->size - offsetof(struct obmc_mctp_hdr, Msg_Type);
+
+  if (len > max) {
+    syslog(LOG_WARNING, "%s: message from EID 0x%02X truncated (%zu > %zu)",
+                        __func__, pend->eid, len, max);
+    len = max;
+  }
+  p->flag_tag = tag_owner ? MCTP_HDR_FLAG_TO : 0;
+  MCTP_HDR_SET_TAG(p->flag_tag, tag);
+  p->Msg_Size = len;
+  memcpy(&p->Msg_Type, msg, len);
+  pend->done = true;
+}
+
 /*
  * This rx_handler is the callback function which is registered by mctp_set_rx_all()
- * if we received a request/response by calling mctp_smbus_read().
- * It should be useful to reply a basic request if we are not the bus owner.
+ * if we received a request/response by calling mctp_smbus_read(), always with
+ * binding->lock held. It hands the message to the exchange waiting for it.
+ * Requests nobody waits for yet are kept in the backlog, responses nobody
+ * waits for anymore are dropped.
  */
 static void rx_handler(uint8_t eid, void *data, void *msg, size_t len,
                        bool tag_owner, uint8_t tag, void *prv)
 {
-  // TODO:
-  //    We should send device the response according to the EID
-  struct obmc_mctp_hdr *p = (struct obmc_mctp_hdr *)data;
+  struct obmc_mctp_binding *binding = (struct obmc_mctp_binding *)data;
+  struct obmc_mctp_pending *pend;
+  struct obmc_mctp_backlog *bl;
+  int i;
+
+  for (i = 0; i < OBMC_MCTP_MAX_PENDING; i++) {
+    pend = &binding->pending[i];
+    if (pend->used && !pend->done && pend->eid == eid &&
+        pend->request == tag_owner &&
+        (pend->tag == OBMC_MCTP_ANY_TAG || pend->tag == tag)) {
+      pending_fill(pend, msg, len, tag_owner, tag);
+      pthread_cond_broadcast(&binding->cond);
+      return;
+    }
+  }
 
-  if (tag_owner)
-    p->flag_tag |= MCTP_HDR_FLAG_TO;
-  MCTP_HDR_SET_TAG(p->flag_tag, tag);
-  p->Msg_Size = len;
-  memcpy(&p->Msg_Type, msg, len);
+  if (!tag_owner) {
+    syslog(LOG_WARNING, "%s: drop unexpected response from EID 0x%02X tag %u",
+                        __func__, eid, tag);
+    return;
+  }
+
+  bl = &binding->backlog[OBMC_MCTP_MAX_BACKLOG - 1];
+  if (bl->msg != NULL) {
+    syslog(LOG_WARNING, "%s: backlog full, drop request from EID 0x%02X",
+                        __func__, binding->backlog[0].eid);
+    free(binding->backlog[0].msg);
+    memmove(&binding->backlog[0], &binding->backlog[1],
+            sizeof(binding->backlog) - sizeof(binding->backlog[0]));
+    bl->msg = NULL;
+  }
+  for (bl = binding->backlog; bl->msg != NULL; bl++);
+  bl->msg = malloc(len);
+  if (bl->msg == NULL) {
+    return;
+  }
+  memcpy(bl->msg, msg, len);
+  bl->len = len;
+  bl->eid = eid;
+  bl->tag = tag;
+}
+
+/*
+ * Feed every packet queued on the slave mqueue to libmctp, with
+ * binding->lock held. mctp_smbus_read() consumes one packet, reading it
+ * from offset 0, so the offset it leaves behind is 0 once the queue is
+ * empty.
+ */
+static int mctp_smbus_drain(struct obmc_mctp_binding *binding)
+{
+  struct mctp_binding_smbus *smbus = (struct mctp_binding_smbus *)binding->prot;
+  int i;
+
+  for (i = 0; i < MCTP_MAX_DRAIN; i++) {
+    if (mctp_smbus_read(smbus) < 0) {
+      syslog(LOG_ERR, "%s: MCTP RX error", __func__);
+      return -1;
+    }
+    if (lseek(binding->in_fd, 0, SEEK_CUR) <= 0) {
+      break;
+    }
+  }
+  return 0;
+}
+
+static void obmc_mctp_backlog_clear(struct obmc_mctp_binding *binding)
+{
+  int i;
+
+  for (i = 0; i < OBMC_MCTP_MAX_BACKLOG; i++) {
+    free(binding->backlog[i].msg);
+    binding->backlog[i].msg = NULL;
+  }
+}
+
+struct obmc_mctp_pending *obmc_mctp_expect(struct obmc_mctp_binding *binding,
+                                           uint8_t eid, uint8_t tag, bool request,
+                                           void *buf, size_t size)
+{
+  struct obmc_mctp_pending *pend = NULL;
+  struct obmc_mctp_backlog *bl;
+  int i;
+
+  if (size <= offsetof(struct obmc_mctp_hdr, Msg_Type)) {
+    return NULL;
+  }
+
+  pthread_mutex_lock(&binding->lock);
+  for (i = 0; i < OBMC_MCTP_MAX_PENDING; i++) {
+    if (!binding->pending[i].used) {
+      pend = &binding->pending[i];
+      break;
+    }
+  }
+  if (pend == NULL) {
+    pthread_mutex_unlock(&binding->lock);
+    syslog(LOG_ERR, "%s: too many outstanding exchanges", __func__);
+    return NULL;
+  }
+  pend->used = true;
+  pend->done = false;
+  pend->request = request;
+  pend->eid = eid;
+  pend->tag = tag;
+  pend->buf = buf;
+  pend->size = size;
+
+  // The endpoint may have sent its request before we got here
+  for (i = 0; request && i < OBMC_MCTP_MAX_BACKLOG && binding->backlog[i].msg; i++) {
+    bl = &binding->backlog[i];
+    if (bl->eid == eid && (tag == OBMC_MCTP_ANY_TAG || bl->tag == tag)) {
+      pending_fill(pend, bl->msg, bl->len, true, bl->tag);
+      free(bl->msg);
+      memmove(bl, bl + 1, (OBMC_MCTP_MAX_BACKLOG - i - 1) * sizeof(*bl));
+      binding->backlog[OBMC_MCTP_MAX_BACKLOG - 1].msg = NULL;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&binding->lock);
+  return pend;
+}
+
+void obmc_mctp_cancel(struct obmc_mctp_binding *binding,
+                      struct obmc_mctp_pending *pend)
+{
+  if (pend == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&binding->lock);
+  pend->used = false;
+  pthread_mutex_unlock(&binding->lock);
+}
+
+static int timespec_ms_until(const struct timespec *deadline)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (deadline->tv_sec - now.tv_sec) * 1000 +
+         (deadline->tv_nsec - now.tv_nsec) / 1000000;
+}
+
+/*
+ * One waiter at a time reads the slave mqueue and dispatches whatever
+ * arrived, for all exchanges; the others sleep until their message was
+ * dispatched or they get to read themselves. Like ipmbd, the queue is
+ * read first and polled only once it is empty.
+ */
+int obmc_mctp_wait(struct obmc_mctp_binding *binding,
+                   struct obmc_mctp_pending *pend, int timeout_ms)
+{
+  struct pollfd pfd;
+  struct timespec deadline;
+  int remaining, ret = 0;
+
+  if (pend == NULL) {
+    return -1;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += timeout_ms / 1000;
+  deadline.tv_nsec += (timeout_ms % 1000) * 1000000;
+  if (deadline.tv_nsec >= 1000000000) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000;
+  }
+
+  pthread_mutex_lock(&binding->lock);
+  while (!pend->done && ret == 0) {
+    if (binding->reading) {
+      if (pthread_cond_timedwait(&binding->cond, &binding->lock, &deadline) == ETIMEDOUT) {
+        break;
+      }
+      continue;
+    }
+
+    ret = mctp_smbus_drain(binding);
+    if (pend->done || ret < 0 || (remaining = timespec_ms_until(&deadline)) <= 0) {
+      break;
+    }
+
+    binding->reading = true;
+    pthread_mutex_unlock(&binding->lock);
+    pfd.fd = binding->in_fd;
+    pfd.events = POLLPRI;
+    if (poll(&pfd, 1, remaining < MCTP_POLL_SLICE_MS ? remaining : MCTP_POLL_SLICE_MS) < 0 &&
+        errno != EINTR) {
+      syslog(LOG_ERR, "%s: poll failed: %s", __func__, strerror(errno));
+    }
+    pthread_mutex_lock(&binding->lock);
+    binding->reading = false;
+    // Let another waiter take over reading
+    pthread_cond_broadcast(&binding->cond);
+  }
+  if (pend->done) {
+    ret = 0;
+  } else if (ret == 0) {
+    syslog(LOG_ERR, "%s: MCTP timeout waiting for EID 0x%02X", __func__, pend->eid);
+    ret = -1;
+  }
+  pend->used = false;
+  pthread_mutex_unlock(&binding->lock);
+  return ret;
 }
 
 struct obmc_mctp_binding* obmc_mctp_smbus_init(uint8_t bus, uint8_t addr, uint8_t src_eid,
@@ -65,18 +289,26 @@ struct obmc_mctp_binding* obmc_mctp_smbus_init(uint8_t bus, uint8_t addr, uint8_
   struct mctp_binding_smbus *smbus;
   struct obmc_mctp_binding *mctp_binding;
 
-  mctp_binding = (struct obmc_mctp_binding *)malloc(sizeof(struct obmc_mctp_binding));
+  pthread_condattr_t cattr;
+
+  mctp_binding = (struct obmc_mctp_binding *)calloc(1, sizeof(struct obmc_mctp_binding));
   if (mctp_binding == NULL) {
     syslog(LOG_ERR, "%s: out of memory", __func__);
     return NULL;
   }
+  pthread_mutex_init(&mctp_binding->lock, NULL);
+  pthread_condattr_init(&cattr);
+  pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+  pthread_cond_init(&mctp_binding->cond, &cattr);
+  pthread_condattr_destroy(&cattr);
 
   if (pkt_size < MCTP_PAYLOAD_SIZE)
     pkt_size = MCTP_PAYLOAD_SIZE;
   mctp_smbus_set_pkt_size(pkt_size);
 
-  mctp = mctp_init();
+  mctp = mctp_binding->mctp = mctp_init();
   smbus = mctp_smbus_init();
+  mctp_binding->prot = (void *)smbus;
   if (mctp == NULL || smbus == NULL || mctp_smbus_register_bus(smbus, mctp, src_eid) < 0) {
     syslog(LOG_ERR, "%s: MCTP init failed", __func__);
     goto bail;
@@ -97,6 +329,7 @@ struct obmc_mctp_binding* obmc_mctp_smbus_init(uint8_t bus, uint8_t addr, uint8_
     goto bail;
   }
   mctp_smbus_set_in_fd(smbus, fd);
+  mctp_binding->in_fd = fd;
 
 #ifdef DEBUG
   mctp_set_log_stdio(MCTP_LOG_DEBUG);
@@ -105,6 +338,13 @@ struct obmc_mctp_binding* obmc_mctp_smbus_init(uint8_t bus, uint8_t addr, uint8_
 
   mctp_binding->mctp = mctp;
   mctp_binding->prot = (void *)smbus;
+  mctp_set_rx_all(mctp, rx_handler, mctp_binding);
+
+  // Whatever is queued was meant for a previous user of the bus
+  pthread_mutex_lock(&mctp_binding->lock);
+  mctp_smbus_drain(mctp_binding);
+  obmc_mctp_backlog_clear(mctp_binding);
+  pthread_mutex_unlock(&mctp_binding->lock);
   return mctp_binding;
 bail:
   obmc_mctp_smbus_free(mctp_binding);
@@ -113,8 +353,13 @@ bail:
 
 void obmc_mctp_smbus_free(struct obmc_mctp_binding* binding)
 {
-  mctp_smbus_free(binding->prot);
-  mctp_destroy(binding->mctp);
+  if (binding->prot)
+    mctp_smbus_free(binding->prot);
+  if (binding->mctp)
+    mctp_destroy(binding->mctp);
+  obmc_mctp_backlog_clear(binding);
+  pthread_cond_destroy(&binding->cond);
+  pthread_mutex_destroy(&binding->lock);
   free(binding);
 }
 
@@ -140,71 +385,99 @@ int mctp_smbus_send_data(struct mctp* mctp, uint8_t dst, uint8_t flag_tag,
   return 0;
 }
 
-int mctp_smbus_recv_data_timeout(struct mctp *mctp, uint8_t dst,
-                                 struct mctp_binding_smbus *smbus,
-                                 void *data, int TOsec)
+static int mctp_decode_status(void *data)
 {
-  // TODO:
-  //    Function overloading
-  int retry = 6*10; // Default 6 secs
   struct obmc_mctp_hdr *p = (struct obmc_mctp_hdr *)data;
 
-  mctp_set_rx_all(mctp, rx_handler, data);
+  if (p->Msg_Type == MCTP_TYPE_NCSI) {
+    struct obmc_mctp_ncsi_rsp *tmp = (struct obmc_mctp_ncsi_rsp *)data;
+    return tmp->pkt.data.Response_Code;
 
-  if (TOsec > 0)
-    retry = TOsec*10;
+  } else if (p->Msg_Type == MCTP_TYPE_PLDM) {
+    struct obmc_mctp_pldm_rsp *tmp = (struct obmc_mctp_pldm_rsp *)data;
+    if (tmp->hdr.flag_tag & MCTP_HDR_FLAG_TO) {
+      // Request comes from device, just return CC_SUCCESS
+      return CC_SUCCESS;
+    } else {
+      return tmp->pkt.Complete_Code;
+    }
+  }
+  syslog(LOG_ERR, "%s: Unknown message (0x%02X)", __func__, p->Msg_Type);
+  return -1;
+}
 
-  while (retry--) {
-    usleep(100*1000);
+/*
+ * Send a request and wait for its response. The response is expected
+ * before the request goes out, so it cannot be missed however fast the
+ * endpoint answers.
+ */
+static int mctp_smbus_xfer(struct obmc_mctp_binding *binding, uint8_t dst, uint8_t tag,
+                           void *req, size_t size, void *rsp, size_t rsp_size,
+                           struct mctp_smbus_extra_params *smbus_extra_params)
+{
+  struct mctp_binding_smbus *smbus = (struct mctp_binding_smbus *)binding->prot;
+  struct obmc_mctp_pending *pend;
+  int ret;
 
-    if (mctp_smbus_read(smbus) < 0) {
-      syslog(LOG_ERR, "%s: MCTP RX error", __func__);
-      return -1;
-    }
+  pend = obmc_mctp_expect(binding, dst, MCTP_HDR_GET_TAG(tag), false, rsp, rsp_size);
+  if (pend == NULL) {
+    return -1;
+  }
 
-    if (p->Msg_Size > 0) {
-      if (p->Msg_Type == MCTP_TYPE_NCSI) {
-        struct obmc_mctp_ncsi_rsp *tmp = (struct obmc_mctp_ncsi_rsp *)data;
-        return tmp->pkt.data.Response_Code;
-
-      } else if (p->Msg_Type == MCTP_TYPE_PLDM) {
-        struct obmc_mctp_pldm_rsp *tmp = (struct obmc_mctp_pldm_rsp *)data;
-        if (tmp->hdr.flag_tag & MCTP_HDR_FLAG_TO) {
-          // Request comes from device, just return CC_SUCCESS
-          return CC_SUCCESS;
-        } else {
-          return tmp->pkt.Complete_Code;
-        }
-      } else {
-        syslog(LOG_ERR, "%s: Unknown message (0x%02X)", __func__, p->Msg_Type);
-        return -1;
-      }
-    }
+  pthread_mutex_lock(&binding->lock);
+  ret = mctp_smbus_send_data(binding->mctp, dst, tag | MCTP_HDR_FLAG_TO, smbus,
+                             req, size, smbus_extra_params);
+  pthread_mutex_unlock(&binding->lock);
+  if (ret < 0) {
+    obmc_mctp_cancel(binding, pend);
+    return -1;
+  }
 
+  if (obmc_mctp_wait(binding, pend, MCTP_DEFAULT_TIMEOUT_MS) < 0) {
+    return -1;
   }
-  syslog(LOG_ERR, "%s: MCTP timeout", __func__);
-  return -1;
+  return mctp_decode_status(rsp);
 }
 
-int mctp_smbus_recv_data(struct mctp *mctp, uint8_t dst,
-                         struct mctp_binding_smbus *smbus,
-                         void *data)
+/*
+ * Wait for the next request the endpoint initiates, e.g. during a PLDM
+ * firmware update.
+ */
+static int mctp_smbus_recv_req(struct obmc_mctp_binding *binding, uint8_t dst,
+                               void *req, size_t size, int TOsec)
+{
+  struct obmc_mctp_pending *pend;
+
+  pend = obmc_mctp_expect(binding, dst, OBMC_MCTP_ANY_TAG, true, req, size);
+  if (obmc_mctp_wait(binding, pend,
+                     TOsec > 0 ? TOsec * 1000 : MCTP_DEFAULT_TIMEOUT_MS) < 0) {
+    return -1;
+  }
+  return mctp_decode_status(req);
+}
+
+static int mctp_smbus_send_rsp(struct obmc_mctp_binding *binding, uint8_t dst, uint8_t tag,
+                               void *rsp, size_t size,
+                               struct mctp_smbus_extra_params *smbus_extra_params)
 {
-  return mctp_smbus_recv_data_timeout(mctp, dst, smbus, data, -1);
+  struct mctp_binding_smbus *smbus = (struct mctp_binding_smbus *)binding->prot;
+  int ret;
+
+  pthread_mutex_lock(&binding->lock);
+  ret = mctp_smbus_send_data(binding->mctp, dst, tag, smbus, rsp, size, smbus_extra_params);
+  pthread_mutex_unlock(&binding->lock);
+  return ret;
 }
 
 int obmc_mctp_clear_init_state(struct obmc_mctp_binding *binding, uint8_t dst_eid,
                                uint8_t tag, uint8_t iid)
 {
   int ret = -1;
-  struct mctp *mctp = binding->mctp;
-  struct mctp_binding_smbus *smbus = (struct mctp_binding_smbus *)binding->prot;
   struct mctp_ncsi_req req = {0};
   struct obmc_mctp_ncsi_rsp rsp = {0};
   struct mctp_smbus_extra_params *smbus_extra_params;
 
   /* NC-SI: Clear init state */
-  tag |= MCTP_HDR_FLAG_TO;
   req.Msg_Type                = MCTP_TYPE_NCSI;
   req.pkt.hdr.MC_ID           = 0x00;
   req.pkt.hdr.Header_Revision = 0x01;
@@ -220,12 +493,8 @@ int obmc_mctp_clear_init_state(struct obmc_mctp_binding *binding, uint8_t dst_ei
     goto bail;
   }
 
-  ret = mctp_smbus_send_data(mctp, dst_eid, tag, smbus, &req, sizeof(req), smbus_extra_params);
-  if (ret < 0) {
-    goto bail;
-  }
-
-  ret = mctp_smbus_recv_data(mctp, dst_eid, smbus, &rsp);
+  ret = mctp_smbus_xfer(binding, dst_eid, tag, &req, sizeof(req),
+                        &rsp, sizeof(rsp), smbus_extra_params);
   if (ret != RESP_COMMAND_COMPLETED) {
     syslog(LOG_ERR, "%s: Response code = 0x%02X, Reason code = 0x%02X",
                     __func__, rsp.pkt.data.Response_Code, rsp.pkt.data.Reason_Code);
@@ -242,14 +511,11 @@ int obmc_mctp_get_version_id(struct obmc_mctp_binding *binding, uint8_t dst_eid,
                              Get_Version_ID_Response *payload)
 {
   int ret = -1;
-  struct mctp *mctp = binding->mctp;
-  struct mctp_binding_smbus *smbus = (struct mctp_binding_smbus *)binding->prot;
   struct mctp_ncsi_req req = {0};
   struct obmc_mctp_ncsi_rsp rsp = {0};
   struct mctp_smbus_extra_params *smbus_extra_params;
 
   /* NC-SI: Get version */
-  tag |= MCTP_HDR_FLAG_TO;
   req.Msg_Type                = MCTP_TYPE_NCSI;
   req.pkt.hdr.MC_ID           = 0x00;
   req.pkt.hdr.Header_Revision = 0x01;
@@ -265,12 +531,8 @@ int obmc_mctp_get_version_id(struct obmc_mctp_binding *binding, uint8_t dst_eid,
     goto bail;
   }
 
-  ret = mctp_smbus_send_data(mctp, dst_eid, tag, smbus, &req, sizeof(req), smbus_extra_params);
-  if (ret < 0) {
-    goto bail;
-  }
-
-  ret = mctp_smbus_recv_data(mctp, dst_eid, smbus, &rsp);
+  ret = mctp_smbus_xfer(binding, dst_eid, tag, &req, sizeof(req),
+                        &rsp, sizeof(rsp), smbus_extra_params);
   if (ret != RESP_COMMAND_COMPLETED) {
     syslog(LOG_ERR, "%s: Response code = 0x%02X, Reason code = 0x%02X",
                     __func__, rsp.pkt.data.Response_Code, rsp.pkt.data.Reason_Code);
@@ -288,15 +550,12 @@ int obmc_mctp_set_tid(struct obmc_mctp_binding *binding, uint8_t dst_eid,
                       uint8_t tid)
 {
   int ret = -1;
-  struct mctp *mctp = binding->mctp;
-  struct mctp_binding_smbus *smbus = (struct mctp_binding_smbus *)binding->prot;
   struct mctp_pldm_req req = {0};
   struct obmc_mctp_pldm_rsp rsp = {0};
   size_t req_size = 1 + PLDM_COMMON_REQ_LEN + sizeof(tid);
   struct mctp_smbus_extra_params *smbus_extra_params;
 
   /* PLDM: Set TID */
-  tag |= MCTP_HDR_FLAG_TO;
   req.Msg_Type             = MCTP_TYPE_PLDM;
   req.pkt.hdr.RQD_IID      = iid | PLDM_REQ_MSG;
   req.pkt.hdr.Command_Type = PLDM_HDR_VER | PLDM_TYPE_MSG_CTRL_AND_DISCOVERY;
@@ -310,12 +569,8 @@ int obmc_mctp_set_tid(struct obmc_mctp_binding *binding, uint8_t dst_eid,
     goto bail;
   }
 
-  ret = mctp_smbus_send_data(mctp, dst_eid, tag, smbus, &req, req_size, smbus_extra_params);
-  if (ret < 0) {
-    goto bail;
-  }
-
-  ret = mctp_smbus_recv_data(mctp, dst_eid, smbus, &rsp);
+  ret = mctp_smbus_xfer(binding, dst_eid, tag, &req, req_size,
+                        &rsp, sizeof(rsp), smbus_extra_params);
   if (ret != CC_SUCCESS) {
     syslog(LOG_ERR, "%s: Complete code = 0x%02X", __func__, rsp.pkt.Complete_Code);
     goto bail;
@@ -331,15 +586,12 @@ int obmc_mctp_get_tid(struct obmc_mctp_binding *binding, uint8_t dst_eid,
                       uint8_t *tid)
 {
   int ret = -1;
-  struct mctp *mctp = binding->mctp;
-  struct mctp_binding_smbus *smbus = (struct mctp_binding_smbus *)binding->prot;
   struct mctp_pldm_req req = {0};
   struct obmc_mctp_pldm_rsp rsp = {0};
   size_t req_size = 1 + PLDM_COMMON_REQ_LEN;
   struct mctp_smbus_extra_params *smbus_extra_params;
 
   /* PLDM: Get TID */
-  tag |= MCTP_HDR_FLAG_TO;
   req.Msg_Type             = MCTP_TYPE_PLDM;
   req.pkt.hdr.RQD_IID      = iid | PLDM_REQ_MSG;
   req.pkt.hdr.Command_Type = PLDM_HDR_VER | PLDM_TYPE_MSG_CTRL_AND_DISCOVERY;
@@ -352,12 +604,8 @@ int obmc_mctp_get_tid(struct obmc_mctp_binding *binding, uint8_t dst_eid,
     goto bail;
   }
 
-  ret = mctp_smbus_send_data(mctp, dst_eid, tag, smbus, &req, req_size, smbus_extra_params);
-  if (ret < 0) {
-    goto bail;
-  }
-
-  ret = mctp_smbus_recv_data(mctp, dst_eid, smbus, &rsp);
+  ret = mctp_smbus_xfer(binding, dst_eid, tag, &req, req_size,
+                        &rsp, sizeof(rsp), smbus_extra_params);
   if (ret != CC_SUCCESS) {
     syslog(LOG_ERR, "%s: Complete code = 0x%02X", __func__, rsp.pkt.Complete_Code);
     goto bail;
@@ -391,8 +639,6 @@ int obmc_mctp_fw_update(struct obmc_mctp_binding *binding, uint8_t dst_eid,
                         uint8_t tag, char *path)
 {
   int ret = -1;
-  struct mctp *mctp = binding->mctp;
-  struct mctp_binding_smbus *smbus = (struct mctp_binding_smbus *)binding->prot;
   struct mctp_pldm_req req = {0};
   struct mctp_pldm_rsp rsp = {0};
   struct obmc_mctp_pldm_req obmc_req = {0};
@@ -423,13 +669,9 @@ int obmc_mctp_fw_update(struct obmc_mctp_binding *binding, uint8_t dst_eid,
   printf("\n01 PldmRequestUpdateOp: payload_size=%d\n", pldmReq.payload_size);
   pldmReq_to_mctpReq(&req, &pldmReq);
 
-  ret = mctp_smbus_send_data(mctp, dst_eid, (tag | MCTP_HDR_FLAG_TO),
-                             smbus, &req, pldmReq.payload_size+1, smbus_extra_params);
-  if (ret < 0) {
-    goto free_exit;
-  }
   memset(&obmc_rsp, 0, sizeof(obmc_rsp));
-  ret = mctp_smbus_recv_data(mctp, dst_eid, smbus, &obmc_rsp);
+  ret = mctp_smbus_xfer(binding, dst_eid, tag, &req, pldmReq.payload_size+1,
+                        &obmc_rsp, sizeof(obmc_rsp), smbus_extra_params);
   if (ret != CC_SUCCESS) {
     goto free_exit;
   }
@@ -440,13 +682,9 @@ int obmc_mctp_fw_update(struct obmc_mctp_binding *binding, uint8_t dst_eid,
     printf("\n02 PldmPassComponentTableOp[%d]: payload_size=%d\n", i,
             pldmReq.payload_size);
     pldmReq_to_mctpReq(&req, &pldmReq);
-    ret = mctp_smbus_send_data(mctp, dst_eid, (tag | MCTP_HDR_FLAG_TO),
-                               smbus, &req, pldmReq.payload_size+1, smbus_extra_params);
-    if (ret < 0) {
-      goto exit;
-    }
     memset(&obmc_rsp, 0, sizeof(obmc_rsp));
-    ret = mctp_smbus_recv_data(mctp, dst_eid, smbus, &obmc_rsp);
+    ret = mctp_smbus_xfer(binding, dst_eid, tag, &req, pldmReq.payload_size+1,
+                          &obmc_rsp, sizeof(obmc_rsp), smbus_extra_params);
     if (ret != CC_SUCCESS) {
       goto exit;
     }
@@ -458,13 +696,9 @@ int obmc_mctp_fw_update(struct obmc_mctp_binding *binding, uint8_t dst_eid,
     printf("\n03 PldmUpdateComponentOp[%d]: payload_size=%d\n", i,
             pldmReq.payload_size);
     pldmReq_to_mctpReq(&req, &pldmReq);
-    ret = mctp_smbus_send_data(mctp, dst_eid, (tag | MCTP_HDR_FLAG_TO),
-                               smbus, &req, pldmReq.payload_size+1, smbus_extra_params);
-    if (ret < 0) {
-      goto exit;
-    }
     memset(&obmc_rsp, 0, sizeof(obmc_rsp));
-    ret = mctp_smbus_recv_data(mctp, dst_eid, smbus, &obmc_rsp);
+    ret = mctp_smbus_xfer(binding, dst_eid, tag, &req, pldmReq.payload_size+1,
+                          &obmc_rsp, sizeof(obmc_rsp), smbus_extra_params);
     if (ret != CC_SUCCESS) {
       goto exit;
     }
@@ -474,7 +708,7 @@ int obmc_mctp_fw_update(struct obmc_mctp_binding *binding, uint8_t dst_eid,
   setPldmTimeout(CMD_UPDATE_COMPONENT, &waitTOsec);
   while (1) {
     memset(&obmc_req, 0, sizeof(obmc_req));
-    ret = mctp_smbus_recv_data_timeout(mctp, dst_eid, smbus, &obmc_req, waitTOsec);
+    ret = mctp_smbus_recv_req(binding, dst_eid, &obmc_req, sizeof(obmc_req), waitTOsec);
     if (ret != CC_SUCCESS) {
       break;
     }
@@ -488,8 +722,9 @@ int obmc_mctp_fw_update(struct obmc_mctp_binding *binding, uint8_t dst_eid,
       pldmCmdStatus = pldmFwUpdateCmdHandler(pkgHdr, &pldmReq, &pldmRes);
       pldmRes_to_mctpRes(&rsp, &pldmRes);
 
-      ret = mctp_smbus_send_data(mctp, dst_eid, tag,
-                                 smbus, &rsp, pldmRes.resp_size+1, smbus_extra_params);
+      // Respond with the tag of the device's request
+      ret = mctp_smbus_send_rsp(binding, dst_eid, MCTP_HDR_GET_TAG(obmc_req.hdr.flag_tag),
+                                &rsp, pldmRes.resp_size+1, smbus_extra_params);
       if (ret < 0) {
         break;
       }
@@ -509,13 +744,9 @@ exit:
     pldmCreateActivateFirmwareCmd(&pldmReq);
     printf("\n05 PldmActivateFirmwareOp\n");
     pldmReq_to_mctpReq(&req, &pldmReq);
-    ret = mctp_smbus_send_data(mctp, dst_eid, tag | MCTP_HDR_FLAG_TO,
-                               smbus, &req, pldmReq.payload_size+1, smbus_extra_params);
-    if (ret < 0) {
-      goto free_exit;
-    }
     memset(&obmc_rsp, 0, sizeof(obmc_rsp));
-    ret = mctp_smbus_recv_data(mctp, dst_eid, smbus, &obmc_rsp);
+    ret = mctp_smbus_xfer(binding, dst_eid, tag, &req, pldmReq.payload_size+1,
+                          &obmc_rsp, sizeof(obmc_rsp), smbus_extra_params);
     if (ret != CC_SUCCESS) {
       goto free_exit;
     }
@@ -527,13 +758,9 @@ exit:
     memset(&pldmReq, 0, sizeof(pldm_cmd_req));
     pldmCreateCancelUpdateCmd(&pldmReq);
     pldmReq_to_mctpReq(&req, &pldmReq);
-    ret = mctp_smbus_send_data(mctp, dst_eid, tag | MCTP_HDR_FLAG_TO,
-                               smbus, &req, pldmReq.payload_size+1, smbus_extra_params);
-    if (ret < 0) {
-      goto free_exit;
-    }
     memset(&obmc_rsp, 0, sizeof(obmc_rsp));
-    ret = mctp_smbus_recv_data(mctp, dst_eid, smbus, &obmc_rsp);
+    ret = mctp_smbus_xfer(binding, dst_eid, tag, &req, pldmReq.payload_size+1,
+                          &obmc_rsp, sizeof(obmc_rsp), smbus_extra_params);
     if (ret != CC_SUCCESS) {
       goto free_exit;
     }
@@ -23,6 +23,8 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
+#include <pthread.h>
 #include <libmctp-smbus.h>
 #include <openbmc/ncsi.h>
 #include <openbmc/pldm.h>
@@ -98,9 +100,39 @@ struct mctp_pldm_rsp {
 } __attribute__((packed));
 
 /* OBMC Binding */
+#define OBMC_MCTP_MAX_PENDING 8
+#define OBMC_MCTP_MAX_BACKLOG 4
+#define OBMC_MCTP_ANY_TAG     0xFF
+
+// A message expected from an endpoint: the response to a request we sent
+// (request == false) or a request initiated by the endpoint.
+struct obmc_mctp_pending {
+  bool used;
+  bool done;
+  bool request;
+  uint8_t eid;
+  uint8_t tag;      // OBMC_MCTP_ANY_TAG matches any tag
+  void *buf;        // filled as struct obmc_mctp_hdr followed by the message
+  size_t size;
+};
+
+// Request from an endpoint which arrived before anybody expected it
+struct obmc_mctp_backlog {
+  uint8_t eid;
+  uint8_t tag;
+  size_t len;
+  void *msg;
+};
+
 struct obmc_mctp_binding {
   struct mctp *mctp;
   void *prot;
+  int in_fd;        // slave mqueue handed to the binding
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  bool reading;     // a thread is polling the slave mqueue for everybody
+  struct obmc_mctp_pending pending[OBMC_MCTP_MAX_PENDING];
+  struct obmc_mctp_backlog backlog[OBMC_MCTP_MAX_BACKLOG];
 };
 
 struct obmc_mctp_hdr {
@@ -135,9 +167,22 @@ int mctp_smbus_send_data(struct mctp* mctp, uint8_t dst, uint8_t flag_tag,
                          void *req, size_t size,
                          struct mctp_smbus_extra_params *smbus_extra_params);
 
-int mctp_smbus_recv_data(struct mctp *mctp, uint8_t dst,
-                         struct mctp_binding_smbus *smbus,
-                         void *data);
+/*
+ * Asynchronous receive: register the expected message with
+ * obmc_mctp_expect() before sending the request, then collect it with
+ * obmc_mctp_wait(). Messages are matched by EID and tag, so several
+ * exchanges, with the same or different endpoints, may be outstanding on
+ * one binding, from one or several threads.
+ */
+struct obmc_mctp_pending *obmc_mctp_expect(struct obmc_mctp_binding *binding,
+                                           uint8_t eid, uint8_t tag, bool request,
+                                           void *buf, size_t size);
+// Returns 0 once the message is in buf, -1 on timeout or error.
+// The pending entry is released in both cases.
+int obmc_mctp_wait(struct obmc_mctp_binding *binding,
+                   struct obmc_mctp_pending *pend, int timeout_ms);
+void obmc_mctp_cancel(struct obmc_mctp_binding *binding,
+                      struct obmc_mctp_pending *pend);
 // Command APIs
 int obmc_mctp_clear_init_state(struct obmc_mctp_binding *binding, uint8_t dst_eid,
                                uint8_t tag, uint8_t iid);
@@ -25,6 +25,7 @@
 #include <openbmc/obmc-i2c.h>
 
 #include "obmc-pmbus.h"
+#include "pmbus-priv.h"
 
 /*
  * Maximum number of pages defined by pmbus spec is 0x1F, so it should
@@ -38,18 +39,54 @@
 struct pmbus_device {
 	int bus;
 	uint16_t addr;
+	int flags;
 
 	uint8_t cur_page;
 	int device_fd;
+	pmbus_sim_t *sim;
+
+	/*
+	 * VOUT_MODE of each page, read once: the last entry is for
+	 * PMBUS_PAGE_NONE.
+	 */
+	uint8_t vout_mode[PMBUS_PAGE_INVALID + 1];
+	uint64_t vout_mode_valid;
+};
+#define IS_VALID_PMBUS_DEV(dev)	\
+	((dev) != NULL && ((dev)->device_fd >= 0 || (dev)->sim != NULL))
+
+/*
+ * A register read of pmbus_read_ops().
+ */
+struct pmbus_op {
+	uint8_t reg;
+	uint8_t len;
+	uint16_t raw;
+	int status;
 };
-#define IS_VALID_PMBUS_DEV(dev)	((dev) != NULL && (dev)->device_fd >= 0)
+
+static pmbus_dev_t* pmbus_device_alloc(int bus, uint16_t addr, int flags)
+{
+	pmbus_dev_t *pmdev;
+
+	pmdev = calloc(1, sizeof(*pmdev));
+	if (pmdev == NULL)
+		return NULL;
+
+	pmdev->bus = bus;
+	pmdev->addr = addr;
+	pmdev->flags = flags;
+	pmdev->device_fd = -1;
+	pmdev->cur_page = PMBUS_PAGE_INVALID;
+	return pmdev;
+}
 
 pmbus_dev_t* pmbus_device_open(int bus, uint16_t addr, int flags)
 {
 	int fd, i2c_flags = 0;
 	pmbus_dev_t *pmdev;
 
-	pmdev = malloc(sizeof(*pmdev));
+	pmdev = pmbus_device_alloc(bus, addr, flags);
 	if (pmdev == NULL)
 		return NULL;
 
@@ -62,10 +99,24 @@ pmbus_dev_t* pmbus_device_open(int bus, uint16_t addr, int flags)
 		return NULL;
 	}
 
-	pmdev->bus = bus;
-	pmdev->addr = addr;
 	pmdev->device_fd = fd;
-	pmdev->cur_page = PMBUS_PAGE_INVALID;
+	return pmdev;
+}
+
+pmbus_dev_t* pmbus_device_open_sim(pmbus_sim_t *sim, int flags)
+{
+	pmbus_dev_t *pmdev;
+
+	if (sim == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	pmdev = pmbus_device_alloc(-1, pmbus_sim_addr(sim), flags);
+	if (pmdev == NULL)
+		return NULL;
+
+	pmdev->sim = sim;
 	return pmdev;
 }
 
@@ -79,6 +130,56 @@ void pmbus_device_close(pmbus_dev_t *pmdev)
 	}
 }
 
+uint8_t pmbus_pec(uint8_t crc, const uint8_t *buf, size_t len)
+{
+	size_t i;
+	int bit;
+
+	for (i = 0; i < len; i++) {
+		crc ^= buf[i];
+		for (bit = 0; bit < 8; bit++) {
+			crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+		}
+	}
+	return crc;
+}
+
+static int pmbus_xfer(pmbus_dev_t *pmdev, struct i2c_msg *msgs, int nmsgs)
+{
+	struct i2c_rdwr_ioctl_data data;
+
+	if (pmdev->sim != NULL)
+		return pmbus_sim_xfer(pmdev->sim, msgs, nmsgs);
+
+	data.msgs = msgs;
+	data.nmsgs = nmsgs;
+	return ioctl(pmdev->device_fd, I2C_RDWR, &data) < 0 ? -1 : 0;
+}
+
+/*
+ * Write byte/word command, with PEC if enabled.
+ */
+static int pmbus_write_data(pmbus_dev_t *pmdev, uint8_t reg,
+			    const uint8_t *data, size_t len)
+{
+	uint8_t buf[4], wr_addr = pmdev->addr << 1;
+	struct i2c_msg msg;
+
+	buf[0] = reg;
+	memcpy(&buf[1], data, len);
+	len++;
+	if (pmdev->flags & PMBUS_FLAG_PEC) {
+		buf[len] = pmbus_pec(pmbus_pec(0, &wr_addr, 1), buf, len);
+		len++;
+	}
+
+	msg.addr = pmdev->addr;
+	msg.flags = 0;
+	msg.len = len;
+	msg.buf = buf;
+	return pmbus_xfer(pmdev, &msg, 1);
+}
+
 int pmbus_set_page(pmbus_dev_t *pmdev, uint8_t page)
 {
 	if (!IS_VALID_PMBUS_DEV(pmdev)) {
@@ -86,8 +187,12 @@ int pmbus_set_page(pmbus_dev_t *pmdev, uint8_t page)
 		return -1;
 	}
 
-	if (i2c_smbus_write_byte_data(pmdev->device_fd,
-				      PMBUS_PAGE, page) != 0) {
+	/*
+	 * PAGE goes in a transfer of its own, as some devices only switch
+	 * page at the STOP condition.
+	 */
+	if (pmbus_write_data(pmdev, PMBUS_PAGE, &page, 1) != 0) {
+		pmdev->cur_page = PMBUS_PAGE_INVALID;
 		return -1;
 	}
 
@@ -95,6 +200,32 @@ int pmbus_set_page(pmbus_dev_t *pmdev, uint8_t page)
 	return 0;
 }
 
+static int pmbus_select_page(pmbus_dev_t *pmdev, uint8_t page)
+{
+	if (page == PMBUS_PAGE_NONE || pmdev->cur_page == page)
+		return 0;
+	if (page >= PMBUS_PAGE_INVALID) {
+		errno = EINVAL;
+		return -1;
+	}
+	return pmbus_set_page(pmdev, page);
+}
+
+static int vout_mode_index(uint8_t page)
+{
+	return page == PMBUS_PAGE_NONE ? PMBUS_PAGE_INVALID : page;
+}
+
+/*
+ * Forget the cached VOUT_MODE of <page>: it is read again with the next
+ * VOUT register of the page.
+ */
+static void vout_mode_invalidate(pmbus_dev_t *pmdev, uint8_t page)
+{
+	if (page == PMBUS_PAGE_NONE || page < PMBUS_PAGE_INVALID)
+		pmdev->vout_mode_valid &= ~(1ULL << vout_mode_index(page));
+}
+
 int pmbus_write_byte_data(pmbus_dev_t *pmdev,
 			  uint8_t page,
 			  uint8_t reg,
@@ -105,10 +236,259 @@ int pmbus_write_byte_data(pmbus_dev_t *pmdev,
 		return -1;
 	}
 
-	if ((pmdev->cur_page != page) &&
-	    (pmbus_set_page(pmdev, page) != 0)) {
+	if (pmbus_select_page(pmdev, page) != 0) {
+		return -1;
+	}
+
+	/* whether or not the write went through, read the mode back */
+	if (reg == PMBUS_VOUT_MODE)
+		vout_mode_invalidate(pmdev, page);
+
+	return pmbus_write_data(pmdev, reg, &value, 1);
+}
+
+/*
+ * Read <ops> of the current page, in transfers of up to PMBUS_MAX_BATCH
+ * registers. When a transfer fails, its registers are read again one by
+ * one so that a single failing register doesn't fail the others.
+ */
+static void pmbus_read_ops(pmbus_dev_t *pmdev, struct pmbus_op *ops,
+			   int nops)
+{
+	struct i2c_msg msgs[PMBUS_MAX_BATCH * 2];
+	uint8_t cmd[PMBUS_MAX_BATCH], rx[PMBUS_MAX_BATCH][3];
+	uint8_t addr[2] = {pmdev->addr << 1, (pmdev->addr << 1) | 1};
+	int pec = !!(pmdev->flags & PMBUS_FLAG_PEC);
+	int i, n, batch, err;
+
+	while (nops > 0) {
+		batch = nops < PMBUS_MAX_BATCH ? nops : PMBUS_MAX_BATCH;
+		for (i = 0, n = 0; i < batch; i++) {
+			cmd[i] = ops[i].reg;
+			msgs[n].addr = pmdev->addr;
+			msgs[n].flags = 0;
+			msgs[n].len = 1;
+			msgs[n].buf = &cmd[i];
+			n++;
+			msgs[n].addr = pmdev->addr;
+			msgs[n].flags = I2C_M_RD;
+			msgs[n].len = ops[i].len + pec;
+			msgs[n].buf = rx[i];
+			n++;
+		}
+
+		if (pmbus_xfer(pmdev, msgs, n) != 0) {
+			err = errno;
+			if (batch == 1) {
+				ops[0].status = err;
+			} else {
+				for (i = 0; i < batch; i++) {
+					pmbus_read_ops(pmdev, &ops[i], 1);
+				}
+			}
+			ops += batch;
+			nops -= batch;
+			continue;
+		}
+
+		for (i = 0; i < batch; i++) {
+			struct pmbus_op *op = &ops[i];
+
+			if (pec) {
+				uint8_t crc = pmbus_pec(0, &addr[0], 1);
+
+				crc = pmbus_pec(crc, &cmd[i], 1);
+				crc = pmbus_pec(crc, &addr[1], 1);
+				if (pmbus_pec(crc, rx[i], op->len) != rx[i][op->len]) {
+					op->status = EBADMSG;
+					continue;
+				}
+			}
+			op->raw = op->len == 1 ? rx[i][0] : rx[i][0] | (rx[i][1] << 8);
+			op->status = 0;
+		}
+		ops += batch;
+		nops -= batch;
+	}
+}
+
+static int pmbus_read_data(pmbus_dev_t *pmdev, uint8_t page, uint8_t reg,
+			   uint8_t len, uint16_t *value)
+{
+	struct pmbus_op op = {reg, len, 0, 0};
+
+	if (!IS_VALID_PMBUS_DEV(pmdev)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (pmbus_select_page(pmdev, page) != 0) {
+		return -1;
+	}
+
+	pmbus_read_ops(pmdev, &op, 1);
+	if (op.status != 0) {
+		vout_mode_invalidate(pmdev, page);
+		errno = op.status;
+		return -1;
+	}
+	*value = op.raw;
+	return 0;
+}
+
+int pmbus_read_byte_data(pmbus_dev_t *pmdev, uint8_t page,
+			 uint8_t reg, uint8_t *value)
+{
+	uint16_t raw;
+
+	if (pmbus_read_data(pmdev, page, reg, 1, &raw) != 0) {
 		return -1;
 	}
+	*value = raw;
+	return 0;
+}
+
+int pmbus_read_word_data(pmbus_dev_t *pmdev, uint8_t page,
+			 uint8_t reg, uint16_t *value)
+{
+	return pmbus_read_data(pmdev, page, reg, 2, value);
+}
+
+static void pmbus_decode(pmbus_dev_t *pmdev, struct pmbus_reading *rd)
+{
+	switch (rd->format) {
+	case PMBUS_FMT_LINEAR11:
+		rd->value = pmbus_linear11_to_double(rd->raw);
+		break;
+	case PMBUS_FMT_VOUT:
+		rd->value = pmbus_vout_to_double(rd->raw,
+				pmdev->vout_mode[vout_mode_index(rd->page)],
+				rd->vid, &rd->direct);
+		break;
+	case PMBUS_FMT_DIRECT:
+		rd->value = pmbus_direct_to_double(rd->raw, &rd->direct);
+		break;
+	default:
+		rd->value = rd->raw;
+		break;
+	}
+}
+
+/*
+ * Sort key of a register list entry: the registers which don't need a
+ * page change come first.
+ */
+static int page_order(const pmbus_dev_t *pmdev, uint8_t page)
+{
+	if (page == PMBUS_PAGE_NONE)
+		return -2;
+	if (page == pmdev->cur_page)
+		return -1;
+	return page;
+}
+
+int pmbus_read_list(pmbus_dev_t *pmdev, struct pmbus_reading *list,
+		    size_t count)
+{
+	struct pmbus_op *ops;
+	size_t *order, i, j, k;
+	int n, ret = 0;
+
+	if (!IS_VALID_PMBUS_DEV(pmdev) || (list == NULL && count > 0)) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (count == 0)
+		return 0;
+
+	order = malloc(count * sizeof(*order));
+	ops = malloc((count + 1) * sizeof(*ops));
+	if (order == NULL || ops == NULL) {
+		free(order);
+		free(ops);
+		return -1;
+	}
+
+	/* stable insertion sort, the lists are short */
+	for (i = 0; i < count; i++) {
+		int key = page_order(pmdev, list[i].page);
+
+		for (j = i; j > 0 &&
+		     page_order(pmdev, list[order[j - 1]].page) > key; j--) {
+			order[j] = order[j - 1];
+		}
+		order[j] = i;
+	}
+
+	for (i = 0; i < count; i = j) {
+		uint8_t page = list[order[i]].page;
+		int mode_idx = vout_mode_index(page);
+		int need_mode = 0;
+
+		for (j = i; j < count && list[order[j]].page == page; j++) {
+			if (list[order[j]].format == PMBUS_FMT_VOUT &&
+			    !(pmdev->vout_mode_valid & (1ULL << mode_idx)))
+				need_mode = 1;
+		}
+
+		if (pmbus_select_page(pmdev, page) != 0) {
+			for (k = i; k < j; k++) {
+				list[order[k]].status = errno;
+			}
+			vout_mode_invalidate(pmdev, page);
+			ret = -1;
+			continue;
+		}
+
+		n = 0;
+		if (need_mode) {
+			ops[n].reg = PMBUS_VOUT_MODE;
+			ops[n].len = 1;
+			n++;
+		}
+		for (k = i; k < j; k++) {
+			ops[n].reg = list[order[k]].reg;
+			ops[n].len = list[order[k]].format == PMBUS_FMT_BYTE ? 1 : 2;
+			n++;
+		}
+		pmbus_read_ops(pmdev, ops, n);
+
+		n = 0;
+		if (need_mode) {
+			if (ops[0].status == 0) {
+				pmdev->vout_mode[mode_idx] = ops[0].raw;
+				pmdev->vout_mode_valid |= 1ULL << mode_idx;
+			}
+			n++;
+		}
+		for (k = i; k < j; k++, n++) {
+			struct pmbus_reading *rd = &list[order[k]];
+
+			rd->status = ops[n].status;
+			if (rd->status == 0 && rd->format == PMBUS_FMT_VOUT &&
+			    !(pmdev->vout_mode_valid & (1ULL << mode_idx)))
+				rd->status = ops[0].status;
+			if (rd->status != 0) {
+				ret = -1;
+				continue;
+			}
+			rd->raw = ops[n].raw;
+			pmbus_decode(pmdev, rd);
+		}
+
+		/*
+		 * A failed read may be a device which was reset or
+		 * replaced meanwhile, its VOUT_MODE is read again.
+		 */
+		for (k = 0; k < n; k++) {
+			if (ops[k].status != 0) {
+				vout_mode_invalidate(pmdev, page);
+				break;
+			}
+		}
+	}
 
-	return i2c_smbus_write_byte_data(pmdev->device_fd, reg, value);
+	free(order);
+	free(ops);
+	return ret;
 }
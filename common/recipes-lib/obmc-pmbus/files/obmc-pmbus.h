@@ -30,6 +30,7 @@ extern "C" {
 
 #include "pmbus.h"
 #include <unistd.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifndef BIT
@@ -57,6 +58,12 @@ typedef struct pmbus_device pmbus_dev_t;
  */
 #define PMBUS_FLAG_FORCE_CLAIM	BIT(0)
 
+/*
+ * - PMBUS_FLAG_PEC
+ *   append PEC to writes, and read and check PEC on reads.
+ */
+#define PMBUS_FLAG_PEC		BIT(1)
+
 /*
  * Open the pmbus device for future read/write.
  *
@@ -90,6 +97,132 @@ int pmbus_set_page(pmbus_dev_t *pmdev, uint8_t page);
 int pmbus_write_byte_data(pmbus_dev_t *pmdev, uint8_t page,
 			  uint8_t reg, uint8_t value);
 
+/*
+ * Read a byte/word register of the given pmbus device.
+ *
+ * Return:
+ *   0 for success, and -1 on failures. errno is set in case of failures
+ *   (EBADMSG for a PEC mismatch).
+ */
+int pmbus_read_byte_data(pmbus_dev_t *pmdev, uint8_t page,
+			 uint8_t reg, uint8_t *value);
+int pmbus_read_word_data(pmbus_dev_t *pmdev, uint8_t page,
+			 uint8_t reg, uint16_t *value);
+
+/*
+ * Register list reads.
+ *
+ * A telemetry loop describes the registers it wants once, and
+ * pmbus_read_list() reads them all: the list is ordered by page so each
+ * page is selected at most once, and the reads of a page are issued as
+ * I2C_RDWR transfers of up to PMBUS_MAX_BATCH registers each. Values
+ * are decoded into engineering units (V, A, W, degrees C, RPM).
+ *
+ * PMBUS_PAGE_NONE is for registers of devices without PAGE support, or
+ * which don't depend on the page: they are read without changing it.
+ */
+#define PMBUS_PAGE_NONE		0xFF
+#define PMBUS_MAX_BATCH		16
+
+enum pmbus_format {
+	PMBUS_FMT_BYTE,		/* raw byte, e.g. STATUS_BYTE */
+	PMBUS_FMT_WORD,		/* raw word, e.g. STATUS_WORD */
+	PMBUS_FMT_LINEAR11,	/* most READ_* registers */
+	PMBUS_FMT_VOUT,		/* LINEAR16, VID or DIRECT as per VOUT_MODE */
+	PMBUS_FMT_DIRECT,	/* coefficients in "direct" */
+};
+
+/*
+ * VID codes, used when VOUT_MODE selects the VID mode. The code type
+ * in VOUT_MODE is vendor specific, so it is given per register.
+ */
+enum pmbus_vid {
+	PMBUS_VID_VR12,
+	PMBUS_VID_VR11,
+	PMBUS_VID_VR13,
+	PMBUS_VID_IMVP9,
+	PMBUS_VID_AMD625MV,
+};
+
+struct pmbus_direct_coef {
+	int16_t m;
+	int16_t b;
+	int8_t R;
+};
+
+struct pmbus_reading {
+	/* set by the caller */
+	uint8_t page;
+	uint8_t reg;
+	uint8_t format;		/* enum pmbus_format */
+	uint8_t vid;		/* enum pmbus_vid */
+	struct pmbus_direct_coef direct;
+
+	/* set by pmbus_read_list() */
+	int status;		/* 0, or errno of the failed read */
+	uint16_t raw;
+	double value;
+};
+
+/*
+ * Read the registers of <list>, and set their status, raw and decoded
+ * values.
+ *
+ * Return:
+ *   0 if all the registers were read, and -1 if any of them failed.
+ */
+int pmbus_read_list(pmbus_dev_t *pmdev, struct pmbus_reading *list,
+		    size_t count);
+
+/*
+ * Data format conversions, refer to PMBus Spec Part II, section 7 and
+ * 8.3 for details.
+ */
+double pmbus_linear11_to_double(uint16_t raw);
+double pmbus_linear16_to_double(uint16_t raw, uint8_t vout_mode);
+double pmbus_vid_to_double(uint8_t code, int vid);
+double pmbus_direct_to_double(uint16_t raw,
+			      const struct pmbus_direct_coef *coef);
+double pmbus_vout_to_double(uint16_t raw, uint8_t vout_mode, int vid,
+			    const struct pmbus_direct_coef *coef);
+
+/*
+ * PMBus device simulator.
+ *
+ * A simulated device holds a value and a size (byte or word) for each
+ * register of each page, and answers the transfers of a device opened
+ * with pmbus_device_open_sim() like a real one would, including PAGE
+ * and PEC. Registers which were never set are unsupported: the device
+ * doesn't acknowledge them. It is meant for unit tests of the library
+ * and its users.
+ *
+ * PMBUS_PAGE_NONE sets a register on all the pages, and gets it from
+ * the current page.
+ */
+typedef struct pmbus_sim pmbus_sim_t;
+
+struct pmbus_sim_stats {
+	unsigned long transfers;	/* I2C_RDWR transfers */
+	unsigned long messages;
+	unsigned long page_writes;
+	unsigned long pec_errors;	/* writes with a bad PEC */
+};
+
+pmbus_sim_t* pmbus_sim_create(uint16_t addr);
+void pmbus_sim_destroy(pmbus_sim_t *sim);
+void pmbus_sim_set_byte(pmbus_sim_t *sim, uint8_t page, uint8_t reg,
+			uint8_t value);
+void pmbus_sim_set_word(pmbus_sim_t *sim, uint8_t page, uint8_t reg,
+			uint16_t value);
+uint16_t pmbus_sim_get(pmbus_sim_t *sim, uint8_t page, uint8_t reg);
+void pmbus_sim_get_stats(pmbus_sim_t *sim, struct pmbus_sim_stats *stats);
+
+/*
+ * Open the simulated device like pmbus_device_open() opens a real one.
+ * The simulator must outlive the device.
+ */
+pmbus_dev_t* pmbus_device_open_sim(pmbus_sim_t *sim, int flags);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
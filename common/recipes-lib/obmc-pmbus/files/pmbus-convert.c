@@ -0,0 +1,107 @@
+/*
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <math.h>
+#include <stdint.h>
+
+#include "obmc-pmbus.h"
+
+/*
+ * LINEAR11: X = Y * 2^N, with Y an 11 bit and N a 5 bit two's
+ * complement integer.
+ */
+double pmbus_linear11_to_double(uint16_t raw)
+{
+	int exponent = (int16_t)raw >> 11;
+	int mantissa = (int16_t)(raw << 5) >> 5;
+
+	return ldexp(mantissa, exponent);
+}
+
+/*
+ * LINEAR16: X = V * 2^N, with V the unsigned register value and N the
+ * 5 bit two's complement exponent in VOUT_MODE.
+ */
+double pmbus_linear16_to_double(uint16_t raw, uint8_t vout_mode)
+{
+	int exponent = (int8_t)(vout_mode << 3) >> 3;
+
+	return ldexp(raw, exponent);
+}
+
+/*
+ * Output voltage in V of a VID code, 0 for codes which turn it off.
+ */
+double pmbus_vid_to_double(uint8_t code, int vid)
+{
+	double mv = 0;
+
+	switch (vid) {
+	case PMBUS_VID_VR11:
+		if (code >= 0x02 && code <= 0xb2)
+			mv = 1600 - (code - 2) * 6.25;
+		break;
+	case PMBUS_VID_VR13:
+		if (code >= 0x01)
+			mv = 500 + (code - 1) * 10;
+		break;
+	case PMBUS_VID_IMVP9:
+		if (code >= 0x01)
+			mv = 200 + (code - 1) * 10;
+		break;
+	case PMBUS_VID_AMD625MV:
+		if (code <= 0xd8)
+			mv = 1550 - code * 6.25;
+		break;
+	case PMBUS_VID_VR12:
+	default:
+		if (code >= 0x01)
+			mv = 250 + (code - 1) * 5;
+		break;
+	}
+	return mv / 1000;
+}
+
+/*
+ * DIRECT: X = (Y * 10^-R - b) / m, with Y the two's complement register
+ * value.
+ */
+double pmbus_direct_to_double(uint16_t raw,
+			      const struct pmbus_direct_coef *coef)
+{
+	if (coef == NULL || coef->m == 0)
+		return NAN;
+
+	return ((int16_t)raw * pow(10, -coef->R) - coef->b) / coef->m;
+}
+
+double pmbus_vout_to_double(uint16_t raw, uint8_t vout_mode, int vid,
+			    const struct pmbus_direct_coef *coef)
+{
+	/* bit 7 only tells whether the mode is relative */
+	switch ((vout_mode >> 5) & 0x3) {
+	case 0:
+		return pmbus_linear16_to_double(raw, vout_mode);
+	case 1:
+		return pmbus_vid_to_double(raw & 0xff, vid);
+	case 2:
+		return pmbus_direct_to_double(raw, coef);
+	default:
+		return NAN;
+	}
+}
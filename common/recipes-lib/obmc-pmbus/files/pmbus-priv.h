@@ -0,0 +1,50 @@
+/*
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * Definitions shared by the files of the library, not installed.
+ */
+
+#ifndef _PMBUS_PRIV_H_
+#define _PMBUS_PRIV_H_
+
+#include <stdint.h>
+#include <linux/i2c.h>
+
+#include "obmc-pmbus.h"
+
+/*
+ * SMBus PEC: CRC-8 (x^8 + x^2 + x + 1) over every byte on the wire,
+ * address bytes included. <crc> is the value for the preceding bytes.
+ */
+uint8_t pmbus_pec(uint8_t crc, const uint8_t *buf, size_t len);
+
+/*
+ * Process the messages of an I2C_RDWR transfer to the simulated device.
+ *
+ * Return:
+ *   0 for success, and -1 (errno set) if the device didn't acknowledge.
+ */
+int pmbus_sim_xfer(pmbus_sim_t *sim, struct i2c_msg *msgs, int nmsgs);
+
+/*
+ * 7-bit address of the simulated device.
+ */
+uint16_t pmbus_sim_addr(pmbus_sim_t *sim);
+
+#endif /* _PMBUS_PRIV_H_ */
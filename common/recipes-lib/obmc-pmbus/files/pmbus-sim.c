@@ -0,0 +1,197 @@
+/*
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "obmc-pmbus.h"
+#include "pmbus-priv.h"
+
+#define PMBUS_SIM_PAGES		(0x1F + 1)
+#define PMBUS_SIM_REGS		256
+
+struct pmbus_sim {
+	uint16_t addr;
+	uint8_t page;
+	uint16_t regs[PMBUS_SIM_PAGES][PMBUS_SIM_REGS];
+	uint8_t size[PMBUS_SIM_PAGES][PMBUS_SIM_REGS];	/* 0 if unsupported */
+	struct pmbus_sim_stats stats;
+};
+
+pmbus_sim_t* pmbus_sim_create(uint16_t addr)
+{
+	pmbus_sim_t *sim;
+
+	sim = calloc(1, sizeof(*sim));
+	if (sim == NULL)
+		return NULL;
+
+	sim->addr = addr;
+	return sim;
+}
+
+void pmbus_sim_destroy(pmbus_sim_t *sim)
+{
+	free(sim);
+}
+
+uint16_t pmbus_sim_addr(pmbus_sim_t *sim)
+{
+	return sim->addr;
+}
+
+static void pmbus_sim_set(pmbus_sim_t *sim, uint8_t page, uint8_t reg,
+			  uint16_t value, uint8_t size)
+{
+	int i;
+
+	for (i = 0; i < PMBUS_SIM_PAGES; i++) {
+		if (page == PMBUS_PAGE_NONE || page == i) {
+			sim->regs[i][reg] = value;
+			sim->size[i][reg] = size;
+		}
+	}
+}
+
+void pmbus_sim_set_byte(pmbus_sim_t *sim, uint8_t page, uint8_t reg,
+			uint8_t value)
+{
+	pmbus_sim_set(sim, page, reg, value, 1);
+}
+
+void pmbus_sim_set_word(pmbus_sim_t *sim, uint8_t page, uint8_t reg,
+			uint16_t value)
+{
+	pmbus_sim_set(sim, page, reg, value, 2);
+}
+
+uint16_t pmbus_sim_get(pmbus_sim_t *sim, uint8_t page, uint8_t reg)
+{
+	if (page >= PMBUS_SIM_PAGES)
+		page = sim->page;
+	return sim->regs[page][reg];
+}
+
+void pmbus_sim_get_stats(pmbus_sim_t *sim, struct pmbus_sim_stats *stats)
+{
+	*stats = sim->stats;
+}
+
+static size_t reg_size(pmbus_sim_t *sim, uint8_t reg)
+{
+	if (reg == PMBUS_PAGE)
+		return 1;
+	return sim->size[sim->page][reg];
+}
+
+static int sim_write(pmbus_sim_t *sim, const uint8_t *buf, size_t len)
+{
+	uint8_t wr_addr = sim->addr << 1;
+	uint8_t reg = buf[0];
+	size_t size = reg_size(sim, reg);
+	uint16_t value;
+
+	/* unsupported commands are not acknowledged */
+	if (size == 0)
+		return -1;
+
+	/* a command alone is for the following read */
+	if (len == 1)
+		return 0;
+
+	if (len == size + 2) {
+		if (pmbus_pec(pmbus_pec(0, &wr_addr, 1), buf, len - 1) !=
+		    buf[len - 1]) {
+			sim->stats.pec_errors++;
+			return -1;
+		}
+		len--;
+	}
+	if (len != size + 1)
+		return -1;
+
+	value = size == 1 ? buf[1] : buf[1] | (buf[2] << 8);
+	if (reg == PMBUS_PAGE) {
+		if (value >= PMBUS_SIM_PAGES)
+			return -1;
+		sim->page = value;
+		sim->stats.page_writes++;
+	} else {
+		sim->regs[sim->page][reg] = value;
+	}
+	return 0;
+}
+
+static void sim_read(pmbus_sim_t *sim, uint8_t reg, uint8_t *buf,
+		     size_t len)
+{
+	uint8_t addr[2] = {sim->addr << 1, (sim->addr << 1) | 1};
+	size_t size = reg_size(sim, reg), i;
+	uint16_t value;
+	uint8_t crc;
+
+	value = reg == PMBUS_PAGE ? sim->page : sim->regs[sim->page][reg];
+	for (i = 0; i < len; i++) {
+		if (i < size) {
+			buf[i] = (value >> (i * 8)) & 0xFF;
+		} else if (i == size) {
+			crc = pmbus_pec(0, &addr[0], 1);
+			crc = pmbus_pec(crc, &reg, 1);
+			crc = pmbus_pec(crc, &addr[1], 1);
+			buf[i] = pmbus_pec(crc, buf, size);
+		} else {
+			buf[i] = 0xFF;
+		}
+	}
+}
+
+int pmbus_sim_xfer(pmbus_sim_t *sim, struct i2c_msg *msgs, int nmsgs)
+{
+	int i, have_cmd = 0;
+	uint8_t cmd = 0;
+
+	sim->stats.transfers++;
+	for (i = 0; i < nmsgs; i++) {
+		struct i2c_msg *msg = &msgs[i];
+
+		sim->stats.messages++;
+		if (msg->addr != sim->addr) {
+			errno = ENXIO;
+			return -1;
+		}
+
+		if (msg->flags & I2C_M_RD) {
+			if (!have_cmd) {
+				errno = EIO;
+				return -1;
+			}
+			sim_read(sim, cmd, msg->buf, msg->len);
+			have_cmd = 0;
+		} else {
+			if (msg->len == 0 || sim_write(sim, msg->buf, msg->len) != 0) {
+				errno = EIO;
+				return -1;
+			}
+			cmd = msg->buf[0];
+			have_cmd = 1;
+		}
+	}
+	return 0;
+}
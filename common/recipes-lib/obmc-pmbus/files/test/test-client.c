@@ -0,0 +1,174 @@
+/*
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <errno.h>
+
+#include "test-defs.h"
+
+#define SIM_ADDR	0x40
+
+void test_client_rw(struct test_stats *stats)
+{
+	pmbus_sim_t *sim = pmbus_sim_create(SIM_ADDR);
+	pmbus_dev_t *pmdev = pmbus_device_open_sim(sim, 0);
+	struct pmbus_sim_stats sim_stats;
+	uint16_t word = 0;
+	uint8_t byte = 0;
+
+	pmbus_sim_set_byte(sim, 1, PMBUS_OPERATION, 0);
+	pmbus_sim_set_word(sim, 1, PMBUS_READ_VOUT, 0x1234);
+
+	TEST_CHECK(stats, pmbus_write_byte_data(pmdev, 1, PMBUS_OPERATION,
+						PMBUS_OPERATION_ON) == 0);
+	TEST_CHECK(stats, pmbus_sim_get(sim, 1, PMBUS_OPERATION) ==
+			  PMBUS_OPERATION_ON);
+	TEST_CHECK(stats, pmbus_read_byte_data(pmdev, 1, PMBUS_OPERATION,
+					       &byte) == 0);
+	TEST_CHECK(stats, byte == PMBUS_OPERATION_ON);
+	TEST_CHECK(stats, pmbus_read_word_data(pmdev, 1, PMBUS_READ_VOUT,
+					       &word) == 0);
+	TEST_CHECK(stats, word == 0x1234);
+
+	/* the page is only written once */
+	pmbus_sim_get_stats(sim, &sim_stats);
+	TEST_CHECK(stats, sim_stats.page_writes == 1);
+
+	pmbus_device_close(pmdev);
+	pmbus_sim_destroy(sim);
+}
+
+void test_client_pec(struct test_stats *stats)
+{
+	pmbus_sim_t *sim = pmbus_sim_create(SIM_ADDR);
+	pmbus_dev_t *pmdev = pmbus_device_open_sim(sim, PMBUS_FLAG_PEC);
+	struct pmbus_sim_stats sim_stats;
+	struct pmbus_reading rd = {
+		.page = PMBUS_PAGE_NONE,
+		.reg = PMBUS_READ_TEMPERATURE_1,
+		.format = PMBUS_FMT_LINEAR11,
+	};
+	uint8_t byte = 0;
+
+	pmbus_sim_set_byte(sim, 0, PMBUS_OPERATION, 0);
+	pmbus_sim_set_word(sim, 0, PMBUS_READ_TEMPERATURE_1, 0x0019);
+
+	TEST_CHECK(stats, pmbus_write_byte_data(pmdev, 0, PMBUS_OPERATION,
+						PMBUS_OPERATION_ON) == 0);
+	TEST_CHECK(stats, pmbus_read_byte_data(pmdev, 0, PMBUS_OPERATION,
+					       &byte) == 0);
+	TEST_CHECK(stats, byte == PMBUS_OPERATION_ON);
+	TEST_CHECK(stats, pmbus_read_list(pmdev, &rd, 1) == 0);
+	TEST_NEAR(stats, rd.value, 25.0);
+
+	pmbus_sim_get_stats(sim, &sim_stats);
+	TEST_CHECK(stats, sim_stats.pec_errors == 0);
+
+	pmbus_device_close(pmdev);
+	pmbus_sim_destroy(sim);
+}
+
+void test_client_read_list(struct test_stats *stats)
+{
+	pmbus_sim_t *sim = pmbus_sim_create(SIM_ADDR);
+	pmbus_dev_t *pmdev = pmbus_device_open_sim(sim, 0);
+	struct pmbus_sim_stats sim_stats;
+	struct pmbus_reading list[] = {
+		{.page = 0, .reg = PMBUS_READ_VOUT, .format = PMBUS_FMT_VOUT},
+		{.page = 1, .reg = PMBUS_READ_VOUT, .format = PMBUS_FMT_VOUT,
+		 .vid = PMBUS_VID_VR12},
+		{.page = 0, .reg = PMBUS_READ_IOUT, .format = PMBUS_FMT_LINEAR11},
+		{.page = 1, .reg = PMBUS_READ_IOUT, .format = PMBUS_FMT_LINEAR11},
+		{.page = 0, .reg = PMBUS_STATUS_BYTE, .format = PMBUS_FMT_BYTE},
+		{.page = 1, .reg = PMBUS_READ_POUT, .format = PMBUS_FMT_LINEAR11},
+	};
+	int i;
+
+	pmbus_sim_set_byte(sim, 0, PMBUS_VOUT_MODE, 0x14);	/* LINEAR16, 2^-12 */
+	pmbus_sim_set_word(sim, 0, PMBUS_READ_VOUT, 0x3000);
+	pmbus_sim_set_word(sim, 0, PMBUS_READ_IOUT, 0xD300);
+	pmbus_sim_set_byte(sim, 0, PMBUS_STATUS_BYTE, 0x42);
+	pmbus_sim_set_byte(sim, 1, PMBUS_VOUT_MODE, 0x21);	/* VID */
+	pmbus_sim_set_word(sim, 1, PMBUS_READ_VOUT, 0x97);
+	pmbus_sim_set_word(sim, 1, PMBUS_READ_IOUT, 0x0010);
+	pmbus_sim_set_word(sim, 1, PMBUS_READ_POUT, 0x0820);
+
+	TEST_CHECK(stats, pmbus_read_list(pmdev, list, ARRAY_SIZE(list)) == 0);
+	for (i = 0; i < ARRAY_SIZE(list); i++) {
+		TEST_CHECK(stats, list[i].status == 0);
+	}
+	TEST_NEAR(stats, list[0].value, 3.0);
+	TEST_NEAR(stats, list[1].value, 1.0);
+	TEST_NEAR(stats, list[2].value, 12.0);
+	TEST_NEAR(stats, list[3].value, 16.0);
+	TEST_CHECK(stats, list[4].raw == 0x42);
+	TEST_NEAR(stats, list[5].value, 64.0);
+
+	/* one PAGE write and one transfer per page */
+	pmbus_sim_get_stats(sim, &sim_stats);
+	TEST_CHECK(stats, sim_stats.page_writes == 2);
+	TEST_CHECK(stats, sim_stats.transfers == 4);
+
+	/* page 1 is current now, and VOUT_MODE is cached */
+	TEST_CHECK(stats, pmbus_read_list(pmdev, list, ARRAY_SIZE(list)) == 0);
+	pmbus_sim_get_stats(sim, &sim_stats);
+	TEST_CHECK(stats, sim_stats.page_writes == 3);
+	TEST_CHECK(stats, sim_stats.transfers == 7);
+	TEST_CHECK(stats, sim_stats.messages == 18 + 13);
+
+	/* an unsupported register doesn't fail the others of its transfer */
+	list[4].reg = 0xD0;	/* MFR_SPECIFIC_00 */
+	TEST_CHECK(stats, pmbus_read_list(pmdev, list, ARRAY_SIZE(list)) == -1);
+	TEST_CHECK(stats, list[4].status == EIO);
+	TEST_CHECK(stats, list[0].status == 0 && list[2].status == 0);
+	TEST_NEAR(stats, list[2].value, 12.0);
+
+	pmbus_device_close(pmdev);
+	pmbus_sim_destroy(sim);
+}
+
+void test_client_vout_mode(struct test_stats *stats)
+{
+	pmbus_sim_t *sim = pmbus_sim_create(SIM_ADDR);
+	pmbus_dev_t *pmdev = pmbus_device_open_sim(sim, 0);
+	struct pmbus_reading list[] = {
+		{.page = 0, .reg = PMBUS_READ_VOUT, .format = PMBUS_FMT_VOUT},
+		{.page = 0, .reg = 0xD0, .format = PMBUS_FMT_BYTE},
+	};
+
+	pmbus_sim_set_byte(sim, 0, PMBUS_VOUT_MODE, 0x14);	/* 2^-12 */
+	pmbus_sim_set_word(sim, 0, PMBUS_READ_VOUT, 0x3000);
+
+	TEST_CHECK(stats, pmbus_read_list(pmdev, list, 1) == 0);
+	TEST_NEAR(stats, list[0].value, 3.0);
+
+	/* writing VOUT_MODE drops the cached one */
+	TEST_CHECK(stats, pmbus_write_byte_data(pmdev, 0, PMBUS_VOUT_MODE,
+						0x13) == 0);
+	TEST_CHECK(stats, pmbus_read_list(pmdev, list, 1) == 0);
+	TEST_NEAR(stats, list[0].value, 1.5);
+
+	/* so does a failed read of the page (MFR_SPECIFIC_00 unsupported) */
+	TEST_CHECK(stats, pmbus_read_list(pmdev, list, 2) == -1);
+	TEST_CHECK(stats, list[0].status == 0 && list[1].status == EIO);
+	pmbus_sim_set_byte(sim, 0, PMBUS_VOUT_MODE, 0x14);
+	TEST_CHECK(stats, pmbus_read_list(pmdev, list, 1) == 0);
+	TEST_NEAR(stats, list[0].value, 3.0);
+
+	pmbus_device_close(pmdev);
+	pmbus_sim_destroy(sim);
+}
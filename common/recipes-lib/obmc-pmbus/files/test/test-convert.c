@@ -0,0 +1,63 @@
+/*
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "test-defs.h"
+
+void test_convert_linear(struct test_stats *stats)
+{
+	/* 12.0 = 0x300 * 2^-6 */
+	TEST_NEAR(stats, pmbus_linear11_to_double(0xD300), 12.0);
+	/* -0.5 = -1 * 2^-1 */
+	TEST_NEAR(stats, pmbus_linear11_to_double(0xFFFF), -0.5);
+	/* 1023 * 2^0, largest positive mantissa */
+	TEST_NEAR(stats, pmbus_linear11_to_double(0x03FF), 1023.0);
+	/* -1024 * 2^1 */
+	TEST_NEAR(stats, pmbus_linear11_to_double(0x0C00), -2048.0);
+	/* 0x4000 * 2^-13 (VOUT_MODE 0x13) */
+	TEST_NEAR(stats, pmbus_linear16_to_double(0x4000, 0x13), 2.0);
+	TEST_NEAR(stats, pmbus_linear16_to_double(0x199A, 0x14), 1.60009765625);
+	/* bit 7 (relative) doesn't change the mode */
+	TEST_NEAR(stats, pmbus_vout_to_double(0x4000, 0x93, 0, NULL), 2.0);
+}
+
+void test_convert_vid(struct test_stats *stats)
+{
+	TEST_NEAR(stats, pmbus_vid_to_double(0x00, PMBUS_VID_VR12), 0.0);
+	TEST_NEAR(stats, pmbus_vid_to_double(0x01, PMBUS_VID_VR12), 0.25);
+	TEST_NEAR(stats, pmbus_vid_to_double(0x97, PMBUS_VID_VR12), 1.0);
+	TEST_NEAR(stats, pmbus_vid_to_double(0x02, PMBUS_VID_VR11), 1.6);
+	TEST_NEAR(stats, pmbus_vid_to_double(0x01, PMBUS_VID_VR13), 0.5);
+	TEST_NEAR(stats, pmbus_vid_to_double(0x33, PMBUS_VID_IMVP9), 0.7);
+	TEST_NEAR(stats, pmbus_vid_to_double(0x10, PMBUS_VID_AMD625MV), 1.45);
+	/* VOUT_MODE 0x21: VID mode */
+	TEST_NEAR(stats, pmbus_vout_to_double(0x0097, 0x21, PMBUS_VID_VR12,
+					      NULL), 1.0);
+}
+
+void test_convert_direct(struct test_stats *stats)
+{
+	struct pmbus_direct_coef coef = {.m = 2, .b = 100, .R = -1};
+
+	/* (Y * 10 - 100) / 2 */
+	TEST_NEAR(stats, pmbus_direct_to_double(30, &coef), 100.0);
+	TEST_NEAR(stats, pmbus_direct_to_double(0xFFF6, &coef), -100.0);
+	TEST_NEAR(stats, pmbus_vout_to_double(30, 0x40, 0, &coef), 100.0);
+
+	coef.m = 0;
+	TEST_CHECK(stats, isnan(pmbus_direct_to_double(30, &coef)));
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef _OBMC_PMBUS_TEST_DEFS_H_
+#define _OBMC_PMBUS_TEST_DEFS_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "../obmc-pmbus.h"
+
+/*
+ * Logging utilities.
+ */
+#define LOG_ERR(fmt, args...)	fprintf(stderr, fmt, ##args)
+
+#ifndef ARRAY_SIZE
+#define ARRAY_SIZE(a)	(sizeof(a) / sizeof((a)[0]))
+#endif /* ARRAY_SIZE */
+
+struct test_stats {
+	int num_total;
+	int num_errors;
+};
+
+#define TEST_CHECK(stats, cond)						\
+do {									\
+	(stats)->num_total++;						\
+	if (!(cond)) {							\
+		LOG_ERR("%s:%d: check failed: %s\n", __func__, __LINE__,	\
+			#cond);						\
+		(stats)->num_errors++;					\
+	}								\
+} while (0)
+
+#define TEST_NEAR(stats, val, expected) \
+	TEST_CHECK(stats, fabs((val) - (expected)) < 1e-6)
+
+/*
+ * Test function declarations.
+ */
+void test_convert_linear(struct test_stats *stats);
+void test_convert_vid(struct test_stats *stats);
+void test_convert_direct(struct test_stats *stats);
+void test_client_rw(struct test_stats *stats);
+void test_client_pec(struct test_stats *stats);
+void test_client_read_list(struct test_stats *stats);
+void test_client_vout_mode(struct test_stats *stats);
+
+#endif /* _OBMC_PMBUS_TEST_DEFS_H_ */
@@ -16,20 +16,117 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <syslog.h>
+#include <pthread.h>
 #include <sys/mman.h>
 #include <fcntl.h>
 #include "phymem.h"
 
+/* Pages kept mapped by phymem_read()/phymem_write() */
+#define PHYMEM_CACHE_PAGES 8
+
+/* Physical address space covered by the simulator, fits a 32-bit off_t */
+#define PHYMEM_SIM_SIZE 0x7ffff000
+
+struct phymem_page {
+	off_t base;
+	void *map;              /* MAP_FAILED if the slot is free */
+	unsigned long last_use;
+};
+
+struct phymem_region {
+	off_t base;
+	size_t length;
+	void *map_base;
+	size_t mapped_size;
+	volatile uint8_t *regs;
+};
+
+static pthread_mutex_t phymem_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct phymem_page page_cache[PHYMEM_CACHE_PAGES];
+static unsigned long use_clock = 0;
+static int mem_fd = -1;
+
+/*
+ * Keep the device ordered with the CPU: on ARM this is a dmb, so a
+ * write is not reordered with the accesses which follow it.
+ */
+#define phymem_barrier() __sync_synchronize()
+
+/* Called with phymem_lock held */
+static int phymem_fd(void)
+{
+	int i;
+
+	if (mem_fd >= 0) {
+		return mem_fd;
+	}
+	mem_fd = open("/dev/mem", O_RDWR | O_SYNC | O_CLOEXEC);
+	if (mem_fd < 0) {
+		syslog(LOG_ERR, "fail to open \"/dev/mem\"");
+		return -1;
+	}
+	for (i = 0; i < PHYMEM_CACHE_PAGES; i++) {
+		page_cache[i].map = MAP_FAILED;
+	}
+	return mem_fd;
+}
+
+int phymem_sim_init(void)
+{
+	int fd, i;
+
+	pthread_mutex_lock(&phymem_lock);
+	if (mem_fd >= 0) {
+		pthread_mutex_unlock(&phymem_lock);
+		return -1;
+	}
+	/* A sparse anonymous file stands for the physical address space */
+	fd = memfd_create("phymem-sim", MFD_CLOEXEC);
+	if (fd < 0 || ftruncate(fd, PHYMEM_SIM_SIZE) < 0) {
+		syslog(LOG_ERR, "cannot create phymem simulator");
+		if (fd >= 0) {
+			close(fd);
+		}
+		pthread_mutex_unlock(&phymem_lock);
+		return -1;
+	}
+	for (i = 0; i < PHYMEM_CACHE_PAGES; i++) {
+		page_cache[i].map = MAP_FAILED;
+	}
+	mem_fd = fd;
+	pthread_mutex_unlock(&phymem_lock);
+	return 0;
+}
+
+static void *phymem_map(off_t page_base, size_t length)
+{
+	void *map_base;
+	int fd;
+
+	pthread_mutex_lock(&phymem_lock);
+	fd = phymem_fd();
+	pthread_mutex_unlock(&phymem_lock);
+	if (fd < 0) {
+		return MAP_FAILED;
+	}
+
+	map_base = mmap(NULL, length, PROT_READ|PROT_WRITE, MAP_SHARED, fd, page_base);
+	if (map_base == MAP_FAILED) {
+		syslog(LOG_ERR, "mmap failed");
+	}
+	return map_base;
+}
 
 void * phymem_open(off_t base, size_t length, size_t *mapped_size)
 {
-	int fd = 0;
-	void *map_base = MAP_FAILED;
 	size_t page_size = 0;
 	off_t page_offset = 0;
 
@@ -41,20 +138,7 @@ void * phymem_open(off_t base, size_t length, size_t *mapped_size)
 	}
 	*mapped_size = length;
 
-	fd = open("/dev/mem", O_RDWR | O_SYNC);
-	if (fd < 0) {
-		syslog(LOG_ERR, "fail to open \"/dev/mem\"");
-		goto end;
-	}
-
-	map_base = mmap(NULL, length, PROT_READ|PROT_WRITE, MAP_SHARED, fd, base & ~(off_t)(page_size - 1));
-
-	if (map_base == MAP_FAILED) {
-		syslog(LOG_ERR, "mmap failed");
-	}
-	close(fd);
-end:
-	return map_base;
+	return phymem_map(base & ~(off_t)(page_size - 1), length);
 }
 
 int phymem_close(void *map_base, size_t length)
@@ -67,18 +151,61 @@ int phymem_close(void *map_base, size_t length)
 	return ret;
 }
 
+/*
+ * Returns the virtual address of <phys> through the page cache, the
+ * least recently used page is unmapped when it is full. Called with
+ * phymem_lock held, the address is valid until it is released.
+ */
+static volatile void *phymem_cache_addr(off_t phys)
+{
+	size_t page_size = getpagesize();
+	off_t page_base = phys & ~(off_t)(page_size - 1);
+	struct phymem_page *page = NULL;
+	int i;
+
+	if (phymem_fd() < 0) {
+		return NULL;
+	}
+
+	for (i = 0; i < PHYMEM_CACHE_PAGES; i++) {
+		struct phymem_page *p = &page_cache[i];
+
+		if (p->map != MAP_FAILED && p->base == page_base) {
+			page = p;
+			break;
+		}
+		if (page == NULL || (page->map != MAP_FAILED &&
+		    (p->map == MAP_FAILED || p->last_use < page->last_use))) {
+			page = p;
+		}
+	}
+
+	if (page->map == MAP_FAILED || page->base != page_base) {
+		if (page->map != MAP_FAILED) {
+			phymem_close(page->map, page_size);
+		}
+		page->map = mmap(NULL, page_size, PROT_READ|PROT_WRITE, MAP_SHARED,
+				 mem_fd, page_base);
+		if (page->map == MAP_FAILED) {
+			syslog(LOG_ERR, "mmap failed");
+			return NULL;
+		}
+		page->base = page_base;
+	}
+	page->last_use = ++use_clock;
+	return (volatile uint8_t *)page->map + (phys - page_base);
+}
+
 int phymem_read(off_t addr, size_t offset, memLength length, void *value)
 {
-	void *vir_addr = NULL, *map_base = NULL;
-	size_t mapped_size = 0, page_size = 0;
-	int ret = 0;
+	volatile void *vir_addr = NULL;
 
-	page_size = getpagesize();
-	map_base = phymem_open(addr, page_size, &mapped_size);
-	if (map_base == MAP_FAILED) {
+	pthread_mutex_lock(&phymem_lock);
+	vir_addr = phymem_cache_addr(addr + offset);
+	if (vir_addr == NULL) {
+		pthread_mutex_unlock(&phymem_lock);
 		return -1;
 	}
-	vir_addr = (char*)map_base + offset;
 
 	switch (length) {
 	case M_BYTE:
@@ -94,22 +221,20 @@ int phymem_read(off_t addr, size_t offset, memLength length, void *value)
 		*(uint32_t *)value = *(volatile uint32_t*)vir_addr;
 		break;
 	}
-	ret = phymem_close(map_base, mapped_size);
-	return ret;
+	pthread_mutex_unlock(&phymem_lock);
+	return 0;
 }
 
 int phymem_write(off_t addr, size_t offset, memLength length, uint32_t value)
 {
-	void *vir_addr = NULL, *map_base = NULL;
-	size_t mapped_size = 0, page_size = 0;
-	int ret = 0;
+	volatile void *vir_addr = NULL;
 
-	page_size = getpagesize();
-	map_base = phymem_open(addr, page_size, &mapped_size);
-	if (map_base == MAP_FAILED) {
-                return -1;
-        }
-	vir_addr = (char*)map_base + offset;
+	pthread_mutex_lock(&phymem_lock);
+	vir_addr = phymem_cache_addr(addr + offset);
+	if (vir_addr == NULL) {
+		pthread_mutex_unlock(&phymem_lock);
+		return -1;
+	}
 
 	switch (length) {
 	case M_BYTE:
@@ -125,8 +250,9 @@ int phymem_write(off_t addr, size_t offset, memLength length, uint32_t value)
 		*(volatile uint32_t*)vir_addr = (uint32_t)value;
 		break;
 	}
-	ret = phymem_close(map_base, mapped_size);
-	return ret;
+	phymem_barrier();
+	pthread_mutex_unlock(&phymem_lock);
+	return 0;
 }
 
 int phymem_get_byte(off_t addr, size_t offset, uint8_t *value)
@@ -163,30 +289,167 @@ int phymem_set_dword(off_t addr, size_t offset, uint32_t value)
 	return phymem_write(addr, offset, M_DWORD, value);
 }
 
-int phymem_dword_set_bit(off_t base, size_t offset, uint8_t bit) {
-	int ret = 0;
-	uint32_t value = 0;
+/* Read-modify-write of a dword under phymem_lock */
+static int phymem_dword_update(off_t base, size_t offset, uint32_t mask, uint32_t bits)
+{
+	volatile uint32_t *reg;
 
-	ret = phymem_get_dword(base, offset, &value);
-	if (ret < 0) {
+	pthread_mutex_lock(&phymem_lock);
+	reg = phymem_cache_addr(base + offset);
+	if (reg == NULL) {
+		pthread_mutex_unlock(&phymem_lock);
 		return -1;
 	}
-	value |= (0x1 << bit);
-	ret = phymem_set_dword(base, offset, value);
+	*reg = (*reg & ~mask) | (bits & mask);
+	phymem_barrier();
+	pthread_mutex_unlock(&phymem_lock);
+	return 0;
+}
 
-	return ret;
+int phymem_dword_set_bit(off_t base, size_t offset, uint8_t bit) {
+	return phymem_dword_update(base, offset, 0x1 << bit, 0x1 << bit);
 }
 
 int phymem_dword_clear_bit(off_t base, size_t offset, uint8_t bit) {
-	int ret = 0;
-	uint32_t value = 0;
+	return phymem_dword_update(base, offset, 0x1 << bit, 0);
+}
+
+phymem_region_t *phymem_region_open(off_t base, size_t length)
+{
+	phymem_region_t *region;
+
+	if (length == 0) {
+		return NULL;
+	}
+	region = calloc(1, sizeof(*region));
+	if (region == NULL) {
+		return NULL;
+	}
+	region->map_base = phymem_open(base, length, &region->mapped_size);
+	if (region->map_base == MAP_FAILED) {
+		free(region);
+		return NULL;
+	}
+	region->base = base;
+	region->length = length;
+	region->regs = (volatile uint8_t *)region->map_base +
+		       (region->mapped_size - length);
+	return region;
+}
+
+void phymem_region_close(phymem_region_t *region)
+{
+	if (region == NULL) {
+		return;
+	}
+	phymem_close(region->map_base, region->mapped_size);
+	free(region);
+}
 
-	ret = phymem_get_dword(base, offset, &value);
-	if (ret < 0) {
+static volatile void *region_addr(phymem_region_t *region, size_t offset,
+                                  size_t size, size_t align)
+{
+	if (region == NULL || (offset & (align - 1)) ||
+	    offset > region->length || size > region->length - offset) {
+		return NULL;
+	}
+	return region->regs + offset;
+}
+
+int phymem_region_read8(phymem_region_t *region, size_t offset, uint8_t *value)
+{
+	volatile uint8_t *reg = region_addr(region, offset, sizeof(*value), sizeof(*value));
+
+	if (reg == NULL) {
 		return -1;
 	}
-	value &= ~(0x1 << bit);
-	ret = phymem_set_dword(base, offset, value);
+	*value = *reg;
+	return 0;
+}
 
-	return ret;
+int phymem_region_read16(phymem_region_t *region, size_t offset, uint16_t *value)
+{
+	volatile uint16_t *reg = region_addr(region, offset, sizeof(*value), sizeof(*value));
+
+	if (reg == NULL) {
+		return -1;
+	}
+	*value = *reg;
+	return 0;
+}
+
+int phymem_region_read32(phymem_region_t *region, size_t offset, uint32_t *value)
+{
+	volatile uint32_t *reg = region_addr(region, offset, sizeof(*value), sizeof(*value));
+
+	if (reg == NULL) {
+		return -1;
+	}
+	*value = *reg;
+	return 0;
+}
+
+int phymem_region_write32(phymem_region_t *region, size_t offset, uint32_t value)
+{
+	volatile uint32_t *reg = region_addr(region, offset, sizeof(value), sizeof(value));
+
+	if (reg == NULL) {
+		return -1;
+	}
+	*reg = value;
+	phymem_barrier();
+	return 0;
+}
+
+int phymem_region_read_bulk32(phymem_region_t *region, size_t offset,
+                              uint32_t *values, size_t count)
+{
+	volatile uint32_t *reg;
+	size_t i;
+
+	if (count > SIZE_MAX / sizeof(uint32_t)) {
+		return -1;
+	}
+	reg = region_addr(region, offset, count * sizeof(uint32_t), sizeof(uint32_t));
+	if (reg == NULL) {
+		return -1;
+	}
+	/* one register at a time, the device may not support bursts */
+	for (i = 0; i < count; i++) {
+		values[i] = reg[i];
+	}
+	return 0;
+}
+
+int phymem_region_write_bulk32(phymem_region_t *region, size_t offset,
+                               const uint32_t *values, size_t count)
+{
+	volatile uint32_t *reg;
+	size_t i;
+
+	if (count > SIZE_MAX / sizeof(uint32_t)) {
+		return -1;
+	}
+	reg = region_addr(region, offset, count * sizeof(uint32_t), sizeof(uint32_t));
+	if (reg == NULL) {
+		return -1;
+	}
+	for (i = 0; i < count; i++) {
+		reg[i] = values[i];
+	}
+	phymem_barrier();
+	return 0;
+}
+
+int phymem_region_update32(phymem_region_t *region, size_t offset,
+                           uint32_t mask, uint32_t bits)
+{
+	volatile uint32_t *reg = region_addr(region, offset, sizeof(uint32_t), sizeof(uint32_t));
+
+	if (reg == NULL) {
+		return -1;
+	}
+	*reg = (*reg & ~mask) | (bits & mask);
+	phymem_barrier();
+	return 0;
 }
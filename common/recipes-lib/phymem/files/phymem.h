@@ -1,6 +1,11 @@
 #ifndef PHYMEM_H
 #define PHYMEM_H
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
 #include <sys/types.h>
 
 typedef enum memLength {
@@ -26,4 +31,41 @@ int phymem_set_dword(off_t addr, size_t offset, uint32_t value);
 int phymem_dword_clear_bit(off_t base, size_t offset, uint8_t bit);
 int phymem_dword_set_bit(off_t base, size_t offset, uint8_t bit);
 
+/*
+ * The accessors above go through a small per-process LRU of mapped
+ * pages, so repeated accesses to the same registers don't mmap/munmap
+ * /dev/mem every time.
+ *
+ * A region maps a register window once, for code which accesses it
+ * many times (strap or postcode dumps, GPIO setup). Offsets are relative
+ * to <base> and must be aligned to the access size; accesses outside the
+ * window fail with -1. Writes are followed by a barrier so that they
+ * reach the device in program order with later accesses.
+ */
+typedef struct phymem_region phymem_region_t;
+
+phymem_region_t *phymem_region_open(off_t base, size_t length);
+void phymem_region_close(phymem_region_t *region);
+int phymem_region_read8(phymem_region_t *region, size_t offset, uint8_t *value);
+int phymem_region_read16(phymem_region_t *region, size_t offset, uint16_t *value);
+int phymem_region_read32(phymem_region_t *region, size_t offset, uint32_t *value);
+int phymem_region_write32(phymem_region_t *region, size_t offset, uint32_t value);
+int phymem_region_read_bulk32(phymem_region_t *region, size_t offset,
+                              uint32_t *values, size_t count);
+int phymem_region_write_bulk32(phymem_region_t *region, size_t offset,
+                               const uint32_t *values, size_t count);
+/* value = (value & ~mask) | (bits & mask) */
+int phymem_region_update32(phymem_region_t *region, size_t offset,
+                           uint32_t mask, uint32_t bits);
+
+/*
+ * Unit tests: back all mappings of this process with anonymous memory
+ * instead of /dev/mem. Must be called before any access.
+ */
+int phymem_sim_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
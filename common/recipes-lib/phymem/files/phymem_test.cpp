@@ -0,0 +1,105 @@
+/*
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <cstring>
+#include <gtest/gtest.h>
+#include "phymem.h"
+
+#define SCU_BASE   0x1E6E2000
+#define GPIO_BASE  0x1E780000
+
+class PhymemTest : public ::testing::Test {
+  protected:
+    static void SetUpTestCase() {
+      ASSERT_EQ(phymem_sim_init(), 0);
+    }
+};
+
+TEST_F(PhymemTest, ReadWrite) {
+  uint32_t dword = 0;
+  uint16_t word = 0;
+  uint8_t byte = 0;
+
+  ASSERT_EQ(phymem_set_dword(SCU_BASE, 0x70, 0x12345678), 0);
+  ASSERT_EQ(phymem_get_dword(SCU_BASE, 0x70, &dword), 0);
+  EXPECT_EQ(dword, 0x12345678u);
+  ASSERT_EQ(phymem_get_word(SCU_BASE, 0x72, &word), 0);
+  EXPECT_EQ(word, 0x1234);
+  ASSERT_EQ(phymem_get_byte(SCU_BASE, 0x70, &byte), 0);
+  EXPECT_EQ(byte, 0x78);
+}
+
+TEST_F(PhymemTest, SetClearBit) {
+  uint32_t dword = 0;
+
+  ASSERT_EQ(phymem_set_dword(SCU_BASE, 0x80, 0xf0), 0);
+  ASSERT_EQ(phymem_dword_set_bit(SCU_BASE, 0x80, 0), 0);
+  ASSERT_EQ(phymem_dword_clear_bit(SCU_BASE, 0x80, 7), 0);
+  ASSERT_EQ(phymem_get_dword(SCU_BASE, 0x80, &dword), 0);
+  EXPECT_EQ(dword, 0x71u);
+}
+
+// More pages than the cache holds, values must survive eviction
+TEST_F(PhymemTest, CacheEviction) {
+  uint32_t dword = 0;
+  int i;
+
+  for (i = 0; i < 32; i++) {
+    ASSERT_EQ(phymem_set_dword(GPIO_BASE + i * 0x1000, 0x4, i), 0);
+  }
+  for (i = 0; i < 32; i++) {
+    ASSERT_EQ(phymem_get_dword(GPIO_BASE + i * 0x1000, 0x4, &dword), 0);
+    EXPECT_EQ(dword, (uint32_t)i);
+  }
+}
+
+TEST_F(PhymemTest, Region) {
+  uint32_t in[4] = {1, 2, 3, 4}, out[4] = {0};
+  uint32_t dword = 0;
+  uint16_t word = 0;
+  phymem_region_t *region = phymem_region_open(SCU_BASE + 0x100, 0x20);
+
+  ASSERT_NE(region, nullptr);
+  ASSERT_EQ(phymem_region_write_bulk32(region, 0x10, in, 4), 0);
+  ASSERT_EQ(phymem_region_read_bulk32(region, 0x10, out, 4), 0);
+  EXPECT_EQ(memcmp(in, out, sizeof(in)), 0);
+
+  // visible through the page cache as well
+  ASSERT_EQ(phymem_get_dword(SCU_BASE, 0x11c, &dword), 0);
+  EXPECT_EQ(dword, 4u);
+
+  ASSERT_EQ(phymem_region_write32(region, 0x0, 0xaabbccdd), 0);
+  ASSERT_EQ(phymem_region_update32(region, 0x0, 0x0000ff00, 0x1234), 0);
+  ASSERT_EQ(phymem_region_read32(region, 0x0, &dword), 0);
+  EXPECT_EQ(dword, 0xaabb12ddu);
+  ASSERT_EQ(phymem_region_read16(region, 0x2, &word), 0);
+  EXPECT_EQ(word, 0xaabb);
+  phymem_region_close(region);
+}
+
+TEST_F(PhymemTest, RegionBounds) {
+  uint32_t out[4];
+  uint32_t dword = 0;
+  phymem_region_t *region = phymem_region_open(SCU_BASE, 0x10);
+
+  ASSERT_NE(region, nullptr);
+  EXPECT_EQ(phymem_region_read32(region, 0x10, &dword), -1);
+  EXPECT_EQ(phymem_region_read32(region, 0x2, &dword), -1);
+  EXPECT_EQ(phymem_region_read_bulk32(region, 0x4, out, 4), -1);
+  EXPECT_EQ(phymem_region_read_bulk32(region, 0x0, out, 4), 0);
+  phymem_region_close(region);
+}
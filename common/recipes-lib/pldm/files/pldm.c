@@ -29,6 +29,7 @@
 #include <stddef.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <openbmc/ncsi.h>
@@ -45,6 +46,10 @@
   #define DBG_PRINT(fmt, args...)
 #endif
 
+// component pages already served are dropped from the page cache in
+// windows of this size
+#define PLDM_PKG_WINDOW (1024 * 1024)
+
 // global PLDM control & configuration variables
 static uint8_t  gPldm_iid = 0; // technically only 5 bits as per DSP0240 v1.0.0
 static uint32_t gPldm_transfer_size = PLDM_MAX_XFER_SIZE;
@@ -497,9 +502,46 @@ void printComponentImgInfo(pldm_fw_pkg_hdr_t *pFwPkgHdr, int index)
 }
 
 
+static uint32_t crc32_table[256];
+static pthread_once_t crc32_once = PTHREAD_ONCE_INIT;
+
+static void crc32_init(void)
+{
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; k++)
+      c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+    crc32_table[i] = c;
+  }
+}
+
+// CRC32 as used for the package header checksum (DSP0267), continues
+// from crc, start with 0
+static uint32_t pldm_crc32(uint32_t crc, const unsigned char *buf, size_t len)
+{
+  pthread_once(&crc32_once, crc32_init);
+  crc = ~crc;
+  while (len--)
+    crc = crc32_table[(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+// Returns a pointer to len bytes at offset in the package, or NULL if
+// they are not all in the file
+static void *pkg_view(pldm_fw_pkg_hdr_t *pFwPkgHdr, size_t offset, size_t len)
+{
+  if (offset > pFwPkgHdr->pkgSize || len > pFwPkgHdr->pkgSize - offset) {
+    printf("ERROR: package truncated, need %zu bytes at offset 0x%zx (size %zu)\n",
+           len, offset, pFwPkgHdr->pkgSize);
+    return NULL;
+  }
+  return pFwPkgHdr->rawHdrBuf + offset;
+}
+
+
 // Given a PLDM Firmware package, this function will
 //  1. allocate a pldm_fw_pkg_hdr_t structure representing this package,
-//  2. read PLDM firmware package to RAM
+//  2. map the PLDM firmware package read-only
 //  3. initialize header info area of pldm_fw_pkg_hdr_t
 //  4. returns
 //       1. pointer to the struct,
@@ -508,50 +550,53 @@ void printComponentImgInfo(pldm_fw_pkg_hdr_t *pFwPkgHdr, int index)
 int
 init_pkg_hdr_info(char *path, pldm_fw_pkg_hdr_t** pFwPkgHdr, int *pOffset)
 {
-  FILE *fp;
-  int rcnt, size;
+  int fd;
   struct stat buf;
+  void *map;
+  pldm_fw_pkg_hdr_info_t *phdrInfo;
 
-  // Open the file exclusively for read
-  fp = fopen(path, "r");
-  if (!fp) {
+  *pFwPkgHdr = NULL;
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
     printf("ERROR: invalid file path :%s!\n", path);
     return -1;
   }
 
-  stat(path, &buf);
-  size = buf.st_size;
-  printf("size of file is %d bytes\n", size);
+  if (fstat(fd, &buf) < 0 || buf.st_size == 0) {
+    printf("ERROR: cannot stat %s or empty file\n", path);
+    close(fd);
+    return -1;
+  }
+  printf("size of file is %lld bytes\n", (long long)buf.st_size);
+
+  // Pages are faulted in as the headers are parsed and the components
+  // are served, the package is never mapped into this process as a whole
+  map = mmap(NULL, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    printf("ERROR: mmap %s failed: %s\n", path, strerror(errno));
+    return -1;
+  }
+  madvise(map, buf.st_size, MADV_SEQUENTIAL);
 
   // allocate pointer structure to access fw pkg header
   *pFwPkgHdr = (pldm_fw_pkg_hdr_t *)calloc(1, sizeof(pldm_fw_pkg_hdr_t));
   if (!(*pFwPkgHdr)) {
-    printf("ERROR: pFwPkgHdr malloc failed, size %d\n", sizeof(pldm_fw_pkg_hdr_t));
-    fclose(fp);
-    return -1;
-  }
-
-  // allocate actual buffer to store fw package header
-  (*pFwPkgHdr)->rawHdrBuf = (unsigned char *)calloc(1, size);
-  if (!(*pFwPkgHdr)->rawHdrBuf) {
-    printf("ERROR: rawHdrBuf malloc failed, size %d\n", size);
-    fclose(fp);
+    printf("ERROR: pFwPkgHdr malloc failed, size %zu\n", sizeof(pldm_fw_pkg_hdr_t));
+    munmap(map, buf.st_size);
     return -1;
   }
+  (*pFwPkgHdr)->rawHdrBuf = (unsigned char *)map;
+  (*pFwPkgHdr)->pkgSize = buf.st_size;
 
-  // Move the file pointer to the start and read the entire package header
-  fseek(fp, 0, SEEK_SET);
-  rcnt = fread((*pFwPkgHdr)->rawHdrBuf, 1, size, fp);
-  if (rcnt < size) {
-    printf("ERROR: rawHdrBuf read, rcnt(%d) < %d", rcnt,
-           size);
-    fclose(fp);
+  phdrInfo = pkg_view(*pFwPkgHdr, 0, offsetof(pldm_fw_pkg_hdr_info_t, versionString));
+  if (!phdrInfo ||
+      !pkg_view(*pFwPkgHdr, 0, offsetof(pldm_fw_pkg_hdr_info_t, versionString) +
+                               phdrInfo->versionStringLength)) {
     return -1;
   }
-  fclose(fp);
-
-
-  (*pFwPkgHdr)->phdrInfo = (pldm_fw_pkg_hdr_info_t *)(*pFwPkgHdr)->rawHdrBuf;
+  (*pFwPkgHdr)->phdrInfo = phdrInfo;
   printHdrInfo((*pFwPkgHdr)->phdrInfo, 1);
   *pOffset += offsetof(pldm_fw_pkg_hdr_info_t, versionString) +
              (*pFwPkgHdr)->phdrInfo->versionStringLength;
@@ -578,32 +623,40 @@ int
 init_device_id_records(pldm_fw_pkg_hdr_t* pFwPkgHdr, int *pOffset)
 {
   int i;
+  uint8_t *pCnt;
+  pldm_fw_dev_id_records_t *recs;
+  int compBitFieldLen = pFwPkgHdr->phdrInfo->componentBitmapBitLength/8;
 
-  pFwPkgHdr->devIdRecordCnt = pFwPkgHdr->rawHdrBuf[*pOffset];
+  pCnt = pkg_view(pFwPkgHdr, *pOffset, sizeof(pFwPkgHdr->devIdRecordCnt));
+  if (!pCnt)
+    return -1;
+  pFwPkgHdr->devIdRecordCnt = *pCnt;
   *pOffset += sizeof(pFwPkgHdr->devIdRecordCnt);
   DBG_PRINT("\n\n Number of Device ID Record in package (devIdRecordCnt) =%d\n",
             pFwPkgHdr->devIdRecordCnt);
+  if (pFwPkgHdr->devIdRecordCnt == 0) {
+    printf("ERROR: no device ID record in package\n");
+    return -1;
+  }
 
-  // allocate a look up table of pointers to each devIdRecord
+  // one allocation for the look up table of pointers to each devIdRecord
+  // and the records themselves, which follow the table
   pFwPkgHdr->pDevIdRecs =
       (pldm_fw_dev_id_records_t **) calloc(pFwPkgHdr->devIdRecordCnt,
-                                        sizeof(pldm_fw_dev_id_records_t *));
+                                        sizeof(pldm_fw_dev_id_records_t *) +
+                                        sizeof(pldm_fw_dev_id_records_t));
   if (!pFwPkgHdr->pDevIdRecs)
   {
-    printf("ERROR: pFwPkgHdr->pDevIdRecs malloc failed, size %d\n",
-       sizeof(pldm_fw_dev_id_records_t *) * pFwPkgHdr->devIdRecordCnt);
+    printf("ERROR: pFwPkgHdr->pDevIdRecs malloc failed, count %d\n",
+       pFwPkgHdr->devIdRecordCnt);
     return -1;
   }
+  recs = (pldm_fw_dev_id_records_t *)(pFwPkgHdr->pDevIdRecs + pFwPkgHdr->devIdRecordCnt);
 
   for (i=0; i<pFwPkgHdr->devIdRecordCnt; ++i)
   {
     // pointer to current DeviceRecord we're working on
-    pFwPkgHdr->pDevIdRecs[i] = calloc(1, sizeof(pldm_fw_dev_id_records_t));
-    if (!(pFwPkgHdr->pDevIdRecs[i])) {
-      printf("ERROR: pFwPkgHdr->pDevIdRecs[%d] malloc failed, size %d\n", i,
-         sizeof(pldm_fw_dev_id_records_t));
-      return -1;
-    }
+    pFwPkgHdr->pDevIdRecs[i] = &recs[i];
     pldm_fw_dev_id_records_t *pDevIdRec = pFwPkgHdr->pDevIdRecs[i];
 
     // "offset" will be updated to track sizeof(current deviceRecord)
@@ -611,13 +664,19 @@ init_device_id_records(pldm_fw_pkg_hdr_t* pFwPkgHdr, int *pOffset)
     //    that are variable length
     int  subOffset = *pOffset;
 
-    pDevIdRec->pRecords = (pldm_fw_dev_id_records_fixed_len_t *)(pFwPkgHdr->rawHdrBuf + subOffset);
+    pDevIdRec->pRecords = pkg_view(pFwPkgHdr, subOffset,
+                                   sizeof(pldm_fw_dev_id_records_fixed_len_t));
+    if (!pDevIdRec->pRecords)
+      return -1;
     subOffset += sizeof(pldm_fw_dev_id_records_fixed_len_t);
-    pDevIdRec->pApplicableComponents = (uint8_t *)(pFwPkgHdr->rawHdrBuf + subOffset);
     // length of pApplicableComponents field is defined in hdr info,
-    subOffset += (pFwPkgHdr->phdrInfo->componentBitmapBitLength/8);
-    pDevIdRec->versionString = (uint8_t *)(pFwPkgHdr->rawHdrBuf + subOffset);
+    pDevIdRec->pApplicableComponents = pkg_view(pFwPkgHdr, subOffset, compBitFieldLen);
+    subOffset += compBitFieldLen;
+    pDevIdRec->versionString = pkg_view(pFwPkgHdr, subOffset,
+                                  pDevIdRec->pRecords->compImgSetVersionStringLength);
     subOffset += pDevIdRec->pRecords->compImgSetVersionStringLength;
+    if (!pDevIdRec->pApplicableComponents || !pDevIdRec->versionString)
+      return -1;
 
     // allocate a look up table of pointers to each Record Descriptor
     pDevIdRec->pRecordDes =
@@ -625,13 +684,18 @@ init_device_id_records(pldm_fw_pkg_hdr_t* pFwPkgHdr, int *pOffset)
                                     sizeof(record_descriptors_t *));
     if (!pDevIdRec->pRecordDes)
     {
-      printf("ERROR: pDevIdRec->pRecordDes malloc failed, size %d\n",
+      printf("ERROR: pDevIdRec->pRecordDes malloc failed, size %zu\n",
          sizeof(record_descriptors_t *) * pDevIdRec->pRecords->descriptorCnt);
       return -1;
     }
     for (int j=0; j<pDevIdRec->pRecords->descriptorCnt; ++j)
     {
-      pDevIdRec->pRecordDes[j] = (record_descriptors_t *)(pFwPkgHdr->rawHdrBuf + subOffset);
+      record_descriptors_t *pDes = pkg_view(pFwPkgHdr, subOffset,
+                                            offsetof(record_descriptors_t, data));
+      if (!pDes ||
+          !pkg_view(pFwPkgHdr, subOffset, offsetof(record_descriptors_t, data) + pDes->length))
+        return -1;
+      pDevIdRec->pRecordDes[j] = pDes;
       subOffset += (offsetof(record_descriptors_t, data) + pDevIdRec->pRecordDes[j]->length);
     }
 
@@ -662,26 +726,46 @@ int
 init_component_img_info(pldm_fw_pkg_hdr_t* pFwPkgHdr, int *pOffset)
 {
   int i;
+  uint16_t *pCnt;
 
-  pFwPkgHdr->componentImageCnt = pFwPkgHdr->rawHdrBuf[*pOffset];
+  pCnt = pkg_view(pFwPkgHdr, *pOffset, sizeof(pFwPkgHdr->componentImageCnt));
+  if (!pCnt)
+    return -1;
+  pFwPkgHdr->componentImageCnt = *pCnt;
   *pOffset += sizeof(pFwPkgHdr->componentImageCnt);
   DBG_PRINT("\n\n Number of Component in package (componentImageCnt) =%d\n",
               pFwPkgHdr->componentImageCnt);
+  if (pFwPkgHdr->componentImageCnt == 0) {
+    printf("ERROR: no component image in package\n");
+    return -1;
+  }
   // allocate a look up table of pointers to each component image
   pFwPkgHdr->pCompImgInfo =
      (pldm_component_img_info_t **) calloc(pFwPkgHdr->componentImageCnt,
                                      sizeof(pldm_component_img_info_t *));
   if (!pFwPkgHdr->pCompImgInfo)
   {
-    printf("ERROR: pFwPkgHdr->pCompImgInfo malloc failed, size %d\n",
+    printf("ERROR: pFwPkgHdr->pCompImgInfo malloc failed, size %zu\n",
        sizeof(pldm_component_img_info_t **) * pFwPkgHdr->componentImageCnt);
     return -1;
   }
   for (i=0; i<pFwPkgHdr->componentImageCnt; ++i)
   {
-    pFwPkgHdr->pCompImgInfo[i] = (pldm_component_img_info_t *)(pFwPkgHdr->rawHdrBuf + *pOffset);
+    pldm_component_img_info_t *pComp =
+        pkg_view(pFwPkgHdr, *pOffset, offsetof(pldm_component_img_info_t, versionString));
+    if (!pComp ||
+        !pkg_view(pFwPkgHdr, *pOffset, offsetof(pldm_component_img_info_t, versionString) +
+                                       pComp->versionStringLength))
+      return -1;
+    pFwPkgHdr->pCompImgInfo[i] = pComp;
     printComponentImgInfo(pFwPkgHdr, i);
 
+    // the image itself is served from the mapping, it must be in the file
+    if (!pkg_view(pFwPkgHdr, pComp->locationOffset, pComp->size)) {
+      printf("ERROR: Component[%d] image lies outside the package\n", i);
+      return -1;
+    }
+
     // move pointer to next Component image, taking int account of variable
     //  version size
     *pOffset += offsetof(pldm_component_img_info_t, versionString) +
@@ -705,11 +789,8 @@ free_pldm_pkg_data(pldm_fw_pkg_hdr_t **pFwPkgHdr)
            ((*pFwPkgHdr)->pDevIdRecs[i]->pRecordDes)) {
         free((*pFwPkgHdr)->pDevIdRecs[i]->pRecordDes);
       }
-
-      if ((*pFwPkgHdr)->pDevIdRecs[i]) {
-        free((*pFwPkgHdr)->pDevIdRecs[i]);
-      }
     }
+    // the records share the allocation of the look up table
     free((*pFwPkgHdr)->pDevIdRecs);
   }
 
@@ -717,9 +798,10 @@ free_pldm_pkg_data(pldm_fw_pkg_hdr_t **pFwPkgHdr)
     free((*pFwPkgHdr)->pCompImgInfo);
   }
   if ((*pFwPkgHdr)->rawHdrBuf) {
-    free((*pFwPkgHdr)->rawHdrBuf);
+    munmap((*pFwPkgHdr)->rawHdrBuf, (*pFwPkgHdr)->pkgSize);
   }
   free(*pFwPkgHdr);
+  *pFwPkgHdr = NULL;
   return;
 }
 
@@ -729,6 +811,8 @@ pldm_fw_pkg_hdr_t *
 pldm_parse_fw_pkg(char *path) {
   int ret = 0;
   int offset = 0;
+  uint32_t *pChksum;
+  uint32_t chksum;
 
   // firmware package header
   pldm_fw_pkg_hdr_t *pFwPkgHdr;
@@ -755,10 +839,19 @@ pldm_parse_fw_pkg(char *path) {
     goto error_exit;
   }
 
-  // pkg header checksum
-  pFwPkgHdr->pkgHdrChksum = *(uint32_t *)(pFwPkgHdr->rawHdrBuf+ offset);
+  // pkg header checksum, CRC32 of the header up to the checksum
+  pChksum = pkg_view(pFwPkgHdr, offset, sizeof(uint32_t));
+  if (!pChksum) {
+    goto error_exit;
+  }
+  pFwPkgHdr->pkgHdrChksum = *pChksum;
+  chksum = pldm_crc32(0, pFwPkgHdr->rawHdrBuf, offset);
   offset += sizeof(uint32_t);
   printf("\n\nPDLM Firmware Package Checksum=0x%x\n", pFwPkgHdr->pkgHdrChksum);
+  if (chksum != pFwPkgHdr->pkgHdrChksum) {
+    printf("ERROR: package header checksum mismatch, computed 0x%x\n", chksum);
+    goto error_exit;
+  }
 
   if (pFwPkgHdr->phdrInfo->headerSize != offset) {
     printf("ERROR: header size(0x%x) and processed data (0x%x) mismatch\n",
@@ -779,49 +872,89 @@ int handlePldmReqFwData(pldm_fw_pkg_hdr_t *pkgHdr, pldm_cmd_req *pCmd, pldm_resp
 {
   PLDM_RequestFWData_t *pReqDataCmd = (PLDM_RequestFWData_t *)pCmd->payload;
   // for now assumes  it's always component 0
-  unsigned char *pComponent =
-       (unsigned char*)(pkgHdr->rawHdrBuf + pkgHdr->pCompImgInfo[0]->locationOffset);
-  uint32_t componentSize = pkgHdr->pCompImgInfo[0]->size;
+  pldm_component_img_info_t *pCompInfo = pkgHdr->pCompImgInfo[0];
+  unsigned char *pComponent = pkgHdr->rawHdrBuf + pCompInfo->locationOffset;
+  uint32_t componentSize = pCompInfo->size;
+  uint32_t offset = pReqDataCmd->offset;
+  uint32_t length = pReqDataCmd->length;
+  uint32_t compBytesLeft, numPaddingNeeded, copyLen;
 
-  // calculate how much FW data is left to transfer and if any padding is needed
-  int compBytesLeft = componentSize - pReqDataCmd->offset;
-  int numPaddingNeeded = pReqDataCmd->length > compBytesLeft ?
-                   (pReqDataCmd->length - compBytesLeft) : 0;
+  memcpy(pldmRes->common, pCmd->common, PLDM_COMMON_REQ_LEN);
+  // clear Req bit in PLDM response header
+  pldmRes->common[PLDM_IID_OFFSET] &= PLDM_RESP_MASK;
+  pldmRes->resp_size = PLDM_COMMON_RES_LEN;
+
+  if (offset >= componentSize) {
+    printf("\n%s offset 0x%x beyond component size 0x%x\n", __FUNCTION__,
+           offset, componentSize);
+    pldmRes->common[PLDM_CC_OFFSET] = CC_DATA_OUT_OF_RANGE;
+    return 0;
+  }
+  if (length > sizeof(pldmRes->response)) {
+    printf("\n%s length 0x%x exceeds transfer size\n", __FUNCTION__, length);
+    pldmRes->common[PLDM_CC_OFFSET] = CC_INVALID_TRANSFER_LENTH;
+    return 0;
+  }
 
+  // calculate how much FW data is left to transfer and if any padding is needed
+  compBytesLeft = componentSize - offset;
+  numPaddingNeeded = length > compBytesLeft ? (length - compBytesLeft) : 0;
+  copyLen = length - numPaddingNeeded;
 
-  printf("\r%s offset = 0x%x, length = 0x%x, compBytesLeft=%d, numPadding=%d",
-         __FUNCTION__, pReqDataCmd->offset, pReqDataCmd->length, compBytesLeft,
-         numPaddingNeeded);
+  printf("\r%s offset = 0x%x, length = 0x%x, compBytesLeft=%u, numPadding=%u",
+         __FUNCTION__, offset, length, compBytesLeft, numPaddingNeeded);
   fflush(stdout);
 
-  memcpy(pldmRes->common, pCmd->common, PLDM_COMMON_REQ_LEN);
-  // clear Req bit in PLDM response header
-  pldmRes->common[PLDM_IID_OFFSET] &= PLDM_RESP_MASK;
-  // hard code success for now, need to check length in the future
   pldmRes->common[PLDM_CC_OFFSET] = CC_SUCCESS;
 
-
+  // copied straight from the mapping into the response
+  memcpy(pldmRes->response, pComponent + offset, copyLen);
   if (numPaddingNeeded > 0) {
-    printf("%s %d bytes padding added\n", __FUNCTION__, numPaddingNeeded);
-    memcpy(pldmRes->response, pComponent + pReqDataCmd->offset, compBytesLeft);
-    memset(pldmRes->response + compBytesLeft, 0, numPaddingNeeded);
-  } else {
-    memcpy(pldmRes->response, pComponent + pReqDataCmd->offset, pReqDataCmd->length);
+    printf("%s %u bytes padding added\n", __FUNCTION__, numPaddingNeeded);
+    memset(pldmRes->response + copyLen, 0, numPaddingNeeded);
+  }
+  pldmRes->resp_size = PLDM_COMMON_RES_LEN + length;
+
+  // Track how far the component was served in order. Devices request it
+  // in order, a retried chunk does not move it and a gap stops it.
+  if (offset == 0) {
+    pkgHdr->compServed = 0;
+  }
+  if (offset <= pkgHdr->compServed && offset + copyLen > pkgHdr->compServed) {
+    uint32_t prevWindow = (pCompInfo->locationOffset + pkgHdr->compServed) / PLDM_PKG_WINDOW;
+
+    pkgHdr->compServed = offset + copyLen;
+
+    // done with the previous window of the package, unmap its pages from
+    // this process. The mapping is MAP_PRIVATE and read-only, so this only
+    // lowers our RSS, the file pages stay in the page cache until the
+    // kernel reclaims them, and a retried request faults them back in.
+    if ((pCompInfo->locationOffset + pkgHdr->compServed) / PLDM_PKG_WINDOW > prevWindow &&
+        prevWindow > 0) {
+      madvise(pkgHdr->rawHdrBuf + (size_t)(prevWindow - 1) * PLDM_PKG_WINDOW,
+              PLDM_PKG_WINDOW, MADV_DONTNEED);
+    }
   }
-  pldmRes->resp_size = PLDM_COMMON_RES_LEN + pReqDataCmd->length;
 
   return 0;
 }
 
 static
-int handlePldmFwTransferComplete(pldm_cmd_req *pCmd, pldm_response *pRes)
+int handlePldmFwTransferComplete(pldm_fw_pkg_hdr_t *pkgHdr, pldm_cmd_req *pCmd,
+                                 pldm_response *pRes)
 {
   PLDM_TransferComplete_t *pReqDataCmd = (PLDM_TransferComplete_t *)pCmd->payload;
+  uint32_t componentSize = pkgHdr->pCompImgInfo[0]->size;
   int ret = 0;
 
   if (pReqDataCmd->transferResult != 0) {
     printf("Error, transfer failed, err=%d\n", pReqDataCmd->transferResult);
     ret = -1;
+  } else if (pkgHdr->compServed == componentSize) {
+    printf("Component transferred, %u bytes\n", componentSize);
+  } else {
+    printf("Component served out of order, %u of %u bytes in order\n",
+           pkgHdr->compServed, componentSize);
   }
 
   memcpy(pRes->common, pCmd->common, PLDM_COMMON_REQ_LEN);
@@ -886,7 +1019,7 @@ int pldmFwUpdateCmdHandler(pldm_fw_pkg_hdr_t *pkgHdr, pldm_cmd_req *pCmd, pldm_r
     case CMD_TRANSFER_COMPLETE:
       printf("handle CMD_TRANSFER_COMPLETE\n");
       dbgPrintCdb(pCmd);
-      ret = handlePldmFwTransferComplete(pCmd, pRes);
+      ret = handlePldmFwTransferComplete(pkgHdr, pCmd, pRes);
       break;
     case CMD_VERIFY_COMPLETE:
       printf("handle CMD_VERIFY_COMPLETE\n");
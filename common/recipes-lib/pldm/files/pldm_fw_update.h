@@ -207,7 +207,10 @@ typedef struct {
 //  figure 5 on DSP0267 1.0.0
 //  detailed layout in Table 3
 typedef struct {
-  unsigned char *rawHdrBuf; // unparsed hdr buffer data bytes
+  // read-only mapping of the whole package, headers are parsed and
+  // component images served in place
+  unsigned char *rawHdrBuf;
+  size_t pkgSize;
 
   // Use pointers for acccessing/interpreting hdr buffer above
 
@@ -224,6 +227,9 @@ typedef struct {
 
   // package header checksum area
   uint32_t pkgHdrChksum;
+
+  // component bytes served in order so far
+  uint32_t compServed;
 } __attribute__((packed)) pldm_fw_pkg_hdr_t;
 
 #define PLDM_MAX_XFER_SIZE (MAX_PLDM_MSG_SIZE - PLDM_COMMON_RES_LEN)
@@ -19,7 +19,10 @@
 
 #include <gio/gio.h>
 #include <openbmc/pal.h>
+#include <pthread.h>
+#include <string.h>
 #include <syslog.h>
+#include <time.h>
 #include "sensor-svc-client.h"
 #include <stdio.h>
 
@@ -28,6 +31,28 @@ static GDBusProxy* _proxy_sensor_service = NULL;
 static GDBusProxy* _proxy_fru[MAX_NUM_FRUS] = {NULL};
 static GDBusProxy* _proxy_sensor[MAX_NUM_FRUS][MAX_SENSOR_NUM] = {NULL};
 
+// Last readings of each FRU. Filled with one getFruSensorReadings call and
+// then kept current by the sensorReadingsChanged signals sensor-svc emits
+// after every sweep, so sensor_svc_read() is answered without a round trip.
+// sensor-svc doesn't signal FRU removal, so a copy older than
+// READINGS_MAX_AGE_MS is fetched again.
+#define READINGS_MAX_AGE_MS 5000
+
+typedef struct {
+  bool valid;
+  struct timespec fetched;
+  bool present[MAX_SENSOR_NUM];
+  int status[MAX_SENSOR_NUM];
+  float value[MAX_SENSOR_NUM];
+} fru_readings_t;
+
+static fru_readings_t _readings[MAX_NUM_FRUS];
+static GDBusConnection* _signal_conn = NULL;
+// signals are dispatched on a private context, drained by a thread of
+// its own: callers do not need to run a main loop
+static GMainContext* _signal_context = NULL;
+static pthread_mutex_t _lock = PTHREAD_MUTEX_INITIALIZER;
+
 static GDBusProxy*
 get_dbus_proxy(const char* path, const char* interface) {
   GError* error = NULL;
@@ -175,12 +200,250 @@ sensor_read(uint8_t fru, uint8_t sensor_num, float *value, const char* method) {
   return -1;
 }
 
+static void
+update_reading(uint8_t fru, uint8_t sensor_num, int status, float value) {
+  fru_readings_t *r = &_readings[fru];
+
+  if (sensor_num >= MAX_SENSOR_NUM) {
+    return;
+  }
+
+  r->present[sensor_num] = true;
+  r->status[sensor_num] = status;
+  if (status == 0) {
+    r->value[sensor_num] = value;
+  }
+}
+
+static void
+on_readings_changed(GDBusConnection* connection, const gchar* sender,
+                    const gchar* path, const gchar* interface,
+                    const gchar* signal, GVariant* parameters,
+                    gpointer user_data) {
+  GVariantIter *iter;
+  guchar fru, sensor_num;
+  gint status;
+  gdouble val;
+
+  g_variant_get(parameters, "(ya(yid))", &fru, &iter);
+  pthread_mutex_lock(&_lock);
+  // FRUs never fetched in full stay invalid, a partial update is no use
+  if (fru < MAX_NUM_FRUS && _readings[fru].valid) {
+    while (g_variant_iter_loop(iter, "(yid)", &sensor_num, &status, &val)) {
+      update_reading(fru, sensor_num, status, val);
+    }
+  }
+  pthread_mutex_unlock(&_lock);
+  g_variant_iter_free(iter);
+}
+
+static void
+on_owner_changed(GDBusConnection* connection, const gchar* sender,
+                 const gchar* path, const gchar* interface,
+                 const gchar* signal, GVariant* parameters,
+                 gpointer user_data) {
+  int fru;
+
+  // sensor-svc restarted, signals may have been lost in between
+  pthread_mutex_lock(&_lock);
+  for (fru = 0; fru < MAX_NUM_FRUS; fru++) {
+    _readings[fru].valid = false;
+  }
+  pthread_mutex_unlock(&_lock);
+}
+
+static void*
+signal_thread(void* arg) {
+  while (true) {
+    g_main_context_iteration(_signal_context, TRUE);
+  }
+  return NULL;
+}
+
+static int
+subscribe_readings(void) {
+  GError *error = NULL;
+  guint readings_id, owner_id;
+  pthread_t tid;
+
+  if (_signal_context != NULL) {
+    return 0;
+  }
+
+  _signal_conn = g_bus_get_sync(G_BUS_TYPE_SYSTEM, NULL, &error);
+  if (error != NULL) {
+    syslog(LOG_ERR, "DBus error in connecting to system bus, %s", error->message);
+    g_error_free(error);
+    _signal_conn = NULL;
+    return -1;
+  }
+
+  // subscriptions dispatch on the thread default context when created
+  _signal_context = g_main_context_new();
+  g_main_context_push_thread_default(_signal_context);
+  readings_id = g_dbus_connection_signal_subscribe(_signal_conn,
+                                     SENSOR_SVC_DBUS_NAME,
+                                     SENSOR_SVC_SENSOR_TREE_INTERFACE,
+                                     SENSOR_SVC_READINGS_CHANGED,
+                                     NULL,
+                                     NULL,
+                                     G_DBUS_SIGNAL_FLAGS_NONE,
+                                     on_readings_changed,
+                                     NULL,
+                                     NULL);
+  owner_id = g_dbus_connection_signal_subscribe(_signal_conn,
+                                     "org.freedesktop.DBus",
+                                     "org.freedesktop.DBus",
+                                     "NameOwnerChanged",
+                                     "/org/freedesktop/DBus",
+                                     SENSOR_SVC_DBUS_NAME,
+                                     G_DBUS_SIGNAL_FLAGS_NONE,
+                                     on_owner_changed,
+                                     NULL,
+                                     NULL);
+  g_main_context_pop_thread_default(_signal_context);
+
+  // started last, the thread holds the context while it waits
+  if (pthread_create(&tid, NULL, signal_thread, NULL)) {
+    syslog(LOG_ERR, "cannot create the sensorReadingsChanged thread");
+    g_dbus_connection_signal_unsubscribe(_signal_conn, readings_id);
+    g_dbus_connection_signal_unsubscribe(_signal_conn, owner_id);
+    g_main_context_unref(_signal_context);
+    _signal_context = NULL;
+    return -1;
+  }
+  pthread_detach(tid);
+  return 0;
+}
+
+// whether the readings of fru can be answered from the cache
+static bool
+readings_current(uint8_t fru) {
+  struct timespec now;
+  long age_ms;
+
+  if (!_readings[fru].valid) {
+    return false;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  age_ms = (now.tv_sec - _readings[fru].fetched.tv_sec) * 1000 +
+           (now.tv_nsec - _readings[fru].fetched.tv_nsec) / 1000000;
+  return age_ms < READINGS_MAX_AGE_MS;
+}
+
+// fetch all readings of fru in one call, optionally sweeping the sensors
+static int
+fetch_fru_readings(uint8_t fru, bool raw) {
+  GVariant *response;
+  GVariantIter *iter;
+  GError *error = NULL;
+  guchar sensor_num;
+  gint status;
+  gdouble val;
+
+  if (_proxy_sensor_service == NULL) {
+    _proxy_sensor_service = get_dbus_proxy(SENSOR_SVC_BASE_PATH, SENSOR_SVC_SENSOR_TREE_INTERFACE);
+    if (_proxy_sensor_service == NULL) {
+      return -1;
+    }
+  }
+
+  response = g_dbus_proxy_call_sync(
+      _proxy_sensor_service,
+      "org.openbmc.SensorTree.getFruSensorReadings",
+      g_variant_new ("(yb)", fru, raw),
+      G_DBUS_CALL_FLAGS_NONE,
+      -1,
+      NULL,
+      &error);
+
+  if (error != NULL) {
+    syslog (LOG_ERR, "DBUS error in getFruSensorReadings fru %d, %s", fru, error->message);
+    g_error_free(error);
+    return -1;
+  }
+
+  memset(&_readings[fru], 0, sizeof(fru_readings_t));
+  g_variant_get(response, "(a(yid))", &iter);
+  while (g_variant_iter_loop(iter, "(yid)", &sensor_num, &status, &val)) {
+    update_reading(fru, sensor_num, status, val);
+  }
+  g_variant_iter_free(iter);
+  g_variant_unref(response);
+
+  // without the signal subscription the copy would go stale
+  _readings[fru].valid = (_signal_context != NULL);
+  clock_gettime(CLOCK_MONOTONIC, &_readings[fru].fetched);
+  return 0;
+}
+
 int
 sensor_svc_raw_read(uint8_t fru, uint8_t sensor_num, float *value) {
-  return sensor_read(fru, sensor_num, value, "org.openbmc.SensorObject.sensorRawRead");
+  int ret;
+
+  pthread_mutex_lock(&_lock);
+  ret = sensor_read(fru, sensor_num, value, "org.openbmc.SensorObject.sensorRawRead");
+  if (ret != -1 && fru < MAX_NUM_FRUS && _readings[fru].valid) {
+    update_reading(fru, sensor_num, ret, *value);
+  }
+  pthread_mutex_unlock(&_lock);
+
+  return ret;
 }
 
 int
 sensor_svc_read(uint8_t fru, uint8_t sensor_num, float *value) {
-  return sensor_read(fru, sensor_num, value, "org.openbmc.SensorObject.sensorRead");
+  int ret = -1;
+  bool cached = false;
+
+  pthread_mutex_lock(&_lock);
+  if (fru < MAX_NUM_FRUS && sensor_num < MAX_SENSOR_NUM &&
+      subscribe_readings() == 0) {
+    if ((readings_current(fru) || fetch_fru_readings(fru, false) == 0) &&
+        _readings[fru].present[sensor_num]) {
+      ret = _readings[fru].status[sensor_num];
+      if (ret == 0) {
+        *value = _readings[fru].value[sensor_num];
+      }
+      cached = true;
+    }
+  }
+
+  // sensor unknown to the FRU listing, ask the sensor object directly
+  if (!cached) {
+    ret = sensor_read(fru, sensor_num, value, "org.openbmc.SensorObject.sensorRead");
+  }
+  pthread_mutex_unlock(&_lock);
+
+  return ret;
+}
+
+/*
+ * Read all sensors of a FRU with a single D-Bus call. With raw set the
+ * sensors are read from the hardware first, otherwise the last readings
+ * are returned. Returns the number of entries stored in readings, or -1.
+ */
+int
+sensor_svc_read_fru(uint8_t fru, bool raw, sensor_svc_reading_t *readings, int max) {
+  int i, count = -1;
+
+  if (fru >= MAX_NUM_FRUS || readings == NULL) {
+    return -1;
+  }
+
+  pthread_mutex_lock(&_lock);
+  subscribe_readings();
+  if (fetch_fru_readings(fru, raw) == 0) {
+    for (i = 0, count = 0; i < MAX_SENSOR_NUM && count < max; i++) {
+      if (_readings[fru].present[i]) {
+        readings[count].sensor_num = i;
+        readings[count].status = _readings[fru].status[i];
+        readings[count].value = _readings[fru].value[i];
+        count++;
+      }
+    }
+  }
+  pthread_mutex_unlock(&_lock);
+
+  return count;
 }
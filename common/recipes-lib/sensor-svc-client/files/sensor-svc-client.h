@@ -22,6 +22,7 @@
 #define __SENSOR_SVC_CLIENT_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -32,8 +33,18 @@ extern "C" {
 #define SENSOR_SVC_SENSOR_TREE_INTERFACE "org.openbmc.SensorTree"
 #define SENSOR_SVC_SENSOR_OBJECT_INTERFACE "org.openbmc.SensorObject"
 
+#define SENSOR_SVC_READINGS_CHANGED "sensorReadingsChanged"
+
+typedef struct {
+  uint8_t sensor_num;
+  int status;
+  float value;
+} sensor_svc_reading_t;
+
 extern int sensor_svc_raw_read(uint8_t fru, uint8_t sensor_num, float *value);
 extern int sensor_svc_read(uint8_t fru, uint8_t sensor_num, float *value);
+extern int sensor_svc_read_fru(uint8_t fru, bool raw,
+                               sensor_svc_reading_t *readings, int max);
 
 #ifdef __cplusplus
 } // extern "C"
@@ -7,8 +7,6 @@
 #include <openbmc/kv.h>
 #include "pxe1110c.h"
 
-extern int i2c_io(int, uint8_t, uint8_t *, uint8_t, uint8_t *, uint8_t);
-
 static int
 get_pxe_crc(int fd, uint8_t addr, uint32_t *crc) {
   int ret = -1;
@@ -45,7 +43,7 @@ cache_pxe_crc(uint8_t bus, uint8_t addr, char *key, char *checksum) {
   int fd, ret = -1;
   uint8_t tbuf[16], rbuf[16], remain;
 
-  if ((fd = i2c_cdev_slave_open(bus, (addr>>1), I2C_SLAVE_FORCE_CLAIM)) < 0) {
+  if ((fd = vr_dev_open(bus, addr)) < 0) {
     return -1;
   }
 
@@ -79,7 +77,7 @@ cache_pxe_crc(uint8_t bus, uint8_t addr, char *key, char *checksum) {
     syslog(LOG_WARNING, "%s: set page to 0x%02X failed", __func__, tbuf[1]);
   }
 
-  close(fd);
+  vr_dev_close(fd);
   return ret;
 }
 
@@ -197,14 +195,14 @@ check_pxe_image(uint32_t crc_exp, uint8_t *data) {
 }
 
 static int
-program_pxe(uint8_t bus, uint8_t addr, struct pxe_config *config, bool force) {
+program_pxe(struct vr_info *info, struct pxe_config *config, bool force) {
   int fd, i, ret = -1;
+  uint8_t bus = info->bus, addr = info->addr;
   uint8_t tbuf[32], rbuf[32], remain = 0, page = 0;
   uint8_t *data = config->data;
   uint32_t crc = 0;
-  float dsize, next_prog;
 
-  if ((fd = i2c_cdev_slave_open(bus, (addr>>1), I2C_SLAVE_FORCE_CLAIM)) < 0) {
+  if ((fd = vr_dev_open(bus, addr)) < 0) {
     return -1;
   }
 
@@ -283,8 +281,6 @@ program_pxe(uint8_t bus, uint8_t addr, struct pxe_config *config, bool force) {
     }
 
     // write configuration data
-    dsize = (float)VR_PXE_TOTAL_RW_SIZE/100;
-    next_prog = dsize;
     for (i = 0; i < VR_PXE_TOTAL_RW_SIZE; i+= 4) {
       if (page != ((data[i+1] >> 1) & 0x3F)) {
         page = (data[i+1] >> 1) & 0x3F;
@@ -305,13 +301,8 @@ program_pxe(uint8_t bus, uint8_t addr, struct pxe_config *config, bool force) {
         break;
       }
 
-      if ((i + 4) >= (int)next_prog) {
-        printf("\rupdated: %d %%  ", (int)(next_prog/dsize));
-        fflush(stdout);
-        next_prog += dsize;
-      }
+      vr_report_progress(info, (i + 4) * 100 / VR_PXE_TOTAL_RW_SIZE);
     }
-    printf("\n");
     if (ret) {
       break;
     }
@@ -369,12 +360,12 @@ program_pxe(uint8_t bus, uint8_t addr, struct pxe_config *config, bool force) {
       break;
     }
 
-    tbuf[0] = 0x01;
+    tbuf[0] = VR_PXE_REG_STATUS;
     if ((ret = i2c_io(fd, addr, tbuf, 1, rbuf, 2))) {
       syslog(LOG_WARNING, "%s: read register 0x%02X failed", __func__, tbuf[0]);
       break;
     }
-    if ((rbuf[0] & 0x01)) {
+    if ((rbuf[0] & VR_PXE_STATUS_ERR)) {
       syslog(LOG_WARNING, "%s: unexpected status, reg%02X=%02X", __func__, tbuf[0], rbuf[0]);
       ret = -1;
       break;
@@ -436,7 +427,7 @@ program_pxe(uint8_t bus, uint8_t addr, struct pxe_config *config, bool force) {
   if (i2c_io(fd, addr, tbuf, 2, rbuf, 0)) {
     syslog(LOG_WARNING, "%s: set page to 0x%02X failed", __func__, tbuf[1]);
   }
-  close(fd);
+  vr_dev_close(fd);
 
   return ret;
 }
@@ -457,7 +448,7 @@ pxe_fw_update(struct vr_info *info, void *args) {
       break;
     }
 
-    ret = program_pxe(info->bus, info->addr, config, info->force);
+    ret = program_pxe(info, config, info->force);
     if (ret) {
       break;
     }
@@ -477,7 +468,7 @@ pxe_fw_verify(struct vr_info *info, void *args) {
     return VR_STATUS_SKIP;
   }
 
-  if ((fd = i2c_cdev_slave_open(info->bus, (info->addr>>1), I2C_SLAVE_FORCE_CLAIM)) < 0) {
+  if ((fd = vr_dev_open(info->bus, info->addr)) < 0) {
     return -1;
   }
 
@@ -488,7 +479,7 @@ pxe_fw_verify(struct vr_info *info, void *args) {
   if (i2c_io(fd, info->addr, buf, 2, buf, 0)) {
     syslog(LOG_WARNING, "%s: set page to 0x%02X failed", __func__, buf[1]);
   }
-  close(fd);
+  vr_dev_close(fd);
   if (ret) {
     return ret;
   }
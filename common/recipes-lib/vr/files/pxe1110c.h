@@ -15,6 +15,9 @@
 #define VR_PXE_REG_CRC_L 0x3D  // page 0x6F
 #define VR_PXE_REG_CRC_H 0x3E  // page 0x6F
 
+#define VR_PXE_REG_STATUS 0x01  // page 0x60
+#define VR_PXE_STATUS_ERR 0x01
+
 #define VR_PXE_TOTAL_RW_SIZE 2040
 
 struct pxe_config {
@@ -7,8 +7,6 @@
 #include <openbmc/kv.h>
 #include "tps53688.h"
 
-extern int i2c_io(int, uint8_t, uint8_t *, uint8_t, uint8_t *, uint8_t);
-
 static int
 get_tps_crc(int fd, uint8_t addr, uint16_t *crc) {
   int ret = -1;
@@ -29,7 +27,7 @@ cache_tps_crc(uint8_t bus, uint8_t addr, char *key, char *checksum) {
   int fd, ret = -1;
   uint8_t buf[16];
 
-  if ((fd = i2c_cdev_slave_open(bus, (addr>>1), I2C_SLAVE_FORCE_CLAIM)) < 0) {
+  if ((fd = vr_dev_open(bus, addr)) < 0) {
     return -1;
   }
 
@@ -42,7 +40,7 @@ cache_tps_crc(uint8_t bus, uint8_t addr, char *key, char *checksum) {
     kv_set(key, checksum, 0, 0);
   } while (0);
 
-  close(fd);
+  vr_dev_close(fd);
   return ret;
 }
 
@@ -178,14 +176,15 @@ check_tps_image(uint16_t crc_exp, uint8_t *data) {
 }
 
 static int
-program_tps(uint8_t bus, uint8_t addr, struct tps_config *config, bool force) {
+program_tps(struct vr_info *info, struct tps_config *config, bool force) {
   int fd, i, ret = -1;
+  uint8_t bus = info->bus, addr = info->addr;
   uint64_t devid = 0x00;
   uint32_t offset = 0, dsize;
   uint16_t crc = 0;
   uint8_t tbuf[64], rbuf[64];
 
-  if ((fd = i2c_cdev_slave_open(bus, (addr>>1), I2C_SLAVE_FORCE_CLAIM)) < 0) {
+  if ((fd = vr_dev_open(bus, addr)) < 0) {
     return -1;
   }
 
@@ -236,10 +235,8 @@ program_tps(uint8_t bus, uint8_t addr, struct tps_config *config, bool force) {
       }
 
       offset += VR_TPS_BLK_WR_LEN;
-      printf("\rupdated: %d %%  ", (offset/dsize)*10);
-      fflush(stdout);
+      vr_report_progress(info, (offset/dsize)*10);
     }
-    printf("\n");
     if (ret) {
       break;
     }
@@ -247,7 +244,7 @@ program_tps(uint8_t bus, uint8_t addr, struct tps_config *config, bool force) {
     msleep(200);
   } while (0);
 
-  close(fd);
+  vr_dev_close(fd);
   return ret;
 }
 
@@ -267,7 +264,7 @@ tps_fw_update(struct vr_info *info, void *args) {
       break;
     }
 
-    ret = program_tps(info->bus, info->addr, config, info->force);
+    ret = program_tps(info, config, info->force);
     if (ret) {
       break;
     }
@@ -287,13 +284,13 @@ tps_fw_verify(struct vr_info *info, void *args) {
     return VR_STATUS_SKIP;
   }
 
-  if ((fd = i2c_cdev_slave_open(info->bus, (info->addr>>1), I2C_SLAVE_FORCE_CLAIM)) < 0) {
+  if ((fd = vr_dev_open(info->bus, info->addr)) < 0) {
     return -1;
   }
 
   // check CRC
   ret = get_tps_crc(fd, info->addr, &crc);
-  close(fd);
+  vr_dev_close(fd);
   if (ret) {
     syslog(LOG_WARNING, "%s: read CRC failed", __func__);
     return ret;
@@ -18,9 +18,12 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <fcntl.h>
 #include <syslog.h>
 #include <string.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <openbmc/obmc-i2c.h>
 #include <openbmc/obmc-pal.h>
 #include "vr.h"
@@ -29,6 +32,19 @@ struct vr_info *dev_list = NULL;
 int dev_list_count = 0;
 void *plat_configs = NULL;
 
+static struct vr_handle {
+  uint8_t bus;
+  uint8_t addr;
+  int fd;
+} vr_handles[MAX_VR_HANDLES];
+static int vr_handle_count = 0;
+static pthread_mutex_t vr_handle_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static vr_progress_cb progress_cb = NULL;
+static int *progress_list = NULL;  // last reported percentage per device
+static bool progress_concurrent = false;
+static pthread_mutex_t progress_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 int vr_device_register(struct vr_info *info, int count)
 {
   dev_list = info;
@@ -50,9 +66,140 @@ int vr_probe()
 void vr_remove()
 {
   plat_vr_exit();
+  vr_dev_close_all();
   vr_device_unregister();
 }
 
+/*
+ * Keep one i2c handle per (bus, addr) for the lifetime of the probe, so
+ * version query, update and verify of a device share the same fd.
+ */
+int vr_dev_open(uint8_t bus, uint8_t addr)
+{
+  int i, fd = -1;
+
+  pthread_mutex_lock(&vr_handle_mutex);
+  for (i = 0; i < vr_handle_count; i++) {
+    if (vr_handles[i].bus == bus && vr_handles[i].addr == addr) {
+      fd = vr_handles[i].fd;
+      break;
+    }
+  }
+
+  if (fd < 0) {
+    fd = i2c_cdev_slave_open(bus, (addr>>1), I2C_SLAVE_FORCE_CLAIM);
+    if (fd >= 0 && vr_handle_count < MAX_VR_HANDLES) {
+      vr_handles[vr_handle_count].bus = bus;
+      vr_handles[vr_handle_count].addr = addr;
+      vr_handles[vr_handle_count].fd = fd;
+      vr_handle_count++;
+    } else if (fd >= 0) {
+      syslog(LOG_WARNING, "%s: handle table full for %u-%02x", __func__, bus, addr);
+    }
+  }
+  pthread_mutex_unlock(&vr_handle_mutex);
+
+  return fd;
+}
+
+/*
+ * Release a handle returned by vr_dev_open(); cached handles stay open
+ * until vr_dev_close_all().
+ */
+void vr_dev_close(int fd)
+{
+  int i;
+
+  pthread_mutex_lock(&vr_handle_mutex);
+  for (i = 0; i < vr_handle_count; i++) {
+    if (vr_handles[i].fd == fd) {
+      break;
+    }
+  }
+  pthread_mutex_unlock(&vr_handle_mutex);
+
+  if (i >= vr_handle_count && fd >= 0) {
+    close(fd);
+  }
+}
+
+void vr_dev_close_all(void)
+{
+  int i;
+
+  pthread_mutex_lock(&vr_handle_mutex);
+  for (i = 0; i < vr_handle_count; i++) {
+    close(vr_handles[i].fd);
+  }
+  vr_handle_count = 0;
+  pthread_mutex_unlock(&vr_handle_mutex);
+}
+
+void vr_set_progress_cb(vr_progress_cb cb)
+{
+  progress_cb = cb;
+}
+
+void vr_report_progress(struct vr_info *info, int percent)
+{
+  int idx = info - dev_list;
+
+  pthread_mutex_lock(&progress_mutex);
+  if (progress_list && idx >= 0 && idx < dev_list_count) {
+    if (percent == progress_list[idx]) {
+      pthread_mutex_unlock(&progress_mutex);
+      return;
+    }
+    progress_list[idx] = percent;
+  }
+
+  if (progress_cb) {
+    progress_cb(info, percent);
+  } else if (progress_concurrent) {
+    // interleaved '\r' updates are unreadable, print a line per 10%
+    if (!(percent % 10)) {
+      printf("%s updated: %d %%\n", info->dev_name, percent);
+    }
+  } else {
+    printf("\rupdated: %d %%  ", percent);
+    if (percent >= 100) {
+      printf("\n");
+    }
+    fflush(stdout);
+  }
+  pthread_mutex_unlock(&progress_mutex);
+}
+
+static int vr_progress_begin(bool concurrent)
+{
+  pthread_mutex_lock(&progress_mutex);
+  progress_list = calloc(dev_list_count, sizeof(*progress_list));
+  progress_concurrent = concurrent;
+  pthread_mutex_unlock(&progress_mutex);
+
+  return progress_list ? 0 : -1;
+}
+
+static void vr_progress_end(void)
+{
+  int i;
+
+  pthread_mutex_lock(&progress_mutex);
+  if (!progress_cb && !progress_concurrent && progress_list) {
+    // terminate the '\r' progress line of an aborted update
+    for (i = 0; i < dev_list_count; i++) {
+      if (progress_list[i] > 0 && progress_list[i] < 100) {
+        printf("\n");
+        break;
+      }
+    }
+  }
+  free(progress_list);
+  progress_list = NULL;
+  progress_concurrent = false;
+  pthread_mutex_unlock(&progress_mutex);
+}
+
 int vr_fw_version(int index, const char *vr_name, char *ver_str)
 {
   struct vr_info *info = dev_list;
@@ -95,69 +242,222 @@ int vr_fw_version(int index, const char *vr_name, char *ver_str)
   return VR_STATUS_FAILURE;
 }
 
-int vr_fw_update(const char *vr_name, const char *path, bool force)
+static int vr_load_file(struct vr_info *info, const char *path, bool verbose)
 {
-  struct vr_info *info = dev_list;
-  int ret, i;
+  if (plat_configs != NULL) {
+    return 0;
+  }
 
-  for (i = 0; i < dev_list_count; i++, info++) {
-    if (!vr_name || !strcmp(info->dev_name, vr_name)) {  // traverse all for unspecified vr_name
-      if (!info->ops ||
-          !info->ops->parse_file ||
-          !info->ops->fw_update) {
-        syslog(LOG_WARNING, "%s: incomplete ops: %s", __func__, info->dev_name);
-        break;
-      }
+  if (info->ops->validate_file &&
+      info->ops->validate_file(info, path) < 0) {
+    if (verbose) {
+      syslog(LOG_WARNING, "%s: validate file failed", __func__);
+    }
+    return -1;
+  }
 
-      if (plat_configs == NULL) {
-        if (info->ops->validate_file &&
-            info->ops->validate_file(info, path) < 0) {
-          if (!vr_name) {
-            continue;
-          }
-          syslog(LOG_WARNING, "%s: validate file failed", __func__);
-          break;
-        }
+  if ((plat_configs = info->ops->parse_file(info, path)) == NULL) {
+    if (verbose) {
+      syslog(LOG_WARNING, "%s: parse file failed", __func__);
+    }
+    return -1;
+  }
 
-        if ((plat_configs = info->ops->parse_file(info, path)) == NULL) {
-          if (!vr_name) {
-            continue;
-          }
-          syslog(LOG_WARNING, "%s: parse file failed", __func__);
-          break;
-        }
-      }
+  return 0;
+}
 
-      info->force = force;
-      if ((ret = info->ops->fw_update(info, plat_configs)) < 0) {
-        if (!vr_name && (ret == VR_STATUS_SKIP)) {
-          continue;
-        }
-        syslog(LOG_WARNING, "%s: update VR %s failed", __func__, info->dev_name);
-        break;
-      }
+static int vr_update_dev(struct vr_info *info, bool force)
+{
+  int ret;
 
-      if (info->ops->fw_verify &&
-          info->ops->fw_verify(info, plat_configs) < 0) {
-        syslog(LOG_WARNING, "%s: verify VR %s failed", __func__, info->dev_name);
-        break;
-      }
+  info->force = force;
+  if ((ret = info->ops->fw_update(info, plat_configs)) < 0) {
+    if (ret != VR_STATUS_SKIP) {
+      syslog(LOG_WARNING, "vr_fw_update: update VR %s failed", info->dev_name);
+    }
+    return ret;
+  }
 
-      return VR_STATUS_SUCCESS;
+  if (info->ops->fw_verify &&
+      info->ops->fw_verify(info, plat_configs) < 0) {
+    syslog(LOG_WARNING, "vr_fw_update: verify VR %s failed", info->dev_name);
+    return VR_STATUS_FAILURE;
+  }
+
+  return VR_STATUS_SUCCESS;
+}
+
+struct vr_bus_job {
+  uint8_t bus;
+  bool force;
+  int count;
+  struct vr_info **devs;
+  int updated;
+  int failed;
+  pthread_t tid;
+};
+
+// devices sharing a bus are programmed back to back by the same worker
+static void *vr_bus_worker(void *arg)
+{
+  struct vr_bus_job *job = (struct vr_bus_job *)arg;
+  int i, ret;
+
+  for (i = 0; i < job->count; i++) {
+    ret = vr_update_dev(job->devs[i], job->force);
+    if (ret == VR_STATUS_SUCCESS) {
+      job->updated++;
+    } else if (ret != VR_STATUS_SKIP) {
+      job->failed++;
     }
   }
 
+  return NULL;
+}
+
+static int vr_find_job(struct vr_bus_job *jobs, int *job_count, uint8_t bus)
+{
+  int j;
+
+  for (j = 0; j < *job_count; j++) {
+    if (jobs[j].bus == bus) {
+      return j;
+    }
+  }
+
+  jobs[j].bus = bus;
+  (*job_count)++;
+  return j;
+}
+
+/*
+ * Update every device which accepts the image. Devices are grouped by bus
+ * and each bus gets its own worker, so VRs behind independent buses are
+ * programmed concurrently.
+ */
+static int vr_update_all(const char *path, bool force)
+{
+  struct vr_info *info, *parser = NULL;
+  struct vr_bus_job *jobs = NULL;
+  struct vr_info **devs = NULL;
+  int i, j, offs, job_count = 0, updated = 0, failed = 0;
+
+  for (i = 0, info = dev_list; i < dev_list_count; i++, info++) {
+    if (!info->ops ||
+        !info->ops->parse_file ||
+        !info->ops->fw_update) {
+      syslog(LOG_WARNING, "%s: incomplete ops: %s", __func__, info->dev_name);
+      return VR_STATUS_FAILURE;
+    }
+
+    if (!vr_load_file(info, path, false)) {
+      parser = info;
+      break;
+    }
+  }
+  if (!parser) {
+    syslog(LOG_WARNING, "%s: no device accepts the image", __func__);
+    return VR_STATUS_FAILURE;
+  }
+
+  jobs = calloc(dev_list_count, sizeof(*jobs));
+  devs = calloc(dev_list_count, sizeof(*devs));
+  if (!jobs || !devs) {
+    free(devs);
+    free(jobs);
+    return VR_STATUS_FAILURE;
+  }
+
+  // the parsed configuration is only meaningful to drivers of the same type
+  for (i = 0, info = dev_list; i < dev_list_count; i++, info++) {
+    if (info->ops == parser->ops) {
+      jobs[vr_find_job(jobs, &job_count, info->bus)].count++;
+    }
+  }
+  for (j = 0, offs = 0; j < job_count; j++) {
+    jobs[j].devs = &devs[offs];
+    jobs[j].force = force;
+    offs += jobs[j].count;
+    jobs[j].count = 0;
+  }
+  for (i = 0, info = dev_list; i < dev_list_count; i++, info++) {
+    if (info->ops == parser->ops) {
+      j = vr_find_job(jobs, &job_count, info->bus);
+      jobs[j].devs[jobs[j].count++] = info;
+    }
+  }
+
+  vr_progress_begin(job_count > 1);
+  for (j = 1; j < job_count; j++) {
+    if (pthread_create(&jobs[j].tid, NULL, vr_bus_worker, &jobs[j])) {
+      syslog(LOG_WARNING, "%s: create worker for bus %u failed", __func__, jobs[j].bus);
+      vr_bus_worker(&jobs[j]);
+      jobs[j].tid = 0;
+    }
+  }
+  vr_bus_worker(&jobs[0]);
+
+  for (j = 0; j < job_count; j++) {
+    if (j && jobs[j].tid) {
+      pthread_join(jobs[j].tid, NULL);
+    }
+    updated += jobs[j].updated;
+    failed += jobs[j].failed;
+  }
+  vr_progress_end();
+
+  free(devs);
+  free(jobs);
+
+  if (failed || !updated) {
+    return VR_STATUS_FAILURE;
+  }
+
+  return VR_STATUS_SUCCESS;
+}
+
+int vr_fw_update(const char *vr_name, const char *path, bool force)
+{
+  struct vr_info *info = dev_list;
+  int i, ret;
+
+  if (!vr_name) {  // update all devices which accept the image
+    return vr_update_all(path, force);
+  }
+
+  for (i = 0; i < dev_list_count; i++, info++) {
+    if (!strcmp(info->dev_name, vr_name)) {
+      break;
+    }
+  }
   if (i >= dev_list_count) {
     syslog(LOG_WARNING, "%s: device %s not found", __func__, vr_name);
+    return VR_STATUS_FAILURE;
   }
 
-  return VR_STATUS_FAILURE;
+  if (!info->ops ||
+      !info->ops->parse_file ||
+      !info->ops->fw_update) {
+    syslog(LOG_WARNING, "%s: incomplete ops: %s", __func__, info->dev_name);
+    return VR_STATUS_FAILURE;
+  }
+
+  if (vr_load_file(info, path, true)) {
+    return VR_STATUS_FAILURE;
+  }
+
+  vr_progress_begin(false);
+  ret = vr_update_dev(info, force);
+  vr_progress_end();
+
+  return (ret == VR_STATUS_SUCCESS) ? VR_STATUS_SUCCESS : VR_STATUS_FAILURE;
 }
 
 int i2c_io(int fd, uint8_t addr, uint8_t *tbuf, uint8_t tcnt, uint8_t *rbuf, uint8_t rcnt)
 {
   int ret = -1;
   int retry = 3;
+  int delay = VR_RETRY_MIN_DELAY;
   uint8_t buf[64];
 
   if (tcnt > sizeof(buf)) {
@@ -170,12 +470,13 @@ int i2c_io(int fd, uint8_t addr, uint8_t *tbuf, uint8_t tcnt, uint8_t *rbuf, uin
     ret = i2c_rdwr_msg_transfer(fd, addr, buf, tcnt, rbuf, rcnt);
     if (ret) {
       syslog(LOG_WARNING, "%s: i2c rw failed for dev 0x%x", __func__, addr);
-      retry--;
-      msleep(100);
+      if (--retry > 0) {
+        msleep(delay);
+        delay *= 2;
+      }
       continue;
     }
 
-    msleep(1);  // delay between transactions
     break;
   }
 
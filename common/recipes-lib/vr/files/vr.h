@@ -34,6 +34,9 @@ extern "C" {
 #define MAX_VER_STR_LEN 80
 #define VR_REG_PAGE 0x00
 
+#define MAX_VR_HANDLES 32
+#define VR_RETRY_MIN_DELAY 10   // ms, doubled on each i2c retry
+
 enum {
   VR_STATUS_SUCCESS = 0,
   VR_STATUS_FAILURE = -1,
@@ -89,6 +92,13 @@ struct vr_info {
   void *private_data;
 };
 
+/*
+ * vr_progress_cb:
+ * 	Called whenever a device reports a new update percentage.
+ * 	Updates of devices on different buses may report concurrently.
+ */
+typedef void (*vr_progress_cb)(struct vr_info*, int);
+
 extern void *plat_configs;
 
 int vr_device_register(struct vr_info*, int);
@@ -97,6 +107,14 @@ int vr_probe(void);
 void vr_remove(void);
 int vr_fw_version(int, const char*, char*);
 int vr_fw_update(const char*, const char*, bool);
+void vr_set_progress_cb(vr_progress_cb);
+
+/* helpers for VR drivers */
+int i2c_io(int, uint8_t, uint8_t*, uint8_t, uint8_t*, uint8_t);
+int vr_dev_open(uint8_t, uint8_t);
+void vr_dev_close(int);
+void vr_dev_close_all(void);
+void vr_report_progress(struct vr_info*, int);
 
 extern int plat_vr_init(void);
 extern void plat_vr_exit(void);
@@ -0,0 +1,257 @@
+/*
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include <openbmc/obmc-i2c.h>
+#include <openbmc/kv.h>
+#include "vr.h"
+extern "C" {
+#include "xdpe12284c.h"
+}
+
+using namespace std;
+
+/*
+ * Simulated XDPE12284C: paged 16-bit register file, a write counter for
+ * the data pages, and a status register whose bit 0 reports an EMTP
+ * programming error.
+ */
+struct SimVR {
+  uint8_t bus;
+  uint8_t addr;
+  uint8_t page = 0;
+  map<uint16_t, uint16_t> regs;
+  vector<uint16_t> written;
+  bool emtp_error = false;
+  uint32_t crc = 0;
+  int transfers = 0;
+};
+
+static mutex sim_lock;
+static vector<SimVR *> sim_devs;
+static map<int, SimVR *> sim_fds;
+static atomic<int> sim_active(0);
+static atomic<int> sim_max_active(0);
+static atomic<int> slept_ms(0);
+
+static uint32_t sim_crc32(const vector<uint16_t> &words) {
+  uint32_t crc = 0xFFFFFFFF;
+  for (auto w : words) {
+    for (int n = 0; n < 2; n++) {
+      crc ^= (uint8_t)(w >> (8 * n));
+      for (int b = 0; b < 32; b++) {
+        crc = (crc & 0x80000000) ? ((crc << 1) ^ 0x04C11DB7) : (crc << 1);
+      }
+    }
+  }
+  return crc;
+}
+
+extern "C" {
+
+int i2c_cdev_slave_open(int bus, uint16_t addr, int flags) {
+  lock_guard<mutex> lk(sim_lock);
+  for (auto dev : sim_devs) {
+    if (dev->bus == bus && (dev->addr >> 1) == addr) {
+      int fd = open("/dev/null", O_RDWR);
+      sim_fds[fd] = dev;
+      return fd;
+    }
+  }
+  return -1;
+}
+
+int i2c_rdwr_msg_transfer(int fd, __u8 addr, __u8 *tbuf, __u8 tcnt,
+                          __u8 *rbuf, __u8 rcnt) {
+  SimVR *dev;
+  {
+    lock_guard<mutex> lk(sim_lock);
+    if (sim_fds.find(fd) == sim_fds.end()) {
+      return -1;
+    }
+    dev = sim_fds[fd];
+  }
+  if (dev->addr != addr || tcnt < 1) {
+    return -1;
+  }
+
+  int active = ++sim_active;
+  int prev = sim_max_active;
+  while (active > prev && !sim_max_active.compare_exchange_weak(prev, active));
+  usleep(50);  // keep the bus "occupied" so concurrent programming overlaps
+  dev->transfers++;
+
+  uint16_t key = (dev->page << 8) | tbuf[0];
+  if (tbuf[0] == VR_REG_PAGE && tcnt == 2) {
+    dev->page = tbuf[1];
+  } else if (tcnt == 3) {
+    dev->regs[key] = tbuf[1] | (tbuf[2] << 8);
+    if (dev->page >= 0x20 && dev->page <= 0x2F) {
+      dev->written.push_back(dev->regs[key]);
+    }
+  } else if (tcnt == 1 && rcnt == 0) {
+    if (dev->page == VR_XDPE_PAGE_32 && tbuf[0] == 0x26) {
+      dev->crc = sim_crc32(dev->written);
+    }
+  } else if (tcnt == 1) {
+    uint16_t val = 0;
+    if (key == ((VR_XDPE_PAGE_60 << 8) | VR_XDPE_REG_STATUS)) {
+      if (dev->emtp_error) {
+        val = VR_XDPE_STATUS_ERR;
+      }
+    } else if (key == ((VR_XDPE_PAGE_50 << 8) | VR_XDPE_REG_REMAIN_WR)) {
+      val = 10 << 6;
+    } else if (key == ((VR_XDPE_PAGE_62 << 8) | VR_XDPE_REG_CRC_L)) {
+      val = dev->crc & 0xFFFF;
+    } else if (key == ((VR_XDPE_PAGE_62 << 8) | VR_XDPE_REG_CRC_H)) {
+      val = dev->crc >> 16;
+    } else if (dev->regs.count(key)) {
+      val = dev->regs[key];
+    }
+    memset(rbuf, 0, rcnt);
+    memcpy(rbuf, &val, rcnt < 2 ? rcnt : 2);
+  }
+
+  --sim_active;
+  return 0;
+}
+
+void msleep(int msec) {
+  slept_ms += msec;
+  usleep(msec * 1000);
+}
+
+int kv_get(const char *key, char *value, size_t *len, unsigned int flags) {
+  return -1;
+}
+
+int kv_set(const char *key, const char *value, size_t len, unsigned int flags) {
+  return 0;
+}
+
+} // extern "C"
+
+static struct vr_ops xdpe_ops = {
+  .get_fw_ver = get_xdpe_ver,
+  .parse_file = xdpe_parse_file,
+  .validate_file = NULL,
+  .fw_update = xdpe_fw_update,
+  .fw_verify = xdpe_fw_verify,
+};
+
+static const char *image_path = "/tmp/vr_test_image.txt";
+
+class VRTest : public ::testing::Test {
+ protected:
+  SimVR dev0, dev1;
+  struct vr_info list[2];
+  map<string, int> progress;
+
+  void SetUp() {
+    vector<uint16_t> words;
+    FILE *fp = fopen(image_path, "w");
+    ASSERT_NE(fp, nullptr);
+
+    for (int i = 0; i < VR_XDPE_TOTAL_RW_SIZE / 4; i++) {
+      words.push_back((uint16_t)(i * 0x0101 + 0x1234));
+    }
+    fprintf(fp, "XDPE12284C - 60 - %08X\n", sim_crc32(words));
+    fprintf(fp, "[Config Data]\n");
+    for (size_t i = 0; i < words.size(); i += 16) {
+      fprintf(fp, "%04X", (unsigned)(0x2000 + i));
+      for (size_t j = i; j < i + 16 && j < words.size(); j++) {
+        fprintf(fp, " %04X", words[j]);
+      }
+      fprintf(fp, "\n");
+    }
+    fprintf(fp, "[End Config Data]\n");
+    fclose(fp);
+
+    dev0.bus = 1;
+    dev0.addr = 0x60;
+    dev1.bus = 2;
+    dev1.addr = 0x60;
+    sim_devs = {&dev0, &dev1};
+    sim_fds.clear();
+    sim_max_active = 0;
+    slept_ms = 0;
+
+    memset(list, 0, sizeof(list));
+    list[0].bus = dev0.bus;
+    list[0].addr = dev0.addr;
+    strcpy(list[0].dev_name, "VR_SIM0");
+    list[0].ops = &xdpe_ops;
+    list[1].bus = dev1.bus;
+    list[1].addr = dev1.addr;
+    strcpy(list[1].dev_name, "VR_SIM1");
+    list[1].ops = &xdpe_ops;
+    vr_device_register(list, 2);
+
+    plat_configs = NULL;
+    vr_set_progress_cb(NULL);
+  }
+
+  void TearDown() {
+    free(plat_configs);
+    plat_configs = NULL;
+    vr_dev_close_all();
+    vr_device_unregister();
+    unlink(image_path);
+  }
+};
+
+TEST_F(VRTest, UpdateByName) {
+  ASSERT_EQ(vr_fw_update("VR_SIM0", image_path, false), VR_STATUS_SUCCESS);
+  ASSERT_EQ(dev0.written.size(), (size_t)VR_XDPE_TOTAL_RW_SIZE / 4);
+  ASSERT_EQ(dev1.written.size(), 0u);
+  // fixed 500 ms upload wait plus 10 ms reload wait
+  ASSERT_GE(slept_ms.load(), 510);
+  // update and verify share one cached handle
+  ASSERT_EQ(sim_fds.size(), 1u);
+}
+
+TEST_F(VRTest, ConcurrentBuses) {
+  static map<string, int> *prog;
+  static mutex prog_lock;
+  prog = &progress;
+  vr_set_progress_cb([](struct vr_info *info, int percent) {
+    lock_guard<mutex> lk(prog_lock);
+    (*prog)[info->dev_name] = percent;
+  });
+
+  ASSERT_EQ(vr_fw_update(NULL, image_path, false), VR_STATUS_SUCCESS);
+  ASSERT_EQ(dev0.written.size(), (size_t)VR_XDPE_TOTAL_RW_SIZE / 4);
+  ASSERT_EQ(dev1.written.size(), (size_t)VR_XDPE_TOTAL_RW_SIZE / 4);
+  ASSERT_EQ(progress["VR_SIM0"], 100);
+  ASSERT_EQ(progress["VR_SIM1"], 100);
+  ASSERT_GT(sim_max_active.load(), 1);
+}
+
+TEST_F(VRTest, StatusError) {
+  dev0.emtp_error = true;
+  ASSERT_EQ(vr_fw_update("VR_SIM0", image_path, false), VR_STATUS_FAILURE);
+  // the register reload is never triggered after a failed upload
+  ASSERT_LT(slept_ms.load(), 510);
+}
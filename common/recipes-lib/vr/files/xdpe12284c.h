@@ -16,6 +16,9 @@
 #define VR_XDPE_REG_CRC_H 0x43     // page 0x62
 #define VR_XDPE_REG_NEXT_MEM 0x65  // page 0x62
 
+#define VR_XDPE_REG_STATUS 0x01  // page 0x60
+#define VR_XDPE_STATUS_ERR 0x01
+
 #define VR_XDPE_TOTAL_RW_SIZE 1080
 
 struct xdpe_config {
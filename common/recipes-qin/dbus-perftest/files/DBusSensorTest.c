@@ -0,0 +1,190 @@
+/*
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <gio/gio.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/time.h>
+
+#define TEST_SENSOR_NUM 64
+
+static double cache[TEST_SENSOR_NUM];
+static int signals = 0;
+
+static double elapsed_us(struct timeval *tv1, struct timeval *tv2) {
+  return (double) (1000000*(tv2->tv_sec - tv1->tv_sec)) +
+         tv2->tv_usec - tv1->tv_usec;
+}
+
+static void on_readings_changed(GDBusConnection *connection,
+                                const gchar     *sender,
+                                const gchar     *object_path,
+                                const gchar     *interface_name,
+                                const gchar     *signal_name,
+                                GVariant        *parameters,
+                                gpointer         user_data) {
+  GVariantIter *iter;
+  guchar fru, id;
+  gint status;
+  gdouble value;
+
+  g_variant_get(parameters, "(ya(yid))", &fru, &iter);
+  while (g_variant_iter_loop(iter, "(yid)", &id, &status, &value)) {
+    if (id < TEST_SENSOR_NUM && status == 0) {
+      cache[id] = value;
+    }
+  }
+  g_variant_iter_free(iter);
+  signals++;
+}
+
+static int read_bulk(GDBusProxy *proxy, gboolean raw, double *values) {
+  GError *error = NULL;
+  GVariantIter *iter;
+  GVariant *response;
+  guchar id;
+  gint status;
+  gdouble value;
+
+  response = g_dbus_proxy_call_sync(
+      proxy,
+      "org.openbmc.TestSensorTree.getFruSensorReadings",
+      g_variant_new("(yb)", 1, raw),
+      G_DBUS_CALL_FLAGS_NONE,
+      -1,
+      NULL,
+      &error);
+  if (error != NULL) {
+    printf("Cannot send message to the proxy: %s\n", error->message);
+    return -1;
+  }
+
+  g_variant_get(response, "(a(yid))", &iter);
+  while (g_variant_iter_loop(iter, "(yid)", &id, &status, &value)) {
+    if (id < TEST_SENSOR_NUM && values != NULL) {
+      values[id] = value;
+    }
+  }
+  g_variant_iter_free(iter);
+  g_variant_unref(response);
+  return 0;
+}
+
+// compare reading a FRU sensor by sensor, in bulk, and from a local cache
+// kept current by sensorReadingsChanged signals
+int main (int argc, char *argv[]) {
+  GError *error = NULL;
+  GMainContext *context;
+  int iteration = 100;
+  int i, j;
+  double per_sensor = 0, bulk = 0, cached = 0;
+  double values[TEST_SENSOR_NUM];
+  struct timeval tv1, tv2;
+
+  // signals are queued here and applied when the cache is read
+  context = g_main_context_new();
+  g_main_context_push_thread_default(context);
+
+  GDBusProxy* proxy = g_dbus_proxy_new_for_bus_sync(
+                        G_BUS_TYPE_SESSION,
+                        G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES,
+                        NULL,
+                        "org.openbmc.TestServer",
+                        "/org/openbmc/test",
+                        "org.openbmc.TestSensorTree",
+                        NULL,
+                        &error);
+
+  if (proxy == NULL) {
+    printf("Cannot register the dbus proxy: %s", error->message);
+    return 1;
+  }
+
+  g_dbus_connection_signal_subscribe(g_dbus_proxy_get_connection(proxy),
+                                     "org.openbmc.TestServer",
+                                     "org.openbmc.TestSensorTree",
+                                     "sensorReadingsChanged",
+                                     "/org/openbmc/test",
+                                     NULL,
+                                     G_DBUS_SIGNAL_FLAGS_NONE,
+                                     on_readings_changed,
+                                     NULL,
+                                     NULL);
+  g_main_context_pop_thread_default(context);
+
+  if (read_bulk(proxy, FALSE, cache)) {
+    return 1;
+  }
+
+  for (i = 0; i < iteration; i++) {
+    // one round trip per sensor
+    gettimeofday(&tv1, NULL);
+    for (j = 0; j < TEST_SENSOR_NUM; j++) {
+      gint status;
+      GVariant *response = g_dbus_proxy_call_sync(
+          proxy,
+          "org.openbmc.TestSensorTree.sensorRead",
+          g_variant_new("(y)", j),
+          G_DBUS_CALL_FLAGS_NONE,
+          -1,
+          NULL,
+          &error);
+      if (error != NULL) {
+        printf("Cannot send message to the proxy: %s\n", error->message);
+        return 1;
+      }
+      g_variant_get(response, "(id)", &status, &values[j]);
+      g_variant_unref(response);
+    }
+    gettimeofday(&tv2, NULL);
+    per_sensor += elapsed_us(&tv1, &tv2);
+
+    // one round trip per FRU, also sweeps the sensors and emits the signal
+    gettimeofday(&tv1, NULL);
+    if (read_bulk(proxy, TRUE, values)) {
+      return 1;
+    }
+    gettimeofday(&tv2, NULL);
+    bulk += elapsed_us(&tv1, &tv2);
+
+    // wait for the signal of this sweep so the cached pass sees it
+    while (signals <= i) {
+      g_main_context_iteration(context, TRUE);
+    }
+
+    // no round trip, apply whatever signals arrived and read locally
+    gettimeofday(&tv1, NULL);
+    while (g_main_context_iteration(context, FALSE));
+    for (j = 0; j < TEST_SENSOR_NUM; j++) {
+      if (cache[j] != values[j]) {
+        printf("cache mismatch on sensor %d: %f != %f\n", j, cache[j], values[j]);
+        return 1;
+      }
+    }
+    gettimeofday(&tv2, NULL);
+    cached += elapsed_us(&tv1, &tv2);
+  }
+
+  printf("sensors per FRU = %d\n", TEST_SENSOR_NUM);
+  printf("per-sensor read, average FRU latency = %f\n", per_sensor / iteration);
+  printf("bulk read, average FRU latency = %f\n", bulk / iteration);
+  printf("cached read, average FRU latency = %f\n", cached / iteration);
+  g_object_unref(proxy);
+  g_main_context_unref(context);
+  return 0;
+}
@@ -31,8 +31,28 @@ const gchar introspection_xml[] =
   "      <arg type='s' name='response' direction='out'/>"
   "    </method>"
   "  </interface>"
+  "  <interface name='org.openbmc.TestSensorTree'>"
+  "    <method name='sensorRead'>"
+  "      <arg type='y' name='sensorId' direction='in'/>"
+  "      <arg type='i' name='readStatus' direction='out'/>"
+  "      <arg type='d' name='value' direction='out'/>"
+  "    </method>"
+  "    <method name='getFruSensorReadings'>"
+  "      <arg type='y' name='fruId' direction='in'/>"
+  "      <arg type='b' name='rawRead' direction='in'/>"
+  "      <arg type='a(yid)' name='readings' direction='out'/>"
+  "    </method>"
+  "    <signal name='sensorReadingsChanged'>"
+  "      <arg type='y' name='fruId'/>"
+  "      <arg type='a(yid)' name='readings'/>"
+  "    </signal>"
+  "  </interface>"
   "</node>";
 
+// simulated FRU for the sensor read tests, mirrors the sensor-svc API
+#define TEST_SENSOR_NUM 64
+static double sensor_values[TEST_SENSOR_NUM];
+
 static GDBusNodeInfo *introspection_data = NULL;
 
 static void handle_method_call (GDBusConnection       *connection,
@@ -55,6 +75,45 @@ static void handle_method_call (GDBusConnection       *connection,
                                           g_variant_new ("(s)", response));
     g_free(response);
   }
+  else if (g_strcmp0(method_name, "sensorRead") == 0) {
+    guchar id;
+    g_variant_get(parameters, "(y)", &id);
+    if (id >= TEST_SENSOR_NUM) {
+      g_dbus_method_invocation_return_value(invocation,
+                                            g_variant_new("(id)", -2, 0.0));
+      return;
+    }
+    g_dbus_method_invocation_return_value(invocation,
+                                          g_variant_new("(id)", 0, sensor_values[id]));
+  }
+  else if (g_strcmp0(method_name, "getFruSensorReadings") == 0) {
+    GVariantBuilder readings, changed;
+    guchar fru;
+    gboolean raw;
+    int i;
+
+    g_variant_get(parameters, "(yb)", &fru, &raw);
+    g_variant_builder_init(&readings, G_VARIANT_TYPE("a(yid)"));
+    g_variant_builder_init(&changed, G_VARIANT_TYPE("a(yid)"));
+    for (i = 0; i < TEST_SENSOR_NUM; i++) {
+      // a sweep changes every other sensor
+      if (raw && (i & 1)) {
+        sensor_values[i] += 1.0;
+        g_variant_builder_add(&changed, "(yid)", i, 0, sensor_values[i]);
+      }
+      g_variant_builder_add(&readings, "(yid)", i, 0, sensor_values[i]);
+    }
+    g_dbus_method_invocation_return_value(invocation,
+                                          g_variant_new("(a(yid))", &readings));
+    if (raw) {
+      g_dbus_connection_emit_signal(connection, NULL, object_path,
+                                    interface_name, "sensorReadingsChanged",
+                                    g_variant_new("(ya(yid))", fru, &changed),
+                                    NULL);
+    } else {
+      g_variant_builder_clear(&changed);
+    }
+  }
 }
 
 static GVariant *handle_get_property (GDBusConnection  *connection,
@@ -98,6 +157,14 @@ static void on_bus_acquired (GDBusConnection *connection,
                                                        NULL,  /* user_data_free_func */
                                                        NULL); /* GError** */
   g_assert (registration_id > 0);
+  registration_id = g_dbus_connection_register_object (connection,
+                                                       "/org/openbmc/test",
+                                                       introspection_data->interfaces[1],
+                                                       &interface_vtable,
+                                                       NULL,  /* user_data */
+                                                       NULL,  /* user_data_free_func */
+                                                       NULL); /* GError** */
+  g_assert (registration_id > 0);
 }
 
 static void on_name_acquired (GDBusConnection *connection,
@@ -221,6 +221,16 @@ class Object {
      */
     std::string getObjectPath() const;
 
+    /**
+     * Id of the object used by the ObjectTree id index. Derived classes
+     * having an id (FRU, sensor, ...) override this.
+     *
+     * @return id of the object; -1 if the object is not to be indexed
+     */
+    virtual int getIndexId() const {
+      return -1;
+    }
+
   protected:
 
     void setParent(Object* parent) {
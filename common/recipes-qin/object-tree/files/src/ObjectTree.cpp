@@ -86,10 +86,42 @@ void ObjectTree::deleteObjectByPath(const std::string &path) {
     LOG(ERROR) << "Failed to delete the object at \"" << path << "\"";
     throw std::invalid_argument("Error deleting object");
   }
+  unindexObject(object);
   objectMap_.erase(it);
   ipc_.get()->unregisterObject(path);
 }
 
+/**
+ * Erase the entry of object from a multimap index.
+ */
+template <typename Index, typename Key>
+static void eraseIndexEntry(Index &index, const Key &key,
+                            const Object* object) {
+  auto range = index.equal_range(key);
+  for (auto it = range.first; it != range.second; it++) {
+    if (it->second == object) {
+      index.erase(it);
+      return;
+    }
+  }
+}
+
+void ObjectTree::indexObject(Object* object, const std::string &path) {
+  nameIndex_.insert(std::make_pair(object->getName(), object));
+  if (object->getIndexId() >= 0) {
+    idIndex_.insert(std::make_pair(object->getIndexId(), object));
+  }
+  pathIndex_[object] = path;
+}
+
+void ObjectTree::unindexObject(const Object* object) {
+  eraseIndexEntry(nameIndex_, object->getName(), object);
+  if (object->getIndexId() >= 0) {
+    eraseIndexEntry(idIndex_, object->getIndexId(), object);
+  }
+  pathIndex_.erase(object);
+}
+
 Object* ObjectTree::getParent(const std::string &parentPath,
                               const std::string &name) const {
   Object* parent = getObject(parentPath);
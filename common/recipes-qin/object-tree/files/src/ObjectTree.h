@@ -38,11 +38,18 @@ namespace qin {
 class ObjectTree {
   public:
     typedef std::unordered_map<std::string, std::unique_ptr<Object>> ObjectMap;
+    // secondary indexes kept in sync with objectMap_
+    typedef std::unordered_multimap<std::string, Object*> NameIndex;
+    typedef std::unordered_multimap<int, Object*> IdIndex;
+    typedef std::unordered_map<const Object*, std::string> PathIndex;
 
   protected:
     std::shared_ptr<Ipc>  ipc_;        // pointer to the ipc interface
     Object*               root_;       // pointer to the root object
     ObjectMap             objectMap_;  // path to *object map of all objects
+    NameIndex             nameIndex_;  // object name to objects
+    IdIndex               idIndex_;    // Object::getIndexId() to objects
+    PathIndex             pathIndex_;  // object to its path
 
   public:
     /**
@@ -99,6 +106,64 @@ class ObjectTree {
       return getObject(path) != nullptr;
     }
 
+    /**
+     * Get the path the object was added at without walking up the tree.
+     *
+     * @param object in the tree
+     * @return path of the object, valid until the object is deleted;
+     *         empty string if not in the tree
+     */
+    const std::string& getObjectPath(const Object* object) const {
+      static const std::string empty;
+      PathIndex::const_iterator it;
+      if ((it = pathIndex_.find(object)) == pathIndex_.end()) {
+        return empty;
+      }
+      return it->second;
+    }
+
+    /**
+     * Find an object of type T by name below ancestor through the name
+     * index. Names are only unique among siblings; if several objects
+     * match, any one of them is returned.
+     *
+     * @param name of the object
+     * @param ancestor to search under; whole tree if nullptr
+     * @return nullptr if not found; T* otherwise
+     */
+    template <typename T = Object>
+    T* findObjectByName(const std::string &name,
+                        const Object* ancestor = nullptr) const {
+      auto range = nameIndex_.equal_range(name);
+      for (auto it = range.first; it != range.second; it++) {
+        T* object = dynamic_cast<T*>(it->second);
+        if (object != nullptr && isDescendant(it->second, ancestor)) {
+          return object;
+        }
+      }
+      return nullptr;
+    }
+
+    /**
+     * Find an object of type T by Object::getIndexId() below ancestor
+     * through the id index.
+     *
+     * @param id of the object
+     * @param ancestor to search under; whole tree if nullptr
+     * @return nullptr if not found; T* otherwise
+     */
+    template <typename T = Object>
+    T* findObjectById(int id, const Object* ancestor = nullptr) const {
+      auto range = idIndex_.equal_range(id);
+      for (auto it = range.first; it != range.second; it++) {
+        T* object = dynamic_cast<T*>(it->second);
+        if (object != nullptr && isDescendant(it->second, ancestor)) {
+          return object;
+        }
+      }
+      return nullptr;
+    }
+
     /**
      * Add an object to the objectMap_ with parent path specified.
      *
@@ -199,10 +264,47 @@ class ObjectTree {
                             const std::string       &path) {
       Object* object = upObj.get();
       objectMap_.insert(std::make_pair(path, std::move(upObj)));
+      indexObject(object, path);
       ipc_->registerObject(path, object);
       return object;
     }
 
+    /**
+     * Add the object to the secondary indexes. Derived trees inserting
+     * into objectMap_ themselves must call this as well.
+     *
+     * @param object added to objectMap_
+     * @param path the object is added at
+     */
+    void indexObject(Object* object, const std::string &path);
+
+    /**
+     * Remove the object from the secondary indexes.
+     *
+     * @param object to be removed from objectMap_
+     */
+    void unindexObject(const Object* object);
+
+    /**
+     * Check if object is in the subtree under ancestor.
+     *
+     * @param object to be checked
+     * @param ancestor of the subtree; any object matches if nullptr
+     * @return true if ancestor is nullptr or a proper ancestor of object
+     */
+    static bool isDescendant(const Object* object, const Object* ancestor) {
+      if (ancestor == nullptr) {
+        return true;
+      }
+      for (object = object->getParent(); object != nullptr;
+           object = object->getParent()) {
+        if (object == ancestor) {
+          return true;
+        }
+      }
+      return false;
+    }
+
     /**
      * Get a new path from parentPath and specified name through ipc_.
      *
@@ -16,9 +16,11 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#include <chrono>
 #include <memory>
 #include <stdexcept>
 #include <string.h>
+#include <vector>
 #include <gtest/gtest.h>
 #include <glog/logging.h>
 #include <ipc-interface/Ipc.h>
@@ -28,6 +30,38 @@
 #include "../Attribute.h"
 using namespace openbmc::qin;
 
+/**
+ * Object carrying an id for the id index.
+ */
+class IdObject : public Object {
+  public:
+    IdObject(const std::string &name, int id) : Object(name), id_(id) {}
+
+    int getIndexId() const override {
+      return id_;
+    }
+
+  private:
+    int id_;
+};
+
+/**
+ * The recursive lookup the index replaces.
+ */
+static Object* findByIdRec(Object* obj, int id) {
+  for (auto &it : obj->getChildMap()) {
+    if (dynamic_cast<IdObject*>(it.second) != nullptr &&
+        it.second->getIndexId() == id) {
+      return it.second;
+    }
+    Object* found = findByIdRec(it.second, id);
+    if (found != nullptr) {
+      return found;
+    }
+  }
+  return nullptr;
+}
+
 class ObjectTreeTest : public ::testing::Test {
  protected:
   virtual void SetUp() {
@@ -145,6 +179,93 @@ TEST_F(ObjectTreeTest, AddObjectByUniquePtr) {
   EXPECT_ANY_THROW(objTree_->addObject(std::move(uObj), "/org"));
 }
 
+TEST_F(ObjectTreeTest, IndexLookup) {
+  objTree_->addObject("openbmc", "/org");
+  Object* fru0 = objTree_->addObject(
+      std::unique_ptr<Object>(new IdObject("fru0", 0)), "/org/openbmc");
+  Object* fru1 = objTree_->addObject(
+      std::unique_ptr<Object>(new IdObject("fru1", 1)), "/org/openbmc");
+  // same sensor name and id under both FRUs
+  Object* snr0 = objTree_->addObject(
+      std::unique_ptr<Object>(new IdObject("temp", 10)), "/org/openbmc/fru0");
+  Object* snr1 = objTree_->addObject(
+      std::unique_ptr<Object>(new IdObject("temp", 10)), "/org/openbmc/fru1");
+
+  EXPECT_EQ(objTree_->findObjectById<IdObject>(1), fru1);
+  EXPECT_EQ(objTree_->findObjectById(10, fru0), snr0);
+  EXPECT_EQ(objTree_->findObjectById(10, fru1), snr1);
+  EXPECT_EQ(objTree_->findObjectById(1, fru0), nullptr);
+  EXPECT_EQ(objTree_->findObjectByName("temp", fru1), snr1);
+  EXPECT_EQ(objTree_->findObjectByName<IdObject>("fru0"), fru0);
+  EXPECT_EQ(objTree_->findObjectByName<IdObject>("openbmc"), nullptr);
+  // an object is not its own descendant
+  EXPECT_EQ(objTree_->findObjectByName("fru0", fru0), nullptr);
+
+  EXPECT_EQ(objTree_->getObjectPath(snr1), "/org/openbmc/fru1/temp");
+  EXPECT_EQ(objTree_->getObjectPath(snr1), snr1->getObjectPath());
+  EXPECT_EQ(objTree_->getObjectPath(objTree_->getRoot()), "/org");
+
+  // deleted objects leave the indexes
+  objTree_->deleteObjectByPath("/org/openbmc/fru1/temp");
+  EXPECT_EQ(objTree_->findObjectById(10, fru1), nullptr);
+  EXPECT_EQ(objTree_->findObjectByName("temp"), snr0);
+  EXPECT_EQ(objTree_->getObjectPath(snr1), "");
+  objTree_->deleteObjectByPath("/org/openbmc/fru1");
+  EXPECT_EQ(objTree_->findObjectById(1), nullptr);
+}
+
+/**
+ * Lookup cost by tree size, indexed versus the recursive walk. Each FRU
+ * holds 9 sensors, ids are unique over the tree.
+ */
+TEST(ObjectTreeScaling, IndexVersusWalk) {
+  const int lookups = 200;
+
+  for (int frus : {10, 100, 1000}) {
+    ObjectTree tree(std::shared_ptr<Ipc>(new DummyIpc()), "org");
+    int id = 0;
+    for (int f = 0; f < frus; f++) {
+      const std::string fruName = "fru" + std::to_string(f);
+      tree.addObject(std::unique_ptr<Object>(new IdObject(fruName, id++)),
+                     "/org");
+      for (int s = 0; s < 9; s++) {
+        tree.addObject(std::unique_ptr<Object>(
+                         new IdObject("snr" + std::to_string(s), id++)),
+                       "/org/" + fruName);
+      }
+    }
+
+    std::vector<int> ids;
+    for (int i = 0; i < lookups; i++) {
+      ids.push_back((i * 7919) % id);
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<Object*> indexed;
+    for (int i : ids) {
+      Object* obj = tree.findObjectById(i, tree.getRoot());
+      indexed.push_back(obj);
+      ASSERT_FALSE(tree.getObjectPath(obj).empty());
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    std::vector<Object*> walked;
+    for (int i : ids) {
+      Object* obj = findByIdRec(tree.getRoot(), i);
+      walked.push_back(obj);
+      ASSERT_FALSE(obj->getObjectPath().empty());
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    ASSERT_EQ(indexed, walked);
+    // timings are informational only, they depend on the build machine
+    double indexUs = std::chrono::duration<double, std::micro>(t1 - t0).count();
+    double walkUs = std::chrono::duration<double, std::micro>(t2 - t1).count();
+    std::cout << tree.getObjectCount() << " objects: " << lookups
+              << " lookups indexed " << indexUs << " us, walk "
+              << walkUs << " us" << std::endl;
+  }
+}
+
 int main (int argc, char* argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
   ::google::InitGoogleLogging(argv[0]);
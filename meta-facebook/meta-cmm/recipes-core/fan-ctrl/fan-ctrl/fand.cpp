@@ -58,6 +58,7 @@
 #include <signal.h>
 #include <syslog.h>
 #include <dirent.h>
+#include <time.h>
 #ifdef CONFIG_GALAXY100
 #include <fcntl.h>
 #endif
@@ -141,6 +142,13 @@
 
 #define PATH_CACHE_SIZE 256
 
+/*
+ * The CPLDs need some time between two accesses. It only applies to the
+ * devices of a same bus, so accesses to other busses proceed meanwhile.
+ */
+#define I2C_BUS_MAX 256
+#define I2C_CPLD_GAP_US 11000
+
 #define log_error(fmt, args...) \
   syslog(LOG_ERR, "%s" fmt ": %s", __func__, ##args, strerror(errno))
 #define log_warn(fmt, args...) \
@@ -562,33 +570,109 @@ close_dir_out:
   return rc;
 }
 
+/*
+ * Per-bus pacing policy, in micro-seconds between the end of an access
+ * and the start of the next one on the same bus. Other busses (the lm75
+ * sensors, whose driver caches the readings) are not paced.
+ */
+static struct {
+  int bus;
+  unsigned int gap_us;
+} i2c_bus_policy[] = {
+  { GALAXY100_CMM_SYS_I2C_BUS, I2C_CPLD_GAP_US },  /* cmmcpld */
+  { 171, I2C_CPLD_GAP_US },  /* fancpld of FCB-1 */
+  { 179, I2C_CPLD_GAP_US },  /* fancpld of FCB-2 */
+  { 187, I2C_CPLD_GAP_US },  /* fancpld of FCB-3 */
+  { 195, I2C_CPLD_GAP_US },  /* fancpld of FCB-4 */
+};
+
+static struct timespec i2c_bus_last_access[I2C_BUS_MAX];
+
+/*
+ * Get the I2C bus of a sysfs path, i.e. <bus> in the ".../<bus>-<addr>/..."
+ * component. Returns -1 if it is not an I2C device.
+ */
+static int i2c_bus_of_path(const char *path)
+{
+  const char *p;
+  int bus, addr, len;
+
+  for (p = strchr(path, '/'); p != NULL; p = strchr(p + 1, '/')) {
+    if (sscanf(p + 1, "%d-%4x%n", &bus, &addr, &len) == 2 &&
+        p[1 + len] == '/' && bus >= 0 && bus < I2C_BUS_MAX) {
+      return bus;
+    }
+  }
+  return -1;
+}
+
+static unsigned int i2c_bus_gap_us(int bus)
+{
+  unsigned int i;
+
+  for (i = 0; i < ARRAY_SIZE(i2c_bus_policy); i++) {
+    if (i2c_bus_policy[i].bus == bus) {
+      return i2c_bus_policy[i].gap_us;
+    }
+  }
+  return 0;
+}
+
+// Wait for the pacing gap since the last access to the bus of the device
+static int i2c_bus_wait(const char *device)
+{
+  struct timespec now, *last;
+  long elapsed_us, gap_us;
+  int bus = i2c_bus_of_path(device);
+
+  if (bus < 0) {
+    return -1;
+  }
+  last = &i2c_bus_last_access[bus];
+  gap_us = i2c_bus_gap_us(bus);
+  if (gap_us == 0 || (last->tv_sec == 0 && last->tv_nsec == 0)) {
+    return bus;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  elapsed_us = (now.tv_sec - last->tv_sec) * 1000000 +
+               (now.tv_nsec - last->tv_nsec) / 1000;
+  if (elapsed_us >= 0 && elapsed_us < gap_us) {
+    usleep(gap_us - elapsed_us);
+  }
+  return bus;
+}
+
+static void i2c_bus_done(int bus)
+{
+  if (bus >= 0) {
+    clock_gettime(CLOCK_MONOTONIC, &i2c_bus_last_access[bus]);
+  }
+}
+
 // Functions for reading from sysfs stub
 static int read_sysfs_raw_internal(const char *device, char *value, int log)
 {
-  FILE *fp;
-  int rc, err;
+  char buf[PATH_CACHE_SIZE];
+  int bus, rc;
 
-  fp = fopen(device, "r");
-  if (!fp) {
+  bus = i2c_bus_wait(device);
+  rc = device_cache_read(device, buf, sizeof(buf));
+  i2c_bus_done(bus);
+  if (rc != 0) {
     if (log) {
-      err = errno;
-      syslog(LOG_INFO, "failed to open device %s for read: %s",
-             device, strerror(err));
-      errno = err;
+      syslog(LOG_INFO, "failed to read device %s: %s",
+             device, strerror(rc));
     }
+    errno = rc;
     return -1;
   }
 
-  rc = fscanf(fp, "%s", value);
-  fclose(fp);
-
-  if (rc != 1) {
+  if (sscanf(buf, "%s", value) != 1) {
     if (log) {
-      err = errno;
-      syslog(LOG_INFO, "failed to read device %s: %s",
-             device, strerror(err));
-      errno = err;
+      syslog(LOG_INFO, "failed to read device %s: empty", device);
     }
+    errno = ENODATA;
     return -1;
   }
 
@@ -626,29 +710,17 @@ static int read_sysfs_int(char *sysfs_path, int *buffer)
 // Functions for writing to system stub
 static int write_sysfs_raw_internal(const char *device, char *value, int log)
 {
-  FILE *fp;
-  int rc, err;
+  int bus, rc;
 
-  fp = fopen(device, "w");
-  if (!fp) {
+  bus = i2c_bus_wait(device);
+  rc = device_cache_write(device, value);
+  i2c_bus_done(bus);
+  if (rc != 0) {
     if (log) {
-      err = errno;
-      syslog(LOG_INFO, "failed to open device %s for write : %s",
-             device, strerror(err));
-      errno = err;
-    }
-    return err;
-  }
-
-  rc = fputs(value, fp);
-  fclose(fp);
-
-  if (rc < 0) {
-    if (log) {
-      err = errno;
-      syslog(LOG_INFO, "failed to write to device %s", device);
-      errno = err;
+      syslog(LOG_INFO, "failed to write to device %s: %s",
+             device, strerror(rc));
     }
+    errno = rc;
     return -1;
   }
 
@@ -731,7 +803,6 @@ static int read_temp_sysfs(struct sensor_info_sysfs *sensor)
     return -1;
   }
 
-  usleep(11000);
   return value;
 }
 
@@ -831,7 +902,6 @@ static int galaxy100_set_fan_sysfs(int fan, int value)
               channel->prefix, "fantray1_pwm", value);
     return -1;
   }
-  usleep(11000);
 
   snprintf(fullpath, PATH_CACHE_SIZE, "%s/%s", channel->prefix, "fantray2_pwm");
   ret = write_sysfs_int(fullpath, value);
@@ -840,7 +910,6 @@ static int galaxy100_set_fan_sysfs(int fan, int value)
               channel->prefix, "fantray2_pwm", value);
     return -1;
   }
-  usleep(11000);
 
   snprintf(fullpath, PATH_CACHE_SIZE, "%s/%s", channel->prefix, "fantray3_pwm");
   ret = write_sysfs_int(fullpath, value);
@@ -849,7 +918,6 @@ static int galaxy100_set_fan_sysfs(int fan, int value)
               channel->prefix, "fantray3_pwm", value);
     return -1;
   }
-  usleep(11000);
 
   return 0;
 }
@@ -874,8 +942,6 @@ static int galaxy100_fab_is_present_sysfs(int fan)
     return -1;
   }
 
-  usleep(11000);
-
   if (ret != 0) {
     syslog(LOG_ERR, "%s: FAB-%d not present", __func__, fan + 1);
     return 0;
@@ -899,7 +965,6 @@ static int galaxy100_lc_present_detect(void)
     lc_1base = i + 1;
     snprintf(buf, PATH_CACHE_SIZE, "/sys/bus/i2c/drivers/cmmcpld/13-003e/lc%d_present", lc_1base);
     rc = read_sysfs_int(buf, &ret);
-    usleep(11000);
     if (rc == 0)
     {
       if (ret != 0) {
@@ -949,7 +1014,6 @@ static int galaxy100_scm_present_detect(void)
                i - 3);
 
     rc = read_sysfs_int(buf, &ret);
-    usleep(11000);
 
     if (rc == 0)
     {
@@ -984,7 +1048,6 @@ static int galaxy100_cmm_is_master(void)
     log_error("failed to read cmm status reg %#x", GALAXY100_CMM_STATUS_REG);
     return -1;
   }
-  usleep(11000);
 
   // In new function, it's a bit tricky.
   // Readvalue : 0 --> We are master --> Function returns 1
@@ -1046,7 +1109,6 @@ static int galaxy100_fan_is_okey_sysfs(int fan)
     log_error("failed to read fan1 status %s", fullpath);
     error++;
   } else {
-    usleep(11000);
     if(ret & 0x1) {
       if(info->fan1.present == 1)
         printf("FCB-%d fantray 1 is removed\n", fan + 1);
@@ -1080,7 +1142,6 @@ static int galaxy100_fan_is_okey_sysfs(int fan)
     log_error("failed to read fan2 status %s", fullpath);
     error++;
   } else {
-    usleep(11000);
     if(ret & 0x1) {
       if(info->fan2.present == 1)
         printf("FCB-%d fantray 2 is removed\n", fan + 1);
@@ -1114,7 +1175,6 @@ static int galaxy100_fan_is_okey_sysfs(int fan)
     log_error("failed to read fan3 status %s", fullpath);
     error++;
   } else {
-    usleep(11000);
     if(ret & 0x1) {
       if(info->fan3.present == 1)
         printf("FCB-%d fantray 3 is removed\n", fan + 1);
@@ -1205,7 +1265,6 @@ static int galaxy100_write_fan_led_sysfs(int fan, const char *color)
         snprintf(fullpath, PATH_CACHE_SIZE, "%s/fantray%d_led_ctrl",
                  channel->prefix, fan_1base);
         write_sysfs_int(fullpath, value);
-        usleep(11000);
         // Finally, read back, and make sure the value is there.
         rc = read_sysfs_int(fullpath, &ret);
         if ((rc < 0) || (ret != value)) {
@@ -1552,7 +1611,6 @@ int main(int argc, char **argv) {
       continue;
     }
 
-    usleep(11000);
     /* Read sensors */
     critical_temp = read_critical_max_temp();
     alarm_temp = read_alarm_max_temp();
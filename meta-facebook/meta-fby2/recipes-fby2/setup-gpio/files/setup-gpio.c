@@ -68,6 +68,22 @@ enum {
 	LASTEST_REG,
 };
 
+static const size_t scu_reg_offset[LASTEST_REG] = {
+	[SCU80] = REG_SCU80,
+	[SCU84] = REG_SCU84,
+	[SCU88] = REG_SCU88,
+	[SCU8C] = REG_SCU8C,
+	[SCU90] = REG_SCU90,
+	[SCU94] = REG_SCU94,
+	[SCU2C] = REG_SCU2C,
+	[SCUA0] = REG_SCUA0,
+	[SCUA4] = REG_SCUA4,
+	[SCUA8] = REG_SCUA8,
+};
+
+#define SCU_REGION_SIZE		0x100
+#define GPIO_REGION_SIZE	0x200
+
 
 int set_gpio_init_value_after_export(const char * name, const char *shadow, gpio_value_t value)
 {
@@ -98,20 +114,22 @@ int
 main(int argc, char **argv) {
 	int spb_type = 0;
 	uint8_t slot_12v_on, slot_prsnt;
-	uint32_t reg[LASTEST_REG];
+	uint32_t reg[LASTEST_REG] = {0};
+	phymem_region_t *scu, *gpio;
+	int i;
 
 	printf("Set up GPIO pins.....\n");
+	// SCU and GPIO registers are mapped once for all the accesses below
+	scu = phymem_region_open(SCU_BASE, SCU_REGION_SIZE);
+	gpio = phymem_region_open(GPIO_BASE, GPIO_REGION_SIZE);
+	if (scu == NULL || gpio == NULL) {
+		syslog(LOG_WARNING, "%s: cannot map SCU/GPIO registers", __func__);
+	}
+
 	// Read register initial value
-	phymem_get_dword(SCU_BASE, REG_SCU80, &reg[SCU80]);
-	phymem_get_dword(SCU_BASE, REG_SCU84, &reg[SCU84]);
-	phymem_get_dword(SCU_BASE, REG_SCU88, &reg[SCU88]);
-	phymem_get_dword(SCU_BASE, REG_SCU8C, &reg[SCU8C]);
-	phymem_get_dword(SCU_BASE, REG_SCU90, &reg[SCU90]);
-	phymem_get_dword(SCU_BASE, REG_SCU94, &reg[SCU94]);
-	phymem_get_dword(SCU_BASE, REG_SCU2C, &reg[SCU2C]);
-	phymem_get_dword(SCU_BASE, REG_SCUA0, &reg[SCUA0]);
-	phymem_get_dword(SCU_BASE, REG_SCUA4, &reg[SCUA4]);
-	phymem_get_dword(SCU_BASE, REG_SCUA8, &reg[SCUA8]);
+	for (i = 0; scu && i < LASTEST_REG; i++) {
+		phymem_region_read32(scu, scu_reg_offset[i], &reg[i]);
+	}
 
 	// To use GPIOE0~E5, SCU80[21:16] must be 0
 	// To use GPIOF0~F3, SCU80[27:24] must be 0
@@ -159,22 +177,17 @@ main(int argc, char **argv) {
 	// reserve GPIOAB2 for WDTRST1, SCUA8[2] must be 1
 	reg[SCUA8] &= ~(0x0000000A);
 #endif
-	phymem_set_dword(SCU_BASE, REG_SCU80, reg[SCU80]);
-	phymem_set_dword(SCU_BASE, REG_SCU84, reg[SCU84]);
-	phymem_set_dword(SCU_BASE, REG_SCU88, reg[SCU88]);
-	phymem_set_dword(SCU_BASE, REG_SCU8C, reg[SCU8C]);
-	phymem_set_dword(SCU_BASE, REG_SCU90, reg[SCU90]);
-	phymem_set_dword(SCU_BASE, REG_SCU94, reg[SCU94]);
-	phymem_set_dword(SCU_BASE, REG_SCU2C, reg[SCU2C]);
-	phymem_set_dword(SCU_BASE, REG_SCUA0, reg[SCUA0]);
-	phymem_set_dword(SCU_BASE, REG_SCUA4, reg[SCUA4]);
-	phymem_set_dword(SCU_BASE, REG_SCUA8, reg[SCUA8]);
+	for (i = 0; scu && i < LASTEST_REG; i++) {
+		phymem_region_write32(scu, scu_reg_offset[i], reg[i]);
+	}
 
 	// To use GPIOI0~GPIOI7, SCU70[13:12] must be 0
 	// To use GPIOD1, SCU70[21] shall be 0
 	// To use GPIOE0, GPIOE4, SCU70[22] must be 0
 	// To use GPIOB4, SCU70[23] must be 0
-	phymem_set_dword(SCU_BASE, REG_SCU7C, 0x00E03000);
+	if (scu) {
+		phymem_region_write32(scu, REG_SCU7C, 0x00E03000);
+	}
 
 	// SLOT1_PRSNT_N, GPIOAA0 (208)
 	gpio_export_by_name(ASPPED_CHIP, "GPIOAA0", "SLOT1_PRSNT_N");
@@ -524,25 +537,31 @@ main(int argc, char **argv) {
 	fby2_common_get_fan_type(); // initialize fan type
 
 	// Disable PWM reset during external reset
-	phymem_dword_clear_bit(SCU_BASE, REG_SCU9C, 17);
+	if (scu) {
+		phymem_region_update32(scu, REG_SCU9C, 1 << 17, 0);
+	}
 
 	// Disable PWM reset during WDT1 reset
 	phymem_dword_clear_bit(WDT_BASE, REG_WDT1_RESET, 17);
-	
-	// Set debounce timer #1 value to 0x179A7B0 ~= 2s
-	phymem_set_dword(GPIO_BASE, 0x50, 0x179A7B0);
-	
-	// Select debounce timer #1 for GPIOZ0~GPIOZ3 and GPIOAA0~GPIOAA3
-	phymem_set_dword(GPIO_BASE, 0x194, 0xF0F00);
-	
-	// Set debounce timer #2 value to 0xBCD3D8 ~= 1s
-	phymem_set_dword(GPIO_BASE, 0x54, 0xBCD3D8);
-	
-	// Select debounce timer #2 for GPIOP0~GPIOP3
-	phymem_set_dword(GPIO_BASE, 0x100, 0xF000000);
 
-	// Select debounce timer #2 for GPIOH5
-	phymem_set_dword(GPIO_BASE, 0x48, 0x20000000);
-	
+	if (gpio) {
+		// Set debounce timer #1 value to 0x179A7B0 ~= 2s
+		phymem_region_write32(gpio, 0x50, 0x179A7B0);
+
+		// Select debounce timer #1 for GPIOZ0~GPIOZ3 and GPIOAA0~GPIOAA3
+		phymem_region_write32(gpio, 0x194, 0xF0F00);
+
+		// Set debounce timer #2 value to 0xBCD3D8 ~= 1s
+		phymem_region_write32(gpio, 0x54, 0xBCD3D8);
+
+		// Select debounce timer #2 for GPIOP0~GPIOP3
+		phymem_region_write32(gpio, 0x100, 0xF000000);
+
+		// Select debounce timer #2 for GPIOH5
+		phymem_region_write32(gpio, 0x48, 0x20000000);
+	}
+
+	phymem_region_close(scu);
+	phymem_region_close(gpio);
 	return 0;
 }
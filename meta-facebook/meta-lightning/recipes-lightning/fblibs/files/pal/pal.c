@@ -1423,28 +1423,33 @@ pal_drive_status(const char* i2c_bus) {
   t_key_value_pair pdlu_decoding;
   t_key_value_pair vendor_decoding;
   t_key_value_pair sn_decoding;
+  int ret;
+
+  // one transaction for all the fields below, vendor ID and serial number
+  // are missing if ret is NVME_MGMT_ID_INVALID
+  ret = nvme_basic_mgmt_read(i2c_bus, &ssd);
 
-  if (nvme_vendor_read_decode(i2c_bus, &ssd.vendor, &vendor_decoding))
+  if (ret || nvme_vendor_decode(ssd.vendor, &vendor_decoding))
     printf("Fail on reading Vendor ID\n");
   else
     printf("%s: %s\n", vendor_decoding.key, vendor_decoding.value);
 
-  if (nvme_serial_num_read_decode(i2c_bus, ssd.serial_num, MAX_SERIAL_NUM, &sn_decoding))
+  if (ret || nvme_serial_num_decode(ssd.serial_num, &sn_decoding))
     printf("Fail on reading Serial Number\n");
   else
     printf("%s: %s\n", sn_decoding.key, sn_decoding.value);
 
-  if (nvme_temp_read_decode(i2c_bus, &ssd.temp, &temp_decoding))
+  if (ret < 0 || nvme_temp_decode(ssd.temp, &temp_decoding))
     printf("Fail on reading Composite Temperature\n");
   else
     printf("%s: %s\n", temp_decoding.key, temp_decoding.value);
 
-  if (nvme_pdlu_read_decode(i2c_bus, &ssd.pdlu, &pdlu_decoding))
+  if (ret < 0 || nvme_pdlu_decode(ssd.pdlu, &pdlu_decoding))
     printf("Fail on reading Percentage Drive Life Used\n");
   else
     printf("%s: %s\n", pdlu_decoding.key, pdlu_decoding.value);
 
-  if (nvme_sflgs_read_decode(i2c_bus, &ssd.sflgs, &status_flag_decoding))
+  if (ret < 0 || nvme_sflgs_decode(ssd.sflgs, &status_flag_decoding))
     printf("Fail on reading Status Flags\n");
   else {
     printf("%s: %s\n", status_flag_decoding.self.key, status_flag_decoding.self.value);
@@ -1456,7 +1461,7 @@ pal_drive_status(const char* i2c_bus) {
     printf("    %s: %s\n", status_flag_decoding.port1_link.key, status_flag_decoding.port1_link.value);
   }
 
-  if (nvme_smart_warning_read_decode(i2c_bus, &ssd.warning, &smart_warning_decoding))
+  if (ret < 0 || nvme_smart_warning_decode(ssd.warning, &smart_warning_decoding))
     printf("Fail on reading SMART Critical Warning\n");
   else {
     printf("%s: %s\n", smart_warning_decoding.self.key, smart_warning_decoding.self.value);
@@ -422,27 +422,24 @@ static int fan_controller_init_41(struct fan_controller *controller)
 }
 
 /*
- * Read an integer from the beginning of the file.
+ * Read an integer from the beginning of the file. The sensor, tacho and
+ * pwm files are accessed every control cycle, so their file descriptors
+ * are kept open by device_cache_read().
  * Return 0 for success, or errno on failures.
  */
 static int device_read_integer(const char *pathname, int *value)
 {
-  FILE *fp;
-  int rc, saved_errno;
+  int rc;
+  char data[64];
 
-  fp = fopen(pathname, "r");
-  if (fp == NULL) {
-    return errno;
+  rc = device_cache_read(pathname, data, sizeof(data));
+  if (rc != 0) {
+    return rc;
   }
 
-  rc = fscanf(fp, "%d", value);
-  if (rc != 1) {
-    saved_errno = errno;
-    fclose(fp);  /* ignore errors */
-    return saved_errno;
+  if (sscanf(data, "%d", value) != 1) {
+    return EINVAL;
   }
-
-  fclose(fp);
   return 0;
 }
 
@@ -451,25 +448,10 @@ static int device_read_integer(const char *pathname, int *value)
  * Return 0 for success, or errno on failures.
  */
 int device_write_integer(const char *pathname, int value) {
-  FILE *fp;
-  int rc, saved_errno;
   char data[64];
 
-  fp = fopen(pathname, "w");
-  if (!fp) {
-    return errno;
-  }
-
   snprintf(data, sizeof(data), "%d", value);
-  rc = fputs(data, fp);
-  if (rc < 0) {
-    saved_errno = errno;
-    fclose(fp); /* ignore errors */
-    return saved_errno;
-  }
-
-  fclose(fp);
-  return 0;
+  return device_cache_write(pathname, data);
 }
 
 static int file_read_line(const char *pathname, char *buf, size_t size)